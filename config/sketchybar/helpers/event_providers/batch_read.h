@@ -0,0 +1,467 @@
+#ifndef BATCH_READ_H
+#define BATCH_READ_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+// Numero massimo di sorgenti lette in un solo batch
+#define BATCH_MAX_SOURCES 64
+// Lunghezza massima di un percorso di una sorgente, prefisso incluso
+#define BATCH_PATH_LENGTH 512
+
+/**
+ * Prefisso dei percorsi procfs/sysfs dei collettori Linux.
+ *
+ * Vuoto in produzione; la variabile d'ambiente SKETCHYBAR_PROC_ROOT o
+ * batch_set_root lo puntano a una directory di fixture che riproduce
+ * proc/ e sys/, per misurare i collettori su forme di macchina che non si
+ * hanno a disposizione.
+ */
+static char g_batch_root[BATCH_PATH_LENGTH];
+static bool g_batch_root_set = false;
+
+/**
+ * Imposta il prefisso dei percorsi
+ *
+ * @param root Directory radice, NULL o "" per il filesystem reale
+ */
+static inline void batch_set_root(const char* root) {
+  snprintf(g_batch_root, sizeof(g_batch_root), "%s", root ? root : "");
+  // "/" finale superfluo: i percorsi dei collettori iniziano già con "/"
+  size_t length = strlen(g_batch_root);
+  while (length > 0 && g_batch_root[length - 1] == '/')
+    g_batch_root[--length] = '\0';
+  g_batch_root_set = true;
+}
+
+/**
+ * Compone il percorso di una sorgente con il prefisso corrente
+ *
+ * @param buffer Buffer di output
+ * @param size Dimensione del buffer
+ * @param path Percorso assoluto sul sistema reale, ad esempio "/proc/stat"
+ * @return true se il percorso non è stato troncato
+ */
+[[nodiscard]] static inline bool batch_path(char* buffer, size_t size, const char* path) {
+  if (!g_batch_root_set)
+    batch_set_root(getenv("SKETCHYBAR_PROC_ROOT"));
+
+  int written = snprintf(buffer, size, "%s%s", g_batch_root, path);
+  return written >= 0 && (size_t)written < size;
+}
+
+/**
+ * Un file di procfs/sysfs riletto a ogni tick dall'offset 0.
+ *
+ * Il file resta aperto e il buffer è allocato una volta: il contenuto letto
+ * è sempre terminato da '\0', così il parser del collettore può usare le
+ * funzioni sulle stringhe. Se un file riempie il buffer, il buffer raddoppia.
+ */
+struct batch_source {
+  int     fd;
+  char*   buffer;
+  size_t  size;
+  ssize_t length; // Byte letti all'ultimo tick, -1 in caso di errore
+};
+
+/**
+ * Apre una sorgente
+ *
+ * @param source Sorgente da inizializzare
+ * @param path Percorso del file
+ * @param size Dimensione iniziale del buffer
+ * @return true in caso di successo
+ */
+[[nodiscard]] static inline bool batch_source_open(struct batch_source* source, const char* path, size_t size) {
+  memset(source, 0, sizeof(struct batch_source));
+  source->length = -1;
+
+  source->fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (source->fd < 0)
+    return false;
+
+  source->buffer = malloc(size);
+  if (!source->buffer) {
+    close(source->fd);
+    source->fd = -1;
+    return false;
+  }
+  source->size = size;
+  return true;
+}
+
+/**
+ * Raddoppia il buffer di una sorgente troncata
+ *
+ * @return true se il buffer è cresciuto
+ */
+[[nodiscard]] static inline bool batch_source_grow(struct batch_source* source) {
+  char* buffer = realloc(source->buffer, source->size * 2);
+  if (!buffer)
+    return false;
+  source->buffer = buffer;
+  source->size *= 2;
+  return true;
+}
+
+/**
+ * Rilegge una sorgente con pread, facendo crescere il buffer se serve
+ *
+ * @param source Sorgente da leggere
+ * @param syscalls Contatore delle chiamate di sistema, può essere NULL
+ * @return true se la lettura è riuscita
+ */
+static inline bool batch_source_pread(struct batch_source* source, uint64_t* syscalls) {
+  for (;;) {
+    source->length = pread(source->fd, source->buffer, source->size - 1, 0);
+    if (syscalls)
+      (*syscalls)++;
+    if (source->length < 0)
+      return false;
+    if ((size_t)source->length < source->size - 1 || !batch_source_grow(source))
+      break;
+  }
+  source->buffer[source->length] = '\0';
+  return true;
+}
+
+/**
+ * Chiude una sorgente
+ */
+static inline void batch_source_close(struct batch_source* source) {
+  if (source->fd >= 0)
+    close(source->fd);
+  free(source->buffer);
+  memset(source, 0, sizeof(struct batch_source));
+  source->fd = -1;
+}
+
+#ifdef __linux__
+/**
+ * Ring io_uring mappato a mano, senza liburing
+ */
+struct batch_ring {
+  int fd;
+
+  unsigned*            sq_head;
+  unsigned*            sq_tail;
+  unsigned*            sq_mask;
+  unsigned*            sq_array;
+  struct io_uring_sqe* sqes;
+
+  unsigned*            cq_head;
+  unsigned*            cq_tail;
+  unsigned*            cq_mask;
+  struct io_uring_cqe* cqes;
+
+  void*  sq_ring;
+  size_t sq_ring_size;
+  void*  cq_ring;
+  size_t cq_ring_size;
+  size_t sqes_size;
+};
+#endif
+
+/**
+ * Stadio di raccolta: a ogni tick rilegge tutte le sorgenti registrate.
+ *
+ * Con io_uring (solo Linux) fd e buffer sono registrati una volta sola, le
+ * letture di un tick partono in un unico io_uring_enter e i completamenti si
+ * raccolgono insieme; altrimenti, o se il kernel non lo consente, una pread
+ * per sorgente. In entrambi i casi dopo batch_reader_read ogni collettore fa
+ * il parse del proprio buffer.
+ */
+struct batch_reader {
+  struct batch_source* sources[BATCH_MAX_SOURCES];
+  int                  count;
+  bool                 uring;
+  bool                 registered; // fd e buffer registrati nel ring
+
+  uint64_t syscalls; // Chiamate di sistema di lettura dall'avvio
+  uint64_t ticks;
+
+#ifdef __linux__
+  struct batch_ring ring;
+#endif
+};
+
+/**
+ * Inizializza uno stadio di raccolta vuoto
+ */
+static inline void batch_reader_init(struct batch_reader* reader) {
+  memset(reader, 0, sizeof(struct batch_reader));
+#ifdef __linux__
+  reader->ring.fd = -1;
+#endif
+}
+
+/**
+ * Aggiunge una sorgente già aperta; va chiamata prima di batch_reader_start
+ *
+ * @return true se la sorgente è stata registrata
+ */
+[[nodiscard]] static inline bool batch_reader_add(struct batch_reader* reader, struct batch_source* source) {
+  if (!source || source->fd < 0 || reader->count >= BATCH_MAX_SOURCES)
+    return false;
+  reader->sources[reader->count++] = source;
+  return true;
+}
+
+#ifdef __linux__
+/**
+ * Registra fd e buffer delle sorgenti nel ring (file e buffer fissi)
+ */
+[[nodiscard]] static inline bool batch_ring_register(struct batch_reader* reader) {
+  int          fds[BATCH_MAX_SOURCES];
+  struct iovec iovecs[BATCH_MAX_SOURCES];
+  for (int i = 0; i < reader->count; i++) {
+    fds[i]    = reader->sources[i]->fd;
+    iovecs[i] = (struct iovec){.iov_base = reader->sources[i]->buffer, .iov_len = reader->sources[i]->size};
+  }
+
+  if (reader->registered) {
+    syscall(__NR_io_uring_register, reader->ring.fd, IORING_UNREGISTER_BUFFERS, NULL, 0);
+    syscall(__NR_io_uring_register, reader->ring.fd, IORING_UNREGISTER_FILES, NULL, 0);
+    reader->registered = false;
+  }
+
+  if (syscall(__NR_io_uring_register, reader->ring.fd, IORING_REGISTER_FILES, fds, reader->count) < 0)
+    return false;
+  if (syscall(__NR_io_uring_register, reader->ring.fd, IORING_REGISTER_BUFFERS, iovecs, reader->count) < 0) {
+    syscall(__NR_io_uring_register, reader->ring.fd, IORING_UNREGISTER_FILES, NULL, 0);
+    return false;
+  }
+
+  reader->registered = true;
+  return true;
+}
+
+/**
+ * Libera il ring
+ */
+static inline void batch_ring_cleanup(struct batch_ring* ring) {
+  if (ring->sqes)
+    munmap(ring->sqes, ring->sqes_size);
+  if (ring->cq_ring && ring->cq_ring != ring->sq_ring)
+    munmap(ring->cq_ring, ring->cq_ring_size);
+  if (ring->sq_ring)
+    munmap(ring->sq_ring, ring->sq_ring_size);
+  if (ring->fd >= 0)
+    close(ring->fd);
+  memset(ring, 0, sizeof(struct batch_ring));
+  ring->fd = -1;
+}
+
+/**
+ * Crea il ring e mappa code di invio, di completamento e SQE
+ */
+[[nodiscard]] static inline bool batch_ring_setup(struct batch_ring* ring, unsigned entries) {
+  struct io_uring_params params = {0};
+
+  ring->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+  if (ring->fd < 0)
+    return false;
+
+  ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  bool single_mmap   = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_mmap && ring->cq_ring_size > ring->sq_ring_size)
+    ring->sq_ring_size = ring->cq_ring_size;
+
+  ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+  if (ring->sq_ring == MAP_FAILED) {
+    ring->sq_ring = NULL;
+    batch_ring_cleanup(ring);
+    return false;
+  }
+
+  if (single_mmap) {
+    ring->cq_ring = ring->sq_ring;
+  } else {
+    ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+    if (ring->cq_ring == MAP_FAILED) {
+      ring->cq_ring = NULL;
+      batch_ring_cleanup(ring);
+      return false;
+    }
+  }
+
+  ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+  ring->sqes      = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+  if (ring->sqes == MAP_FAILED) {
+    ring->sqes = NULL;
+    batch_ring_cleanup(ring);
+    return false;
+  }
+
+  char* sq       = ring->sq_ring;
+  char* cq       = ring->cq_ring;
+  ring->sq_head  = (unsigned*)(sq + params.sq_off.head);
+  ring->sq_tail  = (unsigned*)(sq + params.sq_off.tail);
+  ring->sq_mask  = (unsigned*)(sq + params.sq_off.ring_mask);
+  ring->sq_array = (unsigned*)(sq + params.sq_off.array);
+  ring->cq_head  = (unsigned*)(cq + params.cq_off.head);
+  ring->cq_tail  = (unsigned*)(cq + params.cq_off.tail);
+  ring->cq_mask  = (unsigned*)(cq + params.cq_off.ring_mask);
+  ring->cqes     = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+  return true;
+}
+
+/**
+ * Un tick con io_uring: accoda una READ_FIXED per sorgente, un solo enter
+ * per inviarle e attenderle, poi raccoglie i completamenti
+ *
+ * @return Numero di sorgenti lette, -1 se il ring non è utilizzabile
+ */
+[[nodiscard]] static inline int batch_ring_read(struct batch_reader* reader) {
+  struct batch_ring* ring = &reader->ring;
+  unsigned           mask = *ring->sq_mask;
+  unsigned           tail = *ring->sq_tail;
+
+  for (int i = 0; i < reader->count; i++) {
+    struct batch_source* source = reader->sources[i];
+    unsigned             index  = tail & mask;
+    struct io_uring_sqe* sqe    = &ring->sqes[index];
+
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    sqe->opcode    = IORING_OP_READ_FIXED;
+    sqe->flags     = IOSQE_FIXED_FILE;
+    sqe->fd        = i;
+    sqe->addr      = (uint64_t)(uintptr_t)source->buffer;
+    sqe->len       = (uint32_t)(source->size - 1);
+    sqe->off       = 0;
+    sqe->buf_index = (uint16_t)i;
+    sqe->user_data = (uint64_t)i;
+
+    ring->sq_array[index] = index;
+    tail++;
+  }
+  __atomic_store_n(ring->sq_tail, tail, __ATOMIC_RELEASE);
+
+  int submitted = 0;
+  int completed = 0;
+  while (completed < reader->count) {
+    long result = syscall(
+        __NR_io_uring_enter, ring->fd, (unsigned)(reader->count - submitted), (unsigned)(reader->count - completed),
+        IORING_ENTER_GETEVENTS, NULL, 0);
+    reader->syscalls++;
+    if (result < 0) {
+      if (errno == EINTR)
+        continue;
+      return -1;
+    }
+    submitted += (int)result;
+
+    unsigned head = *ring->cq_head;
+    unsigned end  = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != end; head++, completed++) {
+      struct io_uring_cqe* cqe = &ring->cqes[head & *ring->cq_mask];
+      if (cqe->user_data < (uint64_t)reader->count)
+        reader->sources[cqe->user_data]->length = cqe->res < 0 ? -1 : cqe->res;
+    }
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+  }
+
+  // Le sorgenti troncate crescono e si rileggono subito; i nuovi buffer vanno registrati
+  int  ok         = 0;
+  bool reregister = false;
+  for (int i = 0; i < reader->count; i++) {
+    struct batch_source* source = reader->sources[i];
+    if (source->length >= 0 && (size_t)source->length == source->size - 1) {
+      reregister |= batch_source_pread(source, &reader->syscalls);
+    } else if (source->length >= 0) {
+      source->buffer[source->length] = '\0';
+    }
+    ok += source->length >= 0;
+  }
+
+  if (reregister && !batch_ring_register(reader))
+    return -1;
+  return ok;
+}
+#endif
+
+/**
+ * Prepara lo stadio di raccolta dopo l'ultima batch_reader_add
+ *
+ * @param reader Stadio di raccolta
+ * @param use_uring Prova io_uring; se non disponibile resta pread
+ * @return true se io_uring è attivo
+ */
+static inline bool batch_reader_start(struct batch_reader* reader, bool use_uring) {
+  reader->uring = false;
+#ifdef __linux__
+  if (!use_uring || reader->count == 0)
+    return false;
+
+  if (!batch_ring_setup(&reader->ring, BATCH_MAX_SOURCES))
+    return false;
+
+  if (!batch_ring_register(reader)) {
+    batch_ring_cleanup(&reader->ring);
+    return false;
+  }
+  reader->uring = true;
+#else
+  (void)use_uring;
+#endif
+  return reader->uring;
+}
+
+/**
+ * Rilegge tutte le sorgenti registrate
+ *
+ * @param reader Stadio di raccolta
+ * @return Numero di sorgenti lette con successo
+ */
+static inline int batch_reader_read(struct batch_reader* reader) {
+  reader->ticks++;
+
+#ifdef __linux__
+  if (reader->uring) {
+    int ok = batch_ring_read(reader);
+    if (ok >= 0)
+      return ok;
+
+    // Ring non più utilizzabile: da qui in poi pread
+    fprintf(stderr, "io_uring non disponibile (%s), uso pread\n", strerror(errno));
+    batch_ring_cleanup(&reader->ring);
+    reader->uring      = false;
+    reader->registered = false;
+  }
+#endif
+
+  int ok = 0;
+  for (int i = 0; i < reader->count; i++)
+    ok += batch_source_pread(reader->sources[i], &reader->syscalls);
+  return ok;
+}
+
+/**
+ * Libera il ring; le sorgenti restano dei collettori
+ */
+static inline void batch_reader_cleanup(struct batch_reader* reader) {
+#ifdef __linux__
+  if (reader->uring || reader->ring.fd >= 0)
+    batch_ring_cleanup(&reader->ring);
+#endif
+  reader->uring      = false;
+  reader->registered = false;
+  reader->count      = 0;
+}
+
+#endif /* BATCH_READ_H */
@@ -0,0 +1,552 @@
+#include "../batch_read.h"
+#include "../cadence.h"
+#include "../cpu_load/cpu.h"
+#include "../network_load/network.h"
+#include "../proc_top/proc.h"
+#include <dirent.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <time.h>
+
+// Valori predefiniti del benchmark
+static const int BENCH_TICKS = 2000;
+// Una scansione dei processi costa quanto cento tick degli altri collettori
+static const int BENCH_PROC_RATIO = 100;
+// Forma predefinita delle fixture: macchina molto più grande di un portatile
+static const int FIXTURE_CORES      = 256;
+static const int FIXTURE_INTERFACES = 500;
+static const int FIXTURE_PROCESSES  = 20000;
+// Misura dell'allineamento: provider simulati, periodo e durata di ogni modalità
+static const int CADENCE_PROVIDERS = 7;
+static const int CADENCE_PERIOD_MS = 500;
+static const int CADENCE_SECONDS   = 5;
+// Pubblicazioni entro un frame della barra (60 Hz) producono un solo ridisegno,
+// scadenze dei timer entro un millisecondo un solo risveglio del sistema
+static const uint64_t CADENCE_FRAME_NS  = 16666667;
+static const uint64_t CADENCE_WAKEUP_NS = 1000000;
+#define CADENCE_MAX_PROVIDERS 64
+// Sorgenti dell'alimentazione lette per ogni batteria/alimentatore
+static const char* POWER_SUPPLY_FILES[] = {"capacity", "status", "online"};
+
+/**
+ * Mostra le istruzioni per l'uso del programma
+ */
+static void show_usage(const char* program_name) {
+  if (!program_name)
+    program_name = "bench";
+  printf("Usage: %s [--root \"<dir>\"] [\"<ticks>\"] [\"<interface>\"]\n", program_name);
+  printf("       %s --fixture \"<dir>\" [\"<cores>\" \"<interfaces>\" \"<processes>\"]\n", program_name);
+  printf("       %s --cadence [\"<providers>\" \"<period_ms>\" \"<seconds>\"]\n", program_name);
+  printf("  Misura il costo per tick di cpu_update, network_update e della scansione\n");
+  printf("  dei processi, poi chiamate di sistema e CPU della raccolta batch con una\n");
+  printf("  pread per sorgente e con io_uring\n");
+  printf("  --root: legge proc/ e sys/ da una directory di fixture\n");
+  printf("  --fixture: genera una fixture (predefinita: %d core, %d interfacce, %d processi)\n", FIXTURE_CORES, FIXTURE_INTERFACES,
+         FIXTURE_PROCESSES);
+  printf("  --cadence: conta ridisegni e risvegli di provider simulati con attese libere e\n");
+  printf("             allineate (predefinita: %d provider, %d ms, %d s per modalità)\n", CADENCE_PROVIDERS, CADENCE_PERIOD_MS,
+         CADENCE_SECONDS);
+}
+
+/**
+ * Tempo CPU (utente + sistema) del processo, thread del kernel io_uring inclusi
+ */
+[[nodiscard]] static uint64_t process_cpu_us() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) < 0)
+    return 0;
+
+  return (uint64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000ull
+       + (uint64_t)(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+}
+
+/**
+ * Tempo monotono corrente in nanosecondi
+ */
+[[nodiscard]] static uint64_t monotonic_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * Sorgenti di una raccolta completa: i collettori cpu e network più
+ * /proc/meminfo e i file di power_supply, letti ma non ancora interpretati
+ */
+struct collection {
+  struct cpu          cpu;
+  struct network      network;
+  bool                network_ok;
+  struct batch_source extra[BATCH_MAX_SOURCES];
+  int                 extra_count;
+};
+
+static void collection_add_extra(struct collection* collection, const char* path) {
+  if (collection->extra_count >= BATCH_MAX_SOURCES - 2)
+    return;
+  if (batch_source_open(&collection->extra[collection->extra_count], path, 4096))
+    collection->extra_count++;
+}
+
+/**
+ * Apre tutte le sorgenti della raccolta
+ */
+[[nodiscard]] static bool collection_open(struct collection* collection, char* ifname) {
+  memset(collection, 0, sizeof(struct collection));
+
+  cpu_init(&collection->cpu);
+  if (collection->cpu.source.fd < 0)
+    return false;
+
+  collection->network_ok = network_init(&collection->network, ifname) == 0;
+  collection_add_extra(collection, "/proc/meminfo");
+
+  char root[BATCH_PATH_LENGTH];
+  DIR* supplies = batch_path(root, sizeof(root), "/sys/class/power_supply") ? opendir(root) : NULL;
+  if (supplies) {
+    struct dirent* entry;
+    while ((entry = readdir(supplies)) != NULL) {
+      if (entry->d_name[0] == '.')
+        continue;
+      for (size_t i = 0; i < sizeof(POWER_SUPPLY_FILES) / sizeof(POWER_SUPPLY_FILES[0]); i++) {
+        char path[BATCH_PATH_LENGTH * 2];
+        snprintf(path, sizeof(path), "%s/%s/%s", root, entry->d_name, POWER_SUPPLY_FILES[i]);
+        if (access(path, R_OK) == 0)
+          collection_add_extra(collection, path);
+      }
+    }
+    closedir(supplies);
+  }
+  return true;
+}
+
+static void collection_close(struct collection* collection) {
+  batch_source_close(&collection->cpu.source);
+  if (collection->network_ok)
+    batch_source_close(&collection->network.source);
+  for (int i = 0; i < collection->extra_count; i++)
+    batch_source_close(&collection->extra[i]);
+}
+
+/**
+ * Esegue ticks raccolte complete e stampa il costo per tick
+ *
+ * @param ticks Numero di tick
+ * @param ifname Interfaccia del collettore network
+ * @param use_uring Raccolta con io_uring invece di pread
+ * @return true se la modalità richiesta è stata misurata
+ */
+static bool run_mode(int ticks, char* ifname, bool use_uring) {
+  struct collection collection;
+  if (!collection_open(&collection, ifname)) {
+    fprintf(stderr, "Impossibile aprire le sorgenti\n");
+    return false;
+  }
+
+  struct batch_reader reader;
+  batch_reader_init(&reader);
+  (void)batch_reader_add(&reader, &collection.cpu.source);
+  if (collection.network_ok)
+    (void)batch_reader_add(&reader, &collection.network.source);
+  for (int i = 0; i < collection.extra_count; i++)
+    (void)batch_reader_add(&reader, &collection.extra[i]);
+
+  bool uring = batch_reader_start(&reader, use_uring);
+  if (use_uring && !uring) {
+    printf("uring: non disponibile (%s), vedi pread\n", strerror(errno));
+    batch_reader_cleanup(&reader);
+    collection_close(&collection);
+    return false;
+  }
+
+  // Un tick di riscaldamento: crescita dei buffer e registrazione fuori dalla misura
+  (void)batch_reader_read(&reader);
+
+  uint64_t syscalls = reader.syscalls;
+  uint64_t cpu      = process_cpu_us();
+  uint64_t wall     = monotonic_ns();
+  int      failed   = 0;
+
+  for (int i = 0; i < ticks; i++) {
+    if (batch_reader_read(&reader) != reader.count)
+      failed++;
+
+    // Parse di ogni collettore sul proprio buffer
+    cpu_parse(&collection.cpu);
+    if (collection.network_ok)
+      network_parse(&collection.network);
+  }
+
+  double wall_us = (double)(monotonic_ns() - wall) / 1000.0;
+  double cpu_us  = (double)(process_cpu_us() - cpu);
+
+  printf(
+      "%-6s %2d sorgenti  %6.2f syscall/tick  %8.2f us cpu/tick  %8.2f us/tick  (%d tick con errori)\n", uring ? "uring" : "pread",
+      reader.count, (double)(reader.syscalls - syscalls) / ticks, cpu_us / ticks, wall_us / ticks, failed);
+
+  batch_reader_cleanup(&reader);
+  collection_close(&collection);
+  return true;
+}
+
+/**
+ * Costo per tick dei singoli collettori, ciascuno con la propria pread
+ *
+ * @param ticks Numero di tick di cpu_update e network_update
+ * @param ifname Interfaccia del collettore network
+ */
+static void run_collectors(int ticks, char* ifname) {
+  struct cpu cpu;
+  cpu_init(&cpu);
+  if (cpu.source.fd >= 0) {
+    uint64_t start = process_cpu_us();
+    uint64_t wall  = monotonic_ns();
+    for (int i = 0; i < ticks; i++)
+      cpu_update(&cpu);
+    printf(
+        "cpu_update      %8.2f us cpu/tick  %8.2f us/tick  (%zu byte letti)\n", (double)(process_cpu_us() - start) / ticks,
+        (double)(monotonic_ns() - wall) / 1000.0 / ticks, (size_t)cpu.source.length);
+    batch_source_close(&cpu.source);
+  }
+
+  struct network network;
+  if (network_init(&network, ifname) == 0) {
+    uint64_t start = process_cpu_us();
+    uint64_t wall  = monotonic_ns();
+    for (int i = 0; i < ticks; i++)
+      network_update(&network);
+    printf(
+        "network_update  %8.2f us cpu/tick  %8.2f us/tick  (%zu byte letti)\n", (double)(process_cpu_us() - start) / ticks,
+        (double)(monotonic_ns() - wall) / 1000.0 / ticks, (size_t)network.source.length);
+    batch_source_close(&network.source);
+  }
+
+  struct proc proc;
+  if (proc_init(&proc, 5) == 0) {
+    int proc_ticks = ticks / BENCH_PROC_RATIO > 3 ? ticks / BENCH_PROC_RATIO : 3;
+
+    // La prima scansione apre gli fd di stat: costo misurato a parte
+    uint64_t wall = monotonic_ns();
+    proc_update(&proc);
+    double first_us = (double)(monotonic_ns() - wall) / 1000.0;
+
+    uint64_t start = process_cpu_us();
+    wall           = monotonic_ns();
+    for (int i = 0; i < proc_ticks; i++)
+      proc_update(&proc);
+    printf(
+        "proc_update     %8.2f us cpu/tick  %8.2f us/tick  (%d processi, %zu fd in cache, prima scansione %.0f us)\n",
+        (double)(process_cpu_us() - start) / proc_ticks, (double)(monotonic_ns() - wall) / 1000.0 / proc_ticks, proc.process_count,
+        proc.cached_fds, first_us);
+    proc_cleanup(&proc);
+  }
+}
+
+/**
+ * Un provider simulato: parte con un ritardo casuale, come un provider
+ * lanciato dalla configurazione, e a ogni tick lavora work_ns prima di
+ * pubblicare
+ */
+struct cadence_provider {
+  pthread_t thread;
+  double    period;
+  uint64_t  delay_ns;
+  uint64_t  work_ns;
+  uint64_t  start_ns; // Inizio della misura: tutti i provider sono partiti
+  uint64_t  stop_ns;
+  uint64_t* woken;     // Scadenze dei timer da cui il provider si è svegliato
+  uint64_t* published; // Istanti delle pubblicazioni
+  int       count;
+  int       capacity;
+  uint64_t  skipped;
+};
+
+static void* cadence_provider_run(void* argument) {
+  struct cadence_provider* provider = argument;
+  struct cadence           cadence;
+  cadence_init(&cadence, provider->period);
+  cadence_sleep_until(cadence_now_ns() + provider->delay_ns);
+
+  for (uint64_t now = cadence_now_ns(); now < provider->stop_ns; now = cadence_now_ns()) {
+    // Campionamento e formattazione: lavoro attivo, non un'attesa
+    while (cadence_now_ns() - now < provider->work_ns) {
+    }
+    if (now >= provider->start_ns && provider->count < provider->capacity) {
+      // Con un solo core i thread svegliati insieme girano in fila: conta il timer, non l'ordine di esecuzione
+      provider->woken[provider->count]       = cadence.deadline_ns ? cadence.deadline_ns : now;
+      provider->published[provider->count++] = cadence_now_ns();
+    }
+    cadence_wait(&cadence);
+  }
+  provider->skipped = cadence.skipped;
+  return NULL;
+}
+
+static int compare_u64(const void* a, const void* b) {
+  uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+  return x < y ? -1 : x > y;
+}
+
+/**
+ * Conta i gruppi di istanti ordinati: un istante entro window_ns dal primo
+ * del gruppo corrente vi si aggiunge
+ */
+static int count_groups(const uint64_t* times, int count, uint64_t window_ns) {
+  int groups = 0;
+  for (int i = 0, first = 0; i < count; i++) {
+    if (i == 0 || times[i] - times[first] >= window_ns) {
+      groups++;
+      first = i;
+    }
+  }
+  return groups;
+}
+
+/**
+ * Esegue i provider simulati in una modalità e ne stampa ridisegni e risvegli.
+ * Il primo periodo, con le partenze sparse, resta fuori dalla misura.
+ *
+ * @return Numero di frame della barra con almeno una pubblicazione
+ */
+static int run_cadence_mode(int providers, int period_ms, int seconds, bool aligned, int* wakeups) {
+  // La configurazione normalmente viene dall'ambiente: qui si alternano le due modalità
+  g_cadence_settings = (struct cadence_settings){.state = 1, .aligned = aligned};
+
+  static struct cadence_provider provider[CADENCE_MAX_PROVIDERS];
+  int                            capacity = seconds * 1000 / period_ms + 2;
+  uint64_t*                      woken    = malloc((size_t)(providers * capacity) * sizeof(uint64_t));
+  uint64_t*                      all      = malloc((size_t)(providers * capacity) * sizeof(uint64_t));
+  uint64_t                       start_ns = cadence_now_ns() + (uint64_t)period_ms * 1000000ull;
+  uint64_t                       stop_ns  = start_ns + (uint64_t)seconds * 1000000000ull;
+  if (!woken || !all) {
+    free(woken);
+    free(all);
+    *wakeups = 0;
+    return 0;
+  }
+  srand48(42);
+  for (int i = 0; i < providers; i++) {
+    provider[i] = (struct cadence_provider){
+        .period    = period_ms / 1000.0,
+        .delay_ns  = (uint64_t)(drand48() * period_ms * 1e6),
+        .work_ns   = 100000 + (uint64_t)(drand48() * 1900000),
+        .start_ns  = start_ns,
+        .stop_ns   = stop_ns,
+        .woken     = woken + (size_t)i * (size_t)capacity,
+        .published = all + (size_t)i * (size_t)capacity,
+        .capacity  = capacity,
+    };
+    pthread_create(&provider[i].thread, NULL, cadence_provider_run, &provider[i]);
+  }
+
+  int      count   = 0;
+  uint64_t skipped = 0;
+  for (int i = 0; i < providers; i++) {
+    pthread_join(provider[i].thread, NULL);
+    memmove(woken + count, provider[i].woken, (size_t)provider[i].count * sizeof(uint64_t));
+    memmove(all + count, provider[i].published, (size_t)provider[i].count * sizeof(uint64_t));
+    count += provider[i].count;
+    skipped += provider[i].skipped;
+  }
+  qsort(woken, (size_t)count, sizeof(uint64_t), compare_u64);
+  qsort(all, (size_t)count, sizeof(uint64_t), compare_u64);
+
+  int frames = count_groups(all, count, CADENCE_FRAME_NS);
+  *wakeups   = count_groups(woken, count, CADENCE_WAKEUP_NS);
+  printf(
+      "%-10s %6d pubblicazioni  %6d ridisegni  %6d risvegli  %4.1f ridisegni/periodo  (%llu scadenze saltate)\n",
+      aligned ? "allineata" : "libera", count, frames, *wakeups, (double)frames * period_ms / (seconds * 1000.0),
+      (unsigned long long)skipped);
+  free(woken);
+  free(all);
+  return frames;
+}
+
+/**
+ * Confronta attese libere e allineate sugli stessi provider simulati
+ */
+static int run_cadence(int providers, int period_ms, int seconds) {
+  if (providers <= 0 || providers > CADENCE_MAX_PROVIDERS || period_ms <= 0 || seconds <= 0) {
+    fprintf(stderr, "Parametri non validi: 1-%d provider, periodo e durata positivi\n", CADENCE_MAX_PROVIDERS);
+    return 1;
+  }
+
+  printf("cadence: %d provider, periodo %d ms, %d s per modalità\n", providers, period_ms, seconds);
+  int free_wakeups, aligned_wakeups;
+  int free_frames    = run_cadence_mode(providers, period_ms, seconds, false, &free_wakeups);
+  int aligned_frames = run_cadence_mode(providers, period_ms, seconds, true, &aligned_wakeups);
+  if (free_frames > 0 && free_wakeups > 0)
+    printf(
+        "riduzione  ridisegni %.0f%%, risvegli %.0f%%\n", 100.0 * (free_frames - aligned_frames) / free_frames,
+        100.0 * (free_wakeups - aligned_wakeups) / free_wakeups);
+  return 0;
+}
+
+/**
+ * Scrive un file della fixture creando le directory intermedie
+ */
+static bool fixture_write(const char* root, const char* path, const char* content, size_t length) {
+  char full[BATCH_PATH_LENGTH * 2];
+  snprintf(full, sizeof(full), "%s/%s", root, path);
+
+  for (char* slash = strchr(full + strlen(root) + 1, '/'); slash; slash = strchr(slash + 1, '/')) {
+    *slash = '\0';
+    mkdir(full, 0755);
+    *slash = '/';
+  }
+
+  FILE* file = fopen(full, "w");
+  if (!file) {
+    fprintf(stderr, "Impossibile scrivere %s: %s\n", full, strerror(errno));
+    return false;
+  }
+  bool ok = fwrite(content, 1, length, file) == length;
+  return fclose(file) == 0 && ok;
+}
+
+/**
+ * Buffer di testo che cresce, per comporre i file della fixture
+ */
+struct fixture_text {
+  char*  data;
+  size_t length;
+  size_t capacity;
+};
+
+[[gnu::format(printf, 2, 3)]] static void fixture_printf(struct fixture_text* text, const char* format, ...) {
+  for (;;) {
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(text->data + text->length, text->capacity - text->length, format, args);
+    va_end(args);
+
+    if (written < 0)
+      return;
+    if ((size_t)written < text->capacity - text->length) {
+      text->length += (size_t)written;
+      return;
+    }
+
+    size_t capacity = text->capacity * 2 + (size_t)written + 1;
+    char*  data     = realloc(text->data, capacity);
+    if (!data)
+      return;
+    text->data     = data;
+    text->capacity = capacity;
+  }
+}
+
+/**
+ * Genera una fixture proc/ e sys/ con la forma richiesta
+ *
+ * @param root Directory di destinazione
+ * @param cores Core in /proc/stat
+ * @param interfaces Interfacce in /proc/net/dev, lo compresa
+ * @param processes Directory /proc/<pid>
+ * @return Exit status
+ */
+static int generate_fixture(const char* root, int cores, int interfaces, int processes) {
+  mkdir(root, 0755);
+  struct fixture_text text = {0};
+  bool                ok   = true;
+
+  // /proc/stat: riga aggregata, una riga per core, poi intr con molte sorgenti come sui server
+  fixture_printf(&text, "cpu  %d 0 %d %d 0 0 0 0 0 0\n", cores * 1000, cores * 400, cores * 8000);
+  for (int i = 0; i < cores; i++)
+    fixture_printf(&text, "cpu%d %d %d %d %d %d %d %d 0 0 0\n", i, 1000 + i, i % 7, 400 + i, 8000 + i, i % 13, 0, i % 5);
+  fixture_printf(&text, "intr %d", cores * 100000);
+  for (int i = 0; i < cores * 4; i++)
+    fixture_printf(&text, " %d", i % 3 ? 0 : i * 17);
+  fixture_printf(&text, "\nctxt 123456789\nbtime 1700000000\nprocesses %d\nprocs_running 4\nprocs_blocked 0\n", processes);
+  fixture_printf(&text, "softirq 0 0 0 0 0 0 0 0 0 0 0\n");
+  ok &= fixture_write(root, "proc/stat", text.data, text.length);
+
+  // /proc/net/dev: l'ultima interfaccia è quella predefinita del benchmark
+  text.length = 0;
+  fixture_printf(&text, "Inter-|   Receive                                                |  Transmit\n");
+  fixture_printf(
+      &text, " face |bytes    packets errs drop fifo frame compressed multicast|bytes    packets errs drop fifo colls carrier compressed\n");
+  fixture_printf(&text, "    lo: 14379290    1906    0    0    0     0          0         0 14379290    1906    0    0    0     0       0          0\n");
+  for (int i = 1; i < interfaces; i++)
+    fixture_printf(
+        &text, "veth%04d: %llu %d 0 0 0 0 0 0 %llu %d 0 0 0 0 0 0\n", i, (unsigned long long)i * 1048576ull, i * 10,
+        (unsigned long long)i * 524288ull, i * 7);
+  ok &= fixture_write(root, "proc/net/dev", text.data, text.length);
+
+  text.length = 0;
+  fixture_printf(&text, "MemTotal:       %d kB\nMemFree:        %d kB\nMemAvailable:   %d kB\n", cores * 4194304, cores * 1048576,
+                 cores * 2097152);
+  fixture_printf(&text, "Buffers:          123456 kB\nCached:         7654321 kB\nSwapCached:            0 kB\n");
+  ok &= fixture_write(root, "proc/meminfo", text.data, text.length);
+
+  ok &= fixture_write(root, "sys/class/power_supply/BAT0/capacity", "87\n", 3);
+  ok &= fixture_write(root, "sys/class/power_supply/BAT0/status", "Discharging\n", 12);
+  ok &= fixture_write(root, "sys/class/power_supply/AC/online", "0\n", 2);
+
+  // /proc/<pid>/stat con i 52 campi del kernel; utime e stime crescono con il pid
+  char path[64];
+  for (int pid = 1; pid <= processes && ok; pid++) {
+    text.length = 0;
+    fixture_printf(
+        &text,
+        "%d (worker-%d) S 1 %d %d 0 -1 4194560 %d 0 0 0 %d %d 0 0 20 0 1 0 %d 12345678 456 18446744073709551615 1 1 0 0 0 0 0 "
+        "0 0 0 0 0 17 %d 0 0 0 0 0 0 0 0 0 0 0 0 0\n",
+        pid, pid, pid, pid, pid * 3, pid * 11 % 100000, pid * 3 % 50000, pid, pid % (cores > 0 ? cores : 1));
+    snprintf(path, sizeof(path), "proc/%d/stat", pid);
+    ok &= fixture_write(root, path, text.data, text.length);
+  }
+
+  free(text.data);
+  if (!ok)
+    return 1;
+
+  printf("Fixture in %s: %d core, %d interfacce, %d processi\n", root, cores, interfaces, processes);
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  int   ticks  = BENCH_TICKS;
+  char* ifname = "lo";
+
+  if (argc > 2 && strcmp(argv[1], "--fixture") == 0) {
+    int cores      = argc > 3 ? atoi(argv[3]) : FIXTURE_CORES;
+    int interfaces = argc > 4 ? atoi(argv[4]) : FIXTURE_INTERFACES;
+    int processes  = argc > 5 ? atoi(argv[5]) : FIXTURE_PROCESSES;
+    if (cores <= 0 || interfaces <= 0 || processes < 0) {
+      show_usage(argv[0]);
+      return 1;
+    }
+    return generate_fixture(argv[2], cores, interfaces, processes);
+  }
+
+  if (argc > 1 && strcmp(argv[1], "--cadence") == 0) {
+    return run_cadence(
+        argc > 2 ? atoi(argv[2]) : CADENCE_PROVIDERS, argc > 3 ? atoi(argv[3]) : CADENCE_PERIOD_MS,
+        argc > 4 ? atoi(argv[4]) : CADENCE_SECONDS);
+  }
+
+  if (argc > 2 && strcmp(argv[1], "--root") == 0) {
+    batch_set_root(argv[2]);
+    argv += 2;
+    argc -= 2;
+  }
+
+  if (argc > 1) {
+    ticks = atoi(argv[1]);
+    if (ticks <= 0) {
+      show_usage(argv[0]);
+      return 1;
+    }
+  }
+  if (argc > 2)
+    ifname = argv[2];
+
+  run_collectors(ticks, ifname);
+  run_mode(ticks, ifname, false);
+  run_mode(ticks, ifname, true);
+  return 0;
+}
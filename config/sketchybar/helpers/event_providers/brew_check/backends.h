@@ -0,0 +1,200 @@
+#ifndef BACKENDS_H
+#define BACKENDS_H
+
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+// --- Constants ---
+
+/** @brief Maximum number of package managers checked by one daemon. */
+#define BREW_MAX_BACKENDS 8
+
+/** @brief Maximum number of arguments of a backend command, executable and terminator excluded. */
+#define BREW_MAX_BACKEND_ARGS 4
+
+// --- Data Structures ---
+
+/**
+ * @struct brew_backend_t
+ * @brief Describes how to ask one package manager for its outdated packages.
+ *
+ * A check runs the optional refresh command, then the outdated command, and feeds every line of the latter's standard output to
+ * parse_line. Commands are executed directly, without a shell, from the first executable candidate that exists; a candidate starting
+ * with "~/" is resolved against $HOME. A backend with a script runs it with `/bin/sh -c script sh <executable>` instead, for managers
+ * that have no single command listing outdated packages.
+ */
+typedef struct {
+  const char* name;                                 /**< Short name, used in --managers and in the trigger variables. */
+  const char* executables[4];                       /**< Candidate paths, the first executable one is used. */
+  const char* refresh[BREW_MAX_BACKEND_ARGS + 1];   /**< Arguments of the metadata refresh, empty if the listing refreshes itself. */
+  const char* outdated[BREW_MAX_BACKEND_ARGS + 1];  /**< Arguments of the outdated listing, unused with a script. */
+  const char* script;                               /**< Shell script listing outdated packages, or NULL. */
+  int         success_status;                       /**< Exit status besides 0 that also means success, -1 if none. */
+  int         timeout_seconds;                      /**< Default time allowed to each command. */
+  bool (*parse_line)(char* line, char* package, size_t size); /**< Extracts the package name, false to skip the line. */
+} brew_backend_t;
+
+// --- Line Parsers ---
+
+/**
+ * @brief Copies at most length bytes of a token into the package buffer.
+ * @return True if the token was not empty.
+ */
+static inline bool _brew_copy_token(const char* token, size_t length, char* package, size_t size) {
+  if (length == 0)
+    return false;
+  snprintf(package, size, "%.*s", (int)length, token);
+  return true;
+}
+
+/** @brief First whitespace-separated word: `brew outdated --quiet`, pacman's `checkupdates`. */
+static inline bool brew_parse_first_word(char* line, char* package, size_t size) {
+  while (isspace((unsigned char)*line))
+    line++;
+  return _brew_copy_token(line, strcspn(line, " \t"), package, size);
+}
+
+/** @brief `apt list --upgradable`: "name/suite version arch [upgradable from: old]", after a "Listing..." header. */
+static inline bool brew_parse_apt(char* line, char* package, size_t size) {
+  char* slash = strchr(line, '/');
+  char* space = strchr(line, ' ');
+  if (!slash || (space && space < slash))
+    return false;
+  return _brew_copy_token(line, (size_t)(slash - line), package, size);
+}
+
+/** @brief `dnf check-update -q`: "name.arch version repository"; continuation and section lines are skipped. */
+static inline bool brew_parse_dnf(char* line, char* package, size_t size) {
+  if (isspace((unsigned char)line[0]))
+    return false;
+  size_t length = strcspn(line, " \t");
+  if (line[length] == '\0')
+    return false; // Section headers such as "Obsoleting Packages" have no version column
+
+  char* dot = NULL;
+  for (char* c = line; c < line + length; c++)
+    if (*c == '.')
+      dot = c;
+  return dot && _brew_copy_token(line, (size_t)(dot - line), package, size);
+}
+
+/** @brief `pip list --outdated --format=freeze` run in each pipx venv: "name==version". */
+static inline bool brew_parse_pipx(char* line, char* package, size_t size) {
+  char* separator = strstr(line, "==");
+  return separator && _brew_copy_token(line, (size_t)(separator - line), package, size);
+}
+
+/** @brief `cargo install-update --list`: a table whose last column is "Yes" for crates that need an update. */
+static inline bool brew_parse_cargo(char* line, char* package, size_t size) {
+  size_t length = strlen(line);
+  while (length > 0 && isspace((unsigned char)line[length - 1]))
+    length--;
+  if (length < 4 || strncmp(line + length - 4, " Yes", 4) != 0)
+    return false;
+  return brew_parse_first_word(line, package, size);
+}
+
+/** @brief `npm outdated -g --parseable`: "location:name@wanted:name@current:name@latest[:dependent]". */
+static inline bool brew_parse_npm(char* line, char* package, size_t size) {
+  char* wanted = strchr(line, ':');
+  if (!wanted)
+    return false;
+  wanted++;
+  size_t length = strcspn(wanted, ":");
+
+  // The version starts at the last '@' that is not the scope prefix of "@scope/name"
+  char* at = NULL;
+  for (char* c = wanted + 1; c < wanted + length; c++)
+    if (*c == '@')
+      at = c;
+  return _brew_copy_token(wanted, at ? (size_t)(at - wanted) : length, package, size);
+}
+
+// --- Backend Table ---
+
+/**
+ * @brief Known package managers, in the order used by --managers auto.
+ *
+ * Only Homebrew refreshes its metadata separately; apt's refresh needs root and is left to the system's own timer, while the other
+ * listings query their repositories themselves. dnf, checkupdates and npm use a non-zero exit status to report that updates exist.
+ */
+static const brew_backend_t BREW_BACKENDS[] = {
+    {
+        .name            = "brew",
+        .executables     = {"/opt/homebrew/bin/brew", "/usr/local/bin/brew", "/home/linuxbrew/.linuxbrew/bin/brew"},
+        .refresh         = {"update"},
+        .outdated        = {"outdated", "--quiet"},
+        .success_status  = -1,
+        .timeout_seconds = 600,
+        .parse_line      = brew_parse_first_word,
+    },
+    {
+        .name            = "apt",
+        .executables     = {"/usr/bin/apt"},
+        .outdated        = {"list", "--upgradable"},
+        .success_status  = -1,
+        .timeout_seconds = 120,
+        .parse_line      = brew_parse_apt,
+    },
+    {
+        .name            = "dnf",
+        .executables     = {"/usr/bin/dnf"},
+        .outdated        = {"check-update", "-q"},
+        .success_status  = 100,
+        .timeout_seconds = 300,
+        .parse_line      = brew_parse_dnf,
+    },
+    {
+        .name            = "pacman",
+        .executables     = {"/usr/bin/checkupdates"},
+        .success_status  = 2,
+        .timeout_seconds = 300,
+        .parse_line      = brew_parse_first_word,
+    },
+    {
+        .name        = "pipx",
+        .executables = {"~/.local/bin/pipx", "/usr/bin/pipx", "/opt/homebrew/bin/pipx", "/usr/local/bin/pipx"},
+        .script      = "for venv in $(\"$1\" list --short | cut -d' ' -f1); do"
+                       " \"$1\" runpip \"$venv\" list --outdated --format=freeze 2>/dev/null | grep -i \"^$venv==\";"
+                       " done; exit 0",
+        .success_status  = -1,
+        .timeout_seconds = 300,
+        .parse_line      = brew_parse_pipx,
+    },
+    {
+        .name            = "cargo",
+        .executables     = {"~/.cargo/bin/cargo-install-update"},
+        .outdated        = {"install-update", "--list"},
+        .success_status  = -1,
+        .timeout_seconds = 300,
+        .parse_line      = brew_parse_cargo,
+    },
+    {
+        .name            = "npm",
+        .executables     = {"/usr/bin/npm", "/usr/local/bin/npm", "/opt/homebrew/bin/npm"},
+        .outdated        = {"outdated", "-g", "--parseable"},
+        .success_status  = 1,
+        .timeout_seconds = 120,
+        .parse_line      = brew_parse_npm,
+    },
+};
+
+/** @brief Number of entries in BREW_BACKENDS. */
+static const int BREW_BACKEND_COUNT = (int)(sizeof(BREW_BACKENDS) / sizeof(BREW_BACKENDS[0]));
+
+/**
+ * @brief Looks up a backend by name.
+ * @param name The backend name, e.g. "apt".
+ * @return The backend, or NULL if the name is unknown.
+ */
+[[nodiscard]] static inline const brew_backend_t* brew_backend_find(const char* name) {
+  for (int i = 0; i < BREW_BACKEND_COUNT; i++) {
+    if (strcmp(BREW_BACKENDS[i].name, name) == 0)
+      return &BREW_BACKENDS[i];
+  }
+  return NULL;
+}
+
+#endif /* BACKENDS_H */
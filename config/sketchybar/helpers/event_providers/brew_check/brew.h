@@ -1,21 +1,25 @@
 #ifndef BREW_H
 #define BREW_H
 
+#include "../sample_log.h"
+#include "backends.h"
+#include "busy.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/sysctl.h>
 #include <sys/wait.h>
 #include <time.h>
 #include <unistd.h>
 
 // --- Constants ---
 
-/** @brief Absolute path to the Homebrew executable. Using an absolute path is crucial for robustness when running from environments like
- * Sketchybar, which may have a minimal PATH. */
-static const char* BREW_EXECUTABLE_PATH = "/opt/homebrew/bin/brew";
-
 /** @brief Maximum length for a single package name. */
 static const int BREW_MAX_PACKAGE_NAME = 128;
 
@@ -25,6 +29,9 @@ static const int BREW_INITIAL_BUFFER_SIZE = 1024;
 /** @brief The absolute maximum size for the package list buffer to prevent uncontrolled memory allocation. */
 static const int BREW_MAX_BUFFER_SIZE = 16384;
 
+/** @brief How long a due update may be deferred by a busy system before it runs anyway, so a machine that is never idle still updates. */
+static const int BREW_MAX_DEFER_SECONDS = 6 * 3600;
+
 // --- Error Codes ---
 
 /**
@@ -33,25 +40,31 @@ static const int BREW_MAX_BUFFER_SIZE = 16384;
  */
 typedef enum {
   BREW_SUCCESS = 0,              /**< Operation completed successfully. */
-  BREW_ERROR_NOT_INSTALLED,      /**< Homebrew executable not found. */
+  BREW_ERROR_NOT_INSTALLED,      /**< Package manager executable not found. */
   BREW_ERROR_UPDATE_IN_PROGRESS, /**< An update operation is already running. */
   BREW_ERROR_MEMORY_ALLOCATION,  /**< Failed to allocate memory (malloc, realloc). */
   BREW_ERROR_COMMAND_EXECUTION,  /**< Failed to fork or execute a brew command. */
   BREW_ERROR_PIPE_CREATION,      /**< Failed to create a pipe for IPC. */
   BREW_ERROR_BUFFER_OVERFLOW,    /**< The list of outdated packages exceeds the maximum buffer size. */
   BREW_ERROR_INVALID_STATE,      /**< An operation was called on an uninitialized or invalid structure. */
+  BREW_ERROR_TIMEOUT,            /**< A command exceeded the backend timeout and was killed. */
 } brew_error_t;
 
 // --- Main Data Structure ---
 
 /**
  * @struct brew_t
- * @brief Holds the state of Homebrew information.
+ * @brief Holds the state of one package manager.
  *
  * This structure tracks the number of outdated packages, a list of their names,
- * and metadata about when checks and updates were last performed.
+ * and metadata about when checks and updates were last performed. Absolute
+ * executable paths are crucial for robustness when running from environments
+ * like Sketchybar, which may have a minimal PATH.
  */
 typedef struct {
+  const brew_backend_t* backend;               /**< How to query this package manager. */
+  char                  executable[PATH_MAX];  /**< Resolved absolute path of the executable. */
+  int                   timeout_seconds;       /**< Time allowed to each command before it is killed. */
   int          outdated_count;     /**< Number of outdated packages. */
   char*        package_list;       /**< Comma-separated string of outdated package names. */
   size_t       package_list_size;  /**< Current allocated size of package_list buffer. */
@@ -59,23 +72,57 @@ typedef struct {
   time_t       last_check;         /**< Timestamp of the last check for outdated packages. */
   brew_error_t last_error;         /**< The last error that occurred during an operation. */
   bool         update_in_progress; /**< Flag to prevent concurrent updates. */
+  char         defer_reason[BUSY_REASON_LENGTH + 16]; /**< Why the last due update was deferred, empty if it was not. */
+  struct sample_log* record_log; /**< If set, every outdated listing is appended to this log (--record). */
 } brew_t;
 
 // --- Private Helper Function Prototypes ---
 
-[[nodiscard]] static brew_error_t _brew_execute_command(const char* args[], char** output_buffer, size_t* buffer_size);
+[[nodiscard]] static brew_error_t _brew_execute_command(const char* args[], char** output_buffer, size_t* buffer_size, int timeout_seconds,
+                                                       int success_status);
 [[nodiscard]] static brew_error_t _brew_resize_buffer(brew_t* brew, size_t required_size);
-static int                        _get_cpu_core_count();
+[[nodiscard]] static brew_error_t brew_parse_outdated(brew_t* brew, char* output);
 
 // --- Public API ---
 
+/** @brief Serializes --record writes from backends fetching concurrently on different workers. */
+static pthread_mutex_t g_brew_record_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Finds the executable of a backend.
+ * @param backend The backend to resolve.
+ * @param path Buffer receiving the first executable candidate.
+ * @param size Size of the buffer.
+ * @return True if one of the candidates exists and is executable.
+ */
+[[nodiscard]] static inline bool brew_backend_resolve(const brew_backend_t* backend, char* path, size_t size) {
+  const char* home = getenv("HOME");
+  for (int i = 0; i < 4 && backend->executables[i]; i++) {
+    const char* candidate = backend->executables[i];
+    if (strncmp(candidate, "~/", 2) == 0) {
+      if (!home)
+        continue;
+      snprintf(path, size, "%s/%s", home, candidate + 2);
+    } else {
+      snprintf(path, size, "%s", candidate);
+    }
+    if (access(path, X_OK) == 0)
+      return true;
+  }
+  return false;
+}
+
 /**
- * @brief Initializes the brew state structure.
+ * @brief Initializes the state of one package manager.
  * @param brew A pointer to the brew_t struct to initialize.
+ * @param backend The package manager to query.
+ * @param executable Path of the executable, or NULL to search the backend candidates.
+ * @param timeout_seconds Time allowed to each command, or 0 for the backend default.
  * @return BREW_SUCCESS on success, or an error code on failure.
  */
-[[nodiscard]] static inline brew_error_t brew_init(brew_t* brew) {
-  if (!brew)
+[[nodiscard]] static inline brew_error_t brew_init(brew_t* brew, const brew_backend_t* backend, const char* executable,
+                                                   int timeout_seconds) {
+  if (!brew || !backend)
     return BREW_ERROR_INVALID_STATE;
 
   memset(brew, 0, sizeof(brew_t));
@@ -86,9 +133,14 @@ static int                        _get_cpu_core_count();
   brew->package_list[0]   = '\0';
   brew->package_list_size = BREW_INITIAL_BUFFER_SIZE;
   brew->last_error        = BREW_SUCCESS;
-
-  // Check if brew is installed right away.
-  if (access(BREW_EXECUTABLE_PATH, X_OK) != 0) {
+  brew->backend           = backend;
+  brew->timeout_seconds   = timeout_seconds > 0 ? timeout_seconds : backend->timeout_seconds;
+
+  // Check if the package manager is installed right away.
+  bool found = executable ? snprintf(brew->executable, sizeof(brew->executable), "%s", executable) > 0 &&
+                                access(brew->executable, X_OK) == 0
+                          : brew_backend_resolve(backend, brew->executable, sizeof(brew->executable));
+  if (!found) {
     brew->last_error = BREW_ERROR_NOT_INSTALLED;
     return BREW_ERROR_NOT_INSTALLED;
   }
@@ -108,38 +160,56 @@ static inline void brew_cleanup(brew_t* brew) {
 }
 
 /**
- * @brief Checks if a `brew update` operation is needed based on a time interval and system load.
+ * @brief Checks if a `brew update` operation is needed based on a time interval and the busy gate.
+ *
+ * The gate must be sampled once per check before calling this. A due update is deferred until the gate reports an idle window, or
+ * until it has been overdue for BREW_MAX_DEFER_SECONDS; the reason for a deferral is stored in brew->defer_reason.
+ *
  * @param brew A pointer to the brew_t struct.
+ * @param gate A pointer to the sampled busy gate, or NULL to skip the system check.
  * @param update_interval_seconds The minimum time in seconds that must pass before a new update.
  * @return True if an update is needed, false otherwise.
  */
-[[nodiscard]] static inline bool brew_needs_update(const brew_t* brew, int update_interval_seconds) {
+[[nodiscard]] static inline bool brew_needs_update(brew_t* brew, busy_gate_t* gate, int update_interval_seconds) {
   if (!brew)
     return false;
 
+  brew->defer_reason[0] = '\0';
+
   // Time check
   time_t current_time = time(NULL);
-  if ((current_time - brew->last_update) < update_interval_seconds) {
+  time_t overdue      = current_time - brew->last_update - update_interval_seconds;
+  if (overdue < 0) {
     return false;
   }
 
-  // System load check to avoid running updates on a busy system.
-  double load[1];
-  if (getloadavg(load, 1) == 1) {
-    static int core_count = 0;
-    if (core_count == 0)
-      core_count = _get_cpu_core_count();
-    // The threshold is 75% of the number of cores.
-    double high_load_threshold = (double)core_count * 0.75;
-    if (load[0] > high_load_threshold) {
-      return false; // Defer update if system is busy
-    }
+  // Defer heavy work until the system has been idle for a whole window.
+  if (gate && !busy_gate_is_idle(gate) && overdue < BREW_MAX_DEFER_SECONDS) {
+    snprintf(brew->defer_reason, sizeof(brew->defer_reason), "Deferred: %s", gate->reason);
+    return false;
   }
   return true;
 }
 
 /**
- * @brief Runs `brew update` and then gets the list of outdated packages.
+ * @brief Builds the argument vector of a backend command.
+ * @param brew The package manager state, for the executable path.
+ * @param args The backend arguments, NULL-terminated.
+ * @param argv Output vector of BREW_MAX_BACKEND_ARGS + 2 entries.
+ */
+static inline void _brew_command_args(const brew_t* brew, const char* const* args, const char* argv[]) {
+  argv[0] = brew->executable;
+  int i   = 0;
+  for (; i < BREW_MAX_BACKEND_ARGS && args[i]; i++)
+    argv[i + 1] = args[i];
+  argv[i + 1] = NULL;
+}
+
+/**
+ * @brief Refreshes the package metadata if the backend needs it, then gets the list of outdated packages.
+ *
+ * Each command is killed if it runs longer than the backend timeout. Safe to call concurrently on different brew_t structures.
+ *
  * @param brew A pointer to the brew_t struct to update with new data.
  * @return BREW_SUCCESS on success, or an error code on failure.
  */
@@ -152,22 +222,32 @@ static inline void brew_cleanup(brew_t* brew) {
   brew->update_in_progress = true;
   brew->last_check         = time(NULL);
 
-  // Step 1: Run `brew update`
-  const char*  update_args[] = {BREW_EXECUTABLE_PATH, "update", NULL};
-  brew_error_t err           = _brew_execute_command(update_args, NULL, NULL);
-
-  if (err != BREW_SUCCESS) {
-    brew->last_error         = err;
-    brew->update_in_progress = false;
-    return err;
+  const brew_backend_t* backend = brew->backend;
+  const char*           argv[BREW_MAX_BACKEND_ARGS + 2];
+  brew_error_t          err = BREW_SUCCESS;
+
+  // Step 1: Refresh the metadata, e.g. `brew update`
+  if (backend->refresh[0]) {
+    _brew_command_args(brew, backend->refresh, argv);
+    err = _brew_execute_command(argv, NULL, NULL, brew->timeout_seconds, -1);
+    if (err != BREW_SUCCESS) {
+      brew->last_error         = err;
+      brew->update_in_progress = false;
+      return err;
+    }
   }
   brew->last_update = time(NULL);
 
-  // Step 2: Run `brew outdated --quiet` to get the list.
-  const char* outdated_args[] = {BREW_EXECUTABLE_PATH, "outdated", "--quiet", NULL};
-  char*       package_output  = NULL;
-  size_t      output_size     = 0;
-  err                         = _brew_execute_command(outdated_args, &package_output, &output_size);
+  // Step 2: List the outdated packages, e.g. `brew outdated --quiet`
+  if (backend->script) {
+    const char* script_args[] = {"/bin/sh", "-c", backend->script, "sh", brew->executable, NULL};
+    memcpy(argv, script_args, sizeof(script_args));
+  } else {
+    _brew_command_args(brew, backend->outdated, argv);
+  }
+  char*  package_output = NULL;
+  size_t output_size    = 0;
+  err                   = _brew_execute_command(argv, &package_output, &output_size, brew->timeout_seconds, backend->success_status);
 
   if (err != BREW_SUCCESS) {
     free(package_output);
@@ -176,45 +256,135 @@ static inline void brew_cleanup(brew_t* brew) {
     return err;
   }
 
+  // Each record starts with "#<backend>\n", so --replay can route it to the right package manager
+  if (brew->record_log) {
+    size_t header = strlen(backend->name) + 2;
+    char*  blob   = malloc(header + output_size);
+    if (blob) {
+      snprintf(blob, header + 1, "#%s\n", backend->name);
+      memcpy(blob + header, package_output, output_size);
+      pthread_mutex_lock(&g_brew_record_lock);
+      sample_log_write_blob(brew->record_log, blob, header + output_size);
+      pthread_mutex_unlock(&g_brew_record_lock);
+      free(blob);
+    }
+  }
+
   // Step 3: Parse the output and populate the struct.
+  err = brew_parse_outdated(brew, package_output);
+  free(package_output);
+  brew->update_in_progress = false;
+  brew->last_error         = err;
+  return err;
+}
+
+/**
+ * @struct brew_result_t
+ * @brief Snapshot of a brew_t after a fetch, handed from the worker that ran it to the publisher.
+ *
+ * The worker owns a private brew_t for the whole duration of brew_fetch_outdated, so the publisher can keep reading and sending its
+ * own copy while `brew update` runs.
+ */
+typedef struct {
+  int          outdated_count; /**< Number of outdated packages. */
+  char*        package_list;   /**< Owned copy of the comma-separated package list. */
+  time_t       last_update;    /**< Timestamp of the last successful `brew update`. */
+  time_t       last_check;     /**< Timestamp of the fetch. */
+  brew_error_t last_error;     /**< Outcome of the fetch. */
+} brew_result_t;
+
+/**
+ * @brief Copies the fetch-related fields of a brew state into a new result.
+ * @param brew A pointer to the brew_t struct that ran the fetch.
+ * @return A heap-allocated result, or NULL if allocation failed.
+ */
+[[nodiscard]] static inline brew_result_t* brew_result_create(const brew_t* brew) {
+  brew_result_t* result = malloc(sizeof(brew_result_t));
+  if (!result)
+    return NULL;
+
+  result->package_list = strdup(brew->package_list ? brew->package_list : "");
+  if (!result->package_list) {
+    free(result);
+    return NULL;
+  }
+  result->outdated_count = brew->outdated_count;
+  result->last_update    = brew->last_update;
+  result->last_check     = brew->last_check;
+  result->last_error     = brew->last_error;
+  return result;
+}
+
+/**
+ * @brief Frees a result. The signature matches the release function of a latest slot.
+ */
+static inline void brew_result_free(void* result) {
+  if (result)
+    free(((brew_result_t*)result)->package_list);
+  free(result);
+}
+
+/**
+ * @brief Applies a fetch result to the publisher's brew state and frees it.
+ * @param brew A pointer to the brew_t struct to update.
+ * @param result The result taken from the worker.
+ */
+static inline void brew_apply_result(brew_t* brew, brew_result_t* result) {
+  if (!brew || !result)
+    return;
+
+  free(brew->package_list);
+  brew->package_list      = result->package_list;
+  brew->package_list_size = strlen(result->package_list) + 1;
+  brew->outdated_count    = result->outdated_count;
+  brew->last_update       = result->last_update;
+  brew->last_check        = result->last_check;
+  brew->last_error        = result->last_error;
+  free(result);
+}
+
+/**
+ * @brief Parses the output of the backend's outdated listing into the count and the comma-separated package list.
+ *
+ * Used by brew_fetch_outdated and, with recorded outputs, by --replay. Lines the backend parser rejects (headers, blank lines,
+ * up-to-date entries) are skipped.
+ *
+ * @param brew A pointer to the brew_t struct to update.
+ * @param output The command output, one entry per line. It is modified in place.
+ * @return BREW_SUCCESS on success, or an error code on failure.
+ */
+[[nodiscard]] static inline brew_error_t brew_parse_outdated(brew_t* brew, char* output) {
+  if (!brew || !output)
+    return BREW_ERROR_INVALID_STATE;
+
   brew->outdated_count     = 0;
   brew->package_list[0]    = '\0';
   size_t package_list_used = 0;
 
-  char* line = strtok(package_output, "\n");
-  while (line != NULL) {
-    if (line[0] == '\0') {
-      line = strtok(NULL, "\n");
+  // strtok_r: several backends may parse at the same time on different workers
+  char  package[BREW_MAX_PACKAGE_NAME];
+  char* saveptr = NULL;
+  for (char* line = strtok_r(output, "\n", &saveptr); line != NULL; line = strtok_r(NULL, "\n", &saveptr)) {
+    if (!brew->backend->parse_line(line, package, sizeof(package)))
       continue;
-    }
 
     brew->outdated_count++;
-    size_t line_len       = strlen(line);
+    size_t line_len       = strlen(package);
     size_t required_space = package_list_used + line_len + 2; // +1 for comma, +1 for null terminator
 
     if (required_space > brew->package_list_size) {
-      err = _brew_resize_buffer(brew, required_space);
-      if (err != BREW_SUCCESS) {
-        free(package_output);
-        brew->last_error         = err;
-        brew->update_in_progress = false;
+      brew_error_t err = _brew_resize_buffer(brew, required_space);
+      if (err != BREW_SUCCESS)
         return err;
-      }
     }
 
     if (package_list_used > 0) {
       strcat(brew->package_list, ",");
       package_list_used++;
     }
-    strcat(brew->package_list, line);
+    strcat(brew->package_list, package);
     package_list_used += line_len;
-
-    line = strtok(NULL, "\n");
   }
-
-  free(package_output);
-  brew->update_in_progress = false;
-  brew->last_error         = BREW_SUCCESS;
   return BREW_SUCCESS;
 }
 
@@ -228,7 +398,7 @@ static inline void brew_cleanup(brew_t* brew) {
   case BREW_SUCCESS:
     return "Success";
   case BREW_ERROR_NOT_INSTALLED:
-    return "Homebrew not found";
+    return "Package manager not found";
   case BREW_ERROR_UPDATE_IN_PROGRESS:
     return "Update already in progress";
   case BREW_ERROR_MEMORY_ALLOCATION:
@@ -241,6 +411,8 @@ static inline void brew_cleanup(brew_t* brew) {
     return "Output buffer overflow";
   case BREW_ERROR_INVALID_STATE:
     return "Invalid state";
+  case BREW_ERROR_TIMEOUT:
+    return "Command timed out";
   default:
     return "Unknown error";
   }
@@ -249,98 +421,148 @@ static inline void brew_cleanup(brew_t* brew) {
 // --- Private Helper Function Implementations ---
 
 /**
- * @brief [Private] Executes a command and captures its standard output.
+ * @brief [Private] Executes a command and captures its standard output, killing it if it runs too long.
  *
  * This function is the robust replacement for `popen` and `system`. It uses
- * `fork`, `execv`, and `pipe` for full control over process execution.
+ * `fork`, `execv`, and `pipe` for full control over process execution. The
+ * child gets its own process group, so a timeout also kills whatever it
+ * spawned, and an empty signal mask, since workers run with every signal
+ * blocked. Standard error is discarded: warnings must not be parsed as
+ * packages.
  *
  * @param args Null-terminated array of strings representing the command and its arguments.
  * @param output_buffer A pointer to a char pointer that will be allocated to store the output. The caller must free this buffer. If NULL,
  * output is discarded.
  * @param buffer_size A pointer to a size_t to store the size of the output buffer. Can be NULL if output is discarded.
+ * @param timeout_seconds Time allowed to the command, 0 for no limit.
+ * @param success_status Exit status besides 0 that also means success, -1 if none.
  * @return BREW_SUCCESS on success, or an error code on failure.
  */
-[[nodiscard]] static inline brew_error_t _brew_execute_command(const char* args[], char** output_buffer, size_t* buffer_size) {
+[[nodiscard]] static inline brew_error_t _brew_execute_command(const char* args[], char** output_buffer, size_t* buffer_size, int timeout_seconds,
+                                                              int success_status) {
+  // Both ends are close-on-exec: a manager forked concurrently on another worker must not inherit this
+  // command's stdout, or the reader would only see EOF when that manager exits. dup2 clears the flag in the child.
   int pipefd[2];
-  if (output_buffer && pipe(pipefd) == -1) {
+#ifdef __APPLE__
+  // No pipe2: pipe, FD_CLOEXEC and fork happen under one lock, so no other fork falls in between
+  static pthread_mutex_t fork_lock = PTHREAD_MUTEX_INITIALIZER;
+  pthread_mutex_lock(&fork_lock);
+  if (pipe(pipefd) == -1) {
+    pthread_mutex_unlock(&fork_lock);
+    return BREW_ERROR_PIPE_CREATION;
+  }
+  fcntl(pipefd[0], F_SETFD, FD_CLOEXEC);
+  fcntl(pipefd[1], F_SETFD, FD_CLOEXEC);
+  pid_t pid = fork();
+  if (pid != 0)
+    pthread_mutex_unlock(&fork_lock);
+#else
+  if (pipe2(pipefd, O_CLOEXEC) == -1) {
     return BREW_ERROR_PIPE_CREATION;
   }
-
   pid_t pid = fork();
+#endif
   if (pid == -1) {
-    if (output_buffer) {
-      close(pipefd[0]);
-      close(pipefd[1]);
-    }
+    close(pipefd[0]);
+    close(pipefd[1]);
     return BREW_ERROR_COMMAND_EXECUTION;
   }
 
   if (pid == 0) { // Child process
-    if (output_buffer) {
-      close(pipefd[0]);               // Close unused read end
-      dup2(pipefd[1], STDOUT_FILENO); // Redirect stdout to pipe
-      dup2(pipefd[1], STDERR_FILENO); // Redirect stderr to pipe as well
-      close(pipefd[1]);
-    } else {
-      // Discard output if no buffer is provided
-      freopen("/dev/null", "w", stdout);
-      freopen("/dev/null", "w", stderr);
+    sigset_t none;
+    sigemptyset(&none);
+    sigprocmask(SIG_SETMASK, &none, NULL);
+    setpgid(0, 0);
+
+    // Stdout always goes to the pipe, so the parent sees EOF when the command is done
+    int null_fd = open("/dev/null", O_WRONLY);
+    dup2(pipefd[1], STDOUT_FILENO);
+    if (null_fd >= 0) {
+      dup2(null_fd, STDERR_FILENO);
+      close(null_fd);
     }
+    close(pipefd[1]);
 
     execv(args[0], (char* const*)args);
     // execv only returns on error
-    exit(127);
+    _exit(127);
   }
 
   // Parent process
-  if (output_buffer) {
-    close(pipefd[1]); // Close unused write end
-
-    size_t capacity = 4096;
-    size_t size     = 0;
-    char*  buffer   = malloc(capacity);
-    if (!buffer) {
-      close(pipefd[0]);
-      waitpid(pid, NULL, 0);
-      return BREW_ERROR_MEMORY_ALLOCATION;
+  close(pipefd[1]); // Close unused write end
+
+  size_t capacity = 4096;
+  size_t size     = 0;
+  char*  buffer   = malloc(capacity);
+  if (!buffer) {
+    kill(-pid, SIGKILL);
+    close(pipefd[0]);
+    waitpid(pid, NULL, 0);
+    return BREW_ERROR_MEMORY_ALLOCATION;
+  }
+
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  time_t       deadline = now.tv_sec + timeout_seconds;
+  brew_error_t err      = BREW_SUCCESS;
+  for (;;) {
+    int wait_ms = -1;
+    if (timeout_seconds > 0) {
+      clock_gettime(CLOCK_MONOTONIC, &now);
+      if (now.tv_sec >= deadline) {
+        err = BREW_ERROR_TIMEOUT;
+        break;
+      }
+      wait_ms = (int)(deadline - now.tv_sec) * 1000;
     }
 
-    ssize_t bytes_read;
-    while ((bytes_read = read(pipefd[0], buffer + size, capacity - size - 1)) > 0) {
-      size += bytes_read;
-      if (size >= capacity - 1) {
-        capacity *= 2;
-        char* new_buffer = realloc(buffer, capacity);
-        if (!new_buffer) {
-          free(buffer);
-          close(pipefd[0]);
-          waitpid(pid, NULL, 0);
-          return BREW_ERROR_MEMORY_ALLOCATION;
-        }
-        buffer = new_buffer;
+    struct pollfd pfd = {.fd = pipefd[0], .events = POLLIN};
+    if (poll(&pfd, 1, wait_ms) < 0 && errno != EINTR) {
+      err = BREW_ERROR_COMMAND_EXECUTION;
+      break;
+    }
+    if (!pfd.revents)
+      continue;
+
+    ssize_t bytes_read = read(pipefd[0], buffer + size, capacity - size - 1);
+    if (bytes_read < 0 && errno == EINTR)
+      continue;
+    if (bytes_read <= 0)
+      break;
+
+    // Discarded output is overwritten in place
+    size = output_buffer ? size + (size_t)bytes_read : 0;
+    if (size >= capacity - 1) {
+      capacity *= 2;
+      char* new_buffer = realloc(buffer, capacity);
+      if (!new_buffer) {
+        err = BREW_ERROR_MEMORY_ALLOCATION;
+        break;
       }
+      buffer = new_buffer;
     }
-    buffer[size] = '\0';
-    close(pipefd[0]);
-    *output_buffer = buffer;
-    if (buffer_size)
-      *buffer_size = size;
   }
+  close(pipefd[0]);
 
-  int status;
-  waitpid(pid, &status, 0);
-  if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
-    return BREW_SUCCESS;
+  if (err != BREW_SUCCESS)
+    kill(-pid, SIGKILL);
+  int status = 0;
+  while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
   }
 
-  // If the command failed but we captured output, we don't free it
-  // so the caller might be able to inspect it. But in this design,
-  // we'll just free it on error to keep things simple.
-  if (output_buffer && *output_buffer) {
-    free(*output_buffer);
-    *output_buffer = NULL;
+  if (err == BREW_SUCCESS &&
+      !(WIFEXITED(status) && (WEXITSTATUS(status) == 0 || WEXITSTATUS(status) == success_status)))
+    err = BREW_ERROR_COMMAND_EXECUTION;
+  if (err != BREW_SUCCESS || !output_buffer) {
+    free(buffer);
+    return err;
   }
-  return BREW_ERROR_COMMAND_EXECUTION;
+
+  buffer[size]   = '\0';
+  *output_buffer = buffer;
+  if (buffer_size)
+    *buffer_size = size;
+  return BREW_SUCCESS;
 }
 
 /**
@@ -369,16 +591,4 @@ static inline void brew_cleanup(brew_t* brew) {
   return BREW_SUCCESS;
 }
 
-/**
- * @brief [Private] Gets the number of logical CPU cores.
- */
-static inline int _get_cpu_core_count() {
-  int    ncpu;
-  size_t len = sizeof(ncpu);
-  if (sysctlbyname("hw.ncpu", &ncpu, &len, NULL, 0) == 0 && ncpu > 0) {
-    return ncpu;
-  }
-  return 2; // Return a safe default
-}
-
 #endif /* BREW_H */
@@ -1,5 +1,8 @@
 #include "../sketchybar.h"
+#include "../workers.h"
 #include "brew.h"
+#include "outdated_set.h"
+#include <errno.h>
 #include <limits.h>
 #include <signal.h>
 #include <stdarg.h>
@@ -11,15 +14,52 @@ static const int DEFAULT_CHECK_INTERVAL  = 60;
 static const int MAX_EVENT_NAME_LENGTH   = 64;
 static const int MAX_MESSAGE_LENGTH      = 2048;
 
+// --- Types ---
+
+/**
+ * @brief One enabled package manager.
+ *
+ * The publisher reads and sends `state`; fetches run on a worker with the private `worker` copy and hand their snapshot over through
+ * the job's latest slot, so a slow manager never delays the others.
+ */
+typedef struct {
+  brew_t            state;     /**< Publisher copy, updated by brew_apply_result. */
+  brew_t            worker;    /**< Worker copy, used only while fetch_job runs. */
+  struct worker_job fetch_job; /**< Refresh and listing of this manager. */
+} manager_t;
+
+/**
+ * @brief What the bar has been sent so far.
+ *
+ * Triggers carry only the packages added to and removed from the merged outdated set, tagged with the generation they lead to and the
+ * one they apply to. The generation grows each time the set changes; a listener whose generation differs from `base` has missed a
+ * trigger and asks for the full list with SIGUSR2.
+ */
+typedef struct {
+  outdated_set_t set;            /**< Merged set as of the last trigger. */
+  unsigned long  generation;     /**< Generation of set, 0 before the first trigger. */
+  bool           full_requested; /**< The next trigger carries the full list. */
+} published_t;
+
 // --- Global State ---
 /** @brief Flag to gracefully terminate the daemon, set by a signal handler. Must be volatile sig_atomic_t. */
 static volatile sig_atomic_t g_terminate_flag = 0;
 /** @brief Flag to force an immediate check, set by a signal handler. Must be volatile sig_atomic_t. */
 static volatile sig_atomic_t g_force_check_flag = 0;
+/** @brief Flag to resend the full package list, set by a signal handler. Must be volatile sig_atomic_t. */
+static volatile sig_atomic_t g_full_list_flag = 0;
 
 // --- Forward Declarations ---
 static void handle_signal(int sig);
-static void check_and_notify(brew_t* brew, const char* event_name, bool force_update, bool verbose);
+static int setup_managers(manager_t* managers, const char* list, int timeout, bool replay, bool verbose);
+static bool any_fetch_running(manager_t* managers, int count);
+static void check_and_notify(manager_t* managers, int count, published_t* published, busy_gate_t* gate, struct worker_pool* pool,
+                             const char* event_name, long update_interval, bool force_update, bool verbose);
+static void fetch_outdated(void* context, struct latest* result);
+static time_t monotonic_seconds(void);
+static void notify(const manager_t* managers, int count, published_t* published, const char* event_name);
+static void replay_outdated(manager_t* managers, int* count, bool enable_new, published_t* published, struct sample_log* log,
+                            const char* event_name, bool verbose);
 static void show_usage(const char* program_name);
 static void log_message(bool verbose, const char* format, ...);
 
@@ -33,8 +73,8 @@ int main(int argc, char** argv) {
     return 1;
   }
 
-  char event_name[MAX_EVENT_NAME_LENGTH] = {0};
-  strncpy(event_name, argv[1], sizeof(event_name) - 1);
+  char event_name[MAX_EVENT_NAME_LENGTH];
+  snprintf(event_name, sizeof(event_name), "%s", argv[1]);
 
   long check_interval_secs = strtol(argv[2], NULL, 10);
   if (check_interval_secs <= 0)
@@ -44,8 +84,61 @@ int main(int argc, char** argv) {
   if (update_interval_secs <= 0)
     update_interval_secs = DEFAULT_UPDATE_INTERVAL;
 
-  // This variable is now used by the log_message function.
-  bool verbose_mode = (argc > 4 && strcmp(argv[4], "--verbose") == 0);
+  // --- Busy Gate ---
+  busy_gate_t gate;
+  busy_gate_init(&gate);
+
+  // Optional flags, in any order after the positional arguments.
+  bool        verbose_mode = false;
+  const char* manager_list = "auto";
+  int         jobs         = 0;
+  int         timeout_secs = 0;
+  const char* record_path  = NULL;
+  const char* replay_path  = NULL;
+  double      replay_speed = 1.0;
+  for (int i = 4; i < argc; i++) {
+    if (strcmp(argv[i], "--verbose") == 0) {
+      verbose_mode = true;
+    } else if (strcmp(argv[i], "--managers") == 0 && i + 1 < argc) {
+      manager_list = argv[++i];
+    } else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+      jobs = (int)strtol(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--timeout") == 0 && i + 1 < argc) {
+      timeout_secs = (int)strtol(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+      record_path = argv[++i];
+    } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+      replay_path = argv[++i];
+    } else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+      replay_speed = strtod(argv[++i], NULL);
+    } else if (strcmp(argv[i], "--busy-cpu") == 0 && i + 1 < argc) {
+      gate.thresholds[BUSY_RESOURCE_CPU] = strtod(argv[++i], NULL);
+    } else if (strcmp(argv[i], "--busy-io") == 0 && i + 1 < argc) {
+      gate.thresholds[BUSY_RESOURCE_IO] = strtod(argv[++i], NULL);
+    } else if (strcmp(argv[i], "--busy-memory") == 0 && i + 1 < argc) {
+      gate.thresholds[BUSY_RESOURCE_MEMORY] = strtod(argv[++i], NULL);
+    } else if (strcmp(argv[i], "--idle-samples") == 0 && i + 1 < argc) {
+      gate.idle_samples = (int)strtol(argv[++i], NULL, 10);
+    } else {
+      show_usage(argv[0]);
+      return 1;
+    }
+  }
+  if ((record_path && replay_path) || replay_speed < 0 || jobs < 0 || timeout_secs < 0) {
+    show_usage(argv[0]);
+    return 1;
+  }
+
+  // --- Sample Log ---
+  static struct sample_log sample_log;
+  if (record_path && !sample_log_create(&sample_log, record_path, SAMPLE_LOG_BREW)) {
+    log_message(true, "Cannot create log %s: %s", record_path, strerror(errno));
+    return 1;
+  }
+  if (replay_path && !sample_log_open(&sample_log, replay_path, SAMPLE_LOG_BREW, replay_speed)) {
+    log_message(true, "Cannot open log %s: %s", replay_path, strerror(errno));
+    return 1;
+  }
 
   // --- Signal Handling Setup ---
   struct sigaction sa = {0};
@@ -55,78 +148,437 @@ int main(int argc, char** argv) {
   sigaction(SIGINT, &sa, NULL);
   sigaction(SIGTERM, &sa, NULL);
   sigaction(SIGUSR1, &sa, NULL);
+  sigaction(SIGUSR2, &sa, NULL);
 
   // --- Initialization ---
-  brew_t       brew_state;
-  brew_error_t err = brew_init(&brew_state);
-  if (err != BREW_SUCCESS) {
+  // Replay never runs a package manager, so it works on machines where they are not installed.
+  static manager_t managers[BREW_MAX_BACKENDS];
+  int              manager_count = setup_managers(managers, manager_list, timeout_secs, replay_path != NULL, verbose_mode);
+  if (manager_count < 0 || (manager_count == 0 && !replay_path)) {
     // Fatal errors are always logged.
-    log_message(true, "Initialization failed: %s", brew_error_string(err));
+    log_message(true, "Initialization failed: no usable package manager in '%s'.", manager_list);
+    busy_gate_cleanup(&gate);
     return 1;
   }
 
+  // The first trigger always carries the full list.
+  static published_t published;
+  outdated_set_init(&published.set);
+
   // Register the custom event with Sketchybar
   char sketchybar_cmd[256];
   snprintf(sketchybar_cmd, sizeof(sketchybar_cmd), "--add event %s", event_name);
   sketchybar(sketchybar_cmd);
   log_message(verbose_mode, "Daemon started. Event '%s' registered.", event_name);
 
+  if (replay_path) {
+    replay_outdated(managers, &manager_count, strcmp(manager_list, "auto") == 0, &published, &sample_log, event_name, verbose_mode);
+    g_terminate_flag = 1;
+  }
+
+  // --- Workers ---
+  // Refreshes can take minutes, so each manager fetches on a worker with a private brew_t, and the managers run concurrently: a round
+  // takes as long as its slowest manager, not the sum. This thread is the publisher: it owns the check timer, the signals and the
+  // transport, and picks up finished fetches through the jobs' latest slots.
+  static struct worker_pool pool;
+  if (!replay_path) {
+    if (!worker_pool_start(&pool, jobs > 0 ? jobs : manager_count)) {
+      log_message(true, "Cannot start the fetch workers.");
+      for (int i = 0; i < manager_count; i++) {
+        brew_cleanup(&managers[i].worker);
+        brew_cleanup(&managers[i].state);
+      }
+      busy_gate_cleanup(&gate);
+      return 1;
+    }
+    for (int i = 0; i < manager_count; i++) {
+      managers[i].worker.record_log = record_path ? &sample_log : NULL;
+      worker_job_init(&managers[i].fetch_job, fetch_outdated, &managers[i].worker, brew_result_free);
+    }
+  }
+
   // --- Main Loop ---
   // The first check is triggered immediately to populate the bar on startup.
-  g_force_check_flag = 1;
+  g_force_check_flag  = 1;
+  time_t next_check   = 0;
+  bool   round_update = false; // Results applied since the last trigger
 
   while (!g_terminate_flag) {
-    if (g_force_check_flag) {
+    if (g_force_check_flag || monotonic_seconds() >= next_check) {
+      bool forced        = g_force_check_flag;
       g_force_check_flag = 0;
-      check_and_notify(&brew_state, event_name, true, verbose_mode);
-    } else {
-      check_and_notify(&brew_state, event_name, false, verbose_mode);
+      check_and_notify(managers, manager_count, &published, &gate, &pool, event_name, update_interval_secs, forced, verbose_mode);
+      next_check = monotonic_seconds() + check_interval_secs;
     }
 
-    // Sleep in chunks to remain responsive to signals
-    for (int i = 0; i < check_interval_secs * 2; ++i) {
-      if (g_terminate_flag || g_force_check_flag)
-        break;
-      usleep(500000); // Sleep for 0.5 seconds
+    // A listener out of sync asked for the full list; the set itself has not changed.
+    if (g_full_list_flag) {
+      g_full_list_flag          = 0;
+      published.full_requested = true;
+      notify(managers, manager_count, &published, event_name);
+    }
+
+    // Wake up for a finished fetch, and at least every 0.5 seconds to remain responsive to signals
+    worker_pool_wait(&pool, 500);
+
+    for (int i = 0; i < manager_count; i++) {
+      brew_result_t* result = latest_take(&managers[i].fetch_job.result);
+      if (!result)
+        continue;
+      if (result->last_error != BREW_SUCCESS)
+        log_message(verbose_mode, "%s: fetch failed with error: %s", managers[i].state.backend->name,
+                    brew_error_string(result->last_error));
+      else
+        log_message(verbose_mode, "%s: fetch successful. Found %d outdated packages.", managers[i].state.backend->name,
+                    result->outdated_count);
+      brew_apply_result(&managers[i].state, result);
+      round_update = true;
+    }
+
+    // One merged trigger per round, once the slowest manager is done
+    if (round_update && !any_fetch_running(managers, manager_count)) {
+      notify(managers, manager_count, &published, event_name);
+      round_update = false;
+      next_check   = monotonic_seconds() + check_interval_secs; // This trigger already covers the current interval
     }
   }
 
   // --- Cleanup ---
-  brew_cleanup(&brew_state);
+  // A fetch still running keeps using its worker state and the log until the process exits.
+  bool running = replay_path ? false : any_fetch_running(managers, manager_count);
+  for (int i = 0; i < manager_count; i++) {
+    if (!replay_path && !worker_job_busy(&managers[i].fetch_job)) {
+      latest_cleanup(&managers[i].fetch_job.result);
+      brew_cleanup(&managers[i].worker);
+    }
+    brew_cleanup(&managers[i].state);
+  }
+  if (!running)
+    sample_log_close(&sample_log);
+  outdated_set_free(&published.set);
+  busy_gate_cleanup(&gate);
   log_message(verbose_mode, "Terminating gracefully.");
   return 0;
 }
 
 /**
- * @brief Performs the brew check and sends a trigger to Sketchybar.
+ * @brief Enables the package managers named in a --managers list.
+ *
+ * The list is "auto", which enables every known manager found on this machine, or a comma-separated list of names, each optionally
+ * followed by "=<path>" to use a specific executable (e.g. a wrapper, or a fake manager in tests). In replay mode no executable is
+ * needed, and "auto" enables managers as the recorded outputs name them.
+ *
+ * @param managers The array to fill, BREW_MAX_BACKENDS entries.
+ * @param list The --managers argument.
+ * @param timeout Time allowed to each command, or 0 for the backend defaults.
+ * @param replay True with --replay.
+ * @param verbose If true, logs the enabled managers.
+ * @return The number of enabled managers, or -1 if the list names an unknown or missing manager.
+ */
+static int setup_managers(manager_t* managers, const char* list, int timeout, bool replay, bool verbose) {
+  int count = 0;
+
+  if (strcmp(list, "auto") == 0) {
+    for (int i = 0; i < BREW_BACKEND_COUNT && !replay && count < BREW_MAX_BACKENDS; i++) {
+      if (brew_init(&managers[count].state, &BREW_BACKENDS[i], NULL, timeout) != BREW_SUCCESS) {
+        brew_cleanup(&managers[count].state);
+        continue;
+      }
+      if (brew_init(&managers[count].worker, &BREW_BACKENDS[i], managers[count].state.executable, timeout) != BREW_SUCCESS) {
+        brew_cleanup(&managers[count].state);
+        brew_cleanup(&managers[count].worker);
+        continue;
+      }
+      log_message(verbose, "Enabled %s (%s).", BREW_BACKENDS[i].name, managers[count].state.executable);
+      count++;
+    }
+    return count;
+  }
+
+  char names[512];
+  snprintf(names, sizeof(names), "%s", list);
+  char* saveptr = NULL;
+  for (char* name = strtok_r(names, ",", &saveptr); name; name = strtok_r(NULL, ",", &saveptr)) {
+    char* path = strchr(name, '=');
+    if (path)
+      *path++ = '\0';
+
+    const brew_backend_t* backend = brew_backend_find(name);
+    if (!backend || count == BREW_MAX_BACKENDS) {
+      log_message(true, "Unknown package manager '%s'.", name);
+      return -1;
+    }
+
+    manager_t*   manager = &managers[count++];
+    brew_error_t err     = brew_init(&manager->state, backend, path, timeout);
+    if (err == BREW_SUCCESS && !replay)
+      err = brew_init(&manager->worker, backend, manager->state.executable, timeout);
+    if (err == BREW_ERROR_NOT_INSTALLED && replay)
+      manager->state.last_error = err = BREW_SUCCESS;
+    if (err != BREW_SUCCESS) {
+      log_message(true, "%s: %s.", name, brew_error_string(err));
+      return -1;
+    }
+    log_message(verbose, "Enabled %s (%s).", name, manager->state.executable);
+  }
+  return count;
+}
+
+/**
+ * @return True if at least one manager is still fetching.
+ */
+static bool any_fetch_running(manager_t* managers, int count) {
+  for (int i = 0; i < count; i++) {
+    if (worker_job_busy(&managers[i].fetch_job))
+      return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Performs the check, starts a fetch for every manager that is due, and sends a trigger to Sketchybar.
  *
- * @param brew The brew state structure.
+ * The busy gate is sampled once per check, forced or not, so that its idle streak counts consecutive check intervals, and then applies
+ * to every manager. When a due update is deferred, the reason replaces the error field of the trigger. Fetches never run here: while
+ * any of them is running, the merged trigger is left to the main loop, which sends it when the slowest manager is done.
+ *
+ * @param managers The enabled managers.
+ * @param count The number of enabled managers.
+ * @param published What the bar has been sent so far.
+ * @param gate The busy gate.
+ * @param pool The worker pool.
  * @param event_name The name of the custom event to trigger.
+ * @param update_interval The minimum time in seconds between two refreshes of a manager.
  * @param force_update If true, ignores the time interval and system load checks.
  * @param verbose If true, enables detailed logging for this operation.
  */
-static void check_and_notify(brew_t* brew, const char* event_name, bool force_update, bool verbose) {
-  if (force_update || brew_needs_update(brew, DEFAULT_UPDATE_INTERVAL)) {
-    log_message(verbose, "Fetching outdated packages (forced: %s)...", force_update ? "yes" : "no");
-
-    // Capture the return value to satisfy the [[nodiscard]] attribute.
-    brew_error_t fetch_err = brew_fetch_outdated(brew);
-    if (fetch_err != BREW_SUCCESS) {
-      log_message(verbose, "Fetch failed with error: %s", brew_error_string(fetch_err));
-    } else {
-      log_message(verbose, "Fetch successful. Found %d outdated packages.", brew->outdated_count);
+static void check_and_notify(manager_t* managers, int count, published_t* published, busy_gate_t* gate, struct worker_pool* pool,
+                             const char* event_name, long update_interval, bool force_update, bool verbose) {
+  if (busy_gate_sample(gate))
+    log_message(verbose, "System busy: %s", gate->reason);
+
+  for (int i = 0; i < count; i++) {
+    brew_t* brew         = &managers[i].state;
+    bool    needs_update = brew_needs_update(brew, gate, (int)update_interval);
+    if (force_update) {
+      brew->defer_reason[0] = '\0';
+    } else if (brew->defer_reason[0] != '\0') {
+      log_message(verbose, "%s: %s", brew->backend->name, brew->defer_reason);
+    }
+
+    if (force_update || needs_update) {
+      if (worker_submit(pool, &managers[i].fetch_job))
+        log_message(verbose, "%s: fetching outdated packages in the background (forced: %s)...", brew->backend->name,
+                    force_update ? "yes" : "no");
+      else
+        log_message(verbose, "%s: a fetch is already running.", brew->backend->name);
+    }
+  }
+
+  // The round in progress sends its own trigger when it completes.
+  if (any_fetch_running(managers, count))
+    return;
+  notify(managers, count, published, event_name);
+}
+
+/**
+ * @brief Worker side of a fetch: refreshes and lists one manager on the worker's private brew_t and publishes a snapshot.
+ *
+ * @param context The worker's brew_t.
+ * @param result The latest slot read by the main loop.
+ */
+static void fetch_outdated(void* context, struct latest* result) {
+  brew_t* brew = context;
+
+  uint64_t     trace_start = trace_begin();
+  brew_error_t err         = brew_fetch_outdated(brew);
+  trace_end(TRACE_SAMPLE, trace_start);
+  (void)err; // Also stored in brew->last_error, which the snapshot carries.
+
+  brew_result_t* snapshot = brew_result_create(brew);
+  if (snapshot)
+    latest_put(result, snapshot);
+}
+
+/**
+ * @brief Gets a monotonic time in seconds for the check timer, unaffected by wall clock changes.
+ */
+static time_t monotonic_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec;
+}
+
+/**
+ * @brief Builds the merged outdated set of all managers.
+ *
+ * With more than one manager each package is prefixed with its manager, e.g. "apt:curl", so the same name in two managers stays two
+ * entries.
+ *
+ * @return False if memory allocation failed.
+ */
+static bool merge_outdated(const manager_t* managers, int count, outdated_set_t* set) {
+  char package[BREW_MAX_PACKAGE_NAME + 32];
+  for (int i = 0; i < count; i++) {
+    const brew_t* brew = &managers[i].state;
+    const char*   list = brew->package_list ? brew->package_list : "";
+    while (*list) {
+      size_t length = strcspn(list, ",");
+      snprintf(package, sizeof(package), "%s%s%.*s", count > 1 ? brew->backend->name : "", count > 1 ? ":" : "", (int)length, list);
+      if (!outdated_set_add(set, package))
+        return false;
+      list += length + (list[length] == ',');
     }
   }
+  return outdated_set_finish(set);
+}
+
+/**
+ * @brief Sends the merged state of all managers to Sketchybar.
+ *
+ * outdated_count merges every manager; `managers` lists the enabled managers and outdated_<name> carries each one's count. The
+ * package list travels as a delta: `added` and `removed` turn generation `base` into `generation`, and an unchanged set sends both
+ * empty with base equal to generation. The full list is sent in pending_updates, with full='1', only on the first trigger and on
+ * request (SIGUSR2). The first deferral reason, or else the first error, fills the error field.
+ *
+ * @param managers The enabled managers.
+ * @param count The number of enabled managers.
+ * @param published What the bar has been sent so far; updated to the state sent.
+ * @param event_name The name of the custom event to trigger.
+ */
+static void notify(const manager_t* managers, int count, published_t* published, const char* event_name) {
+  int         total      = 0;
+  time_t      last_check = 0;
+  const char* error      = NULL;
+  char        error_buf[BUSY_REASON_LENGTH + 64];
+  for (int i = 0; i < count; i++) {
+    const brew_t* brew = &managers[i].state;
+    total += brew->outdated_count;
+    if (brew->last_check > last_check)
+      last_check = brew->last_check;
+    if (!error && brew->defer_reason[0] != '\0')
+      error = brew->defer_reason;
+  }
+  for (int i = 0; i < count && !error; i++) {
+    const brew_t* brew = &managers[i].state;
+    if (brew->last_error == BREW_SUCCESS)
+      continue;
+    snprintf(error_buf, sizeof(error_buf), count > 1 ? "%s: %s" : "%.0s%s", brew->backend->name, brew_error_string(brew->last_error));
+    error = error_buf;
+  }
+
+  outdated_set_t current;
+  outdated_set_init(&current);
+  if (!merge_outdated(managers, count, &current)) {
+    outdated_set_free(&current);
+    return;
+  }
+
+  // Both deltas fit in the two sets, the full list in the current one
+  size_t size            = (size_t)MAX_MESSAGE_LENGTH + current.bytes * 2 + published->set.bytes;
+  char*  trigger_message = malloc(size);
+  char*  added           = malloc(current.bytes);
+  char*  removed         = malloc(published->set.bytes);
+  if (!trigger_message || !added || !removed) {
+    free(trigger_message);
+    free(added);
+    free(removed);
+    outdated_set_free(&current);
+    return;
+  }
+
+  bool          full    = published->generation == 0 || published->full_requested;
+  int           changes = outdated_set_join(&current, &published->set, added, current.bytes);
+  unsigned long base    = published->generation;
+  changes += outdated_set_join(&published->set, &current, removed, published->set.bytes);
+  if (changes > 0 || published->generation == 0)
+    published->generation++;
+  if (full)
+    added[0] = removed[0] = '\0';
 
   // Prepare the message for Sketchybar
-  char trigger_message[MAX_MESSAGE_LENGTH];
-  snprintf(
-      trigger_message, sizeof(trigger_message), "--trigger %s outdated_count='%d' pending_updates='%s' last_check='%ld' error='%s'",
-      event_name, brew->outdated_count, brew->package_list ? brew->package_list : "", (long)brew->last_check,
-      brew_error_string(brew->last_error));
+  size_t used = (size_t)snprintf(trigger_message, size,
+                                 "--trigger %s outdated_count='%d' generation='%lu' base='%lu' added='%s' removed='%s' full='%d'",
+                                 event_name, total, published->generation, base, added, removed, full);
+  if (full) {
+    used += (size_t)snprintf(trigger_message + used, size - used, " pending_updates='");
+    outdated_set_join(&current, NULL, trigger_message + used, size - used);
+    used += strlen(trigger_message + used);
+    used += (size_t)snprintf(trigger_message + used, size - used, "'");
+  }
+  used += (size_t)snprintf(trigger_message + used, size - used, " managers='");
+  for (int i = 0; i < count; i++)
+    used += (size_t)snprintf(trigger_message + used, size - used, "%s%s", i ? " " : "", managers[i].state.backend->name);
+  used += (size_t)snprintf(trigger_message + used, size - used, "'");
+  for (int i = 0; i < count; i++)
+    used += (size_t)snprintf(trigger_message + used, size - used, " outdated_%s='%d'", managers[i].state.backend->name,
+                             managers[i].state.outdated_count);
+  snprintf(trigger_message + used, size - used, " last_check='%ld' error='%s'", (long)last_check, error ? error : "Success");
 
   // Send the command to Sketchybar
   sketchybar(trigger_message);
+
+  outdated_set_move(&published->set, &current);
+  published->full_requested = false;
+  free(trigger_message);
+  free(added);
+  free(removed);
+}
+
+/**
+ * @brief Feeds recorded outdated listings through the parse and notify path (--replay).
+ *
+ * Each record is replayed at its recorded time divided by the replay speed; no package manager and no busy gate are involved. A
+ * record starting with "#<name>" belongs to that manager; older logs without the header hold `brew outdated` outputs. With
+ * --managers auto, managers are enabled as records name them.
+ *
+ * @param managers The enabled managers.
+ * @param count The number of enabled managers, increased when a record enables a new one.
+ * @param enable_new True with --managers auto.
+ * @param published What the bar has been sent so far.
+ * @param log The log opened for replay.
+ * @param event_name The name of the custom event to trigger.
+ * @param verbose If true, enables detailed logging for this operation.
+ */
+static void replay_outdated(manager_t* managers, int* count, bool enable_new, published_t* published, struct sample_log* log,
+                            const char* event_name, bool verbose) {
+  struct sample_record record = {0};
+  while (!g_terminate_flag && sample_log_next(log, &record)) {
+    if (record.type != SAMPLE_RECORD_BLOB)
+      continue;
+
+    char  name[32] = "brew";
+    char* output   = record.blob;
+    if (output[0] == '#') {
+      size_t length = strcspn(output + 1, "\n");
+      snprintf(name, sizeof(name), "%.*s", (int)length, output + 1);
+      output += 1 + length + (output[1 + length] == '\n');
+    }
+
+    brew_t* brew = NULL;
+    for (int i = 0; i < *count && !brew; i++) {
+      if (strcmp(managers[i].state.backend->name, name) == 0)
+        brew = &managers[i].state;
+    }
+    const brew_backend_t* backend = brew_backend_find(name);
+    if (!brew && enable_new && backend && *count < BREW_MAX_BACKENDS) {
+      brew = &managers[*count].state;
+      if (brew_init(brew, backend, NULL, 0) == BREW_ERROR_NOT_INSTALLED)
+        brew->last_error = BREW_SUCCESS;
+      if (!brew->package_list)
+        continue;
+      (*count)++;
+    }
+    if (!brew) {
+      log_message(verbose, "Skipped a record of '%s', a manager not enabled.", name);
+      continue;
+    }
+
+    brew->last_check = time(NULL);
+    brew->last_error = brew_parse_outdated(brew, output);
+    log_message(verbose, "Replayed %zu bytes, %s: %d outdated packages.", record.blob_length, name, brew->outdated_count);
+    notify(managers, *count, published, event_name);
+  }
 }
 
 /**
@@ -144,6 +596,9 @@ static void handle_signal(int sig) {
   case SIGUSR1:
     g_force_check_flag = 1;
     break;
+  case SIGUSR2:
+    g_full_list_flag = 1;
+    break;
   }
 }
 
@@ -152,7 +607,27 @@ static void handle_signal(int sig) {
  * @param program_name The name of the executable (argv[0]).
  */
 static void show_usage(const char* program_name) {
-  fprintf(stderr, "Usage: %s <event_name> [check_interval_s] [update_interval_s] [--verbose]\n", program_name);
+  char names[256] = "";
+  for (int i = 0; i < BREW_BACKEND_COUNT; i++)
+    snprintf(names + strlen(names), sizeof(names) - strlen(names), "%s%s", i ? " " : "", BREW_BACKENDS[i].name);
+
+  fprintf(stderr,
+          "Usage: %s <event_name> [check_interval_s] [update_interval_s] [--verbose]\n"
+          "       [--managers auto|name[=path],...] [--jobs n] [--timeout s]\n"
+          "       [--busy-cpu pct] [--busy-io pct] [--busy-memory pct] [--idle-samples n]\n"
+          "       [--record file | --replay file [--speed N]]\n"
+          "\n"
+          "--managers picks the package managers to check (default auto: every one installed) among:\n"
+          "       %s\n"
+          "They are checked concurrently on up to n workers (default: one per manager, at most %d), and each command is\n"
+          "killed after s seconds (default: per manager). The trigger carries the merged count plus outdated_<name>, and the\n"
+          "package list as added/removed deltas between generations; SIGUSR2 resends the full list, SIGUSR1 forces a check.\n"
+          "Due updates wait for n consecutive idle checks (default %d). On Linux the thresholds apply to the PSI 'some avg10'\n"
+          "of /proc/pressure/{cpu,io,memory}; without PSI, and on macOS, --busy-cpu is the share of non-idle CPU ticks and,\n"
+          "on macOS, any non-zero --busy-memory defers on kernel memory pressure. A threshold of 0 disables that check.\n"
+          "--record appends every outdated listing to a binary log; --replay sends the recorded results again\n"
+          "at N times the recorded pace (0 = as fast as possible) without running any package manager.\n",
+          program_name, names, WORKER_MAX_THREADS, BUSY_DEFAULT_IDLE_SAMPLES);
 }
 
 /**
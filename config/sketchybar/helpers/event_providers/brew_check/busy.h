@@ -0,0 +1,207 @@
+#ifndef BUSY_H
+#define BUSY_H
+
+#include "../cpu_load/cpu.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __APPLE__
+#include <sys/sysctl.h>
+#endif
+
+// --- Constants ---
+
+/** @brief Default Linux PSI thresholds: `some avg10` percentage of time in which at least one task stalled on the resource. */
+static const double BUSY_DEFAULT_PSI_CPU    = 20.0;
+static const double BUSY_DEFAULT_PSI_IO     = 10.0;
+static const double BUSY_DEFAULT_PSI_MEMORY = 5.0;
+
+/** @brief Default CPU threshold when only tick deltas are available (macOS, or Linux without PSI): percentage of non-idle ticks. */
+static const double BUSY_DEFAULT_CPU_LOAD = 40.0;
+
+/** @brief Consecutive idle samples required before the system counts as idle. One sample is taken per check interval. */
+static const int BUSY_DEFAULT_IDLE_SAMPLES = 2;
+
+/** @brief Maximum length of the human-readable defer reason. */
+#define BUSY_REASON_LENGTH 128
+
+// --- Data Structures ---
+
+/**
+ * @enum busy_resource_t
+ * @brief Resources watched by the busy gate, also used as indices into the PSI sources.
+ */
+typedef enum {
+  BUSY_RESOURCE_CPU = 0,
+  BUSY_RESOURCE_IO,
+  BUSY_RESOURCE_MEMORY,
+  BUSY_RESOURCE_COUNT,
+} busy_resource_t;
+
+/**
+ * @struct busy_gate_t
+ * @brief Decides whether the system is idle enough for heavy background work.
+ *
+ * On Linux the gate reads the `some avg10` line of /proc/pressure/{cpu,io,memory}, which reacts within seconds and also covers tasks
+ * stalled on I/O and reclaim. Without PSI (older kernels, macOS) it falls back to the CPU tick deltas of cpu.h over the check interval;
+ * macOS additionally reports the kernel memory pressure level. A threshold of 0 disables the corresponding resource.
+ */
+typedef struct {
+  double thresholds[BUSY_RESOURCE_COUNT]; /**< Per-resource busy threshold, in percent. 0 disables the check. */
+  int    idle_samples;                    /**< Consecutive idle samples required to open an idle window. */
+  int    idle_streak;                     /**< Consecutive idle samples observed so far. */
+  struct cpu cpu;                         /**< Tick-delta fallback, sampled once per check. */
+#ifndef __APPLE__
+  struct batch_source pressure[BUSY_RESOURCE_COUNT]; /**< Persistent /proc/pressure sources, fd -1 when unavailable. */
+  bool                has_psi;                       /**< True if at least one PSI source could be opened. */
+#endif
+  char reason[BUSY_REASON_LENGTH]; /**< Why the last sample was busy, empty when idle. */
+} busy_gate_t;
+
+// --- Public API ---
+
+/**
+ * @brief Gets the name of a resource, as used in defer reasons.
+ */
+[[nodiscard]] static inline const char* busy_resource_name(busy_resource_t resource) {
+  switch (resource) {
+  case BUSY_RESOURCE_CPU:
+    return "cpu";
+  case BUSY_RESOURCE_IO:
+    return "io";
+  case BUSY_RESOURCE_MEMORY:
+    return "memory";
+  default:
+    return "unknown";
+  }
+}
+
+/**
+ * @brief Initializes the gate with the platform default thresholds and takes the first tick sample.
+ * @param gate A pointer to the busy_gate_t struct to initialize.
+ */
+static inline void busy_gate_init(busy_gate_t* gate) {
+  if (!gate)
+    return;
+
+  memset(gate, 0, sizeof(busy_gate_t));
+  gate->idle_samples = BUSY_DEFAULT_IDLE_SAMPLES;
+
+#ifdef __APPLE__
+  gate->thresholds[BUSY_RESOURCE_CPU]    = BUSY_DEFAULT_CPU_LOAD;
+  gate->thresholds[BUSY_RESOURCE_MEMORY] = BUSY_DEFAULT_PSI_MEMORY;
+#else
+  static const char* pressure_paths[BUSY_RESOURCE_COUNT] = {"/proc/pressure/cpu", "/proc/pressure/io", "/proc/pressure/memory"};
+  for (int i = 0; i < BUSY_RESOURCE_COUNT; i++) {
+    char path[BATCH_PATH_LENGTH];
+    gate->pressure[i].fd = -1;
+    if (batch_path(path, sizeof(path), pressure_paths[i]) && batch_source_open(&gate->pressure[i], path, 256))
+      gate->has_psi = true;
+  }
+
+  gate->thresholds[BUSY_RESOURCE_CPU]    = gate->has_psi ? BUSY_DEFAULT_PSI_CPU : BUSY_DEFAULT_CPU_LOAD;
+  gate->thresholds[BUSY_RESOURCE_IO]     = BUSY_DEFAULT_PSI_IO;
+  gate->thresholds[BUSY_RESOURCE_MEMORY] = BUSY_DEFAULT_PSI_MEMORY;
+#endif
+
+  // Prime the tick counters so that the first sample already has a delta.
+  cpu_init(&gate->cpu);
+  cpu_update(&gate->cpu);
+}
+
+/**
+ * @brief Releases the PSI sources held by the gate.
+ */
+static inline void busy_gate_cleanup(busy_gate_t* gate) {
+  if (!gate)
+    return;
+#ifndef __APPLE__
+  for (int i = 0; i < BUSY_RESOURCE_COUNT; i++)
+    batch_source_close(&gate->pressure[i]);
+  batch_source_close(&gate->cpu.source);
+#endif
+}
+
+#ifndef __APPLE__
+/**
+ * @brief [Private] Reads the `some avg10` value of a PSI source.
+ * @return The stall percentage, or a negative value if the source is unavailable or malformed.
+ */
+static inline double _busy_read_pressure(struct batch_source* source) {
+  if (source->fd < 0 || !batch_source_pread(source, NULL))
+    return -1.0;
+
+  // Format: "some avg10=1.23 avg60=0.45 avg300=0.10 total=123456"
+  const char* field = strstr(source->buffer, "some avg10=");
+  if (!field)
+    return -1.0;
+  return strtod(field + strlen("some avg10="), NULL);
+}
+#endif
+
+/**
+ * @brief Samples the system once and updates the idle streak.
+ *
+ * Meant to be called once per check interval, whether or not an update is due, so that the tick delta covers exactly one interval
+ * and the streak reflects consecutive checks.
+ *
+ * @param gate A pointer to the busy_gate_t struct.
+ * @return True if this sample was busy; the reason is then stored in gate->reason.
+ */
+static inline bool busy_gate_sample(busy_gate_t* gate) {
+  if (!gate)
+    return false;
+
+  gate->reason[0] = '\0';
+  cpu_update(&gate->cpu);
+
+#ifndef __APPLE__
+  if (gate->has_psi) {
+    for (int i = 0; i < BUSY_RESOURCE_COUNT && gate->reason[0] == '\0'; i++) {
+      double pressure = _busy_read_pressure(&gate->pressure[i]);
+      if (gate->thresholds[i] > 0.0 && pressure >= gate->thresholds[i])
+        snprintf(gate->reason, sizeof(gate->reason), "%s pressure %.1f%% >= %.1f%%", busy_resource_name(i), pressure, gate->thresholds[i]);
+    }
+  } else
+#endif
+  {
+    double threshold = gate->thresholds[BUSY_RESOURCE_CPU];
+    if (threshold > 0.0 && gate->cpu.total_load >= threshold)
+      snprintf(gate->reason, sizeof(gate->reason), "cpu load %d%% >= %.0f%%", gate->cpu.total_load, threshold);
+  }
+
+#ifdef __APPLE__
+  // 1 = normal, 2 = warning, 4 = critical. There is no percentage to compare, so any non-zero threshold means "defer from warning up".
+  int    level = 0;
+  size_t len   = sizeof(level);
+  if (gate->reason[0] == '\0' && gate->thresholds[BUSY_RESOURCE_MEMORY] > 0.0 &&
+      sysctlbyname("kern.memorystatus_vm_pressure_level", &level, &len, NULL, 0) == 0 && level >= 2)
+    snprintf(gate->reason, sizeof(gate->reason), "memory pressure %s", level >= 4 ? "critical" : "warning");
+#endif
+
+  bool busy         = gate->reason[0] != '\0';
+  gate->idle_streak = busy ? 0 : gate->idle_streak + 1;
+  return busy;
+}
+
+/**
+ * @brief Tells whether the system has been idle for enough consecutive samples.
+ *
+ * When it has not, and the last sample itself was idle, gate->reason explains that the idle window is still opening.
+ *
+ * @param gate A pointer to the busy_gate_t struct.
+ * @return True if heavy work can start now.
+ */
+[[nodiscard]] static inline bool busy_gate_is_idle(busy_gate_t* gate) {
+  if (!gate)
+    return true;
+  if (gate->idle_streak >= gate->idle_samples)
+    return true;
+  if (gate->reason[0] == '\0')
+    snprintf(gate->reason, sizeof(gate->reason), "waiting for idle window (%d/%d)", gate->idle_streak, gate->idle_samples);
+  return false;
+}
+
+#endif /* BUSY_H */
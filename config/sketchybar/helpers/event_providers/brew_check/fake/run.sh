@@ -0,0 +1,60 @@
+#!/bin/sh
+# Runs one brew_check round against the fake managers in this directory.
+#
+# brew (2 s), apt (3 s), npm (1 s) and a hung manager standing in for dnf
+# run with --timeout 5. Checked concurrently, the round ends when the hung
+# manager is killed, about 5 s after the start, instead of the 11 s a
+# sequential check would take. The merged trigger must carry every count and
+# the timeout error.
+#
+# Triggers are read from stdout, where brew_check writes them when there is
+# no sketchybar to talk to (Linux).
+#
+# Usage: run.sh [path/to/brew_check]
+
+set -u
+dir=$(cd "$(dirname "$0")" && pwd)
+bin=${1:-$dir/../bin/brew_check}
+out=$(mktemp)
+trap 'rm -f "$out"' EXIT
+
+start=$(date +%s)
+"$bin" fake_update 3600 3600 --managers "brew=$dir/brew,apt=$dir/apt,npm=$dir/npm,dnf=$dir/hung" --timeout 5 >"$out" 2>/dev/null &
+pid=$!
+
+# The first trigger closes the round; give up after 15 s
+tries=0
+while ! grep -q -- '--trigger' "$out" && [ $tries -lt 150 ]; do
+  sleep 0.1
+  tries=$((tries + 1))
+done
+elapsed=$(($(date +%s) - start))
+kill "$pid" 2>/dev/null
+wait "$pid" 2>/dev/null
+
+trigger=$(grep -- '--trigger' "$out" | head -n 1)
+echo "round: ${elapsed} s"
+echo "$trigger"
+
+failed=0
+expect() {
+  case "$trigger" in
+    *"$1"*) ;;
+    *) echo "FAIL: missing $1"; failed=1 ;;
+  esac
+}
+expect "outdated_count='6'"
+expect "outdated_brew='2'"
+expect "outdated_apt='3'"
+expect "outdated_npm='1'"
+expect "outdated_dnf='0'"
+expect "error='dnf: Command timed out'"
+
+# Sequentially the round would take 2 + 3 + 1 + 5 = 11 s
+if [ "$elapsed" -lt 4 ] || [ "$elapsed" -gt 7 ]; then
+  echo "FAIL: round took ${elapsed} s, expected about 5 s"
+  failed=1
+fi
+
+[ $failed -eq 0 ] && echo "ok"
+exit $failed
@@ -0,0 +1,177 @@
+#ifndef OUTDATED_SET_H
+#define OUTDATED_SET_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// --- Data Structures ---
+
+/**
+ * @struct outdated_set_t
+ * @brief A set of package names, kept sorted for stable output and hashed for constant-time membership.
+ *
+ * Names are added in any order and the set is sealed with outdated_set_finish, which sorts, drops duplicates and builds an
+ * open-addressing index over the sorted array. Diffing two sealed sets walks one and probes the other, so a check that changes a few
+ * packages costs a few hash lookups per name instead of string scans over both lists.
+ */
+typedef struct {
+  char**  items;      /**< Owned names, sorted once the set is sealed. */
+  int     count;      /**< Number of names. */
+  int     capacity;   /**< Allocated entries of items. */
+  int*    slots;      /**< Open-addressing index into items, -1 for an empty slot. */
+  int     slot_count; /**< Size of slots, a power of two at least twice count. */
+  size_t  bytes;      /**< Length of all names joined with commas, terminator included. */
+} outdated_set_t;
+
+// --- Helpers ---
+
+/** @brief FNV-1a hash of a package name. */
+[[nodiscard]] static inline uint32_t _outdated_hash(const char* name) {
+  uint32_t hash = 2166136261u;
+  for (const unsigned char* c = (const unsigned char*)name; *c; c++)
+    hash = (hash ^ *c) * 16777619u;
+  return hash;
+}
+
+/** @brief qsort comparator for the items array. */
+static inline int _outdated_compare(const void* a, const void* b) {
+  return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+// --- Public API ---
+
+/**
+ * @brief Initializes an empty set.
+ */
+static inline void outdated_set_init(outdated_set_t* set) {
+  memset(set, 0, sizeof(outdated_set_t));
+  set->bytes = 1;
+}
+
+/**
+ * @brief Frees all names and the index.
+ */
+static inline void outdated_set_free(outdated_set_t* set) {
+  for (int i = 0; i < set->count; i++)
+    free(set->items[i]);
+  free(set->items);
+  free(set->slots);
+  outdated_set_init(set);
+}
+
+/**
+ * @brief Adds a name; the set must be sealed again with outdated_set_finish before lookups.
+ * @return False if memory allocation failed.
+ */
+[[nodiscard]] static inline bool outdated_set_add(outdated_set_t* set, const char* name) {
+  if (set->count == set->capacity) {
+    int    capacity = set->capacity ? set->capacity * 2 : 32;
+    char** items    = realloc(set->items, (size_t)capacity * sizeof(char*));
+    if (!items)
+      return false;
+    set->items    = items;
+    set->capacity = capacity;
+  }
+  char* copy = strdup(name);
+  if (!copy)
+    return false;
+  set->items[set->count++] = copy;
+  return true;
+}
+
+/**
+ * @brief Sorts the names, drops duplicates and rebuilds the hash index.
+ * @return False if memory allocation failed.
+ */
+[[nodiscard]] static inline bool outdated_set_finish(outdated_set_t* set) {
+  if (set->count > 1)
+    qsort(set->items, (size_t)set->count, sizeof(char*), _outdated_compare);
+
+  int unique = 0;
+  set->bytes = 1;
+  for (int i = 0; i < set->count; i++) {
+    if (unique > 0 && strcmp(set->items[unique - 1], set->items[i]) == 0) {
+      free(set->items[i]);
+      continue;
+    }
+    set->items[unique++] = set->items[i];
+    set->bytes += strlen(set->items[i]) + 1;
+  }
+  set->count = unique;
+
+  int slot_count = 16;
+  while (slot_count < set->count * 2)
+    slot_count *= 2;
+  if (slot_count != set->slot_count) {
+    int* slots = realloc(set->slots, (size_t)slot_count * sizeof(int));
+    if (!slots)
+      return false;
+    set->slots      = slots;
+    set->slot_count = slot_count;
+  }
+  for (int i = 0; i < set->slot_count; i++)
+    set->slots[i] = -1;
+  for (int i = 0; i < set->count; i++) {
+    uint32_t slot = _outdated_hash(set->items[i]) & (uint32_t)(set->slot_count - 1);
+    while (set->slots[slot] >= 0)
+      slot = (slot + 1) & (uint32_t)(set->slot_count - 1);
+    set->slots[slot] = i;
+  }
+  return true;
+}
+
+/**
+ * @brief Tests membership in a sealed set.
+ */
+[[nodiscard]] static inline bool outdated_set_contains(const outdated_set_t* set, const char* name) {
+  if (!set->slot_count)
+    return false;
+  for (uint32_t slot = _outdated_hash(name) & (uint32_t)(set->slot_count - 1); set->slots[slot] >= 0;
+       slot = (slot + 1) & (uint32_t)(set->slot_count - 1)) {
+    if (strcmp(set->items[set->slots[slot]], name) == 0)
+      return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Joins, in sorted order and separated by commas, the names of a set that are missing from another one.
+ *
+ * outdated_set_join(new, old) gives the added packages, outdated_set_join(old, new) the removed ones, and a NULL other set the full
+ * list. A buffer of set->bytes bytes is always large enough.
+ *
+ * @param set The sealed set to walk.
+ * @param other The sealed set to exclude, or NULL.
+ * @param buffer Output buffer.
+ * @param size Size of the buffer.
+ * @return The number of names written.
+ */
+static inline int outdated_set_join(const outdated_set_t* set, const outdated_set_t* other, char* buffer, size_t size) {
+  size_t used    = 0;
+  int    written = 0;
+  buffer[0]      = '\0';
+  for (int i = 0; i < set->count; i++) {
+    if (other && outdated_set_contains(other, set->items[i]))
+      continue;
+    int length = snprintf(buffer + used, size - used, "%s%s", written ? "," : "", set->items[i]);
+    if (length < 0 || (size_t)length >= size - used)
+      break;
+    used += (size_t)length;
+    written++;
+  }
+  return written;
+}
+
+/**
+ * @brief Replaces the contents of a set with another one, which is left empty.
+ */
+static inline void outdated_set_move(outdated_set_t* set, outdated_set_t* from) {
+  outdated_set_free(set);
+  *set = *from;
+  outdated_set_init(from);
+}
+
+#endif /* OUTDATED_SET_H */
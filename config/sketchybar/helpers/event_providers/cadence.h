@@ -0,0 +1,135 @@
+#ifndef CADENCE_H
+#define CADENCE_H
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * Pubblicazione allineata in fase.
+ *
+ * Ogni provider partiva con il proprio usleep dal momento del lancio, e la
+ * barra ridisegnava in istanti scorrelati più volte per periodo. Qui le
+ * scadenze cadono invece su una griglia comune: multipli del periodo
+ * dall'epoca di CLOCK_MONOTONIC (l'avvio del sistema, la stessa per tutti i
+ * processi), più uno sfasamento per provider. Provider con lo stesso periodo,
+ * o con periodi multipli l'uno dell'altro, si svegliano insieme e i loro
+ * trigger finiscono nello stesso frame della barra.
+ *
+ * Si configura dall'ambiente, come SKETCHYBAR_ASYNC:
+ *   SKETCHYBAR_PHASE_MS=<ms>  sfasamento del provider sulla griglia (default 0)
+ *   SKETCHYBAR_PHASE=off      attese libere di un periodo dopo ogni tick, come prima
+ *
+ * Un tick che supera la propria scadenza salta alle successive invece di
+ * recuperarle in raffica.
+ */
+struct cadence_settings {
+  int      state; // 0 da inizializzare, 1 letto
+  bool     aligned;
+  uint64_t offset_ns;
+};
+
+static struct cadence_settings g_cadence_settings;
+
+/**
+ * Scadenze di un ciclo periodico
+ */
+struct cadence {
+  uint64_t period_ns;
+  uint64_t deadline_ns; // Ultima scadenza attesa, 0 prima della prima attesa
+  uint64_t skipped;     // Scadenze saltate perché il tick le ha superate
+};
+
+/**
+ * @return Orologio monotono in nanosecondi
+ */
+[[nodiscard]] static inline uint64_t cadence_now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * Legge la configurazione dall'ambiente alla prima chiamata
+ */
+static inline const struct cadence_settings* cadence_settings() {
+  struct cadence_settings* settings = &g_cadence_settings;
+  if (settings->state)
+    return settings;
+
+  settings->state     = 1;
+  const char* phase   = getenv("SKETCHYBAR_PHASE");
+  settings->aligned   = !phase || strcmp(phase, "off") != 0;
+  const char* offset  = getenv("SKETCHYBAR_PHASE_MS");
+  double      ms      = offset ? strtod(offset, NULL) : 0;
+  settings->offset_ns = ms > 0 ? (uint64_t)(ms * 1e6) : 0;
+  return settings;
+}
+
+/**
+ * Prossima scadenza di un periodo, strettamente dopo now
+ *
+ * @param period_ns Periodo in nanosecondi
+ * @param now_ns Istante corrente sull'orologio monotono
+ * @return Il primo punto della griglia dopo now, o now + periodo senza allineamento
+ */
+[[nodiscard]] static inline uint64_t cadence_next(uint64_t period_ns, uint64_t now_ns) {
+  const struct cadence_settings* settings = cadence_settings();
+  if (!settings->aligned || period_ns == 0)
+    return now_ns + period_ns;
+
+  // Lo sfasamento è ridotto al periodo: 2500 ms su un periodo di 2 s valgono 500 ms
+  uint64_t offset = settings->offset_ns % period_ns;
+  if (now_ns < offset)
+    return offset;
+  return ((now_ns - offset) / period_ns + 1) * period_ns + offset;
+}
+
+/**
+ * Dorme fino alla scadenza assoluta indicata (orologio monotono)
+ */
+static inline void cadence_sleep_until(uint64_t deadline_ns) {
+#ifdef __APPLE__
+  // Senza clock_nanosleep: attesa relativa, ricalcolata dopo ogni interruzione
+  for (uint64_t now = cadence_now_ns(); now < deadline_ns; now = cadence_now_ns()) {
+    uint64_t        remaining = deadline_ns - now;
+    struct timespec ts        = {.tv_sec = (time_t)(remaining / 1000000000ull), .tv_nsec = (long)(remaining % 1000000000ull)};
+    if (nanosleep(&ts, NULL) == 0)
+      break;
+  }
+#else
+  struct timespec ts = {.tv_sec = (time_t)(deadline_ns / 1000000000ull), .tv_nsec = (long)(deadline_ns % 1000000000ull)};
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+  }
+#endif
+}
+
+/**
+ * Inizializza un ciclo periodico
+ *
+ * @param cadence Ciclo da inizializzare
+ * @param period_seconds Periodo in secondi
+ */
+static inline void cadence_init(struct cadence* cadence, double period_seconds) {
+  memset(cadence, 0, sizeof(struct cadence));
+  cadence->period_ns = period_seconds > 0 ? (uint64_t)(period_seconds * 1e9) : 0;
+}
+
+/**
+ * Attende la prossima scadenza del ciclo
+ *
+ * @param cadence Ciclo da far avanzare
+ */
+static inline void cadence_wait(struct cadence* cadence) {
+  uint64_t next = cadence_next(cadence->period_ns, cadence_now_ns());
+  if (cadence->deadline_ns && cadence->period_ns && next > cadence->deadline_ns + cadence->period_ns)
+    cadence->skipped += (next - cadence->deadline_ns) / cadence->period_ns - 1;
+  cadence->deadline_ns = next;
+  cadence_sleep_until(next);
+}
+
+#endif /* CADENCE_H */
@@ -1,23 +1,33 @@
 #ifndef CPU_H
 #define CPU_H
 
-#include <mach/mach.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <unistd.h>
 
+#ifdef __APPLE__
+#include <mach/mach.h>
+
 struct cpu {
   host_t                    host;
   mach_msg_type_number_t    count;
   host_cpu_load_info_data_t load;
-  host_cpu_load_info_data_t prev_load;
-  bool                      has_prev_load;
+
+  // Tick cumulativi della lettura precedente
+  uint64_t user;
+  uint64_t system;
+  uint64_t idle;
+  bool     has_prev_load;
 
   int user_load;
   int sys_load;
   int total_load;
 };
 
+static inline void cpu_account(struct cpu* cpu, uint64_t user, uint64_t system, uint64_t idle);
+static inline void cpu_load_from_deltas(struct cpu* cpu, uint64_t delta_user, uint64_t delta_system, uint64_t delta_idle);
+
 /**
  * Inizializza una struttura cpu
  *
@@ -54,33 +64,154 @@ static inline void cpu_update(struct cpu* cpu) {
     return;
   }
 
-  if (cpu->has_prev_load) {
-    uint32_t delta_user =
-        cpu->load.cpu_ticks[CPU_STATE_USER] - cpu->prev_load.cpu_ticks[CPU_STATE_USER];
-
-    uint32_t delta_system =
-        cpu->load.cpu_ticks[CPU_STATE_SYSTEM] - cpu->prev_load.cpu_ticks[CPU_STATE_SYSTEM];
-
-    uint32_t delta_idle =
-        cpu->load.cpu_ticks[CPU_STATE_IDLE] - cpu->prev_load.cpu_ticks[CPU_STATE_IDLE];
-
-    // Calcola il delta totale per evitare divisione per zero
-    uint32_t delta_total = delta_system + delta_user + delta_idle;
-
-    if (delta_total > 0) {
-      // Conversione sicura a double prima della divisione
-      cpu->user_load  = (int)(((double)delta_user / (double)delta_total) * 100.0);
-      cpu->sys_load   = (int)(((double)delta_system / (double)delta_total) * 100.0);
-      cpu->total_load = cpu->user_load + cpu->sys_load;
-    } else {
-      // Evita divisione per zero
-      cpu->user_load  = 0;
-      cpu->sys_load   = 0;
-      cpu->total_load = 0;
-    }
+  uint32_t user   = cpu->load.cpu_ticks[CPU_STATE_USER];
+  uint32_t system = cpu->load.cpu_ticks[CPU_STATE_SYSTEM];
+  uint32_t idle   = cpu->load.cpu_ticks[CPU_STATE_IDLE];
+
+  // I tick del kernel sono a 32 bit: la differenza modulare resta esatta anche attraverso l'overflow
+  if (cpu->has_prev_load)
+    cpu_load_from_deltas(cpu, (uint32_t)(user - (uint32_t)cpu->user), (uint32_t)(system - (uint32_t)cpu->system),
+                         (uint32_t)(idle - (uint32_t)cpu->idle));
+
+  cpu->user          = user;
+  cpu->system        = system;
+  cpu->idle          = idle;
+  cpu->has_prev_load = true;
+}
+
+#else
+#include "../batch_read.h"
+#include <stdlib.h>
+#include <string.h>
+
+struct cpu {
+  struct batch_source source; // /proc/stat, tenuto aperto
+  char                path[BATCH_PATH_LENGTH];
+
+  // Tick cumulativi della lettura precedente
+  uint64_t user;
+  uint64_t system;
+  uint64_t idle;
+  bool     has_prev_load;
+
+  int user_load;
+  int sys_load;
+  int total_load;
+};
+
+static inline void cpu_account(struct cpu* cpu, uint64_t user, uint64_t system, uint64_t idle);
+
+/**
+ * Inizializza una struttura cpu
+ *
+ * @param cpu Puntatore alla struttura cpu da inizializzare
+ */
+static inline void cpu_init(struct cpu* cpu) {
+  if (!cpu)
+    return;
+
+  memset(cpu, 0, sizeof(struct cpu));
+  cpu->source.fd = -1;
+
+  if (!batch_path(cpu->path, sizeof(cpu->path), "/proc/stat") || !batch_source_open(&cpu->source, cpu->path, 4096))
+    fprintf(stderr, "Error: Could not open %s: %s\n", cpu->path, strerror(errno));
+}
+
+/**
+ * Calcola il carico dal contenuto di /proc/stat già letto nel buffer della
+ * sorgente (da cpu_update o da uno stadio di raccolta batch_reader)
+ *
+ * @param cpu Puntatore alla struttura cpu da aggiornare
+ */
+static inline void cpu_parse(struct cpu* cpu) {
+  if (!cpu || cpu->source.length <= 0)
+    return;
+
+  // Prima riga: "cpu  user nice system idle iowait irq softirq steal ..."
+  const char* cursor = cpu->source.buffer;
+  if (strncmp(cursor, "cpu ", 4) != 0) {
+    fprintf(stderr, "Error: Unexpected format of %s.\n", cpu->path);
+    return;
   }
+  cursor += 4;
+
+  uint64_t fields[8] = {0};
+  for (int i = 0; i < 8; i++) {
+    char* end = NULL;
+    fields[i] = strtoull(cursor, &end, 10);
+    if (end == cursor)
+      break;
+    cursor = end;
+  }
+
+  // Stesse tre classi di host_statistics: nice conta come user, iowait come idle
+  uint64_t user   = fields[0] + fields[1];
+  uint64_t system = fields[2] + fields[5] + fields[6] + fields[7];
+  uint64_t idle   = fields[3] + fields[4];
+
+  cpu_account(cpu, user, system, idle);
+}
+
+/**
+ * Aggiorna le statistiche CPU con una pread di /proc/stat
+ *
+ * @param cpu Puntatore alla struttura cpu da aggiornare
+ */
+static inline void cpu_update(struct cpu* cpu) {
+  if (!cpu)
+    return;
 
-  cpu->prev_load     = cpu->load;
+  if (!batch_source_pread(&cpu->source, NULL)) {
+    fprintf(stderr, "Error: Could not read %s.\n", cpu->path);
+    return;
+  }
+  cpu_parse(cpu);
+}
+
+#endif
+
+/**
+ * Calcola il carico dai tick trascorsi dalla lettura precedente
+ *
+ * @param cpu Puntatore alla struttura cpu da aggiornare
+ * @param delta_user Tick utente trascorsi
+ * @param delta_system Tick di sistema trascorsi
+ * @param delta_idle Tick idle trascorsi
+ */
+static inline void cpu_load_from_deltas(struct cpu* cpu, uint64_t delta_user, uint64_t delta_system, uint64_t delta_idle) {
+  // Calcola il delta totale per evitare divisione per zero
+  uint64_t delta_total = delta_system + delta_user + delta_idle;
+
+  if (delta_total > 0) {
+    // Conversione sicura a double prima della divisione
+    cpu->user_load  = (int)(((double)delta_user / (double)delta_total) * 100.0);
+    cpu->sys_load   = (int)(((double)delta_system / (double)delta_total) * 100.0);
+    cpu->total_load = cpu->user_load + cpu->sys_load;
+  } else {
+    // Evita divisione per zero
+    cpu->user_load  = 0;
+    cpu->sys_load   = 0;
+    cpu->total_load = 0;
+  }
+}
+
+/**
+ * Calcola il carico dai tick cumulativi a 64 bit, letti da /proc/stat o da
+ * un log registrato (--replay)
+ *
+ * @param cpu Puntatore alla struttura cpu da aggiornare
+ * @param user Tick utente cumulativi
+ * @param system Tick di sistema cumulativi
+ * @param idle Tick idle cumulativi
+ */
+static inline void cpu_account(struct cpu* cpu, uint64_t user, uint64_t system, uint64_t idle) {
+  // Un contatore che torna indietro (log troncato o concatenato) riparte da una nuova base
+  if (cpu->has_prev_load && user >= cpu->user && system >= cpu->system && idle >= cpu->idle)
+    cpu_load_from_deltas(cpu, user - cpu->user, system - cpu->system, idle - cpu->idle);
+
+  cpu->user          = user;
+  cpu->system        = system;
+  cpu->idle          = idle;
   cpu->has_prev_load = true;
 }
 
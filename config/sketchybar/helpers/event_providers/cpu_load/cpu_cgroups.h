@@ -0,0 +1,325 @@
+#ifndef CPU_CGROUPS_H
+#define CPU_CGROUPS_H
+
+#include "cpu.h"
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef __APPLE__
+#include "../batch_read.h"
+#endif
+
+// Numero massimo di cgroup seguiti da un processo
+#define CPU_CGROUP_MAX 8
+// Lunghezza massima dell'etichetta, prefisso dei campi del trigger
+#define CPU_CGROUP_LABEL_LENGTH 32
+// Radice della gerarchia cgroup v2 per i percorsi relativi
+#define CPU_CGROUP_ROOT "/sys/fs/cgroup"
+
+// File letti da ogni cgroup; mancano quando il controller non è attivo nel genitore
+enum cpu_cgroup_file {
+  CPU_CGROUP_CPU_STAT,
+  CPU_CGROUP_CPU_MAX,
+  CPU_CGROUP_MEMORY_CURRENT,
+  CPU_CGROUP_MEMORY_MAX,
+  CPU_CGROUP_CPUSET,
+  CPU_CGROUP_FILES,
+};
+
+static const char* CPU_CGROUP_FILE_NAMES[CPU_CGROUP_FILES] = {
+    "cpu.stat", "cpu.max", "memory.current", "memory.max", "cpuset.cpus.effective",
+};
+
+/**
+ * Un cgroup v2 seguito da cpu_load --cgroup.
+ *
+ * Il carico è usage_usec di cpu.stat rispetto alla capacità del cgroup, non
+ * a quella della macchina: quota/period di cpu.max se c'è una quota,
+ * altrimenti le CPU di cpuset.cpus.effective, altrimenti quelle online. La
+ * memoria è memory.current, in percentuale di memory.max o, senza limite,
+ * della memoria fisica.
+ */
+struct cpu_cgroup {
+  char label[CPU_CGROUP_LABEL_LENGTH];
+#ifndef __APPLE__
+  char                path[BATCH_PATH_LENGTH];
+  struct batch_source files[CPU_CGROUP_FILES]; // fd -1 se il file manca
+#endif
+
+  uint64_t usage_usec; // Lettura precedente di usage_usec
+  uint64_t sample_ns;  // Istante della lettura precedente
+  bool     has_prev;
+
+  double   cpus;       // Capacità in CPU, anche frazionaria con una quota
+  int      load;       // Percentuale della capacità
+  uint64_t memory;     // memory.current, byte
+  uint64_t memory_max; // memory.max, byte, 0 se senza limite
+  int      memory_pct;
+};
+
+/**
+ * I cgroup seguiti, letti in un solo passaggio per tick insieme a /proc/stat
+ */
+struct cpu_cgroups {
+  struct cpu_cgroup groups[CPU_CGROUP_MAX];
+  int               count;
+  int               online_cpus;
+  uint64_t          host_memory;
+  bool              use_uring; // Raccolta con io_uring invece di pread (--uring), solo Linux
+#ifndef __APPLE__
+  struct batch_reader reader;
+  bool                started;
+#endif
+};
+
+/**
+ * Inizializza l'insieme vuoto
+ */
+static inline void cpu_cgroups_init(struct cpu_cgroups* cgroups) {
+  memset(cgroups, 0, sizeof(struct cpu_cgroups));
+  long cpus            = sysconf(_SC_NPROCESSORS_ONLN);
+  long pages           = sysconf(_SC_PHYS_PAGES);
+  long page_size       = sysconf(_SC_PAGESIZE);
+  cgroups->online_cpus = cpus > 0 ? (int)cpus : 1;
+  cgroups->host_memory = pages > 0 && page_size > 0 ? (uint64_t)pages * (uint64_t)page_size : 0;
+#ifndef __APPLE__
+  batch_reader_init(&cgroups->reader);
+#endif
+}
+
+/**
+ * Sostituisce con '_' i caratteri non alfanumerici di un'etichetta, che
+ * diventa parte delle chiavi del trigger (<etichetta>_load, ...)
+ */
+static inline void cpu_cgroup_sanitize(char* label) {
+  for (char* c = label; *c; c++) {
+    if (!isalnum((unsigned char)*c))
+      *c = '_';
+  }
+}
+
+/**
+ * Etichetta predefinita: ultimo componente del percorso senza il suffisso
+ * systemd, con i caratteri non alfanumerici sostituiti da '_'
+ * ("user-1000.slice" diventa "user_1000")
+ */
+static inline void cpu_cgroup_label(char* label, size_t size, const char* path) {
+  const char* base = strrchr(path, '/');
+  base             = base && base[1] ? base + 1 : path;
+  size_t length    = strlen(base);
+
+  static const char* suffixes[] = {".slice", ".scope", ".service"};
+  for (size_t i = 0; i < sizeof(suffixes) / sizeof(suffixes[0]); i++) {
+    size_t suffix = strlen(suffixes[i]);
+    if (length > suffix && strcmp(base + length - suffix, suffixes[i]) == 0) {
+      length -= suffix;
+      break;
+    }
+  }
+
+  snprintf(label, size, "%.*s", (int)length, length ? base : "root");
+  cpu_cgroup_sanitize(label);
+}
+
+#ifndef __APPLE__
+/**
+ * Aggiunge un cgroup da seguire
+ *
+ * @param cgroups Insieme dei cgroup
+ * @param spec "[etichetta=]percorso", assoluto o relativo a /sys/fs/cgroup
+ * @return true se il cgroup esiste ed espone cpu.stat
+ */
+[[nodiscard]] static inline bool cpu_cgroups_add(struct cpu_cgroups* cgroups, const char* spec) {
+  if (cgroups->count == CPU_CGROUP_MAX) {
+    fprintf(stderr, "Troppi cgroup, al massimo %d\n", CPU_CGROUP_MAX);
+    return false;
+  }
+
+  struct cpu_cgroup* group  = &cgroups->groups[cgroups->count];
+  const char*        equals = strchr(spec, '=');
+  const char*        path   = equals ? equals + 1 : spec;
+  *group                    = (struct cpu_cgroup){0};
+
+  char relative[BATCH_PATH_LENGTH];
+  snprintf(relative, sizeof(relative), "%s%s%s", path[0] == '/' ? "" : CPU_CGROUP_ROOT, path[0] == '/' ? "" : "/", path);
+  if (!batch_path(group->path, sizeof(group->path), relative)) {
+    fprintf(stderr, "Percorso del cgroup troppo lungo: %s\n", path);
+    return false;
+  }
+  // Un'etichetta esplicita subisce la stessa pulizia di quella predefinita
+  if (equals && equals > spec) {
+    snprintf(group->label, sizeof(group->label), "%.*s", (int)(equals - spec), spec);
+    cpu_cgroup_sanitize(group->label);
+  } else {
+    cpu_cgroup_label(group->label, sizeof(group->label), relative);
+  }
+
+  for (int f = 0; f < CPU_CGROUP_FILES; f++) {
+    char file[BATCH_PATH_LENGTH];
+    group->files[f].fd = -1;
+    if (snprintf(file, sizeof(file), "%s/%s", group->path, CPU_CGROUP_FILE_NAMES[f]) < (int)sizeof(file))
+      (void)batch_source_open(&group->files[f], file, 512);
+  }
+  if (group->files[CPU_CGROUP_CPU_STAT].fd < 0) {
+    fprintf(stderr, "Impossibile aprire %s/cpu.stat: %s\n", group->path, strerror(errno));
+    for (int f = 0; f < CPU_CGROUP_FILES; f++)
+      batch_source_close(&group->files[f]);
+    return false;
+  }
+  cgroups->count++;
+  return true;
+}
+
+/**
+ * Numero di CPU in una lista di cpuset ("0-3,8,10-11")
+ */
+[[nodiscard]] static inline int cpu_cgroup_cpuset_count(const char* list) {
+  int count = 0;
+  while (*list && *list != '\n') {
+    char* end   = NULL;
+    long  first = strtol(list, &end, 10);
+    if (end == list)
+      break;
+    long last = first;
+    if (*end == '-')
+      last = strtol(end + 1, &end, 10);
+    count += last >= first ? (int)(last - first + 1) : 0;
+    list = *end == ',' ? end + 1 : end;
+  }
+  return count;
+}
+
+/**
+ * Valore di una chiave in un file "chiave valore" per riga (cpu.stat)
+ */
+[[nodiscard]] static inline bool cpu_cgroup_key(const char* text, const char* key, uint64_t* value) {
+  size_t length = strlen(key);
+  for (const char* line = text; line && *line; line = strchr(line, '\n') ? strchr(line, '\n') + 1 : NULL) {
+    if (strncmp(line, key, length) == 0 && line[length] == ' ') {
+      *value = strtoull(line + length + 1, NULL, 10);
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Calcola carico e memoria di un cgroup dai buffer appena riletti
+ */
+static inline void cpu_cgroup_parse(const struct cpu_cgroups* cgroups, struct cpu_cgroup* group, uint64_t now_ns) {
+  const struct batch_source* files = group->files;
+
+  // Capacità: quota di cpu.max ("quota period" o "max period"), poi cpuset, poi CPU online
+  group->cpus = cgroups->online_cpus;
+  if (files[CPU_CGROUP_CPUSET].length > 0) {
+    int cpuset = cpu_cgroup_cpuset_count(files[CPU_CGROUP_CPUSET].buffer);
+    if (cpuset > 0)
+      group->cpus = cpuset;
+  }
+  if (files[CPU_CGROUP_CPU_MAX].length > 0 && strncmp(files[CPU_CGROUP_CPU_MAX].buffer, "max", 3) != 0) {
+    char*  end    = NULL;
+    double quota  = strtod(files[CPU_CGROUP_CPU_MAX].buffer, &end);
+    double period = strtod(end, NULL);
+    if (quota > 0 && period > 0 && quota / period < group->cpus)
+      group->cpus = quota / period;
+  }
+
+  uint64_t usage_usec = 0;
+  if (files[CPU_CGROUP_CPU_STAT].length > 0 && cpu_cgroup_key(files[CPU_CGROUP_CPU_STAT].buffer, "usage_usec", &usage_usec)) {
+    if (group->has_prev && usage_usec >= group->usage_usec && now_ns > group->sample_ns) {
+      double elapsed_usec = (double)(now_ns - group->sample_ns) / 1000.0;
+      group->load         = (int)(100.0 * (double)(usage_usec - group->usage_usec) / (elapsed_usec * group->cpus) + 0.5);
+    }
+    group->usage_usec = usage_usec;
+    group->sample_ns  = now_ns;
+    group->has_prev   = true;
+  }
+
+  group->memory     = files[CPU_CGROUP_MEMORY_CURRENT].length > 0 ? strtoull(files[CPU_CGROUP_MEMORY_CURRENT].buffer, NULL, 10) : 0;
+  group->memory_max = files[CPU_CGROUP_MEMORY_MAX].length > 0 ? strtoull(files[CPU_CGROUP_MEMORY_MAX].buffer, NULL, 10) : 0;
+  uint64_t limit    = group->memory_max ? group->memory_max : cgroups->host_memory;
+  group->memory_pct = limit ? (int)(100.0 * (double)group->memory / (double)limit + 0.5) : 0;
+}
+
+/**
+ * Rilegge /proc/stat e i file di tutti i cgroup in un solo passaggio dello
+ * stadio di raccolta, poi calcola il carico della macchina e dei cgroup.
+ * Sostituisce cpu_update quando ci sono cgroup.
+ *
+ * @param cgroups Insieme dei cgroup
+ * @param cpu Carico della macchina, da aggiornare nello stesso tick
+ */
+static inline void cpu_cgroups_update(struct cpu_cgroups* cgroups, struct cpu* cpu) {
+  if (!cgroups->started) {
+    (void)batch_reader_add(&cgroups->reader, &cpu->source);
+    for (int g = 0; g < cgroups->count; g++) {
+      for (int f = 0; f < CPU_CGROUP_FILES; f++)
+        (void)batch_reader_add(&cgroups->reader, &cgroups->groups[g].files[f]);
+    }
+    // pread di default: su procfs/sysfs io_uring costa più CPU per tick (vedi bench)
+    (void)batch_reader_start(&cgroups->reader, cgroups->use_uring);
+    cgroups->started = true;
+  }
+
+  (void)batch_reader_read(&cgroups->reader);
+  cpu_parse(cpu);
+
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  uint64_t now_ns = (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+  for (int g = 0; g < cgroups->count; g++)
+    cpu_cgroup_parse(cgroups, &cgroups->groups[g], now_ns);
+}
+
+#else
+/**
+ * I cgroup v2 esistono solo su Linux
+ */
+[[nodiscard]] static inline bool cpu_cgroups_add(struct cpu_cgroups* cgroups, const char* spec) {
+  (void)cgroups;
+  fprintf(stderr, "cgroup v2 non disponibili su questo sistema: %s\n", spec);
+  return false;
+}
+
+static inline void cpu_cgroups_update(struct cpu_cgroups* cgroups, struct cpu* cpu) {
+  (void)cgroups;
+  cpu_update(cpu);
+}
+#endif
+
+/**
+ * Formatta i campi dei cgroup (<etichetta>_load, _mem, _mem_max, _mem_pct);
+ * la memoria è in MiB, mem_max vale "max" se il cgroup non ha limite
+ *
+ * @param cgroups Insieme dei cgroup
+ * @param buffer Buffer di output
+ * @param size Dimensione del buffer
+ * @return Numero di caratteri scritti, come snprintf
+ */
+static inline int cpu_cgroups_format(const struct cpu_cgroups* cgroups, char* buffer, size_t size) {
+  int written = 0;
+  for (int g = 0; g < cgroups->count && (size_t)written < size; g++) {
+    const struct cpu_cgroup* group = &cgroups->groups[g];
+    char                     limit[24];
+    if (group->memory_max)
+      snprintf(limit, sizeof(limit), "%llu", (unsigned long long)(group->memory_max >> 20));
+    else
+      snprintf(limit, sizeof(limit), "max");
+
+    int result = snprintf(
+        buffer + written, size - (size_t)written, " %s_load='%02d' %s_mem='%llu' %s_mem_max='%s' %s_mem_pct='%02d'", group->label,
+        group->load, group->label, (unsigned long long)(group->memory >> 20), group->label, limit, group->label, group->memory_pct);
+    if (result < 0)
+      return result;
+    written += result;
+  }
+  return written;
+}
+
+#endif /* CPU_CGROUPS_H */
@@ -0,0 +1,478 @@
+#ifndef CPU_CLUSTERS_H
+#define CPU_CLUSTERS_H
+
+#include "cpu.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __APPLE__
+#include <CoreFoundation/CoreFoundation.h>
+#include <IOKit/pwr_mgt/IOPMLib.h>
+#include <sys/sysctl.h>
+#else
+#include <dirent.h>
+#endif
+
+// Numero massimo di core logici seguiti singolarmente
+#define CPU_MAX_CORES 512
+// Numero massimo di policy cpufreq (una per core nel caso peggiore)
+#define CPU_MAX_POLICIES CPU_MAX_CORES
+
+enum cpu_cluster { CPU_CLUSTER_PERFORMANCE, CPU_CLUSTER_EFFICIENCY, CPU_CLUSTERS };
+
+// Prefisso dei campi pubblicati per ogni cluster (p_load, e_load)
+static const char* CPU_CLUSTER_NAMES[CPU_CLUSTERS] = {"p", "e"};
+
+/**
+ * Tick cumulativi di un core: occupato e totale
+ */
+struct cpu_core_ticks {
+  uint64_t busy;
+  uint64_t total;
+};
+
+#ifndef __APPLE__
+/**
+ * Una policy cpufreq: i core che condividono la frequenza
+ */
+struct cpu_policy {
+  struct batch_source cur_freq;  // scaling_cur_freq, kHz
+  struct batch_source max_freq;  // scaling_max_freq, kHz: limite imposto da termica e alimentazione
+  uint64_t            hw_max;    // cpuinfo_max_freq, kHz, letto una volta
+  int                 cpu_count; // Core della policy, peso nella media
+};
+#endif
+
+/**
+ * Carico per cluster (performance/efficiency), frequenza media e
+ * indicatore di throttling, letti nello stesso passaggio di cpu_update.
+ *
+ * I cluster sono decisi una volta all'avvio: su macOS dai livelli di
+ * prestazione (hw.perflevelN), su Linux da /sys/devices/cpu_core e
+ * cpu_atom (ibridi Intel) o, in alternativa, da cpu_capacity (ARM). Su
+ * macchine omogenee c'è un solo cluster e il carico per cluster non viene
+ * pubblicato.
+ */
+struct cpu_clusters {
+  int     core_count;
+  int     cluster_count;
+  uint8_t cluster_of[CPU_MAX_CORES];
+
+  struct cpu_core_ticks prev[CPU_MAX_CORES];
+  bool                  has_prev;
+
+  int  load[CPU_CLUSTERS];
+  bool has_freq;   // freq_mhz è noto (non su Apple Silicon, senza hw.cpufrequency)
+  bool has_limit;  // freq_limit e throttled sono noti
+  int  freq_mhz;   // Frequenza media sui core
+  int  freq_limit; // Percentuale della frequenza massima consentita ora
+  bool throttled;
+
+#ifdef __APPLE__
+  host_t   host;
+  uint64_t nominal_hz; // hw.cpufrequency, solo Intel
+#else
+  struct cpu_policy*  policies;
+  int                 policy_count;
+  struct batch_source throttle; // thermal_throttle/package_throttle_count di cpu0
+  uint64_t            throttle_count;
+  bool                has_throttle_count;
+#endif
+};
+
+#ifdef __APPLE__
+
+/**
+ * Legge un intero con sysctlbyname, 0 se la chiave non esiste
+ */
+[[nodiscard]] static inline int64_t cpu_sysctl(const char* name) {
+  int64_t value = 0;
+  size_t  size  = sizeof(value);
+  if (sysctlbyname(name, &value, &size, NULL, 0) < 0)
+    return 0;
+  // Le chiavi a 32 bit riempiono solo la parte bassa
+  return size == sizeof(int32_t) ? (int64_t)(int32_t)value : value;
+}
+
+/**
+ * Cluster da hw.perflevelN: su Apple Silicon i core di efficienza hanno gli
+ * indici più bassi
+ */
+static inline void cpu_clusters_discover(struct cpu_clusters* clusters) {
+  clusters->host       = mach_host_self();
+  clusters->core_count = (int)cpu_sysctl("hw.logicalcpu");
+  if (clusters->core_count > CPU_MAX_CORES)
+    clusters->core_count = CPU_MAX_CORES;
+
+  int efficiency          = cpu_sysctl("hw.nperflevels") > 1 ? (int)cpu_sysctl("hw.perflevel1.logicalcpu") : 0;
+  clusters->cluster_count = efficiency > 0 ? 2 : 1;
+  for (int i = 0; i < clusters->core_count; i++)
+    clusters->cluster_of[i] = i < efficiency ? CPU_CLUSTER_EFFICIENCY : CPU_CLUSTER_PERFORMANCE;
+
+  clusters->nominal_hz = (uint64_t)cpu_sysctl("hw.cpufrequency");
+}
+
+/**
+ * Tick per core da host_processor_info
+ *
+ * @return Numero di core letti
+ */
+[[nodiscard]] static inline int cpu_clusters_read_ticks(struct cpu_clusters* clusters, const struct cpu* cpu, struct cpu_core_ticks* ticks) {
+  (void)cpu;
+
+  natural_t              count      = 0;
+  processor_info_array_t info       = NULL;
+  mach_msg_type_number_t info_count = 0;
+  if (host_processor_info(clusters->host, PROCESSOR_CPU_LOAD_INFO, &count, &info, &info_count) != KERN_SUCCESS)
+    return 0;
+
+  processor_cpu_load_info_t load = (processor_cpu_load_info_t)info;
+  int                       read = (int)count < clusters->core_count ? (int)count : clusters->core_count;
+  for (int i = 0; i < read; i++) {
+    uint64_t busy   = load[i].cpu_ticks[CPU_STATE_USER] + load[i].cpu_ticks[CPU_STATE_SYSTEM] + load[i].cpu_ticks[CPU_STATE_NICE];
+    ticks[i].busy   = busy;
+    ticks[i].total  = busy + load[i].cpu_ticks[CPU_STATE_IDLE];
+  }
+
+  vm_deallocate(mach_task_self(), (vm_address_t)info, info_count * sizeof(integer_t));
+  return read;
+}
+
+/**
+ * Limite di velocità imposto dal sistema (IOPMCopyCPUPowerStatus) e
+ * frequenza stimata dove la frequenza nominale è nota
+ */
+static inline void cpu_clusters_read_freq(struct cpu_clusters* clusters) {
+  CFDictionaryRef status = NULL;
+  if (IOPMCopyCPUPowerStatus(&status) != kIOReturnSuccess || !status)
+    return;
+
+  int32_t     limit  = 100;
+  CFNumberRef number = CFDictionaryGetValue(status, CFSTR(kIOPMCPUPowerLimitProcessorSpeedKey));
+  if (number)
+    CFNumberGetValue(number, kCFNumberSInt32Type, &limit);
+  CFRelease(status);
+
+  clusters->freq_limit = limit;
+  clusters->throttled  = limit < 100;
+  clusters->has_limit  = true;
+  clusters->has_freq   = clusters->nominal_hz > 0;
+  clusters->freq_mhz   = (int)(clusters->nominal_hz / 1000000 * (uint64_t)limit / 100);
+}
+
+static inline void cpu_clusters_cleanup(struct cpu_clusters* clusters) {
+  (void)clusters;
+}
+
+#else
+
+/**
+ * Legge un intero da un file di sysfs (sotto il prefisso di batch_path)
+ *
+ * @return true se il file esiste e contiene un numero
+ */
+[[nodiscard]] static inline bool cpu_read_sysfs(const char* relative, uint64_t* value) {
+  char path[BATCH_PATH_LENGTH];
+  if (!batch_path(path, sizeof(path), relative))
+    return false;
+
+  FILE* file = fopen(path, "r");
+  if (!file)
+    return false;
+  unsigned long long number = 0;
+  bool               ok     = fscanf(file, "%llu", &number) == 1;
+  fclose(file);
+  *value = number;
+  return ok;
+}
+
+/**
+ * Apre un file di sysfs come sorgente persistente
+ */
+[[nodiscard]] static inline bool cpu_open_sysfs(struct batch_source* source, const char* relative) {
+  char path[BATCH_PATH_LENGTH];
+  source->fd = -1;
+  return batch_path(path, sizeof(path), relative) && batch_source_open(source, path, 64);
+}
+
+/**
+ * Assegna al cluster i core di una lista nel formato di sysfs ("0-3,8-11")
+ *
+ * @return Numero di core assegnati
+ */
+static inline int cpu_assign_list(struct cpu_clusters* clusters, const char* relative, enum cpu_cluster cluster) {
+  char path[BATCH_PATH_LENGTH];
+  if (!batch_path(path, sizeof(path), relative))
+    return 0;
+
+  FILE* file = fopen(path, "r");
+  if (!file)
+    return 0;
+  char list[4096];
+  bool ok = fgets(list, sizeof(list), file) != NULL;
+  fclose(file);
+  if (!ok)
+    return 0;
+
+  int   assigned = 0;
+  char* cursor   = list;
+  while (*cursor >= '0' && *cursor <= '9') {
+    long first = strtol(cursor, &cursor, 10);
+    long last  = first;
+    if (*cursor == '-')
+      last = strtol(cursor + 1, &cursor, 10);
+    for (long cpu = first; cpu <= last && cpu < CPU_MAX_CORES; cpu++, assigned++)
+      clusters->cluster_of[cpu] = (uint8_t)cluster;
+    if (*cursor == ',')
+      cursor++;
+  }
+  return assigned;
+}
+
+/**
+ * Cluster dai PMU ibridi di Intel, altrimenti da cpu_capacity; policy
+ * cpufreq aperte una volta sola
+ */
+static inline void cpu_clusters_discover(struct cpu_clusters* clusters) {
+  // Core possibili da sysfs ("0-255"), così anche una fixture ha la sua forma
+  uint64_t last = 0;
+  char     path[BATCH_PATH_LENGTH];
+  FILE*    file = batch_path(path, sizeof(path), "/sys/devices/system/cpu/possible") ? fopen(path, "r") : NULL;
+  if (file) {
+    unsigned long long number;
+    while (fscanf(file, "%llu%*[-,]", &number) == 1)
+      last = number;
+    fclose(file);
+  }
+  long configured      = file ? (long)last + 1 : sysconf(_SC_NPROCESSORS_CONF);
+  clusters->core_count = configured > CPU_MAX_CORES ? CPU_MAX_CORES : (configured > 0 ? (int)configured : 1);
+
+  char relative[BATCH_PATH_LENGTH];
+  if (cpu_assign_list(clusters, "/sys/devices/cpu_atom/cpus", CPU_CLUSTER_EFFICIENCY) > 0) {
+    cpu_assign_list(clusters, "/sys/devices/cpu_core/cpus", CPU_CLUSTER_PERFORMANCE);
+    clusters->cluster_count = 2;
+  } else {
+    // big.LITTLE: i core con la capacità massima sono quelli di prestazione
+    uint64_t capacity[CPU_MAX_CORES];
+    uint64_t highest = 0;
+    for (int i = 0; i < clusters->core_count; i++) {
+      snprintf(relative, sizeof(relative), "/sys/devices/system/cpu/cpu%d/cpu_capacity", i);
+      if (!cpu_read_sysfs(relative, &capacity[i]))
+        capacity[i] = 0;
+      if (capacity[i] > highest)
+        highest = capacity[i];
+    }
+    clusters->cluster_count = 1;
+    for (int i = 0; i < clusters->core_count; i++) {
+      if (capacity[i] > 0 && capacity[i] < highest) {
+        clusters->cluster_of[i] = CPU_CLUSTER_EFFICIENCY;
+        clusters->cluster_count = 2;
+      }
+    }
+  }
+
+  // Una policy per gruppo di core con la stessa frequenza
+  char root[BATCH_PATH_LENGTH];
+  DIR* directory = batch_path(root, sizeof(root), "/sys/devices/system/cpu/cpufreq") ? opendir(root) : NULL;
+  if (directory) {
+    clusters->policies = calloc(CPU_MAX_POLICIES, sizeof(struct cpu_policy));
+    struct dirent* entry;
+    while (clusters->policies && (entry = readdir(directory)) != NULL && clusters->policy_count < CPU_MAX_POLICIES) {
+      if (strncmp(entry->d_name, "policy", 6) != 0)
+        continue;
+
+      struct cpu_policy* policy = &clusters->policies[clusters->policy_count];
+      char               list[BATCH_PATH_LENGTH];
+      snprintf(relative, sizeof(relative), "/sys/devices/system/cpu/cpufreq/%.64s/cpuinfo_max_freq", entry->d_name);
+      if (!cpu_read_sysfs(relative, &policy->hw_max) || policy->hw_max == 0)
+        continue;
+
+      snprintf(relative, sizeof(relative), "/sys/devices/system/cpu/cpufreq/%.64s/scaling_cur_freq", entry->d_name);
+      if (!cpu_open_sysfs(&policy->cur_freq, relative))
+        continue;
+      snprintf(relative, sizeof(relative), "/sys/devices/system/cpu/cpufreq/%.64s/scaling_max_freq", entry->d_name);
+      if (!cpu_open_sysfs(&policy->max_freq, relative)) {
+        batch_source_close(&policy->cur_freq);
+        continue;
+      }
+
+      // Il peso è il numero di core della policy; la lista serve solo qui
+      snprintf(list, sizeof(list), "/sys/devices/system/cpu/cpufreq/%.64s/related_cpus", entry->d_name);
+      policy->cpu_count = 1;
+      file              = batch_path(path, sizeof(path), list) ? fopen(path, "r") : NULL;
+      if (file) {
+        int count = 0, cpu;
+        while (fscanf(file, "%d", &cpu) == 1)
+          count++;
+        fclose(file);
+        policy->cpu_count = count > 0 ? count : 1;
+      }
+      clusters->policy_count++;
+    }
+    closedir(directory);
+  }
+
+  // Contatore degli eventi di throttling termico del package (Intel)
+  clusters->throttle.fd = -1;
+  clusters->has_throttle_count =
+      cpu_open_sysfs(&clusters->throttle, "/sys/devices/system/cpu/cpu0/thermal_throttle/package_throttle_count");
+}
+
+/**
+ * Tick per core dalle righe "cpuN" di /proc/stat, già nel buffer di cpu
+ *
+ * @return Numero di core letti
+ */
+[[nodiscard]] static inline int cpu_clusters_read_ticks(struct cpu_clusters* clusters, const struct cpu* cpu, struct cpu_core_ticks* ticks) {
+  if (cpu->source.length <= 0)
+    return 0;
+
+  int         read = 0;
+  const char* line = strchr(cpu->source.buffer, '\n');
+  while (line && strncmp(line + 1, "cpu", 3) == 0 && line[4] >= '0' && line[4] <= '9') {
+    char* cursor = NULL;
+    long  index  = strtol(line + 4, &cursor, 10);
+
+    uint64_t fields[8] = {0};
+    for (int i = 0; i < 8; i++)
+      fields[i] = strtoull(cursor, &cursor, 10);
+
+    if (index >= 0 && index < clusters->core_count) {
+      uint64_t busy         = fields[0] + fields[1] + fields[2] + fields[5] + fields[6] + fields[7];
+      ticks[index].busy     = busy;
+      ticks[index].total    = busy + fields[3] + fields[4];
+      read                  = (int)index + 1 > read ? (int)index + 1 : read;
+    }
+    line = strchr(line + 1, '\n');
+  }
+  return read;
+}
+
+/**
+ * Frequenza media pesata sui core e limite corrente, stesso tick del carico
+ */
+static inline void cpu_clusters_read_freq(struct cpu_clusters* clusters) {
+  uint64_t weighted = 0, limit = 0, hw_max = 0, cpus = 0;
+  for (int i = 0; i < clusters->policy_count; i++) {
+    struct cpu_policy* policy = &clusters->policies[i];
+    if (!batch_source_pread(&policy->cur_freq, NULL) || !batch_source_pread(&policy->max_freq, NULL))
+      continue;
+
+    weighted += strtoull(policy->cur_freq.buffer, NULL, 10) * (uint64_t)policy->cpu_count;
+    limit += strtoull(policy->max_freq.buffer, NULL, 10) * (uint64_t)policy->cpu_count;
+    hw_max += policy->hw_max * (uint64_t)policy->cpu_count;
+    cpus += (uint64_t)policy->cpu_count;
+  }
+
+  bool throttle_event = false;
+  if (clusters->has_throttle_count && batch_source_pread(&clusters->throttle, NULL)) {
+    uint64_t count           = strtoull(clusters->throttle.buffer, NULL, 10);
+    throttle_event           = clusters->throttle_count > 0 && count > clusters->throttle_count;
+    clusters->throttle_count = count;
+  }
+
+  clusters->has_freq  = cpus > 0;
+  clusters->has_limit = cpus > 0;
+  if (!clusters->has_freq)
+    return;
+
+  clusters->freq_mhz   = (int)(weighted / cpus / 1000);
+  clusters->freq_limit = (int)(100 * limit / hw_max);
+  clusters->throttled  = clusters->freq_limit < 100 || throttle_event;
+}
+
+static inline void cpu_clusters_cleanup(struct cpu_clusters* clusters) {
+  for (int i = 0; i < clusters->policy_count; i++) {
+    batch_source_close(&clusters->policies[i].cur_freq);
+    batch_source_close(&clusters->policies[i].max_freq);
+  }
+  free(clusters->policies);
+  clusters->policies     = NULL;
+  clusters->policy_count = 0;
+  if (clusters->has_throttle_count)
+    batch_source_close(&clusters->throttle);
+}
+
+#endif
+
+/**
+ * Inizializza cluster e sorgenti di frequenza
+ *
+ * @param clusters Struttura da inizializzare
+ */
+static inline void cpu_clusters_init(struct cpu_clusters* clusters) {
+  memset(clusters, 0, sizeof(struct cpu_clusters));
+  cpu_clusters_discover(clusters);
+}
+
+/**
+ * Aggiorna carico per cluster e frequenza; va chiamata subito dopo
+ * cpu_update, nello stesso tick
+ *
+ * @param clusters Stato dei cluster
+ * @param cpu Struttura cpu appena aggiornata
+ */
+static inline void cpu_clusters_update(struct cpu_clusters* clusters, const struct cpu* cpu) {
+  static struct cpu_core_ticks ticks[CPU_MAX_CORES];
+
+  int read = cpu_clusters_read_ticks(clusters, cpu, ticks);
+  if (read > 0 && clusters->cluster_count > 1) {
+    uint64_t busy[CPU_CLUSTERS]  = {0};
+    uint64_t total[CPU_CLUSTERS] = {0};
+    for (int i = 0; i < read && clusters->has_prev; i++) {
+      // Un core i cui tick tornano indietro (overflow a 32 bit su macOS, core riacceso) salta questo tick e riparte
+      // dalla nuova base copiata sotto, come in cpu_account
+      if (ticks[i].busy < clusters->prev[i].busy || ticks[i].total < clusters->prev[i].total)
+        continue;
+      busy[clusters->cluster_of[i]] += ticks[i].busy - clusters->prev[i].busy;
+      total[clusters->cluster_of[i]] += ticks[i].total - clusters->prev[i].total;
+    }
+    for (int c = 0; c < CPU_CLUSTERS; c++)
+      clusters->load[c] = total[c] > 0 ? (int)(100.0 * (double)busy[c] / (double)total[c]) : 0;
+
+    memcpy(clusters->prev, ticks, (size_t)read * sizeof(struct cpu_core_ticks));
+    clusters->has_prev = true;
+  }
+
+  cpu_clusters_read_freq(clusters);
+}
+
+/**
+ * Formatta i campi opzionali del trigger (p_load, e_load, freq_mhz, ...)
+ *
+ * @param clusters Stato dei cluster
+ * @param buffer Buffer di output
+ * @param size Dimensione del buffer
+ * @return Numero di caratteri scritti, come snprintf
+ */
+static inline int cpu_clusters_format(const struct cpu_clusters* clusters, char* buffer, size_t size) {
+  int written = snprintf(buffer, size, " clusters='%d'", clusters->cluster_count);
+
+  for (int c = 0; c < CPU_CLUSTERS && clusters->cluster_count > 1 && written >= 0 && (size_t)written < size; c++) {
+    int result = snprintf(buffer + written, size - (size_t)written, " %s_load='%02d'", CPU_CLUSTER_NAMES[c], clusters->load[c]);
+    if (result < 0)
+      return result;
+    written += result;
+  }
+
+  if (clusters->has_freq && written >= 0 && (size_t)written < size) {
+    int result = snprintf(buffer + written, size - (size_t)written, " freq_mhz='%d'", clusters->freq_mhz);
+    if (result < 0)
+      return result;
+    written += result;
+  }
+
+  if (clusters->has_limit && written >= 0 && (size_t)written < size) {
+    int result = snprintf(
+        buffer + written, size - (size_t)written, " freq_limit='%d' throttled='%d'", clusters->freq_limit, clusters->throttled ? 1 : 0);
+    if (result < 0)
+      return result;
+    written += result;
+  }
+  return written;
+}
+
+#endif /* CPU_CLUSTERS_H */
@@ -1,11 +1,17 @@
+#include "../cadence.h"
+#include "../history.h"
+#include "../sample_log.h"
 #include "../sketchybar.h"
 #include "cpu.h"
+#include "cpu_cgroups.h"
+#include "cpu_clusters.h"
+#include "cpu_stats.h"
 #include <errno.h>
 #include <stdlib.h>
 #include <string.h>
 
 static const int MAX_EVENT_MESSAGE_LENGTH   = 512;
-static const int MAX_TRIGGER_MESSAGE_LENGTH = 512;
+static const int MAX_TRIGGER_MESSAGE_LENGTH = 1024;
 
 /**
  * Mostra le istruzioni per l'uso del programma
@@ -13,7 +19,20 @@ static const int MAX_TRIGGER_MESSAGE_LENGTH = 512;
 static void show_usage(const char* program_name) {
   if (!program_name)
     program_name = "cpu_load";
-  printf("Usage: %s \"<event-name>\" \"<event_freq>\"\n", program_name);
+  printf("Usage: %s \"<event-name>\" \"<event_freq>\" [--stats] [--clusters] [--record <file> | --replay <file> [--speed N]]\n"
+         "       [--history <dir> [--history-days N]] [--cgroup <spec>]... [--uring]\n",
+         program_name);
+  printf("  --stats: pubblica anche avg e p95 su 1, 5 e 15 minuti (avg_1m, p95_1m, ...)\n");
+  printf("  --clusters: pubblica il carico per cluster (p_load, e_load), la frequenza media\n");
+  printf("              e il throttling (freq_mhz, freq_limit, throttled)\n");
+  printf("  --cgroup: pubblica carico e memoria di un cgroup v2, \"[etichetta=]percorso\" relativo a /sys/fs/cgroup;\n");
+  printf("            il carico è rispetto alla quota di cpu.max (<etichetta>_load, _mem, _mem_max, _mem_pct), ripetibile\n");
+  printf("  --uring: con --cgroup legge i file con io_uring invece di una pread per file (Linux)\n");
+  printf("  --record: registra i tick grezzi con il tempo monotono in un log binario\n");
+  printf("  --replay: ricalcola e invia i trigger dai tick di un log, a velocità N (0 = senza attese)\n");
+  printf("  --history: conserva user, sys e total compressi in <dir>, un file al giorno per N giorni (default %d),\n"
+         "             da interrogare con sbhist\n",
+         HISTORY_DEFAULT_RETENTION_DAYS);
 }
 
 int main(int argc, char** argv) {
@@ -31,9 +50,97 @@ int main(int argc, char** argv) {
     // Non è un errore critico, possiamo continuare
   }
 
+  // Opzioni dopo la frequenza, in qualunque ordine
+  bool        stats_enabled    = false;
+  bool        clusters_enabled = false;
+  const char* cgroup_specs[CPU_CGROUP_MAX];
+  int         cgroup_count     = 0;
+  const char* record_path      = NULL;
+  const char* replay_path      = NULL;
+  double      replay_speed     = 1.0;
+  const char* history_dir      = NULL;
+  int         history_days     = HISTORY_DEFAULT_RETENTION_DAYS;
+  bool        use_uring        = false;
+  for (int i = 3; i < argc; i++) {
+    if (strcmp(argv[i], "--stats") == 0) {
+      stats_enabled = true;
+    } else if (strcmp(argv[i], "--clusters") == 0) {
+      clusters_enabled = true;
+    } else if (strcmp(argv[i], "--cgroup") == 0 && i + 1 < argc && cgroup_count < CPU_CGROUP_MAX) {
+      cgroup_specs[cgroup_count++] = argv[++i];
+    } else if (strcmp(argv[i], "--uring") == 0) {
+      use_uring = true;
+    } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+      record_path = argv[++i];
+    } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+      replay_path = argv[++i];
+    } else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+      replay_speed = strtod(argv[++i], NULL);
+    } else if (strcmp(argv[i], "--history") == 0 && i + 1 < argc) {
+      history_dir = argv[++i];
+    } else if (strcmp(argv[i], "--history-days") == 0 && i + 1 < argc) {
+      history_days = atoi(argv[++i]);
+    } else {
+      show_usage(argv[0]);
+      return 1;
+    }
+  }
+  if ((record_path && replay_path) || (history_dir && replay_path) || replay_speed < 0) {
+    show_usage(argv[0]);
+    return 1;
+  }
+
+  // Log dei campioni grezzi: in replay i tick vengono dal log e non dal sistema
+  static struct sample_log sample_log;
+  if (record_path && !sample_log_create(&sample_log, record_path, SAMPLE_LOG_CPU)) {
+    fprintf(stderr, "Impossibile creare il log %s: %s\n", record_path, strerror(errno));
+    return 1;
+  }
+  if (replay_path && !sample_log_open(&sample_log, replay_path, SAMPLE_LOG_CPU, replay_speed)) {
+    fprintf(stderr, "Impossibile aprire il log %s: %s\n", replay_path, strerror(errno));
+    return 1;
+  }
+  if (replay_path && clusters_enabled) {
+    fprintf(stderr, "I cluster leggono sorgenti live, disattivati durante il replay\n");
+    clusters_enabled = false;
+  }
+  if (replay_path && cgroup_count > 0) {
+    fprintf(stderr, "I cgroup leggono sorgenti live, disattivati durante il replay\n");
+    cgroup_count = 0;
+  }
+
   // Inizializza la struttura CPU
-  struct cpu cpu;
-  cpu_init(&cpu);
+  struct cpu cpu = {0};
+  if (!replay_path)
+    cpu_init(&cpu);
+
+  // Cluster e sorgenti di frequenza scelti una volta sola
+  static struct cpu_clusters clusters;
+  if (clusters_enabled)
+    cpu_clusters_init(&clusters);
+
+  // Cgroup aperti una volta, riletti insieme a /proc/stat a ogni tick
+  static struct cpu_cgroups cgroups;
+  cpu_cgroups_init(&cgroups);
+  cgroups.use_uring = use_uring;
+  for (int i = 0; i < cgroup_count; i++) {
+    if (!cpu_cgroups_add(&cgroups, cgroup_specs[i]))
+      return 1;
+  }
+
+  // Statistiche mobili opzionali, memoria allocata una sola volta qui
+  static struct cpu_stats stats;
+  if (stats_enabled && !cpu_stats_init(&stats, update_freq)) {
+    fprintf(stderr, "Impossibile allocare le statistiche mobili, disattivate\n");
+    stats_enabled = false;
+  }
+
+  // Storico compresso opzionale su disco
+  static struct history history;
+  if (history_dir && !history_open(&history, history_dir, (const char* const[]){"user", "sys", "total"}, 3, history_days)) {
+    fprintf(stderr, "Impossibile usare la directory dello storico %s: %s\n", history_dir, strerror(errno));
+    return 1;
+  }
 
   // Setup the event in sketchybar
   char event_message[MAX_EVENT_MESSAGE_LENGTH];
@@ -49,36 +156,89 @@ int main(int argc, char** argv) {
   // Prepara il buffer per il messaggio di trigger
   char trigger_message[MAX_TRIGGER_MESSAGE_LENGTH];
 
+  // Verifica che il valore non sia troppo grande
+  if (update_freq > 3600) {
+    fprintf(stderr, "Frequenza di aggiornamento non valida (%f), uso 1 secondo\n", update_freq);
+    update_freq = 1.0;
+  }
+  struct cadence cadence;
+  cadence_init(&cadence, update_freq);
+
   // Loop principale
   while (true) {
-    // Aggiorna le informazioni CPU
-    cpu_update(&cpu);
+    // La prima lettura fa solo da base: il carico di quel tick non è un campione
+    bool     had_prev = cpu.has_prev_load;
+    uint64_t tick_start;
+    if (replay_path) {
+      // Tick registrati, al loro istante scalato dalla velocità
+      struct sample_record record = {0};
+      if (!sample_log_next(&sample_log, &record))
+        break;
+      if (record.type != SAMPLE_RECORD_COUNTERS || record.count != 3)
+        continue;
+      tick_start = trace_begin();
+      cpu_account(&cpu, record.counters[0], record.counters[1], record.counters[2]);
+    } else {
+      // Aggiorna le informazioni CPU; cluster e frequenza nello stesso risveglio
+      tick_start = trace_begin();
+      if (cgroups.count > 0)
+        cpu_cgroups_update(&cgroups, &cpu);
+      else
+        cpu_update(&cpu);
+      if (clusters_enabled)
+        cpu_clusters_update(&clusters, &cpu);
+      if (record_path)
+        sample_log_write_counters(&sample_log, (uint64_t[]){cpu.user, cpu.system, cpu.idle}, 3);
+    }
+    if (history_dir && had_prev)
+      history_append(&history, history_now_ms(), (double[]){cpu.user_load, cpu.sys_load, cpu.total_load});
+    trace_end(TRACE_SAMPLE, tick_start);
 
     // Prepara il messaggio di evento
-    int trigger_len = snprintf(
+    uint64_t format_start = trace_begin();
+    int      trigger_len = snprintf(
         trigger_message, sizeof(trigger_message),
         "--trigger '%s' user_load='%d' sys_load='%02d' total_load='%02d'", argv[1], cpu.user_load,
         cpu.sys_load, cpu.total_load);
 
+    if (stats_enabled && trigger_len > 0 && trigger_len < (int)sizeof(trigger_message)) {
+      if (had_prev)
+        cpu_stats_add(&stats, cpu.total_load);
+      int stats_len = cpu_stats_format(&stats, trigger_message + trigger_len, sizeof(trigger_message) - (size_t)trigger_len);
+      trigger_len   = stats_len < 0 ? stats_len : trigger_len + stats_len;
+    }
+
+    if (clusters_enabled && trigger_len > 0 && trigger_len < (int)sizeof(trigger_message)) {
+      int clusters_len =
+          cpu_clusters_format(&clusters, trigger_message + trigger_len, sizeof(trigger_message) - (size_t)trigger_len);
+      trigger_len = clusters_len < 0 ? clusters_len : trigger_len + clusters_len;
+    }
+
+    if (cgroups.count > 0 && trigger_len > 0 && trigger_len < (int)sizeof(trigger_message)) {
+      int cgroups_len =
+          cpu_cgroups_format(&cgroups, trigger_message + trigger_len, sizeof(trigger_message) - (size_t)trigger_len);
+      trigger_len = cgroups_len < 0 ? cgroups_len : trigger_len + cgroups_len;
+    }
+
     if (trigger_len < 0 || trigger_len >= (int)sizeof(trigger_message)) {
       fprintf(stderr, "Errore o troncamento durante la formattazione del messaggio trigger\n");
       // Continuiamo comunque l'esecuzione
     }
+    trace_end(TRACE_FORMAT, format_start);
 
     // Invia il trigger a sketchybar
     sketchybar(trigger_message);
+    trace_end(TRACE_TICK, tick_start);
 
-    // Attesa per il prossimo aggiornamento
-    // Verifica che il valore non sia troppo grande o negativo
-    if (update_freq <= 0 || update_freq > 3600) {
-      fprintf(stderr, "Frequenza di aggiornamento non valida (%f), uso 1 secondo\n", update_freq);
-      update_freq = 1.0;
-    }
+    // In replay il ritmo lo dà il log
+    if (replay_path)
+      continue;
 
-    unsigned long sleep_time = (unsigned long)(update_freq * 1000000);
-    usleep(sleep_time);
+    // Attesa per il prossimo aggiornamento, sulla griglia condivisa con gli altri provider
+    cadence_wait(&cadence);
   }
 
-  // Mai raggiunto, ma il compilatore potrebbe avvisare senza return
+  // Raggiunto solo a fine replay
+  sample_log_close(&sample_log);
   return 0;
 }
@@ -0,0 +1,199 @@
+#ifndef CPU_STATS_H
+#define CPU_STATS_H
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Il carico è un intero 0..100: un bin per valore
+#define CPU_STATS_BINS 101
+// Numero massimo di campioni conservati per finestra (oltre si decima)
+#define CPU_STATS_MAX_SAMPLES 4096
+
+/**
+ * Statistiche mobili su una finestra temporale fissa.
+ *
+ * EWMA con costante di tempo pari alla finestra (come il load average) e
+ * istogramma esatto degli ultimi campioni: ogni aggiornamento toglie dal
+ * bin il campione uscito dal ring e aggiunge quello nuovo, quindi O(1).
+ * Tutta la memoria è allocata all'inizializzazione.
+ */
+struct cpu_window {
+  double   alpha;
+  double   ewma;
+  bool     primed;
+  uint32_t decimation; // Tick per campione conservato
+  uint32_t phase;
+  uint32_t capacity;
+  uint32_t head;
+  uint32_t count;
+  uint8_t* ring;
+  uint16_t histogram[CPU_STATS_BINS];
+};
+
+/**
+ * Inizializza una finestra
+ *
+ * @param window Finestra da inizializzare
+ * @param window_seconds Durata della finestra
+ * @param period_seconds Periodo di campionamento
+ * @return true in caso di successo
+ */
+[[nodiscard]] static inline bool cpu_window_init(struct cpu_window* window, double window_seconds, double period_seconds) {
+  if (!window || window_seconds <= 0 || period_seconds <= 0)
+    return false;
+
+  memset(window, 0, sizeof(struct cpu_window));
+
+  double ticks       = ceil(window_seconds / period_seconds);
+  window->decimation = (uint32_t)ceil(ticks / CPU_STATS_MAX_SAMPLES);
+  window->capacity   = (uint32_t)ceil(ticks / window->decimation);
+  window->alpha      = 1.0 - exp(-period_seconds / window_seconds);
+
+  window->ring = calloc(window->capacity, sizeof(uint8_t));
+  return window->ring != NULL;
+}
+
+/**
+ * Libera la memoria di una finestra
+ *
+ * @param window Finestra da liberare
+ */
+static inline void cpu_window_cleanup(struct cpu_window* window) {
+  if (!window)
+    return;
+  free(window->ring);
+  window->ring = NULL;
+}
+
+/**
+ * Aggiunge un campione alla finestra
+ *
+ * @param window Finestra da aggiornare
+ * @param load Carico 0..100
+ */
+static inline void cpu_window_add(struct cpu_window* window, int load) {
+  if (!window || !window->ring)
+    return;
+
+  uint8_t value = (uint8_t)(load < 0 ? 0 : (load > 100 ? 100 : load));
+
+  if (!window->primed) {
+    window->ewma   = value;
+    window->primed = true;
+  } else {
+    window->ewma += window->alpha * ((double)value - window->ewma);
+  }
+
+  if (window->phase++ % window->decimation != 0)
+    return;
+
+  if (window->count == window->capacity)
+    window->histogram[window->ring[window->head]]--;
+  else
+    window->count++;
+
+  window->ring[window->head] = value;
+  window->histogram[value]++;
+  window->head = (window->head + 1) % window->capacity;
+}
+
+/**
+ * Calcola un percentile della finestra (nearest-rank)
+ *
+ * @param window Finestra da interrogare
+ * @param percentile Percentile richiesto, 0..100
+ * @return Il percentile, 0 se la finestra è vuota
+ */
+[[nodiscard]] static inline int cpu_window_percentile(const struct cpu_window* window, double percentile) {
+  if (!window || window->count == 0)
+    return 0;
+
+  uint32_t rank = (uint32_t)ceil(percentile / 100.0 * window->count);
+  if (rank == 0)
+    rank = 1;
+
+  uint32_t seen = 0;
+  for (int bin = 0; bin < CPU_STATS_BINS; bin++) {
+    seen += window->histogram[bin];
+    if (seen >= rank)
+      return bin;
+  }
+  return CPU_STATS_BINS - 1;
+}
+
+// Finestre pubblicate: 1, 5 e 15 minuti
+#define CPU_STATS_WINDOWS 3
+
+static const int   CPU_STATS_WINDOW_SECONDS[CPU_STATS_WINDOWS] = {60, 300, 900};
+static const char* CPU_STATS_WINDOW_NAMES[CPU_STATS_WINDOWS]   = {"1m", "5m", "15m"};
+
+struct cpu_stats {
+  struct cpu_window windows[CPU_STATS_WINDOWS];
+};
+
+/**
+ * Inizializza le finestre 1/5/15 minuti
+ *
+ * @param stats Struttura da inizializzare
+ * @param period_seconds Periodo di campionamento
+ * @return true in caso di successo
+ */
+[[nodiscard]] static inline bool cpu_stats_init(struct cpu_stats* stats, double period_seconds) {
+  for (int i = 0; i < CPU_STATS_WINDOWS; i++) {
+    if (!cpu_window_init(&stats->windows[i], CPU_STATS_WINDOW_SECONDS[i], period_seconds)) {
+      while (i-- > 0)
+        cpu_window_cleanup(&stats->windows[i]);
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Aggiunge un campione a tutte le finestre
+ *
+ * @param stats Statistiche da aggiornare
+ * @param load Carico 0..100
+ */
+static inline void cpu_stats_add(struct cpu_stats* stats, int load) {
+  for (int i = 0; i < CPU_STATS_WINDOWS; i++)
+    cpu_window_add(&stats->windows[i], load);
+}
+
+/**
+ * Formatta i campi opzionali del trigger (avg_1m, p95_1m, ...)
+ *
+ * @param stats Statistiche da formattare
+ * @param buffer Buffer di output
+ * @param size Dimensione del buffer
+ * @return Numero di caratteri scritti, come snprintf
+ */
+static inline int cpu_stats_format(const struct cpu_stats* stats, char* buffer, size_t size) {
+  int written = 0;
+  for (int i = 0; i < CPU_STATS_WINDOWS && written >= 0 && (size_t)written < size; i++) {
+    const struct cpu_window* window = &stats->windows[i];
+    int                      result = snprintf(
+        buffer + written, size - (size_t)written, " avg_%s='%02d' p95_%s='%02d'", CPU_STATS_WINDOW_NAMES[i], (int)lround(window->ewma),
+        CPU_STATS_WINDOW_NAMES[i], cpu_window_percentile(window, 95.0));
+    if (result < 0)
+      return result;
+    written += result;
+  }
+  return written;
+}
+
+/**
+ * Libera la memoria delle finestre
+ *
+ * @param stats Statistiche da liberare
+ */
+static inline void cpu_stats_cleanup(struct cpu_stats* stats) {
+  for (int i = 0; i < CPU_STATS_WINDOWS; i++)
+    cpu_window_cleanup(&stats->windows[i]);
+}
+
+#endif /* CPU_STATS_H */
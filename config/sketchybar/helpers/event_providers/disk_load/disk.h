@@ -0,0 +1,435 @@
+#ifndef DISK_H
+#define DISK_H
+
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef __APPLE__
+#include <CoreFoundation/CoreFoundation.h>
+#include <IOKit/IOBSD.h>
+#include <IOKit/IOKitLib.h>
+#include <IOKit/storage/IOBlockStorageDriver.h>
+#include <IOKit/storage/IOMedia.h>
+#else
+#include "../batch_read.h"
+#include <dirent.h>
+#endif
+
+// Numero massimo di dischi sommati
+#define DISK_MAX_DEVICES 32
+// Lunghezza massima del nome BSD/kernel di un disco
+#define DISK_NAME_LENGTH 32
+
+// Array di stringhe per le unità, come in network_load
+static const char disk_unit_str[3][6] = {
+    {" Bps"},
+    {"KBps"},
+    {"MBps"},
+};
+
+enum disk_unit { DISK_UNIT_BPS, DISK_UNIT_KBPS, DISK_UNIT_MBPS };
+
+/**
+ * Contatori cumulativi di un disco
+ */
+struct disk_counters {
+  uint64_t read_bytes;
+  uint64_t write_bytes;
+  uint64_t reads;
+  uint64_t writes;
+};
+
+/**
+ * Un disco scelto all'inizializzazione
+ */
+struct disk_device {
+  char                 name[DISK_NAME_LENGTH];
+  struct disk_counters last;
+#ifdef __APPLE__
+  io_registry_entry_t driver; // IOBlockStorageDriver, trattenuto
+#else
+  int line; // Riga in /proc/diskstats
+#endif
+};
+
+struct disk {
+  // Array piatto dei dischi filtrati una volta sola all'avvio
+  char               device[DISK_NAME_LENGTH]; // Filtro richiesto: un nome o "all"
+  struct disk_device devices[DISK_MAX_DEVICES];
+  int                count;
+  struct timespec    ts_nm1, ts_n;
+
+#ifndef __APPLE__
+  struct batch_source source; // /proc/diskstats, tenuto aperto
+  char                path[BATCH_PATH_LENGTH];
+#endif
+
+  double         read_rate;  // Lettura in byte al secondo
+  double         write_rate; // Scrittura in byte al secondo
+  double         read_iops;  // Operazioni di lettura al secondo
+  double         write_iops; // Operazioni di scrittura al secondo
+  bool           valid;      // Il campione corrente ha un intervallo valido
+  int            read;       // Velocità di lettura nell'unità scelta
+  int            write;      // Velocità di scrittura nell'unità scelta
+  enum disk_unit read_unit, write_unit;
+};
+
+/**
+ * Converte una velocità in byte al secondo nel valore e nell'unità da mostrare
+ *
+ * @param rate Velocità in byte al secondo
+ * @param value Valore intero nell'unità scelta
+ * @param unit Unità scelta
+ */
+static inline void disk_scale(double rate, int* value, enum disk_unit* unit) {
+  // Evita log di valori negativi o zero
+  double exponent = (rate > 0) ? log10(rate) : 0;
+
+  if (exponent < 3) {
+    *unit  = DISK_UNIT_BPS;
+    *value = (int)rate;
+  } else if (exponent < 6) {
+    *unit  = DISK_UNIT_KBPS;
+    *value = (int)(rate / 1000.0);
+  } else {
+    *unit  = DISK_UNIT_MBPS;
+    *value = (int)(rate / 1000000.0);
+  }
+}
+
+#ifdef __APPLE__
+/**
+ * Legge un contatore dal dizionario delle statistiche del driver
+ */
+[[nodiscard]] static inline uint64_t disk_stat(CFDictionaryRef stats, CFStringRef key) {
+  CFNumberRef number = CFDictionaryGetValue(stats, key);
+  int64_t     value  = 0;
+  if (number)
+    CFNumberGetValue(number, kCFNumberSInt64Type, &value);
+  return (uint64_t)value;
+}
+
+/**
+ * Legge i contatori di un disco dalle statistiche di IOBlockStorageDriver
+ *
+ * @return true in caso di successo
+ */
+[[nodiscard]] static inline bool disk_read_device(struct disk_device* device, struct disk_counters* counters) {
+  CFDictionaryRef stats =
+      IORegistryEntryCreateCFProperty(device->driver, CFSTR(kIOBlockStorageDriverStatisticsKey), kCFAllocatorDefault, 0);
+  if (!stats)
+    return false;
+
+  counters->read_bytes  = disk_stat(stats, CFSTR(kIOBlockStorageDriverStatisticsBytesReadKey));
+  counters->write_bytes = disk_stat(stats, CFSTR(kIOBlockStorageDriverStatisticsBytesWrittenKey));
+  counters->reads       = disk_stat(stats, CFSTR(kIOBlockStorageDriverStatisticsReadsKey));
+  counters->writes      = disk_stat(stats, CFSTR(kIOBlockStorageDriverStatisticsWritesKey));
+  CFRelease(stats);
+  return true;
+}
+
+/**
+ * Trova i dischi: un IOBlockStorageDriver per disco intero, il nome BSD è
+ * quello del media figlio (disk0, disk1, ...)
+ */
+[[nodiscard]] static inline int disk_discover(struct disk* disk, const char* device) {
+  io_iterator_t iterator;
+  if (IOServiceGetMatchingServices(MACH_PORT_NULL, IOServiceMatching(kIOBlockStorageDriverClass), &iterator) != KERN_SUCCESS)
+    return -1;
+
+  io_registry_entry_t driver;
+  while ((driver = IOIteratorNext(iterator)) != 0) {
+    io_registry_entry_t media = 0;
+    bool                keep  = false;
+    char                name[DISK_NAME_LENGTH];
+
+    if (IORegistryEntryGetChildEntry(driver, kIOServicePlane, &media) == KERN_SUCCESS) {
+      CFStringRef  bsd   = IORegistryEntryCreateCFProperty(media, CFSTR(kIOBSDNameKey), kCFAllocatorDefault, 0);
+      CFBooleanRef whole = IORegistryEntryCreateCFProperty(media, CFSTR(kIOMediaWholeKey), kCFAllocatorDefault, 0);
+
+      keep = bsd && CFStringGetCString(bsd, name, sizeof(name), kCFStringEncodingUTF8) && whole && CFBooleanGetValue(whole)
+          && (strcmp(device, "all") == 0 || strcmp(device, name) == 0) && disk->count < DISK_MAX_DEVICES;
+
+      if (bsd)
+        CFRelease(bsd);
+      if (whole)
+        CFRelease(whole);
+      IOObjectRelease(media);
+    }
+
+    if (!keep) {
+      IOObjectRelease(driver);
+      continue;
+    }
+
+    struct disk_device* entry = &disk->devices[disk->count++];
+    snprintf(entry->name, sizeof(entry->name), "%s", name);
+    entry->driver = driver;
+  }
+  IOObjectRelease(iterator);
+  return 0;
+}
+
+/**
+ * Legge i contatori di tutti i dischi
+ *
+ * @param disk Struttura disk
+ * @param counters Array di count contatori da riempire
+ * @return 0 in caso di successo, -1 altrimenti
+ */
+[[nodiscard]] static inline int disk_read(struct disk* disk, struct disk_counters* counters) {
+  for (int i = 0; i < disk->count; i++) {
+    if (!disk_read_device(&disk->devices[i], &counters[i]))
+      return -1;
+  }
+  return 0;
+}
+
+#else
+
+/**
+ * Il disco va sommato? Solo dischi interi (presenti in /sys/block), niente
+ * loop, ramdisk, zram o dispositivi impilati su altri dischi (LVM, RAID),
+ * che conterebbero due volte lo stesso traffico
+ */
+[[nodiscard]] static inline bool disk_is_physical(const char* name) {
+  if (strncmp(name, "loop", 4) == 0 || strncmp(name, "ram", 3) == 0 || strncmp(name, "zram", 4) == 0)
+    return false;
+
+  char relative[BATCH_PATH_LENGTH];
+  char path[BATCH_PATH_LENGTH];
+  snprintf(relative, sizeof(relative), "/sys/block/%s/slaves", name);
+  if (!batch_path(path, sizeof(path), relative))
+    return false;
+
+  DIR* slaves = opendir(path);
+  if (!slaves) {
+    // Niente /sys/block/<name>: è una partizione
+    snprintf(relative, sizeof(relative), "/sys/block/%s", name);
+    return batch_path(path, sizeof(path), relative) && access(path, F_OK) == 0;
+  }
+
+  bool           stacked = false;
+  struct dirent* entry;
+  while ((entry = readdir(slaves)) != NULL) {
+    if (entry->d_name[0] != '.') {
+      stacked = true;
+      break;
+    }
+  }
+  closedir(slaves);
+  return !stacked;
+}
+
+/**
+ * Estrae nome e contatori da una riga di /proc/diskstats:
+ * "major minor name reads merged sectors ms writes merged sectors ..."
+ *
+ * @return Puntatore al nome (terminato da '\0' in name), NULL se la riga non è valida
+ */
+[[nodiscard]] static inline const char* disk_parse_line(const char* line, char* name, struct disk_counters* counters) {
+  char* cursor = NULL;
+  strtoul(line, &cursor, 10);
+  strtoul(cursor, &cursor, 10);
+  while (*cursor == ' ')
+    cursor++;
+
+  size_t length = strcspn(cursor, " \n");
+  if (length == 0 || length >= DISK_NAME_LENGTH)
+    return NULL;
+  memcpy(name, cursor, length);
+  name[length] = '\0';
+  cursor += length;
+
+  uint64_t fields[7];
+  for (int i = 0; i < 7; i++)
+    fields[i] = strtoull(cursor, &cursor, 10);
+
+  // I settori di diskstats sono sempre da 512 byte
+  counters->reads       = fields[0];
+  counters->read_bytes  = fields[2] * 512;
+  counters->writes      = fields[4];
+  counters->write_bytes = fields[6] * 512;
+  return name;
+}
+
+/**
+ * Trova i dischi in /proc/diskstats e ne ricorda la riga
+ */
+[[nodiscard]] static inline int disk_discover(struct disk* disk, const char* device) {
+  if (!batch_source_pread(&disk->source, NULL))
+    return -1;
+
+  disk->count    = 0;
+  int         nr = 0;
+  const char* line;
+  for (line = disk->source.buffer; *line; nr++) {
+    char                 name[DISK_NAME_LENGTH];
+    struct disk_counters counters;
+    const char*          end = strchr(line, '\n');
+
+    bool all = strcmp(device, "all") == 0;
+    if (disk_parse_line(line, name, &counters) && disk->count < DISK_MAX_DEVICES
+        && (all ? disk_is_physical(name) : strcmp(name, device) == 0)) {
+      struct disk_device* entry = &disk->devices[disk->count++];
+      snprintf(entry->name, sizeof(entry->name), "%s", name);
+      entry->line = nr;
+    }
+
+    if (!end)
+      break;
+    line = end + 1;
+  }
+  return 0;
+}
+
+/**
+ * Legge i contatori di tutti i dischi con una sola pread di /proc/diskstats;
+ * i dischi sono in ordine di riga, quindi basta un passaggio
+ *
+ * @param disk Struttura disk
+ * @param counters Array di count contatori da riempire
+ * @return 0 in caso di successo, -1 se l'elenco dei dischi è cambiato
+ */
+[[nodiscard]] static inline int disk_read(struct disk* disk, struct disk_counters* counters) {
+  if (!batch_source_pread(&disk->source, NULL))
+    return -1;
+
+  const char* line = disk->source.buffer;
+  int         nr   = 0;
+  for (int i = 0; i < disk->count; i++) {
+    for (; nr < disk->devices[i].line && line; nr++) {
+      line = strchr(line, '\n');
+      if (line)
+        line++;
+    }
+
+    char name[DISK_NAME_LENGTH];
+    if (!line || !disk_parse_line(line, name, &counters[i]) || strcmp(name, disk->devices[i].name) != 0)
+      return -1;
+  }
+  return 0;
+}
+
+#endif
+
+/**
+ * Sceglie i dischi e legge la base dei delta
+ *
+ * @return 0 in caso di successo, -1 altrimenti
+ */
+[[nodiscard]] static inline int disk_rescan(struct disk* disk) {
+#ifdef __APPLE__
+  for (int i = 0; i < disk->count; i++)
+    IOObjectRelease(disk->devices[i].driver);
+#endif
+  disk->count = 0;
+
+  struct disk_counters counters[DISK_MAX_DEVICES];
+  if (disk_discover(disk, disk->device) < 0 || disk->count == 0 || disk_read(disk, counters) < 0)
+    return -1;
+
+  for (int i = 0; i < disk->count; i++)
+    disk->devices[i].last = counters[i];
+  return 0;
+}
+
+/**
+ * Inizializza una struttura disk
+ *
+ * @param disk Puntatore alla struttura disk da inizializzare
+ * @param device Nome del disco, oppure "all" per tutti i dischi interi
+ * @return 0 in caso di successo, -1 altrimenti
+ */
+[[nodiscard]] static inline int disk_init(struct disk* disk, const char* device) {
+  if (!disk || !device)
+    return -1;
+
+  memset(disk, 0, sizeof(struct disk));
+  snprintf(disk->device, sizeof(disk->device), "%s", device);
+
+#ifndef __APPLE__
+  if (!batch_path(disk->path, sizeof(disk->path), "/proc/diskstats") || !batch_source_open(&disk->source, disk->path, 4096)) {
+    fprintf(stderr, "Errore nell'aprire %s: %s\n", disk->path, strerror(errno));
+    return -1;
+  }
+#endif
+
+  if (disk_rescan(disk) < 0) {
+    fprintf(stderr, "Disco '%s' non trovato\n", device);
+    return -1;
+  }
+
+  // Timestamp monotoni: non risentono delle correzioni dell'orologio di sistema
+  clock_gettime(CLOCK_MONOTONIC, &disk->ts_n);
+  disk->ts_nm1 = disk->ts_n;
+  return 0;
+}
+
+/**
+ * Differenza tra due letture di un contatore, 0 se il contatore è tornato indietro
+ */
+[[nodiscard]] static inline uint64_t disk_delta(uint64_t now, uint64_t last) {
+  return now >= last ? now - last : 0;
+}
+
+/**
+ * Aggiorna i dati dei dischi
+ *
+ * @param disk Puntatore alla struttura disk da aggiornare
+ */
+static inline void disk_update(struct disk* disk) {
+  if (!disk)
+    return;
+
+  disk->valid = false;
+
+  // Un disco aggiunto o rimosso sposta le righe: si ripete il filtro e si salta un campione
+  struct disk_counters counters[DISK_MAX_DEVICES];
+  if (disk_read(disk, counters) < 0) {
+    if (disk_rescan(disk) < 0)
+      fprintf(stderr, "Errore nel leggere le statistiche dei dischi\n");
+    clock_gettime(CLOCK_MONOTONIC, &disk->ts_nm1);
+    return;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &disk->ts_n);
+  double time_scale = (double)(disk->ts_n.tv_sec - disk->ts_nm1.tv_sec) + 1e-9 * (double)(disk->ts_n.tv_nsec - disk->ts_nm1.tv_nsec);
+  disk->ts_nm1      = disk->ts_n;
+
+  // Somma dei delta sull'array piatto dei dischi; un contatore che torna
+  // indietro (disco reinizializzato con lo stesso nome) riparte da una nuova base
+  struct disk_counters delta = {0};
+  for (int i = 0; i < disk->count; i++) {
+    struct disk_counters* last = &disk->devices[i].last;
+    delta.read_bytes += disk_delta(counters[i].read_bytes, last->read_bytes);
+    delta.write_bytes += disk_delta(counters[i].write_bytes, last->write_bytes);
+    delta.reads += disk_delta(counters[i].reads, last->reads);
+    delta.writes += disk_delta(counters[i].writes, last->writes);
+    *last = counters[i];
+  }
+
+  // Verifica che il tempo sia in un range ragionevole
+  static const double MIN_VALID_TIME = 1e-6;
+  static const double MAX_VALID_TIME = 1e2;
+
+  if (time_scale < MIN_VALID_TIME || time_scale > MAX_VALID_TIME)
+    return;
+
+  disk->read_rate  = (double)delta.read_bytes / time_scale;
+  disk->write_rate = (double)delta.write_bytes / time_scale;
+  disk->read_iops  = (double)delta.reads / time_scale;
+  disk->write_iops = (double)delta.writes / time_scale;
+  disk->valid      = true;
+
+  disk_scale(disk->read_rate, &disk->read, &disk->read_unit);
+  disk_scale(disk->write_rate, &disk->write, &disk->write_unit);
+}
+
+#endif /* DISK_H */
@@ -0,0 +1,117 @@
+#include "../cadence.h"
+#include "../sketchybar.h"
+#include "disk.h"
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static const int MAX_MESSAGE_LENGTH = 512;
+
+/**
+ * Mostra le istruzioni per l'uso del programma
+ */
+static void show_usage(const char* program_name) {
+  if (!program_name)
+    program_name = "disk_load";
+  printf("Usage: %s \"<device>\" \"<event-name>\" \"<event_freq>\"\n", program_name);
+  printf("  device: nome del disco (disk0, nvme0n1, ...) oppure \"all\" per tutti i dischi interi\n");
+}
+
+/**
+ * Gestisce eventuali segnali
+ */
+static void signal_handler(int signum) {
+  fprintf(stderr, "Ricevuto segnale %d, uscita in corso...\n", signum);
+  exit(signum);
+}
+
+int main(int argc, char** argv) {
+  float update_freq;
+
+  // Verifica argomenti
+  if (argc < 4 || (sscanf(argv[3], "%f", &update_freq) != 1) || update_freq <= 0) {
+    show_usage(argv[0]);
+    exit(1);
+  }
+
+  // Disattiva il segnale di allarme e imposta handler di segnali
+  if (alarm(0) == (unsigned int)-1) {
+    fprintf(stderr, "Avviso: errore nella disattivazione dell'allarme: %s\n", strerror(errno));
+    // Non è un errore critico, possiamo continuare
+  }
+
+  // Imposta gestione dei segnali per terminazione pulita
+  struct sigaction sa = {0};
+  sa.sa_handler       = signal_handler;
+  sigemptyset(&sa.sa_mask);
+
+  if (sigaction(SIGINT, &sa, NULL) < 0 || sigaction(SIGTERM, &sa, NULL) < 0) {
+    fprintf(stderr, "Avviso: impossibile impostare handler di segnali: %s\n", strerror(errno));
+    // Non è un errore critico, possiamo continuare
+  }
+
+  // Setup the event in sketchybar
+  char event_message[MAX_MESSAGE_LENGTH];
+  int  msg_len = snprintf(event_message, sizeof(event_message), "--add event '%s'", argv[2]);
+
+  if (msg_len < 0 || msg_len >= (int)sizeof(event_message)) {
+    fprintf(stderr, "Errore durante la formattazione del messaggio evento\n");
+    return 1;
+  }
+
+  sketchybar(event_message);
+
+  // Inizializza la struttura disk
+  struct disk disk;
+  if (disk_init(&disk, argv[1]) != 0) {
+    fprintf(stderr, "Errore: impossibile inizializzare il disco '%s'\n", argv[1]);
+    return 1;
+  }
+
+  // Buffer per il messaggio di trigger
+  char trigger_message[MAX_MESSAGE_LENGTH];
+
+  // Verifica che il valore della frequenza sia in un range ragionevole
+  if (update_freq < 0.1 || update_freq > 3600) {
+    fprintf(stderr, "Frequenza di aggiornamento non valida (%f), uso 1 secondo\n", update_freq);
+    update_freq = 1.0;
+  }
+
+  struct cadence cadence;
+  cadence_init(&cadence, update_freq);
+
+  // Loop principale
+  for (;;) {
+    // Attesa prima della lettura: il primo delta parte dalla base di disk_init,
+    // le scadenze dalla griglia condivisa con gli altri provider
+    cadence_wait(&cadence);
+
+    // Aggiorna le informazioni dei dischi
+    uint64_t tick_start = trace_begin();
+    disk_update(&disk);
+    trace_end(TRACE_SAMPLE, tick_start);
+
+    // Prepara il messaggio di evento
+    uint64_t format_start = trace_begin();
+    int      trigger_len  = snprintf(
+        trigger_message, sizeof(trigger_message),
+        "--trigger '%s' read='%03d%s' write='%03d%s' read_iops='%d' write_iops='%d' disks='%d'", argv[2], disk.read,
+        disk_unit_str[disk.read_unit], disk.write, disk_unit_str[disk.write_unit], (int)lround(disk.read_iops),
+        (int)lround(disk.write_iops), disk.count);
+
+    if (trigger_len < 0 || trigger_len >= (int)sizeof(trigger_message)) {
+      fprintf(stderr, "Errore o troncamento durante la formattazione del messaggio trigger\n");
+      // Continuiamo comunque l'esecuzione
+    }
+    trace_end(TRACE_FORMAT, format_start);
+
+    // Invia il trigger a sketchybar
+    sketchybar(trigger_message);
+    trace_end(TRACE_TICK, tick_start);
+  }
+
+  // Mai raggiunto
+  return 0;
+}
@@ -0,0 +1,516 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define HISTORY_VERSION 1
+// Dimensione di un blocco, l'unità che sbhist decodifica o salta
+#define HISTORY_BLOCK_SIZE 4096
+// Blocchi di una partizione giornaliera, intestazione compresa (4 MiB, file sparso)
+#define HISTORY_PARTITION_BLOCKS 1024
+// Serie per campione
+#define HISTORY_MAX_SERIES 4
+#define HISTORY_NAME_LENGTH 16
+#define HISTORY_PATH_LENGTH 512
+#define HISTORY_DAY_MS 86400000ll
+// Giorni conservati se il provider non indica --history-days
+#define HISTORY_DEFAULT_RETENTION_DAYS 30
+// Bit massimi di un campione: timestamp (4 + 32) e per ogni serie controllo (2), zeri iniziali (5), lunghezza (6) e valore (64)
+#define HISTORY_SAMPLE_MAX_BITS (36 + HISTORY_MAX_SERIES * (2 + 5 + 6 + 64))
+
+/**
+ * Intestazione di una partizione, nel primo blocco del file
+ */
+struct history_header {
+  char     magic[4]; // "SBHI"
+  uint32_t version;
+  uint32_t series;
+  uint32_t blocks;       // Blocchi di dati scritti, l'ultimo può essere parziale
+  int64_t  partition_ms; // Inizio del giorno UTC, in ms dall'epoch
+  char     names[HISTORY_MAX_SERIES][HISTORY_NAME_LENGTH];
+};
+
+/**
+ * Blocco di dati: riepilogo non compresso seguito dai campioni codificati.
+ *
+ * Ogni blocco si decodifica da solo. Il riepilogo basta a sbhist per
+ * saltare i blocchi fuori intervallo e per aggregare senza decodificarli
+ * quelli che cadono interi in un solo intervallo di downsampling.
+ */
+struct history_block {
+  int64_t  first_ms; // Timestamp del primo campione
+  int64_t  last_ms;  // Timestamp dell'ultimo campione
+  uint32_t count;    // Campioni, aggiornato per ultimo
+  uint32_t bits;     // Bit usati del payload
+  double   min[HISTORY_MAX_SERIES];
+  double   max[HISTORY_MAX_SERIES];
+  double   sum[HISTORY_MAX_SERIES];
+  uint8_t  payload[];
+};
+
+#define HISTORY_PAYLOAD_BITS ((HISTORY_BLOCK_SIZE - sizeof(struct history_block)) * 8)
+
+/**
+ * Storico compresso di un provider su disco (--history <dir>).
+ *
+ * Un file per giorno UTC (<dir>/AAAA-MM-GG.sbh) mappato in memoria e
+ * diviso in blocchi da 4 KiB. I campioni sono codificati come in Gorilla:
+ * il timestamp come delta del delta in ms (1 bit se la cadenza è
+ * regolare), ogni valore come XOR con il precedente della stessa serie,
+ * con la finestra dei bit significativi riusata finché ci sta (1 bit se il
+ * valore non cambia). A ogni cambio di giorno le partizioni più vecchie di
+ * retention_days vengono cancellate. Alla riapertura dello stesso giorno la
+ * scrittura riprende da un blocco nuovo, così un blocco interrotto da un
+ * crash resta leggibile fino all'ultimo campione contato.
+ */
+struct history {
+  char dir[HISTORY_PATH_LENGTH];
+  int  series;
+  char names[HISTORY_MAX_SERIES][HISTORY_NAME_LENGTH];
+  int  retention_days;
+
+  int                    fd;
+  uint8_t*               map;
+  struct history_header* header;
+  struct history_block*  block; // Blocco corrente, NULL se il prossimo campione ne apre uno
+  int64_t                partition_ms;
+  bool                   full;
+
+  // Stato del codificatore nel blocco corrente
+  int64_t  prev_ms;
+  int64_t  prev_delta;
+  uint64_t prev_bits[HISTORY_MAX_SERIES];
+  int      prev_leading[HISTORY_MAX_SERIES];
+  int      prev_trailing[HISTORY_MAX_SERIES];
+};
+
+/**
+ * Tempo reale corrente in millisecondi dall'epoch
+ */
+[[nodiscard]] static inline int64_t history_now_ms() {
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * Inizio del giorno UTC che contiene l'istante indicato
+ */
+[[nodiscard]] static inline int64_t history_day_start(int64_t ms) {
+  int64_t day = ms / HISTORY_DAY_MS;
+  if (ms < 0 && ms % HISTORY_DAY_MS)
+    day--;
+  return day * HISTORY_DAY_MS;
+}
+
+/**
+ * Percorso della partizione di un giorno
+ *
+ * @return true se il percorso sta nel buffer
+ */
+[[nodiscard]] static inline bool history_partition_path(char* path, size_t size, const char* dir, int64_t day_ms) {
+  time_t    seconds = (time_t)(day_ms / 1000);
+  struct tm day;
+  if (!gmtime_r(&seconds, &day))
+    return false;
+  int written = snprintf(path, size, "%s/%04d-%02d-%02d.sbh", dir, day.tm_year + 1900, day.tm_mon + 1, day.tm_mday);
+  return written > 0 && written < (int)size;
+}
+
+/**
+ * Verifica l'intestazione di una partizione mappata
+ */
+[[nodiscard]] static inline bool history_header_valid(const struct history_header* header) {
+  return memcmp(header->magic, "SBHI", 4) == 0 && header->version == HISTORY_VERSION && header->series >= 1
+      && header->series <= HISTORY_MAX_SERIES && header->blocks < HISTORY_PARTITION_BLOCKS;
+}
+
+// --- Bit ---
+
+/**
+ * Scrive i count bit meno significativi di value, dal più significativo, a partire dal bit *bit
+ * (il payload di un blocco nuovo è già a zero)
+ */
+static inline void history_put_bits(uint8_t* payload, uint32_t* bit, uint64_t value, int count) {
+  for (int i = count - 1; i >= 0; i--) {
+    if ((value >> i) & 1)
+      payload[*bit >> 3] |= (uint8_t)(0x80 >> (*bit & 7));
+    (*bit)++;
+  }
+}
+
+[[nodiscard]] static inline uint64_t history_get_bits(const uint8_t* payload, uint32_t* bit, int count) {
+  uint64_t value = 0;
+  for (int i = 0; i < count; i++) {
+    value = value << 1 | ((payload[*bit >> 3] >> (7 - (*bit & 7))) & 1);
+    (*bit)++;
+  }
+  return value;
+}
+
+[[nodiscard]] static inline uint64_t history_double_bits(double value) {
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+[[nodiscard]] static inline double history_bits_double(uint64_t bits) {
+  double value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+// --- Scrittura ---
+
+/**
+ * Prepara lo storico; le partizioni vengono create alla prima scrittura
+ *
+ * @param history Storico da inizializzare
+ * @param dir Directory delle partizioni, creata se manca
+ * @param names Nomi delle serie
+ * @param series Numero di serie, al più HISTORY_MAX_SERIES
+ * @param retention_days Giorni conservati, compreso quello corrente
+ * @return true se la directory è utilizzabile
+ */
+[[nodiscard]] static inline bool history_open(struct history* history, const char* dir, const char* const* names, int series,
+                                              int retention_days) {
+  memset(history, 0, sizeof(struct history));
+  history->fd = -1;
+  if (series < 1 || series > HISTORY_MAX_SERIES)
+    return false;
+
+  int written = snprintf(history->dir, sizeof(history->dir), "%s", dir);
+  if (written <= 0 || written >= (int)sizeof(history->dir))
+    return false;
+  if (mkdir(dir, 0755) < 0 && errno != EEXIST)
+    return false;
+
+  history->series         = series;
+  history->retention_days = retention_days < 1 ? 1 : retention_days;
+  for (int i = 0; i < series; i++)
+    snprintf(history->names[i], HISTORY_NAME_LENGTH, "%s", names[i]);
+  history->partition_ms = INT64_MIN;
+  return true;
+}
+
+/**
+ * Cancella le partizioni più vecchie della retention
+ */
+static inline void history_prune(struct history* history) {
+  DIR* dir = opendir(history->dir);
+  if (!dir)
+    return;
+
+  int64_t        oldest = history->partition_ms - (int64_t)(history->retention_days - 1) * HISTORY_DAY_MS;
+  struct dirent* entry;
+  while ((entry = readdir(dir)) != NULL) {
+    int       year, month, day;
+    char      suffix[8];
+    struct tm date = {0};
+    if (sscanf(entry->d_name, "%4d-%2d-%2d%7s", &year, &month, &day, suffix) != 4 || strcmp(suffix, ".sbh") != 0)
+      continue;
+
+    date.tm_year = year - 1900;
+    date.tm_mon  = month - 1;
+    date.tm_mday = day;
+    if ((int64_t)timegm(&date) * 1000 >= oldest)
+      continue;
+
+    char path[HISTORY_PATH_LENGTH + 256];
+    snprintf(path, sizeof(path), "%s/%s", history->dir, entry->d_name);
+    unlink(path);
+  }
+  closedir(dir);
+}
+
+/**
+ * Rilascia la partizione mappata
+ */
+static inline void history_unmap(struct history* history) {
+  if (history->map)
+    munmap(history->map, (size_t)HISTORY_BLOCK_SIZE * HISTORY_PARTITION_BLOCKS);
+  if (history->fd >= 0)
+    close(history->fd);
+  history->map    = NULL;
+  history->header = NULL;
+  history->block  = NULL;
+  history->fd     = -1;
+  history->full   = false;
+}
+
+/**
+ * Mappa (creandola se serve) la partizione del giorno indicato
+ *
+ * @return true se la partizione è scrivibile e ha le stesse serie
+ */
+[[nodiscard]] static inline bool history_map(struct history* history, int64_t day_ms) {
+  history_unmap(history);
+  history->partition_ms = day_ms;
+
+  char path[HISTORY_PATH_LENGTH + 32];
+  if (!history_partition_path(path, sizeof(path), history->dir, day_ms))
+    return false;
+
+  size_t size = (size_t)HISTORY_BLOCK_SIZE * HISTORY_PARTITION_BLOCKS;
+  history->fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  struct stat st;
+  if (history->fd < 0 || fstat(history->fd, &st) < 0 || ((size_t)st.st_size != size && ftruncate(history->fd, (off_t)size) < 0)) {
+    history_unmap(history);
+    return false;
+  }
+
+  void* map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, history->fd, 0);
+  if (map == MAP_FAILED) {
+    history_unmap(history);
+    return false;
+  }
+  history->map    = map;
+  history->header = map;
+
+  struct history_header* header = history->header;
+  if (st.st_size == 0) {
+    memcpy(header->magic, "SBHI", 4);
+    header->version      = HISTORY_VERSION;
+    header->series       = (uint32_t)history->series;
+    header->partition_ms = day_ms;
+    memcpy(header->names, history->names, sizeof(header->names));
+  } else if (!history_header_valid(header) || header->series != (uint32_t)history->series
+             || memcmp(header->names, history->names, sizeof(header->names)) != 0) {
+    fprintf(stderr, "Partizione %s non compatibile, storico sospeso fino al giorno dopo\n", path);
+    history_unmap(history);
+    return false;
+  }
+
+  history_prune(history);
+  return true;
+}
+
+/**
+ * Apre il blocco successivo della partizione
+ *
+ * @return false se la partizione è piena
+ */
+[[nodiscard]] static inline bool history_next_block(struct history* history) {
+  if (history->header->blocks + 1 >= HISTORY_PARTITION_BLOCKS) {
+    if (!history->full)
+      fprintf(stderr, "Partizione dello storico piena, campioni scartati fino al giorno dopo\n");
+    history->full  = true;
+    history->block = NULL;
+    return false;
+  }
+
+  history->block = (struct history_block*)(history->map + (size_t)(history->header->blocks + 1) * HISTORY_BLOCK_SIZE);
+  history->header->blocks++;
+  history->prev_delta = 0;
+  for (int i = 0; i < history->series; i++) {
+    history->prev_bits[i]     = 0;
+    history->prev_leading[i]  = -1;
+    history->prev_trailing[i] = 0;
+  }
+  return true;
+}
+
+/**
+ * Codifica il delta del delta del timestamp
+ */
+static inline void history_put_timestamp(struct history* history, int64_t time_ms) {
+  struct history_block* block = history->block;
+  int64_t               delta = time_ms - history->prev_ms;
+  int64_t               dod   = delta - history->prev_delta;
+  history->prev_delta         = delta;
+
+  if (dod == 0) {
+    history_put_bits(block->payload, &block->bits, 0, 1);
+  } else if (dod >= -64 && dod < 64) {
+    history_put_bits(block->payload, &block->bits, 0b10, 2);
+    history_put_bits(block->payload, &block->bits, (uint64_t)dod, 7);
+  } else if (dod >= -256 && dod < 256) {
+    history_put_bits(block->payload, &block->bits, 0b110, 3);
+    history_put_bits(block->payload, &block->bits, (uint64_t)dod, 9);
+  } else if (dod >= -2048 && dod < 2048) {
+    history_put_bits(block->payload, &block->bits, 0b1110, 4);
+    history_put_bits(block->payload, &block->bits, (uint64_t)dod, 12);
+  } else {
+    if (dod < INT32_MIN)
+      dod = INT32_MIN;
+    if (dod > INT32_MAX)
+      dod = INT32_MAX;
+    history_put_bits(block->payload, &block->bits, 0b1111, 4);
+    history_put_bits(block->payload, &block->bits, (uint64_t)dod, 32);
+  }
+}
+
+/**
+ * Codifica un valore come XOR con il precedente della stessa serie
+ */
+static inline void history_put_value(struct history* history, int serie, double value) {
+  struct history_block* block = history->block;
+  uint64_t              bits  = history_double_bits(value);
+  uint64_t              xor   = bits ^ history->prev_bits[serie];
+  history->prev_bits[serie]   = bits;
+
+  if (!xor) {
+    history_put_bits(block->payload, &block->bits, 0, 1);
+    return;
+  }
+
+  int leading  = __builtin_clzll(xor);
+  int trailing = __builtin_ctzll(xor);
+  if (leading > 31)
+    leading = 31;
+
+  if (history->prev_leading[serie] >= 0 && leading >= history->prev_leading[serie] && trailing >= history->prev_trailing[serie]) {
+    // Stessa finestra del valore precedente
+    int significant = 64 - history->prev_leading[serie] - history->prev_trailing[serie];
+    history_put_bits(block->payload, &block->bits, 0b10, 2);
+    history_put_bits(block->payload, &block->bits, xor >> history->prev_trailing[serie], significant);
+    return;
+  }
+
+  int significant = 64 - leading - trailing;
+  history_put_bits(block->payload, &block->bits, 0b11, 2);
+  history_put_bits(block->payload, &block->bits, (uint64_t)leading, 5);
+  history_put_bits(block->payload, &block->bits, (uint64_t)(significant - 1), 6);
+  history_put_bits(block->payload, &block->bits, xor >> trailing, significant);
+  history->prev_leading[serie]  = leading;
+  history->prev_trailing[serie] = trailing;
+}
+
+/**
+ * Aggiunge un campione allo storico
+ *
+ * @param history Storico aperto con history_open
+ * @param time_ms Istante del campione, in ms dall'epoch (history_now_ms)
+ * @param values Un valore per serie
+ * @return true se il campione è stato scritto
+ */
+static inline bool history_append(struct history* history, int64_t time_ms, const double* values) {
+  int64_t day_ms = history_day_start(time_ms);
+  if (day_ms != history->partition_ms && !history_map(history, day_ms))
+    return false;
+  if (!history->map || history->full)
+    return false;
+
+  if (!history->block || history->block->bits + HISTORY_SAMPLE_MAX_BITS > HISTORY_PAYLOAD_BITS) {
+    if (!history_next_block(history))
+      return false;
+  }
+
+  struct history_block* block = history->block;
+  if (block->count == 0) {
+    // Il primo timestamp sta nel riepilogo
+    block->first_ms = time_ms;
+    for (int i = 0; i < history->series; i++)
+      block->min[i] = block->max[i] = values[i];
+  } else {
+    history_put_timestamp(history, time_ms);
+  }
+  history->prev_ms = time_ms;
+
+  for (int i = 0; i < history->series; i++) {
+    history_put_value(history, i, values[i]);
+    if (values[i] < block->min[i])
+      block->min[i] = values[i];
+    if (values[i] > block->max[i])
+      block->max[i] = values[i];
+    block->sum[i] += values[i];
+  }
+  block->last_ms = time_ms;
+  block->count++;
+  return true;
+}
+
+/**
+ * Chiude lo storico
+ */
+static inline void history_close(struct history* history) {
+  history_unmap(history);
+}
+
+// --- Lettura ---
+
+/**
+ * Decodificatore dei campioni di un blocco
+ */
+struct history_cursor {
+  const struct history_block* block;
+  int                         series;
+  uint32_t                    index;
+  uint32_t                    bit;
+  int64_t                     ms;
+  int64_t                     delta;
+  uint64_t                    bits[HISTORY_MAX_SERIES];
+  int                         leading[HISTORY_MAX_SERIES];
+  int                         trailing[HISTORY_MAX_SERIES];
+};
+
+static inline void history_cursor_init(struct history_cursor* cursor, const struct history_block* block, int series) {
+  memset(cursor, 0, sizeof(struct history_cursor));
+  cursor->block  = block;
+  cursor->series = series;
+  cursor->ms     = block->first_ms;
+}
+
+[[nodiscard]] static inline int64_t history_sign_extend(uint64_t value, int bits) {
+  uint64_t sign = 1ull << (bits - 1);
+  return (int64_t)((value ^ sign) - sign);
+}
+
+/**
+ * Decodifica il campione successivo
+ *
+ * @return false alla fine del blocco o se il payload è corrotto
+ */
+[[nodiscard]] static inline bool history_cursor_next(struct history_cursor* cursor, int64_t* time_ms, double* values) {
+  const struct history_block* block = cursor->block;
+  // Il codificatore apre un blocco nuovo prima che un campione possa uscire dal payload
+  if (cursor->index >= block->count || cursor->bit + HISTORY_SAMPLE_MAX_BITS > HISTORY_PAYLOAD_BITS)
+    return false;
+
+  if (cursor->index > 0) {
+    int64_t dod = 0;
+    if (history_get_bits(block->payload, &cursor->bit, 1)) {
+      int width = 32;
+      if (!history_get_bits(block->payload, &cursor->bit, 1))
+        width = 7;
+      else if (!history_get_bits(block->payload, &cursor->bit, 1))
+        width = 9;
+      else if (!history_get_bits(block->payload, &cursor->bit, 1))
+        width = 12;
+      dod = history_sign_extend(history_get_bits(block->payload, &cursor->bit, width), width);
+    }
+    cursor->delta += dod;
+    cursor->ms += cursor->delta;
+  }
+
+  for (int i = 0; i < cursor->series; i++) {
+    if (history_get_bits(block->payload, &cursor->bit, 1)) {
+      if (history_get_bits(block->payload, &cursor->bit, 1)) {
+        cursor->leading[i]  = (int)history_get_bits(block->payload, &cursor->bit, 5);
+        int significant     = (int)history_get_bits(block->payload, &cursor->bit, 6) + 1;
+        cursor->trailing[i] = 64 - cursor->leading[i] - significant;
+        if (cursor->trailing[i] < 0)
+          return false;
+      }
+      int significant = 64 - cursor->leading[i] - cursor->trailing[i];
+      cursor->bits[i] ^= history_get_bits(block->payload, &cursor->bit, significant) << cursor->trailing[i];
+    }
+    values[i] = history_bits_double(cursor->bits[i]);
+  }
+
+  *time_ms = cursor->ms;
+  cursor->index++;
+  return true;
+}
+
+#endif /* HISTORY_H */
@@ -0,0 +1,306 @@
+#ifndef MEM_H
+#define MEM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+// Livelli di pressione, nell'ordine di kern.memorystatus_vm_pressure_level
+enum mem_pressure {
+  MEM_PRESSURE_NORMAL,
+  MEM_PRESSURE_WARN,
+  MEM_PRESSURE_CRITICAL,
+};
+
+static const char* mem_pressure_str[] = {"normal", "warn", "critical"};
+
+/**
+ * Memoria e swap dell'ultima lettura, in byte.
+ *
+ * used è la memoria non recuperabile senza paginare: su macOS app memory +
+ * wired + compressa, come in Monitoraggio Attività; su Linux MemTotal meno
+ * MemAvailable. compressed è lo spazio occupato dal compressore (zswap su
+ * Linux, 0 se non attivo).
+ */
+struct mem_values {
+  uint64_t total;
+  uint64_t used;
+  uint64_t compressed;
+  uint64_t swap_total;
+  uint64_t swap_used;
+
+  int               used_pct;
+  enum mem_pressure pressure;
+  double            psi_some; // avg10 di /proc/pressure/memory, -1 se assente
+  double            psi_full;
+};
+
+static inline void mem_account(struct mem_values* values);
+
+#ifdef __APPLE__
+#include <mach/mach.h>
+#include <sys/sysctl.h>
+
+struct mem {
+  host_t                 host;
+  vm_size_t              page_size;
+  vm_statistics64_data_t vm;
+  struct mem_values      values;
+};
+
+/**
+ * Inizializza una struttura mem
+ *
+ * @param mem Puntatore alla struttura mem da inizializzare
+ */
+static inline void mem_init(struct mem* mem) {
+  if (!mem)
+    return;
+
+  memset(mem, 0, sizeof(struct mem));
+  mem->host = mach_host_self();
+  if (host_page_size(mem->host, &mem->page_size) != KERN_SUCCESS)
+    mem->page_size = (vm_size_t)sysconf(_SC_PAGESIZE);
+
+  size_t len = sizeof(mem->values.total);
+  if (sysctlbyname("hw.memsize", &mem->values.total, &len, NULL, 0) != 0)
+    fprintf(stderr, "Error: Could not read hw.memsize.\n");
+  mem->values.psi_some = -1.0;
+  mem->values.psi_full = -1.0;
+}
+
+/**
+ * Aggiorna memoria, swap e livello di pressione
+ *
+ * @param mem Puntatore alla struttura mem da aggiornare
+ */
+static inline void mem_update(struct mem* mem) {
+  if (!mem)
+    return;
+
+  mach_msg_type_number_t count = HOST_VM_INFO64_COUNT;
+  if (host_statistics64(mem->host, HOST_VM_INFO64, (host_info64_t)&mem->vm, &count) != KERN_SUCCESS) {
+    fprintf(stderr, "Error: Could not read vm host statistics.\n");
+    return;
+  }
+
+  // App memory (pagine anonime meno le purgeable) + wired + compressa
+  uint64_t page     = (uint64_t)mem->page_size;
+  uint64_t internal = mem->vm.internal_page_count > mem->vm.purgeable_count ? mem->vm.internal_page_count - mem->vm.purgeable_count : 0;
+  mem->values.used  = (internal + mem->vm.wire_count + mem->vm.compressor_page_count) * page;
+  mem->values.compressed = (uint64_t)mem->vm.compressor_page_count * page;
+
+  struct xsw_usage swap = {0};
+  size_t           len  = sizeof(swap);
+  if (sysctlbyname("vm.swapusage", &swap, &len, NULL, 0) == 0) {
+    mem->values.swap_total = swap.xsu_total;
+    mem->values.swap_used  = swap.xsu_used;
+  }
+
+  // 1 = normal, 2 = warning, 4 = critical
+  int level = 1;
+  len       = sizeof(level);
+  if (sysctlbyname("kern.memorystatus_vm_pressure_level", &level, &len, NULL, 0) != 0)
+    level = 1;
+  mem->values.pressure = level >= 4 ? MEM_PRESSURE_CRITICAL : level >= 2 ? MEM_PRESSURE_WARN : MEM_PRESSURE_NORMAL;
+
+  mem_account(&mem->values);
+}
+
+#else
+#include "../batch_read.h"
+
+// Soglie su avg10 di /proc/pressure/memory: una quota di tempo in stallo
+// "some" segnala memoria contesa, una quota "full" una macchina ferma
+#define MEM_PSI_WARN 10.0
+#define MEM_PSI_CRITICAL 10.0
+// Senza PSI: percentuale di MemAvailable sotto cui la pressione sale
+#define MEM_AVAILABLE_WARN 10
+#define MEM_AVAILABLE_CRITICAL 5
+
+// Chiavi di /proc/meminfo lette, nell'ordine in cui il kernel le scrive
+enum mem_key {
+  MEM_KEY_TOTAL,
+  MEM_KEY_AVAILABLE,
+  MEM_KEY_SWAP_TOTAL,
+  MEM_KEY_SWAP_FREE,
+  MEM_KEY_ZSWAP,
+  MEM_KEYS,
+};
+
+static const struct {
+  const char* name;
+  size_t      length;
+} mem_keys[MEM_KEYS] = {
+    {"MemTotal", 8}, {"MemAvailable", 12}, {"SwapTotal", 9}, {"SwapFree", 8}, {"Zswap", 5},
+};
+
+struct mem {
+  struct batch_source meminfo;  // /proc/meminfo, tenuto aperto
+  struct batch_source pressure; // /proc/pressure/memory, fd -1 senza PSI
+  char                path[BATCH_PATH_LENGTH];
+  uint64_t            keys[MEM_KEYS];
+  struct mem_values   values;
+};
+
+/**
+ * Inizializza una struttura mem
+ *
+ * @param mem Puntatore alla struttura mem da inizializzare
+ */
+static inline void mem_init(struct mem* mem) {
+  if (!mem)
+    return;
+
+  memset(mem, 0, sizeof(struct mem));
+  mem->meminfo.fd      = -1;
+  mem->pressure.fd     = -1;
+  mem->values.psi_some = -1.0;
+  mem->values.psi_full = -1.0;
+
+  char path[BATCH_PATH_LENGTH];
+  if (batch_path(path, sizeof(path), "/proc/pressure/memory"))
+    (void)batch_source_open(&mem->pressure, path, 256);
+  if (!batch_path(mem->path, sizeof(mem->path), "/proc/meminfo") || !batch_source_open(&mem->meminfo, mem->path, 4096))
+    fprintf(stderr, "Error: Could not open %s: %s\n", mem->path, strerror(errno));
+}
+
+/**
+ * Legge un intero decimale senza segno e avanza il cursore
+ */
+static inline uint64_t mem_parse_integer(const char** cursor) {
+  const char* c     = *cursor;
+  uint64_t    value = 0;
+  while (*c == ' ')
+    c++;
+  for (; *c >= '0' && *c <= '9'; c++)
+    value = value * 10 + (uint64_t)(*c - '0');
+  *cursor = c;
+  return value;
+}
+
+/**
+ * Legge un decimale a virgola fissa di PSI ("12.34") e avanza il cursore
+ */
+static inline double mem_parse_decimal(const char** cursor) {
+  double value = (double)mem_parse_integer(cursor);
+  if (**cursor == '.') {
+    const char* c     = *cursor + 1;
+    double      scale = 0.1;
+    for (; *c >= '0' && *c <= '9'; c++, scale /= 10)
+      value += (*c - '0') * scale;
+    *cursor = c;
+  }
+  return value;
+}
+
+/**
+ * Estrae da /proc/meminfo le sole chiavi di mem_keys in un passaggio.
+ *
+ * Ogni riga è "Chiave:   valore kB": si confronta il nome fino ai due punti
+ * e ci si ferma appena trovate tutte le chiavi.
+ *
+ * @return true se MemTotal e MemAvailable sono presenti
+ */
+static inline bool mem_parse_meminfo(struct mem* mem) {
+  const char* cursor = mem->meminfo.buffer;
+  const char* end    = cursor + mem->meminfo.length;
+  unsigned    found  = 0;
+
+  memset(mem->keys, 0, sizeof(mem->keys));
+  while (cursor < end && found != (1u << MEM_KEYS) - 1) {
+    const char* colon = memchr(cursor, ':', (size_t)(end - cursor));
+    if (!colon)
+      break;
+
+    size_t length = (size_t)(colon - cursor);
+    for (int k = 0; k < MEM_KEYS; k++) {
+      if (!(found & (1u << k)) && length == mem_keys[k].length && memcmp(cursor, mem_keys[k].name, length) == 0) {
+        const char* value = colon + 1;
+        mem->keys[k]      = mem_parse_integer(&value) * 1024;
+        found |= 1u << k;
+        break;
+      }
+    }
+
+    const char* newline = memchr(colon, '\n', (size_t)(end - colon));
+    cursor              = newline ? newline + 1 : end;
+  }
+  return (found & (1u << MEM_KEY_TOTAL)) && (found & (1u << MEM_KEY_AVAILABLE));
+}
+
+/**
+ * Estrae avg10 delle righe "some" e "full" di /proc/pressure/memory
+ */
+static inline void mem_parse_pressure(struct mem* mem) {
+  mem->values.psi_some = -1.0;
+  mem->values.psi_full = -1.0;
+
+  const char* cursor = mem->pressure.buffer;
+  const char* end    = cursor + mem->pressure.length;
+  while (cursor < end) {
+    // "some avg10=1.23 avg60=0.45 avg300=0.10 total=123456"
+    bool some = strncmp(cursor, "some avg10=", 11) == 0;
+    if (some || strncmp(cursor, "full avg10=", 11) == 0) {
+      cursor += 11;
+      *(some ? &mem->values.psi_some : &mem->values.psi_full) = mem_parse_decimal(&cursor);
+    }
+    const char* newline = memchr(cursor, '\n', (size_t)(end - cursor));
+    cursor              = newline ? newline + 1 : end;
+  }
+}
+
+/**
+ * Aggiorna memoria, swap e pressione con una pread per file
+ *
+ * @param mem Puntatore alla struttura mem da aggiornare
+ */
+static inline void mem_update(struct mem* mem) {
+  if (!mem)
+    return;
+
+  if (!batch_source_pread(&mem->meminfo, NULL) || !mem_parse_meminfo(mem)) {
+    fprintf(stderr, "Error: Could not read %s.\n", mem->path);
+    return;
+  }
+
+  struct mem_values* values = &mem->values;
+  uint64_t           total  = mem->keys[MEM_KEY_TOTAL];
+  uint64_t           avail  = mem->keys[MEM_KEY_AVAILABLE];
+  values->total             = total;
+  values->used              = total > avail ? total - avail : 0;
+  values->compressed        = mem->keys[MEM_KEY_ZSWAP];
+  values->swap_total        = mem->keys[MEM_KEY_SWAP_TOTAL];
+  values->swap_used         = values->swap_total > mem->keys[MEM_KEY_SWAP_FREE] ? values->swap_total - mem->keys[MEM_KEY_SWAP_FREE] : 0;
+
+  if (mem->pressure.fd >= 0 && batch_source_pread(&mem->pressure, NULL))
+    mem_parse_pressure(mem);
+
+  if (values->psi_some >= 0.0) {
+    values->pressure = values->psi_full >= MEM_PSI_CRITICAL ? MEM_PRESSURE_CRITICAL
+                       : values->psi_some >= MEM_PSI_WARN   ? MEM_PRESSURE_WARN
+                                                            : MEM_PRESSURE_NORMAL;
+  } else {
+    uint64_t available_pct = total ? avail * 100 / total : 100;
+    values->pressure       = available_pct < MEM_AVAILABLE_CRITICAL ? MEM_PRESSURE_CRITICAL
+                             : available_pct < MEM_AVAILABLE_WARN   ? MEM_PRESSURE_WARN
+                                                                    : MEM_PRESSURE_NORMAL;
+  }
+
+  mem_account(values);
+}
+
+#endif
+
+/**
+ * Calcola le percentuali dai valori appena letti
+ *
+ * @param values Valori da completare
+ */
+static inline void mem_account(struct mem_values* values) {
+  values->used_pct = values->total ? (int)((double)values->used / (double)values->total * 100.0 + 0.5) : 0;
+}
+
+#endif /* MEM_H */
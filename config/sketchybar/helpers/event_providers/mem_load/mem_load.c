@@ -0,0 +1,119 @@
+#include "../cadence.h"
+#include "../sketchybar.h"
+#include "mem.h"
+
+static const int MAX_EVENT_MESSAGE_LENGTH   = 256;
+static const int MAX_TRIGGER_MESSAGE_LENGTH = 512;
+// Un trigger identico al precedente viene saltato, ma non per più di tanti
+// tick: una barra riavviata riceve comunque i valori entro questo intervallo
+static const int MAX_SKIPPED_TICKS = 30;
+
+/**
+ * Mostra le istruzioni per l'uso del programma
+ */
+static void show_usage(const char* program_name) {
+  if (!program_name)
+    program_name = "mem_load";
+  printf("Usage: %s \"<event-name>\" \"<event_freq>\"\n", program_name);
+  printf("  pubblica used_pct, used, compressed, swap_used, swap_total (GiB), pressure (normal, warn, critical)\n");
+  printf("  e, su Linux con PSI, psi_some e psi_full; il trigger parte solo quando un valore cambia\n");
+}
+
+/**
+ * Converte byte in GiB; nel trigger hanno un decimale, e quella risoluzione
+ * è anche quella che decide se il trigger è cambiato
+ */
+static double gib(uint64_t bytes) {
+  return (double)bytes / (1024.0 * 1024.0 * 1024.0);
+}
+
+int main(int argc, char** argv) {
+  float update_freq;
+
+  // Verifica argomenti
+  if (argc < 3 || (sscanf(argv[2], "%f", &update_freq) != 1) || update_freq <= 0) {
+    show_usage(argv[0]);
+    exit(1);
+  }
+
+  // Disattiva il segnale di allarme
+  if (alarm(0) == (unsigned int)-1) {
+    fprintf(stderr, "Errore durante la disattivazione dell'allarme: %s\n", strerror(errno));
+    // Non è un errore critico, possiamo continuare
+  }
+
+  // Inizializza la struttura mem
+  struct mem mem;
+  mem_init(&mem);
+
+  // Setup the event in sketchybar
+  char event_message[MAX_EVENT_MESSAGE_LENGTH];
+  int  msg_len = snprintf(event_message, sizeof(event_message), "--add event '%s'", argv[1]);
+
+  if (msg_len < 0 || msg_len >= (int)sizeof(event_message)) {
+    fprintf(stderr, "Errore durante la formattazione del messaggio evento\n");
+    return 1;
+  }
+
+  sketchybar(event_message);
+
+  // Verifica che il valore non sia troppo grande o negativo
+  if (update_freq > 3600) {
+    fprintf(stderr, "Frequenza di aggiornamento non valida (%f), uso 1 secondo\n", update_freq);
+    update_freq = 1.0;
+  }
+
+  // Due buffer: il trigger corrente e l'ultimo inviato
+  char messages[2][MAX_TRIGGER_MESSAGE_LENGTH];
+  int  current = 0;
+  int  skipped = MAX_SKIPPED_TICKS;
+  messages[1][0] = '\0';
+
+  // Scadenze sulla griglia condivisa con gli altri provider
+  struct cadence cadence;
+  cadence_init(&cadence, update_freq);
+
+  // Loop principale
+  while (true) {
+    uint64_t tick_start = trace_begin();
+    mem_update(&mem);
+    trace_end(TRACE_SAMPLE, tick_start);
+
+    // Prepara il messaggio di evento
+    uint64_t                 format_start = trace_begin();
+    const struct mem_values* values       = &mem.values;
+    char*                    trigger      = messages[current];
+    int                      trigger_len  = snprintf(
+        trigger, MAX_TRIGGER_MESSAGE_LENGTH,
+        "--trigger '%s' used_pct='%02d' used='%.1f' compressed='%.1f' swap_used='%.1f' swap_total='%.1f' pressure='%s'", argv[1],
+        values->used_pct, gib(values->used), gib(values->compressed), gib(values->swap_used), gib(values->swap_total),
+        mem_pressure_str[values->pressure]);
+
+    if (values->psi_some >= 0.0 && trigger_len > 0 && trigger_len < MAX_TRIGGER_MESSAGE_LENGTH) {
+      int psi_len = snprintf(
+          trigger + trigger_len, (size_t)(MAX_TRIGGER_MESSAGE_LENGTH - trigger_len), " psi_some='%.1f' psi_full='%.1f'", values->psi_some,
+          values->psi_full);
+      trigger_len = psi_len < 0 ? psi_len : trigger_len + psi_len;
+    }
+
+    if (trigger_len < 0 || trigger_len >= MAX_TRIGGER_MESSAGE_LENGTH) {
+      fprintf(stderr, "Errore o troncamento durante la formattazione del messaggio trigger\n");
+      // Continuiamo comunque l'esecuzione
+    }
+    trace_end(TRACE_FORMAT, format_start);
+
+    // Invia il trigger a sketchybar solo se qualcosa è cambiato
+    if (skipped >= MAX_SKIPPED_TICKS || strcmp(trigger, messages[1 - current]) != 0) {
+      sketchybar(trigger);
+      current = 1 - current;
+      skipped = 0;
+    } else {
+      skipped++;
+    }
+    trace_end(TRACE_TICK, tick_start);
+
+    cadence_wait(&cadence);
+  }
+
+  return 0;
+}
@@ -0,0 +1,150 @@
+#include "../cadence.h"
+#include "../sketchybar.h"
+#include "talkers.h"
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const int MAX_EVENT_MESSAGE_LENGTH   = 512;
+static const int MAX_TRIGGER_MESSAGE_LENGTH = 2048;
+static const int DEFAULT_TOP_N              = 5;
+
+// Stesse unità di network_load
+static const char unit_str[3][6] = {
+    {" Bps"},
+    {"KBps"},
+    {"MBps"},
+};
+
+/**
+ * Mostra le istruzioni per l'uso del programma
+ */
+static void show_usage(const char* program_name) {
+  if (!program_name)
+    program_name = "net_top";
+  printf("Usage: %s \"<event-name>\" \"<event_freq>\" [\"<top_n>\"] [--budget-ms N]\n", program_name);
+  printf("  pubblica i top_n processi per traffico (name_i, pid_i, up_i, down_i), il traffico non attribuito\n");
+  printf("  (other_up, other_down), i processi attivi e i socket ancora senza proprietario (active, unresolved)\n");
+  printf("  --budget-ms: tempo massimo per tick per cercare il proprietario dei socket nuovi (Linux, default %d)\n",
+         TALKERS_DEFAULT_BUDGET_MS);
+}
+
+/**
+ * Copia un nome di processo rimuovendo i caratteri che romperebbero il messaggio
+ */
+static void sanitize_name(const char* name, char* buffer, size_t size) {
+  size_t length = 0;
+  for (const char* c = name; *c && length < size - 1; c++)
+    buffer[length++] = (*c == '\'' || *c == '"') ? '_' : *c;
+  buffer[length] = '\0';
+}
+
+/**
+ * Formatta una velocità in byte al secondo come network_load ("012KBps")
+ */
+static void format_rate(double rate, char* buffer, size_t size) {
+  double exponent = (rate > 0) ? log10(rate) : 0;
+  int    unit     = exponent < 3 ? 0 : exponent < 6 ? 1 : 2;
+  snprintf(buffer, size, "%03d%s", (int)(rate / pow(1000.0, unit)), unit_str[unit]);
+}
+
+int main(int argc, char** argv) {
+  float update_freq;
+
+  // Verifica degli argomenti
+  if (argc < 3 || (sscanf(argv[2], "%f", &update_freq) != 1) || update_freq <= 0) {
+    show_usage(argv[0]);
+    return 1;
+  }
+
+  int top_n     = DEFAULT_TOP_N;
+  int budget_ms = TALKERS_DEFAULT_BUDGET_MS;
+  for (int i = 3; i < argc; i++) {
+    if (strcmp(argv[i], "--budget-ms") == 0 && i + 1 < argc) {
+      budget_ms = atoi(argv[++i]);
+    } else if (i == 3 && argv[i][0] != '-') {
+      top_n = atoi(argv[i]);
+    } else {
+      show_usage(argv[0]);
+      return 1;
+    }
+  }
+  if (top_n <= 0 || top_n > TALKERS_MAX_TOP) {
+    fprintf(stderr, "Numero di processi non valido (%d), uso %d\n", top_n, DEFAULT_TOP_N);
+    top_n = DEFAULT_TOP_N;
+  }
+
+  if (update_freq > 3600) {
+    fprintf(stderr, "Frequenza di aggiornamento non valida (%f), uso 1 secondo\n", update_freq);
+    update_freq = 1.0;
+  }
+
+  // Inizializza la lettura dei socket
+  static struct talkers talkers;
+  if (talkers_init(&talkers, top_n, update_freq, budget_ms) != 0) {
+    fprintf(stderr, "Errore: impossibile inizializzare la lettura del traffico per processo\n");
+    return 1;
+  }
+
+  // Setup the event in sketchybar
+  char event_message[MAX_EVENT_MESSAGE_LENGTH];
+  int  msg_len = snprintf(event_message, sizeof(event_message), "--add event '%s'", argv[1]);
+
+  if (msg_len < 0 || msg_len >= (int)sizeof(event_message)) {
+    fprintf(stderr, "Errore durante la formattazione del messaggio evento\n");
+    return 1;
+  }
+
+  sketchybar(event_message);
+
+  // La prima lettura serve solo da base per i delta
+  talkers_update(&talkers);
+
+  char           trigger_message[MAX_TRIGGER_MESSAGE_LENGTH];
+  char           name[TALKERS_NAME_LENGTH];
+  char           up[32], down[32];
+  struct cadence cadence;
+  cadence_init(&cadence, update_freq);
+
+  // Loop principale: la prima attesa porta sulla griglia condivisa con gli altri provider
+  for (;;) {
+    cadence_wait(&cadence);
+    uint64_t tick_start = trace_begin();
+    talkers_update(&talkers);
+    trace_end(TRACE_SAMPLE, tick_start);
+
+    uint64_t format_start = trace_begin();
+    format_rate(talkers.other_up, up, sizeof(up));
+    format_rate(talkers.other_down, down, sizeof(down));
+    int trigger_len = snprintf(
+        trigger_message, sizeof(trigger_message),
+        "--trigger '%s' count='%d' active='%d' unresolved='%d' other_up='%s' other_down='%s'", argv[1], talkers.top.count,
+        talkers.active, talkers.unresolved, up, down);
+
+    for (int i = 0; i < talkers.top.count && trigger_len > 0 && trigger_len < (int)sizeof(trigger_message); i++) {
+      const struct talker_item* item = &talkers.top.items[i];
+      sanitize_name(item->name, name, sizeof(name));
+      format_rate(item->up, up, sizeof(up));
+      format_rate(item->down, down, sizeof(down));
+      int written = snprintf(
+          trigger_message + trigger_len, sizeof(trigger_message) - (size_t)trigger_len, " name_%d='%s' pid_%d='%d' up_%d='%s' down_%d='%s'",
+          i + 1, name, i + 1, (int)item->pid, i + 1, up, i + 1, down);
+      trigger_len = written < 0 ? written : trigger_len + written;
+    }
+
+    if (trigger_len < 0 || trigger_len >= (int)sizeof(trigger_message)) {
+      fprintf(stderr, "Errore o troncamento durante la formattazione del messaggio trigger\n");
+      // Continuiamo comunque l'esecuzione
+    }
+    trace_end(TRACE_FORMAT, format_start);
+
+    // Invia il trigger a sketchybar
+    sketchybar(trigger_message);
+    trace_end(TRACE_TICK, tick_start);
+  }
+
+  // Mai raggiunto
+  talkers_cleanup(&talkers);
+  return 0;
+}
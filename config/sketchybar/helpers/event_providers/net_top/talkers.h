@@ -0,0 +1,816 @@
+#ifndef TALKERS_H
+#define TALKERS_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __APPLE__
+#include <signal.h>
+#include <sys/wait.h>
+#else
+#include "../batch_read.h"
+#include <dirent.h>
+#include <linux/inet_diag.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/sock_diag.h>
+#include <linux/tcp.h>
+#include <netinet/in.h>
+#include <stddef.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#endif
+
+// Numero massimo di processi pubblicati
+#define TALKERS_MAX_TOP 16
+// Lunghezza massima del nome di un processo
+#define TALKERS_NAME_LENGTH 33
+// Tempo massimo per tick dedicato a cercare il proprietario dei socket nuovi
+#define TALKERS_DEFAULT_BUDGET_MS 2
+
+/**
+ * Un elemento della classifica, velocità in byte al secondo
+ */
+struct talker_item {
+  pid_t  pid;
+  double up;
+  double down;
+  char   name[TALKERS_NAME_LENGTH];
+};
+
+/**
+ * Classifica dei processi: min-heap di dimensione limitata su up + down
+ */
+struct talker_top {
+  int                top_n;
+  int                count;
+  struct talker_item items[TALKERS_MAX_TOP];
+};
+
+/**
+ * Inserisce un candidato nella classifica
+ */
+static inline void talker_top_push(struct talker_top* top, pid_t pid, double up, double down, const char* name) {
+  struct talker_item* heap  = top->items;
+  double              total = up + down;
+  int                 index;
+
+  if (top->count == top->top_n) {
+    if (total <= heap[0].up + heap[0].down)
+      return;
+
+    // Sostituisce il minimo e lo fa scendere
+    index = 0;
+    for (;;) {
+      int    left     = 2 * index + 1;
+      int    right    = left + 1;
+      int    smallest = index;
+      double lowest   = total;
+      if (left < top->count && heap[left].up + heap[left].down < lowest) {
+        smallest = left;
+        lowest   = heap[left].up + heap[left].down;
+      }
+      if (right < top->count && heap[right].up + heap[right].down < lowest)
+        smallest = right;
+      if (smallest == index)
+        break;
+      heap[index] = heap[smallest];
+      index       = smallest;
+    }
+  } else {
+    index = top->count++;
+    while (index > 0 && heap[(index - 1) / 2].up + heap[(index - 1) / 2].down > total) {
+      heap[index] = heap[(index - 1) / 2];
+      index       = (index - 1) / 2;
+    }
+  }
+  heap[index].pid  = pid;
+  heap[index].up   = up;
+  heap[index].down = down;
+  snprintf(heap[index].name, sizeof(heap[index].name), "%s", name ? name : "");
+}
+
+static int talker_compare(const void* a, const void* b) {
+  double lhs = ((const struct talker_item*)a)->up + ((const struct talker_item*)a)->down;
+  double rhs = ((const struct talker_item*)b)->up + ((const struct talker_item*)b)->down;
+  return (lhs < rhs) - (lhs > rhs);
+}
+
+/**
+ * Tempo monotono corrente in nanosecondi
+ */
+[[nodiscard]] static inline uint64_t talkers_now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+#ifdef __APPLE__
+// Comando di nettop: un riepilogo per processo, byte dall'ultimo campione
+// (-d) in CSV (-L 0, senza fine), solo le colonne dei byte
+#define TALKERS_NETTOP "/usr/bin/nettop"
+// Buffer di una riga dell'output
+#define TALKERS_LINE_LENGTH 512
+
+/**
+ * Su macOS le statistiche per processo vengono dall'interfaccia ntstat del
+ * kernel, che non ha header pubblici: le legge nettop, che qui resta in
+ * esecuzione e scrive un campione ogni intervallo su una pipe non bloccante.
+ * Ogni campione inizia con una riga di intestazione; le righe dei processi
+ * vanno in una classifica provvisoria che diventa quella pubblicata alla
+ * riga di intestazione successiva. La memoria è la riga corrente e le due
+ * classifiche.
+ */
+struct talkers {
+  struct talker_top top;     // Ultimo campione completo
+  struct talker_top pending; // Campione in lettura
+  double            other_up;
+  double            other_down;
+  double            pending_up;
+  double            pending_down;
+  int               active;     // Processi con traffico nell'ultimo campione
+  int               unresolved; // Sempre 0: nettop riporta già il pid
+  int               pending_active;
+
+  double interval; // Secondi tra due campioni di nettop
+  pid_t  child;
+  int    fd;
+  int    samples; // Intestazioni lette: il primo campione è cumulativo, non un delta
+  size_t line_length;
+  char   line[TALKERS_LINE_LENGTH];
+};
+
+/**
+ * Avvia nettop con l'intervallo dato
+ */
+[[nodiscard]] static inline bool talkers_spawn(struct talkers* talkers) {
+  int pipe_fds[2];
+  if (pipe(pipe_fds) < 0)
+    return false;
+
+  char interval[16];
+  snprintf(interval, sizeof(interval), "%d", (int)talkers->interval);
+
+  pid_t pid = fork();
+  if (pid < 0) {
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+    return false;
+  }
+  if (pid == 0) {
+    dup2(pipe_fds[1], STDOUT_FILENO);
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+    int null = open("/dev/null", O_WRONLY);
+    if (null >= 0)
+      dup2(null, STDERR_FILENO);
+    execl(TALKERS_NETTOP, "nettop", "-P", "-x", "-d", "-L", "0", "-s", interval, "-J", "bytes_in,bytes_out", (char*)NULL);
+    _exit(127);
+  }
+
+  close(pipe_fds[1]);
+  fcntl(pipe_fds[0], F_SETFL, fcntl(pipe_fds[0], F_GETFL) | O_NONBLOCK);
+  fcntl(pipe_fds[0], F_SETFD, FD_CLOEXEC);
+  talkers->child       = pid;
+  talkers->fd          = pipe_fds[0];
+  talkers->samples     = 0;
+  talkers->line_length = 0;
+  return true;
+}
+
+/**
+ * Chiude la pipe e raccoglie nettop
+ */
+static inline void talkers_reap(struct talkers* talkers) {
+  if (talkers->fd >= 0)
+    close(talkers->fd);
+  if (talkers->child > 0) {
+    kill(talkers->child, SIGTERM);
+    waitpid(talkers->child, NULL, 0);
+  }
+  talkers->fd    = -1;
+  talkers->child = 0;
+}
+
+/**
+ * Interpreta una riga del CSV: "hh:mm:ss.us,nome.pid,bytes_in,bytes_out,"
+ */
+static inline void talkers_parse_line(struct talkers* talkers, char* line) {
+  char* process = strchr(line, ',');
+  if (!process)
+    return;
+  process++;
+
+  // Intestazione ("time,,bytes_in,bytes_out,"): il campione precedente è completo.
+  // La seconda chiude il primo campione, cumulativo dall'avvio: si scarta
+  if (*process == ',') {
+    if (talkers->samples++ > 1) {
+      talkers->top        = talkers->pending;
+      talkers->other_up   = talkers->pending_up;
+      talkers->other_down = talkers->pending_down;
+      talkers->active     = talkers->pending_active;
+      qsort(talkers->top.items, (size_t)talkers->top.count, sizeof(struct talker_item), talker_compare);
+    }
+    talkers->pending.count  = 0;
+    talkers->pending_up     = 0;
+    talkers->pending_down   = 0;
+    talkers->pending_active = 0;
+    return;
+  }
+
+  char* bytes = strchr(process, ',');
+  if (!bytes)
+    return;
+  *bytes++ = '\0';
+
+  char*    end      = NULL;
+  uint64_t bytes_in = strtoull(bytes, &end, 10);
+  if (*end != ',')
+    return;
+  uint64_t bytes_out = strtoull(end + 1, NULL, 10);
+  if (bytes_in == 0 && bytes_out == 0)
+    return;
+
+  // Il pid è dopo l'ultimo punto: il nome può contenerne altri
+  char* dot = strrchr(process, '.');
+  pid_t pid = dot ? (pid_t)strtol(dot + 1, NULL, 10) : 0;
+  if (dot)
+    *dot = '\0';
+
+  double up   = (double)bytes_out / talkers->interval;
+  double down = (double)bytes_in / talkers->interval;
+  talkers->pending_active++;
+  if (pid > 0)
+    talker_top_push(&talkers->pending, pid, up, down, process);
+  else {
+    talkers->pending_up += up;
+    talkers->pending_down += down;
+  }
+}
+
+/**
+ * Inizializza la lettura
+ *
+ * @param talkers Struttura da inizializzare
+ * @param top_n Numero di processi in classifica
+ * @param interval Secondi tra due campioni
+ * @param budget_ms Non usato: nettop lavora nel suo processo
+ * @return 0 in caso di successo, -1 altrimenti
+ */
+[[nodiscard]] static inline int talkers_init(struct talkers* talkers, int top_n, double interval, int budget_ms) {
+  (void)budget_ms;
+  memset(talkers, 0, sizeof(struct talkers));
+  talkers->top.top_n     = top_n < 1 ? 1 : (top_n > TALKERS_MAX_TOP ? TALKERS_MAX_TOP : top_n);
+  talkers->pending.top_n = talkers->top.top_n;
+  talkers->interval      = interval < 1 ? 1 : (double)(int)(interval + 0.5); // nettop accetta solo secondi interi
+  talkers->fd            = -1;
+  if (!talkers_spawn(talkers)) {
+    fprintf(stderr, "Impossibile avviare %s: %s\n", TALKERS_NETTOP, strerror(errno));
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * Consuma le righe disponibili sulla pipe senza bloccare; se nettop è
+ * terminato lo riavvia
+ */
+static inline void talkers_update(struct talkers* talkers) {
+  if (talkers->fd < 0 && !talkers_spawn(talkers))
+    return;
+
+  char    chunk[4096];
+  ssize_t length;
+  while ((length = read(talkers->fd, chunk, sizeof(chunk))) > 0) {
+    for (ssize_t i = 0; i < length; i++) {
+      if (chunk[i] != '\n') {
+        // Una riga troppo lunga viene troncata, non spezzata
+        if (talkers->line_length < sizeof(talkers->line) - 1)
+          talkers->line[talkers->line_length++] = chunk[i];
+        continue;
+      }
+      talkers->line[talkers->line_length] = '\0';
+      talkers_parse_line(talkers, talkers->line);
+      talkers->line_length = 0;
+    }
+  }
+
+  if (length == 0 || (length < 0 && errno != EAGAIN && errno != EINTR)) {
+    fprintf(stderr, "nettop terminato, riavvio al prossimo tick\n");
+    talkers_reap(talkers);
+  }
+}
+
+/**
+ * Termina nettop
+ */
+static inline void talkers_cleanup(struct talkers* talkers) {
+  talkers_reap(talkers);
+}
+
+#else
+
+// Slot delle tabelle, potenze di due; ognuna si riempie al più a metà, oltre
+// i socket e i processi in più finiscono in other_up/other_down
+#define TALKERS_SOCKET_SLOTS 16384
+#define TALKERS_PROCESS_SLOTS 2048
+// Buffer della risposta netlink, più messaggi per recv
+#define TALKERS_NETLINK_BUFFER 32768
+// Stati TCP senza inode o senza traffico: LISTEN e TIME_WAIT
+#define TALKERS_TCP_STATES (0xfff & ~((1u << 10) | (1u << 6)))
+
+/**
+ * Uno slot delle tabelle a indirizzamento aperto, chiave 0 = vuoto.
+ *
+ * La stessa forma serve tre tabelle: socket per cookie (contatori
+ * cumulativi e inode), inode per numero (pid proprietario, 0 se non ancora
+ * trovato, -1 se introvabile; pass della scansione in cui è comparso) e
+ * processi per pid (byte del tick corrente).
+ */
+struct talker_slot {
+  uint64_t key;
+  uint64_t sent;
+  uint64_t received;
+  uint64_t inode;
+  pid_t    pid;
+  uint32_t generation;
+  uint32_t pass;
+};
+
+struct talker_table {
+  struct talker_slot* slots;
+  size_t              capacity;
+  size_t              used;
+};
+
+/**
+ * Socket TCP di tutti i processi via NETLINK_SOCK_DIAG, con i contatori di
+ * tcp_info (tcpi_bytes_acked, tcpi_bytes_received).
+ *
+ * Il proprietario di un socket si trova solo da /proc/<pid>/fd: l'indice
+ * inode -> pid è costruito in modo incrementale, riprendendo la scansione
+ * di /proc da dove si era fermata e solo finché ci sono inode nuovi senza
+ * proprietario, entro un budget di tempo per tick. Un inode rimasto senza
+ * proprietario per un giro completo (socket di altri utenti o di altri
+ * namespace) non viene più cercato. Tabelle e buffer sono allocati una
+ * volta all'avvio.
+ */
+struct talkers {
+  struct talker_top top;
+  double            other_up; // Traffico di socket senza proprietario noto
+  double            other_down;
+  int               active;     // Processi con traffico nel tick
+  int               sockets;    // Socket TCP con tcp_info
+  int               unresolved; // Inode ancora senza proprietario
+
+  struct talker_table sockets_table;
+  struct talker_table inodes;
+  struct talker_table processes;
+  uint32_t            generation;
+  uint64_t            last_ns;
+  uint64_t            budget_ns;
+
+  int      netlink;
+  uint32_t sequence;
+  int      proc_fd;     // Directory /proc, riletta con getdents64
+  int64_t  scan_offset; // Posizione della scansione in /proc
+  uint32_t pass;        // Giri completi della scansione
+  char     buffer[TALKERS_NETLINK_BUFFER];
+  char     dirents[8192];
+};
+
+/**
+ * Hash di una chiave (moltiplicativo di Fibonacci)
+ */
+[[nodiscard]] static inline size_t talker_hash(uint64_t key, size_t capacity) {
+  return (size_t)((key * 11400714819323198485ull) >> 32) & (capacity - 1);
+}
+
+/**
+ * Cerca lo slot di una chiave, o lo slot vuoto dove andrebbe inserita
+ */
+[[nodiscard]] static inline struct talker_slot* talker_slot(struct talker_table* table, uint64_t key) {
+  size_t index = talker_hash(key, table->capacity);
+  while (table->slots[index].key != 0 && table->slots[index].key != key)
+    index = (index + 1) & (table->capacity - 1);
+  return &table->slots[index];
+}
+
+/**
+ * Restituisce lo slot di una chiave, inserendola se nuova
+ *
+ * @return Lo slot, NULL se la tabella è piena a metà
+ */
+[[nodiscard]] static inline struct talker_slot* talker_insert(struct talker_table* table, uint64_t key, bool* fresh) {
+  struct talker_slot* slot = talker_slot(table, key);
+  *fresh                   = slot->key == 0;
+  if (*fresh) {
+    if ((table->used + 1) * 2 > table->capacity)
+      return NULL;
+    memset(slot, 0, sizeof(struct talker_slot));
+    slot->key = key;
+    table->used++;
+  }
+  return slot;
+}
+
+/**
+ * Rimuove uno slot mantenendo intatte le catene di sondaggio (backward shift)
+ */
+static inline void talker_remove(struct talker_table* table, struct talker_slot* slot) {
+  size_t hole = (size_t)(slot - table->slots);
+  size_t mask = table->capacity - 1;
+
+  table->slots[hole].key = 0;
+  table->used--;
+  for (size_t next = (hole + 1) & mask; table->slots[next].key != 0; next = (next + 1) & mask) {
+    size_t home = talker_hash(table->slots[next].key, table->capacity);
+    if (((next - home) & mask) >= ((next - hole) & mask)) {
+      table->slots[hole]     = table->slots[next];
+      table->slots[next].key = 0;
+      hole                   = next;
+    }
+  }
+}
+
+[[nodiscard]] static inline bool talker_table_init(struct talker_table* table, size_t capacity) {
+  table->slots    = calloc(capacity, sizeof(struct talker_slot));
+  table->capacity = capacity;
+  table->used     = 0;
+  return table->slots != NULL;
+}
+
+// Layout dei record restituiti da getdents64
+struct talker_dirent64 {
+  uint64_t       d_ino;
+  int64_t        d_off;
+  unsigned short d_reclen;
+  unsigned char  d_type;
+  char           d_name[];
+};
+
+/**
+ * Registra l'inode di un socket come da attribuire
+ */
+static inline struct talker_slot* talkers_inode(struct talkers* talkers, uint64_t inode) {
+  bool                fresh = false;
+  struct talker_slot* slot  = talker_insert(&talkers->inodes, inode, &fresh);
+  if (!slot)
+    return NULL;
+  if (fresh) {
+    slot->pass = talkers->pass;
+    talkers->unresolved++;
+  }
+  slot->generation = talkers->generation;
+  return slot;
+}
+
+/**
+ * Somma i byte di un socket al suo processo, o a other se il processo non è noto
+ */
+static inline void talkers_attribute(struct talkers* talkers, pid_t pid, uint64_t sent, uint64_t received) {
+  if (sent == 0 && received == 0)
+    return;
+
+  bool                fresh = false;
+  struct talker_slot* slot  = pid > 0 ? talker_insert(&talkers->processes, (uint64_t)pid, &fresh) : NULL;
+  if (!slot) {
+    talkers->other_up += (double)sent;
+    talkers->other_down += (double)received;
+    return;
+  }
+  slot->pid = pid;
+  slot->sent += sent;
+  slot->received += received;
+}
+
+/**
+ * Aggiorna un socket dal messaggio inet_diag e ne calcola il delta
+ */
+static inline void talkers_account(struct talkers* talkers, const struct inet_diag_msg* msg, size_t length) {
+  if (msg->idiag_inode == 0)
+    return;
+
+  // tcp_info cresce con il kernel: contano solo i contatori di byte
+  struct tcp_info info = {0};
+  bool            found = false;
+  size_t          attributes = length - NLMSG_ALIGN(sizeof(struct inet_diag_msg));
+  for (struct rtattr* attribute = (struct rtattr*)(msg + 1); RTA_OK(attribute, attributes); attribute = RTA_NEXT(attribute, attributes)) {
+    if (attribute->rta_type != INET_DIAG_INFO)
+      continue;
+    size_t payload = RTA_PAYLOAD(attribute);
+    if (payload < offsetof(struct tcp_info, tcpi_bytes_received) + sizeof(info.tcpi_bytes_received))
+      return;
+    memcpy(&info, RTA_DATA(attribute), payload < sizeof(info) ? payload : sizeof(info));
+    found = true;
+  }
+  if (!found)
+    return;
+
+  uint64_t cookie = (uint64_t)msg->id.idiag_cookie[0] | ((uint64_t)msg->id.idiag_cookie[1] << 32);
+  bool     fresh  = false;
+  struct talker_slot* socket = talker_insert(&talkers->sockets_table, cookie ? cookie : 1, &fresh);
+  struct talker_slot* inode  = talkers_inode(talkers, msg->idiag_inode);
+  talkers->sockets++;
+  if (!socket)
+    return;
+
+  // Il primo passaggio di un socket fa solo da base, come per proc_top
+  if (!fresh && info.tcpi_bytes_acked >= socket->sent && info.tcpi_bytes_received >= socket->received) {
+    talkers_attribute(
+        talkers, inode ? inode->pid : 0, info.tcpi_bytes_acked - socket->sent, info.tcpi_bytes_received - socket->received);
+  }
+  socket->sent       = info.tcpi_bytes_acked;
+  socket->received   = info.tcpi_bytes_received;
+  socket->inode      = msg->idiag_inode;
+  socket->generation = talkers->generation;
+}
+
+/**
+ * Chiede a sock_diag tutti i socket TCP di una famiglia e li contabilizza
+ *
+ * @return true se il dump è arrivato fino a NLMSG_DONE
+ */
+[[nodiscard]] static inline bool talkers_dump(struct talkers* talkers, uint8_t family) {
+  struct {
+    struct nlmsghdr         header;
+    struct inet_diag_req_v2 request;
+  } message = {
+      .header =
+          {
+              .nlmsg_len   = sizeof(message),
+              .nlmsg_type  = SOCK_DIAG_BY_FAMILY,
+              .nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP,
+              .nlmsg_seq   = ++talkers->sequence,
+          },
+      .request =
+          {
+              .sdiag_family   = family,
+              .sdiag_protocol = IPPROTO_TCP,
+              .idiag_ext      = 1 << (INET_DIAG_INFO - 1),
+              .idiag_states   = TALKERS_TCP_STATES,
+          },
+  };
+
+  struct sockaddr_nl kernel = {.nl_family = AF_NETLINK};
+  if (sendto(talkers->netlink, &message, sizeof(message), 0, (struct sockaddr*)&kernel, sizeof(kernel)) < 0)
+    return false;
+
+  for (;;) {
+    int length = (int)recv(talkers->netlink, talkers->buffer, sizeof(talkers->buffer), 0);
+    if (length < 0 && errno == EINTR)
+      continue;
+    if (length <= 0)
+      return false;
+
+    for (struct nlmsghdr* header = (struct nlmsghdr*)talkers->buffer; NLMSG_OK(header, length);
+         header = NLMSG_NEXT(header, length)) {
+      if (header->nlmsg_seq != talkers->sequence)
+        continue;
+      if (header->nlmsg_type == NLMSG_DONE)
+        return true;
+      if (header->nlmsg_type == NLMSG_ERROR)
+        return false;
+      if (header->nlmsg_type == SOCK_DIAG_BY_FAMILY && header->nlmsg_len >= NLMSG_LENGTH(sizeof(struct inet_diag_msg)))
+        talkers_account(talkers, NLMSG_DATA(header), header->nlmsg_len - NLMSG_HDRLEN);
+    }
+  }
+}
+
+/**
+ * Cerca tra gli fd di un processo i socket con inode ancora senza proprietario
+ */
+static inline void talkers_scan_process(struct talkers* talkers, const char* pid_name, pid_t pid) {
+  char path[32];
+  snprintf(path, sizeof(path), "%s/fd", pid_name);
+  int dir = openat(talkers->proc_fd, path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (dir < 0)
+    return; // Processo terminato o di un altro utente
+
+  char dirents[4096];
+  long bytes;
+  while (talkers->unresolved > 0 && (bytes = syscall(SYS_getdents64, dir, dirents, sizeof(dirents))) > 0) {
+    for (long offset = 0; offset < bytes;) {
+      struct talker_dirent64* dirent = (struct talker_dirent64*)(dirents + offset);
+      offset += dirent->d_reclen;
+      if (dirent->d_type != DT_LNK)
+        continue;
+
+      // "socket:[12345]"
+      char    link[64];
+      ssize_t length = readlinkat(dir, dirent->d_name, link, sizeof(link) - 1);
+      if (length < 9 || memcmp(link, "socket:[", 8) != 0)
+        continue;
+      link[length]   = '\0';
+      uint64_t inode = strtoull(link + 8, NULL, 10);
+
+      struct talker_slot* slot = talker_slot(&talkers->inodes, inode);
+      if (slot->key == inode && slot->pid == 0) {
+        slot->pid = pid;
+        talkers->unresolved--;
+      }
+    }
+  }
+  close(dir);
+}
+
+/**
+ * Chiude un giro della scansione: gli inode cercati per un giro intero
+ * senza trovarli non guidano più la scansione
+ */
+static inline void talkers_end_pass(struct talkers* talkers) {
+  for (size_t i = 0; i < talkers->inodes.capacity; i++) {
+    struct talker_slot* slot = &talkers->inodes.slots[i];
+    if (slot->key != 0 && slot->pid == 0 && slot->pass < talkers->pass) {
+      slot->pid = -1;
+      talkers->unresolved--;
+    }
+  }
+  talkers->pass++;
+  talkers->scan_offset = 0;
+}
+
+/**
+ * Riprende la scansione di /proc dal punto in cui si era fermata, finché ci
+ * sono inode senza proprietario e al più fino a deadline_ns; un giro
+ * completo per tick al massimo
+ */
+static inline void talkers_scan(struct talkers* talkers, uint64_t deadline_ns) {
+  bool wrapped = false;
+  while (talkers->unresolved > 0 && talkers_now_ns() < deadline_ns) {
+    if (lseek(talkers->proc_fd, talkers->scan_offset, SEEK_SET) < 0)
+      return;
+
+    long bytes = syscall(SYS_getdents64, talkers->proc_fd, talkers->dirents, sizeof(talkers->dirents));
+    if (bytes <= 0) {
+      talkers_end_pass(talkers);
+      if (wrapped)
+        return;
+      wrapped = true;
+      continue;
+    }
+
+    for (long offset = 0; offset < bytes && talkers->unresolved > 0;) {
+      struct talker_dirent64* dirent = (struct talker_dirent64*)(talkers->dirents + offset);
+      offset += dirent->d_reclen;
+      talkers->scan_offset = dirent->d_off;
+
+      // Solo le directory numeriche sono processi
+      const char* name = dirent->d_name;
+      if (name[0] < '1' || name[0] > '9')
+        continue;
+
+      pid_t pid = 0;
+      for (const char* c = name; *c >= '0' && *c <= '9'; c++)
+        pid = pid * 10 + (*c - '0');
+      talkers_scan_process(talkers, name, pid);
+
+      if (talkers_now_ns() >= deadline_ns)
+        return;
+    }
+  }
+}
+
+/**
+ * Legge il nome di un processo da /proc/<pid>/comm
+ */
+static inline void talkers_name(struct talkers* talkers, pid_t pid, char* name, size_t size) {
+  char path[32];
+  snprintf(path, sizeof(path), "%d/comm", (int)pid);
+  snprintf(name, size, "%d", (int)pid);
+
+  int fd = openat(talkers->proc_fd, path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return;
+  ssize_t length = read(fd, name, size - 1);
+  close(fd);
+  if (length <= 0) {
+    snprintf(name, size, "%d", (int)pid);
+    return;
+  }
+  if (name[length - 1] == '\n')
+    length--;
+  name[length] = '\0';
+}
+
+/**
+ * Inizializza la lettura
+ *
+ * @param talkers Struttura da inizializzare
+ * @param top_n Numero di processi in classifica
+ * @param interval Non usato: il ritmo lo dà il chiamante
+ * @param budget_ms Tempo massimo per tick della scansione di /proc
+ * @return 0 in caso di successo, -1 altrimenti
+ */
+[[nodiscard]] static inline int talkers_init(struct talkers* talkers, int top_n, double interval, int budget_ms) {
+  (void)interval;
+  memset(talkers, 0, sizeof(struct talkers));
+  talkers->top.top_n = top_n < 1 ? 1 : (top_n > TALKERS_MAX_TOP ? TALKERS_MAX_TOP : top_n);
+  talkers->budget_ns = (uint64_t)(budget_ms > 0 ? budget_ms : TALKERS_DEFAULT_BUDGET_MS) * 1000000ull;
+  talkers->netlink   = -1;
+
+  char path[BATCH_PATH_LENGTH];
+  talkers->proc_fd = batch_path(path, sizeof(path), "/proc") ? open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC) : -1;
+  if (talkers->proc_fd < 0) {
+    fprintf(stderr, "Impossibile aprire %s: %s\n", path, strerror(errno));
+    return -1;
+  }
+
+  talkers->netlink = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_SOCK_DIAG);
+  if (talkers->netlink < 0) {
+    fprintf(stderr, "Impossibile aprire il socket NETLINK_SOCK_DIAG: %s\n", strerror(errno));
+    close(talkers->proc_fd);
+    return -1;
+  }
+
+  if (!talker_table_init(&talkers->sockets_table, TALKERS_SOCKET_SLOTS) || !talker_table_init(&talkers->inodes, TALKERS_SOCKET_SLOTS)
+      || !talker_table_init(&talkers->processes, TALKERS_PROCESS_SLOTS)) {
+    fprintf(stderr, "Impossibile allocare le tabelle dei socket\n");
+    return -1;
+  }
+
+  talkers->last_ns = talkers_now_ns();
+  return 0;
+}
+
+/**
+ * Esegue un tick: dump dei socket, attribuzione dei delta, scansione
+ * incrementale entro il budget e classifica
+ *
+ * @param talkers Stato della lettura
+ */
+static inline void talkers_update(struct talkers* talkers) {
+  uint64_t now     = talkers_now_ns();
+  double   elapsed = (double)(now - talkers->last_ns) / 1e9;
+  talkers->last_ns = now;
+
+  talkers->generation++;
+  talkers->sockets    = 0;
+  talkers->other_up   = 0;
+  talkers->other_down = 0;
+  talkers->top.count  = 0;
+  memset(talkers->processes.slots, 0, talkers->processes.capacity * sizeof(struct talker_slot));
+  talkers->processes.used = 0;
+
+  if (!talkers_dump(talkers, AF_INET) || !talkers_dump(talkers, AF_INET6))
+    fprintf(stderr, "Dump dei socket TCP incompleto: %s\n", strerror(errno));
+
+  // Socket chiusi e inode non più usati
+  struct talker_table* tables[] = {&talkers->sockets_table, &talkers->inodes};
+  for (int t = 0; t < 2; t++) {
+    struct talker_table* table = tables[t];
+    for (size_t i = 0; i < table->capacity; i++) {
+      struct talker_slot* slot = &table->slots[i];
+      while (slot->key != 0 && slot->generation != talkers->generation) {
+        if (table == &talkers->inodes && slot->pid == 0)
+          talkers->unresolved--;
+        talker_remove(table, slot); // Lo shift può portare qui un altro slot da controllare
+      }
+    }
+  }
+
+  if (talkers->unresolved > 0)
+    talkers_scan(talkers, talkers_now_ns() + talkers->budget_ns);
+
+  if (elapsed <= 0)
+    return;
+
+  talkers->other_up /= elapsed;
+  talkers->other_down /= elapsed;
+  for (size_t i = 0; i < talkers->processes.capacity; i++) {
+    const struct talker_slot* slot = &talkers->processes.slots[i];
+    if (slot->key != 0)
+      talker_top_push(&talkers->top, slot->pid, (double)slot->sent / elapsed, (double)slot->received / elapsed, NULL);
+  }
+  talkers->active = (int)talkers->processes.used;
+  qsort(talkers->top.items, (size_t)talkers->top.count, sizeof(struct talker_item), talker_compare);
+
+  // Nomi letti solo per i processi in classifica
+  for (int i = 0; i < talkers->top.count; i++)
+    talkers_name(talkers, talkers->top.items[i].pid, talkers->top.items[i].name, sizeof(talkers->top.items[i].name));
+}
+
+/**
+ * Libera le risorse della lettura
+ */
+static inline void talkers_cleanup(struct talkers* talkers) {
+  free(talkers->sockets_table.slots);
+  free(talkers->inodes.slots);
+  free(talkers->processes.slots);
+  if (talkers->netlink >= 0)
+    close(talkers->netlink);
+  if (talkers->proc_fd >= 0)
+    close(talkers->proc_fd);
+}
+
+#endif
+
+#endif /* TALKERS_H */
@@ -4,11 +4,19 @@
 #include <errno.h>
 #include <math.h>
 #include <net/if.h>
-#include <net/if_mib.h>
+#include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/select.h>
+#include <time.h>
+
+#ifdef __APPLE__
+#include <net/if_mib.h>
 #include <sys/sysctl.h>
+#else
+#include "../batch_read.h"
+#endif
 
 // Array di stringhe per le unità
 static const char unit_str[3][6] = {
@@ -19,16 +27,67 @@ static const char unit_str[3][6] = {
 
 enum unit { UNIT_BPS, UNIT_KBPS, UNIT_MBPS };
 
+// Contatori cumulativi letti a ogni campione, tutti dalla stessa lettura
+// (ifmibdata su macOS, la riga dell'interfaccia di /proc/net/dev su Linux)
+enum network_counter {
+  NETWORK_IBYTES,
+  NETWORK_OBYTES,
+  NETWORK_IPACKETS,
+  NETWORK_OPACKETS,
+  NETWORK_IERRORS,
+  NETWORK_OERRORS,
+  NETWORK_IDROPS,
+  NETWORK_ODROPS,
+  NETWORK_COUNTERS,
+};
+
 struct network {
+#ifdef __APPLE__
   uint32_t         row;
   struct ifmibdata data;
-  struct timeval   tv_nm1, tv_n, tv_delta;
+#else
+  struct batch_source source; // /proc/net/dev, tenuto aperto
+  char                path[BATCH_PATH_LENGTH];
+  char                ifname[IFNAMSIZ];
+  size_t              hint; // Offset della riga dell'interfaccia all'ultima lettura
+#endif
+  uint64_t        counters[NETWORK_COUNTERS]; // Contatori cumulativi dell'ultima lettura
+  uint64_t        deltas[NETWORK_COUNTERS];   // Incrementi rispetto alla lettura precedente
+  double          interval;                   // Secondi coperti dai delta
+  struct timespec ts_nm1, ts_n;
 
-  int       up;   // Upload speed
-  int       down; // Download speed
+  double    up_rate;   // Upload in byte al secondo, non arrotondato
+  double    down_rate; // Download in byte al secondo, non arrotondato
+  bool      valid;     // Il campione corrente ha un intervallo valido
+  int       up;        // Upload speed
+  int       down;      // Download speed
   enum unit up_unit, down_unit;
 };
 
+/**
+ * Converte una velocità in byte al secondo nel valore e nell'unità da mostrare
+ *
+ * @param rate Velocità in byte al secondo
+ * @param value Valore intero nell'unità scelta
+ * @param unit Unità scelta
+ */
+static inline void network_scale(double rate, int* value, enum unit* unit) {
+  // Evita log di valori negativi o zero
+  double exponent = (rate > 0) ? log10(rate) : 0;
+
+  if (exponent < 3) {
+    *unit  = UNIT_BPS;
+    *value = (int)rate;
+  } else if (exponent < 6) {
+    *unit  = UNIT_KBPS;
+    *value = (int)(rate / 1000.0);
+  } else { // exponent < 9
+    *unit  = UNIT_MBPS;
+    *value = (int)(rate / 1000000.0);
+  }
+}
+
+#ifdef __APPLE__
 /**
  * Ottiene i dati dell'interfaccia di rete
  *
@@ -49,6 +108,22 @@ struct network {
   return (result < 0) ? -1 : 0;
 }
 
+/**
+ * Copia i contatori dall'ultima ifmibdata letta; ifmd_snd_drops sono i
+ * pacchetti scartati dalla coda di invio
+ */
+static inline void network_copy_counters(const struct network* net, uint64_t* counters) {
+  const struct if_data64* data = &net->data.ifmd_data;
+  counters[NETWORK_IBYTES]     = data->ifi_ibytes;
+  counters[NETWORK_OBYTES]     = data->ifi_obytes;
+  counters[NETWORK_IPACKETS]   = data->ifi_ipackets;
+  counters[NETWORK_OPACKETS]   = data->ifi_opackets;
+  counters[NETWORK_IERRORS]    = data->ifi_ierrors;
+  counters[NETWORK_OERRORS]    = data->ifi_oerrors;
+  counters[NETWORK_IDROPS]     = data->ifi_iqdrops;
+  counters[NETWORK_ODROPS]     = net->data.ifmd_snd_drops;
+}
+
 /**
  * Inizializza una struttura network
  *
@@ -88,43 +163,154 @@ struct network {
     return -1;
   }
 
-  // Initialize timeval structures
-  gettimeofday(&net->tv_n, NULL);
-  net->tv_nm1 = net->tv_n;
+  network_copy_counters(net, net->counters);
+
+  // Timestamp monotoni: non risentono delle correzioni dell'orologio di sistema
+  clock_gettime(CLOCK_MONOTONIC, &net->ts_n);
+  net->ts_nm1 = net->ts_n;
 
   return 0;
 }
 
 /**
- * Aggiorna i dati di rete
+ * Legge i contatori cumulativi dell'interfaccia
  *
- * @param net Puntatore alla struttura network da aggiornare
+ * @param net Puntatore alla struttura network
+ * @param counters Contatori letti, NETWORK_COUNTERS elementi
+ * @return 0 in caso di successo, -1 altrimenti
  */
-static inline void network_update(struct network* net) {
-  if (!net)
-    return;
+[[nodiscard]] static inline int network_read(struct network* net, uint64_t* counters) {
+  if (ifdata(net->row, &net->data) < 0)
+    return -1;
 
-  // Aggiorna i timestamp
-  if (gettimeofday(&net->tv_n, NULL) < 0) {
-    fprintf(stderr, "Errore nell'ottenere il timestamp: %s\n", strerror(errno));
-    return;
+  network_copy_counters(net, counters);
+  return 0;
+}
+
+#else
+/**
+ * Cerca la riga dell'interfaccia nel contenuto di /proc/net/dev già letto
+ * nel buffer della sorgente ed estrae i contatori
+ *
+ * @param net Puntatore alla struttura network
+ * @param counters Contatori letti, NETWORK_COUNTERS elementi
+ * @return 0 in caso di successo, -1 se l'interfaccia non c'è
+ */
+[[nodiscard]] static inline int network_parse_counters(struct network* net, uint64_t* counters) {
+  if (net->source.length <= 0)
+    return -1;
+
+  const char* buffer = net->source.buffer;
+  size_t      length = (size_t)net->source.length;
+  size_t      name   = strlen(net->ifname);
+
+  // Le interfacce cambiano ordine di rado: prima prova la riga dell'ultima volta
+  for (int pass = 0; pass < 2; pass++) {
+    size_t offset = pass == 0 ? net->hint : 0;
+    size_t stop   = pass == 0 ? offset + 1 : length;
+    if (offset > 0 && (offset >= length || buffer[offset - 1] != '\n'))
+      continue;
+
+    while (offset < length && offset < stop) {
+      const char* line = buffer + offset;
+      const char* end  = memchr(line, '\n', length - offset);
+      size_t      next = end ? (size_t)(end - buffer) + 1 : length;
+
+      const char* cursor = line;
+      while (*cursor == ' ')
+        cursor++;
+
+      if (strncmp(cursor, net->ifname, name) == 0 && cursor[name] == ':') {
+        // "<ifname>: bytes packets errs drop fifo frame compressed multicast" per rx, poi
+        // "bytes packets errs drop fifo colls carrier compressed" per tx
+        static const int fields[NETWORK_COUNTERS] = {
+            [NETWORK_IBYTES] = 0, [NETWORK_OBYTES] = 8,   [NETWORK_IPACKETS] = 1, [NETWORK_OPACKETS] = 9,
+            [NETWORK_IERRORS] = 2, [NETWORK_OERRORS] = 10, [NETWORK_IDROPS] = 3,   [NETWORK_ODROPS] = 11,
+        };
+        uint64_t values[12];
+        char*    field = (char*)cursor + name + 1;
+        for (int i = 0; i < 12; i++)
+          values[i] = strtoull(field, &field, 10);
+        for (int c = 0; c < NETWORK_COUNTERS; c++)
+          counters[c] = values[fields[c]];
+        net->hint = offset;
+        return 0;
+      }
+      offset = next;
+    }
   }
+  return -1;
+}
 
-  timersub(&net->tv_n, &net->tv_nm1, &net->tv_delta);
-  net->tv_nm1 = net->tv_n;
+/**
+ * Inizializza una struttura network
+ *
+ * @param net Puntatore alla struttura network da inizializzare
+ * @param ifname Nome dell'interfaccia
+ * @return 0 in caso di successo, -1 altrimenti
+ */
+[[nodiscard]] static inline int network_init(struct network* net, char* ifname) {
+  if (!net || !ifname)
+    return -1;
 
-  // Salva i valori precedenti
-  uint64_t ibytes_nm1 = net->data.ifmd_data.ifi_ibytes;
-  uint64_t obytes_nm1 = net->data.ifmd_data.ifi_obytes;
+  memset(net, 0, sizeof(struct network));
+  snprintf(net->ifname, sizeof(net->ifname), "%s", ifname);
 
-  // Ottieni nuovi dati
-  if (ifdata(net->row, &net->data) < 0) {
-    fprintf(stderr, "Errore nell'ottenere i dati dell'interfaccia\n");
-    return;
+  if (!batch_path(net->path, sizeof(net->path), "/proc/net/dev") || !batch_source_open(&net->source, net->path, 4096)) {
+    fprintf(stderr, "Errore nell'aprire %s: %s\n", net->path, strerror(errno));
+    return -1;
+  }
+
+  if (!batch_source_pread(&net->source, NULL) || network_parse_counters(net, net->counters) < 0) {
+    fprintf(stderr, "Interfaccia '%s' non trovata\n", ifname);
+    batch_source_close(&net->source);
+    return -1;
   }
 
+  // Timestamp monotoni: non risentono delle correzioni dell'orologio di sistema
+  clock_gettime(CLOCK_MONOTONIC, &net->ts_n);
+  net->ts_nm1 = net->ts_n;
+
+  return 0;
+}
+
+/**
+ * Legge i contatori cumulativi dell'interfaccia con una pread di /proc/net/dev
+ *
+ * @param net Puntatore alla struttura network
+ * @param counters Contatori letti, NETWORK_COUNTERS elementi
+ * @return 0 in caso di successo, -1 altrimenti
+ */
+[[nodiscard]] static inline int network_read(struct network* net, uint64_t* counters) {
+  if (!batch_source_pread(&net->source, NULL))
+    return -1;
+  return network_parse_counters(net, counters);
+}
+
+#endif
+
+/**
+ * Calcola le velocità da contatori letti all'istante indicato (dal sistema
+ * o da un log registrato, --replay)
+ *
+ * @param net Puntatore alla struttura network da aggiornare
+ * @param counters Contatori letti, NETWORK_COUNTERS elementi
+ * @param now Tempo monotono della lettura
+ */
+static inline void network_account_at(struct network* net, const uint64_t* counters, struct timespec now) {
+  net->valid = false;
+  net->ts_n  = now;
+
   // Calcola la scala temporale
-  double time_scale = (net->tv_delta.tv_sec + 1e-6 * net->tv_delta.tv_usec);
+  double time_scale = (double)(net->ts_n.tv_sec - net->ts_nm1.tv_sec) + 1e-9 * (double)(net->ts_n.tv_nsec - net->ts_nm1.tv_nsec);
+  net->ts_nm1       = net->ts_n;
+
+  // Un contatore che torna indietro (interfaccia riavviata) riparte da una nuova base
+  for (int c = 0; c < NETWORK_COUNTERS; c++) {
+    net->deltas[c]   = counters[c] >= net->counters[c] ? counters[c] - net->counters[c] : 0;
+    net->counters[c] = counters[c];
+  }
+  net->interval = 0;
 
   // Verifica che il tempo sia in un range ragionevole
   static const double MIN_VALID_TIME = 1e-6;
@@ -135,36 +321,194 @@ static inline void network_update(struct network* net) {
   }
 
   // Calcola le velocità in byte al secondo
-  double delta_ibytes = (double)(net->data.ifmd_data.ifi_ibytes - ibytes_nm1) / time_scale;
-  double delta_obytes = (double)(net->data.ifmd_data.ifi_obytes - obytes_nm1) / time_scale;
+  net->down_rate = (double)net->deltas[NETWORK_IBYTES] / time_scale;
+  net->up_rate   = (double)net->deltas[NETWORK_OBYTES] / time_scale;
+  net->interval  = time_scale;
+  net->valid     = true;
 
-  // Evita log di valori negativi o zero
-  double exponent_ibytes = (delta_ibytes > 0) ? log10(delta_ibytes) : 0;
-  double exponent_obytes = (delta_obytes > 0) ? log10(delta_obytes) : 0;
-
-  // Imposta le unità per download (incoming bytes)
-  if (exponent_ibytes < 3) {
-    net->down_unit = UNIT_BPS;
-    net->down      = (int)delta_ibytes;
-  } else if (exponent_ibytes < 6) {
-    net->down_unit = UNIT_KBPS;
-    net->down      = (int)(delta_ibytes / 1000.0);
-  } else { // exponent_ibytes < 9
-    net->down_unit = UNIT_MBPS;
-    net->down      = (int)(delta_ibytes / 1000000.0);
+  // Imposta le unità per download (incoming bytes) e upload (outgoing bytes)
+  network_scale(net->down_rate, &net->down, &net->down_unit);
+  network_scale(net->up_rate, &net->up, &net->up_unit);
+}
+
+/**
+ * Calcola le velocità dai contatori appena letti
+ *
+ * @param net Puntatore alla struttura network da aggiornare
+ * @param counters Contatori letti, NETWORK_COUNTERS elementi
+ */
+static inline void network_account(struct network* net, const uint64_t* counters) {
+  struct timespec now;
+  if (clock_gettime(CLOCK_MONOTONIC, &now) < 0) {
+    net->valid = false;
+    fprintf(stderr, "Errore nell'ottenere il timestamp: %s\n", strerror(errno));
+    return;
   }
+  network_account_at(net, counters, now);
+}
 
-  // Imposta le unità per upload (outgoing bytes)
-  if (exponent_obytes < 3) {
-    net->up_unit = UNIT_BPS;
-    net->up      = (int)delta_obytes;
-  } else if (exponent_obytes < 6) {
-    net->up_unit = UNIT_KBPS;
-    net->up      = (int)(delta_obytes / 1000.0);
-  } else { // exponent_obytes < 9
-    net->up_unit = UNIT_MBPS;
-    net->up      = (int)(delta_obytes / 1000000.0);
+/**
+ * Aggiorna i dati di rete
+ *
+ * @param net Puntatore alla struttura network da aggiornare
+ */
+static inline void network_update(struct network* net) {
+  if (!net)
+    return;
+
+  uint64_t counters[NETWORK_COUNTERS];
+
+  // Ottieni nuovi dati
+  if (network_read(net, counters) < 0) {
+    net->valid = false;
+    fprintf(stderr, "Errore nell'ottenere i dati dell'interfaccia\n");
+    return;
   }
+
+  network_account(net, counters);
+}
+
+#ifndef __APPLE__
+/**
+ * Aggiorna i dati di rete dal buffer già riempito da uno stadio di raccolta
+ *
+ * @param net Puntatore alla struttura network da aggiornare
+ */
+static inline void network_parse(struct network* net) {
+  uint64_t counters[NETWORK_COUNTERS];
+  if (network_parse_counters(net, counters) < 0) {
+    net->valid = false;
+    return;
+  }
+  network_account(net, counters);
+}
+#endif
+
+// Numero massimo di campioni aggregati per ogni pubblicazione
+#define NETWORK_MAX_SAMPLES 256
+
+/**
+ * Aggregatore dei campioni letti a frequenza interna più alta di quella di
+ * pubblicazione: buffer a dimensione fissa, nessuna allocazione per campione.
+ */
+struct network_window {
+  int      count;
+  double   up[NETWORK_MAX_SAMPLES];
+  double   down[NETWORK_MAX_SAMPLES];
+  double   scratch[NETWORK_MAX_SAMPLES];
+  uint64_t deltas[NETWORK_COUNTERS]; // Incrementi sommati sulla finestra
+  double   interval;
+};
+
+/**
+ * Statistiche di una finestra di pubblicazione, in byte al secondo
+ */
+struct network_stats {
+  double avg, peak, p95;
+};
+
+/**
+ * Aggiunge un campione alla finestra
+ *
+ * @param window Finestra di aggregazione
+ * @param net Struttura network appena aggiornata
+ */
+static inline void network_window_add(struct network_window* window, const struct network* net) {
+  if (!window || !net || !net->valid || window->count >= NETWORK_MAX_SAMPLES)
+    return;
+
+  window->up[window->count]   = net->up_rate;
+  window->down[window->count] = net->down_rate;
+  window->count++;
+  for (int c = 0; c < NETWORK_COUNTERS; c++)
+    window->deltas[c] += net->deltas[c];
+  window->interval += net->interval;
+}
+
+static int network_compare_rate(const void* a, const void* b) {
+  double lhs = *(const double*)a;
+  double rhs = *(const double*)b;
+  return (lhs > rhs) - (lhs < rhs);
+}
+
+/**
+ * Calcola media, picco e 95° percentile di una serie di campioni
+ *
+ * @param samples Campioni
+ * @param count Numero di campioni
+ * @param scratch Buffer di appoggio di almeno count elementi
+ * @return Le statistiche della serie
+ */
+[[nodiscard]] static inline struct network_stats network_stats_of(const double* samples, int count, double* scratch) {
+  struct network_stats stats = {0};
+  if (count <= 0)
+    return stats;
+
+  double sum = 0;
+  for (int i = 0; i < count; i++) {
+    sum += samples[i];
+    scratch[i] = samples[i];
+  }
+
+  qsort(scratch, (size_t)count, sizeof(double), network_compare_rate);
+
+  // Nearest-rank: il campione più piccolo che copre il 95% della finestra
+  int rank   = (int)ceil(0.95 * count) - 1;
+  stats.avg  = sum / count;
+  stats.peak = scratch[count - 1];
+  stats.p95  = scratch[rank < 0 ? 0 : rank];
+  return stats;
+}
+
+/**
+ * Pacchetti, errori e scarti al secondo, da incrementi su un intervallo
+ */
+struct network_packets {
+  double rx_pps, tx_pps;
+  double rx_errors, tx_errors;
+  double rx_drops, tx_drops;
+};
+
+/**
+ * Calcola i tassi di pacchetti, errori e scarti
+ *
+ * @param deltas Incrementi dei contatori, NETWORK_COUNTERS elementi
+ * @param interval Secondi coperti dagli incrementi
+ * @return I tassi, tutti a zero se l'intervallo non è valido
+ */
+[[nodiscard]] static inline struct network_packets network_packets_of(const uint64_t* deltas, double interval) {
+  struct network_packets packets = {0};
+  if (interval <= 0)
+    return packets;
+
+  packets.rx_pps    = (double)deltas[NETWORK_IPACKETS] / interval;
+  packets.tx_pps    = (double)deltas[NETWORK_OPACKETS] / interval;
+  packets.rx_errors = (double)deltas[NETWORK_IERRORS] / interval;
+  packets.tx_errors = (double)deltas[NETWORK_OERRORS] / interval;
+  packets.rx_drops  = (double)deltas[NETWORK_IDROPS] / interval;
+  packets.tx_drops  = (double)deltas[NETWORK_ODROPS] / interval;
+  return packets;
+}
+
+/**
+ * Chiude la finestra corrente calcolando le statistiche e la svuota
+ *
+ * @param window Finestra di aggregazione
+ * @param up Statistiche di upload
+ * @param down Statistiche di download
+ * @param packets Tassi di pacchetti, errori e scarti sull'intera finestra
+ * @return Numero di campioni aggregati
+ */
+static inline int network_window_flush(
+    struct network_window* window, struct network_stats* up, struct network_stats* down, struct network_packets* packets) {
+  int count        = window->count;
+  *up              = network_stats_of(window->up, count, window->scratch);
+  *down            = network_stats_of(window->down, count, window->scratch);
+  *packets         = network_packets_of(window->deltas, window->interval);
+  window->count    = 0;
+  window->interval = 0;
+  memset(window->deltas, 0, sizeof(window->deltas));
+  return count;
 }
 
 #endif /* NETWORK_H */
@@ -1,12 +1,38 @@
+#include "../cadence.h"
+#include "../history.h"
+#include "../sample_log.h"
 #include "../sketchybar.h"
 #include "network.h"
 #include <errno.h>
 #include <signal.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/resource.h>
 #include <unistd.h>
 
-static const int MAX_MESSAGE_LENGTH = 512;
+static const int MAX_MESSAGE_LENGTH = 768;
+
+// Log dei contatori grezzi (--record / --replay)
+static struct sample_log g_sample_log;
+static bool              g_recording = false;
+static bool              g_replaying = false;
+// In replay il tempo è quello del record corrente, le attese le fa sample_log_next
+static uint64_t g_replay_now_ns = 0;
+// Storico compresso opzionale (--history)
+static struct history g_history;
+static bool           g_history_enabled = false;
+
+/**
+ * Soglie opzionali su scarti ed errori (rx + tx, al secondo): superarle
+ * invia un evento separato con state='spike', rientrare uno con state='clear'
+ */
+struct network_alert {
+  char   event[128];
+  double max_drops;  // 0 = disattivata
+  double max_errors; // 0 = disattivata
+  bool   active;
+};
+static struct network_alert g_alert;
 
 /**
  * Mostra le istruzioni per l'uso del programma
@@ -14,7 +40,201 @@ static const int MAX_MESSAGE_LENGTH = 512;
 static void show_usage(const char* program_name) {
   if (!program_name)
     program_name = "network_load";
-  printf("Usage: %s \"<interface>\" \"<event-name>\" \"<event_freq>\"\n", program_name);
+  printf("Usage: %s \"<interface>\" \"<event-name>\" \"<event_freq>\" [\"<sample_ms>\"] [--record <file> | --replay <file> [--speed N]]\n"
+         "       [--history <dir> [--history-days N]] [--max-drops N] [--max-errors N] [--alert-event <name>]\n",
+         program_name);
+  printf("  sample_ms: legge i contatori ogni sample_ms millisecondi e pubblica media, picco e p95\n");
+  printf("  pubblica anche pacchetti, errori e scarti al secondo (rx_pps, tx_pps, rx_errors, tx_errors, rx_drops, tx_drops)\n");
+  printf("  --max-drops, --max-errors: soglie al secondo (rx + tx) oltre cui inviare l'evento di allarme\n");
+  printf("  --alert-event: nome dell'evento di allarme (default <event-name>_alert), con state='spike' o 'clear'\n");
+  printf("  --record: registra i contatori grezzi con il tempo monotono in un log binario\n");
+  printf("  --replay: ricalcola e invia i trigger dai contatori di un log, a velocità N (0 = senza attese)\n");
+  printf("  --history: conserva upload e download (byte/s) compressi in <dir>, un file al giorno per N giorni\n"
+         "             (default %d), da interrogare con sbhist\n",
+         HISTORY_DEFAULT_RETENTION_DAYS);
+}
+
+/**
+ * Tempo CPU (utente + sistema) consumato dal processo, in microsecondi
+ */
+[[nodiscard]] static uint64_t process_cpu_us() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) < 0)
+    return 0;
+
+  return (uint64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000ull
+       + (uint64_t)(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+}
+
+/**
+ * Tempo monotono corrente in nanosecondi
+ */
+[[nodiscard]] static uint64_t monotonic_ns() {
+  return g_replaying ? g_replay_now_ns : cadence_now_ns();
+}
+
+/**
+ * Dorme fino alla scadenza assoluta indicata (tempo monotono)
+ */
+static void sleep_until(uint64_t deadline_ns) {
+  if (!g_replaying)
+    cadence_sleep_until(deadline_ns);
+}
+
+/**
+ * Legge un campione: dal sistema, registrandolo se richiesto, o dal log in replay
+ *
+ * @return false a fine replay
+ */
+[[nodiscard]] static bool network_sample(struct network* network) {
+  if (!g_replaying) {
+    network_update(network);
+    if (g_recording)
+      sample_log_write_counters(&g_sample_log, network->counters, NETWORK_COUNTERS);
+    return true;
+  }
+
+  // I log registrati prima dei contatori di pacchetti hanno solo i byte
+  struct sample_record record = {0};
+  do {
+    if (!sample_log_next(&g_sample_log, &record))
+      return false;
+  } while (record.type != SAMPLE_RECORD_COUNTERS || (record.count != 2 && record.count != NETWORK_COUNTERS));
+
+  uint64_t counters[NETWORK_COUNTERS] = {0};
+  memcpy(counters, record.counters, (size_t)record.count * sizeof(uint64_t));
+  g_replay_now_ns    = record.timestamp_ns;
+  struct timespec ts = {.tv_sec = (time_t)(record.timestamp_ns / 1000000000ull), .tv_nsec = (long)(record.timestamp_ns % 1000000000ull)};
+  network_account_at(network, counters, ts);
+  return true;
+}
+
+/**
+ * Aggiunge al trigger i tassi di pacchetti, errori e scarti
+ *
+ * @return La nuova lunghezza del messaggio, come snprintf
+ */
+static int format_packets(char* message, int length, const struct network_packets* packets) {
+  if (length < 0 || length >= MAX_MESSAGE_LENGTH)
+    return length;
+
+  int written = snprintf(
+      message + length, (size_t)(MAX_MESSAGE_LENGTH - length),
+      " rx_pps='%.0f' tx_pps='%.0f' rx_errors='%.1f' tx_errors='%.1f' rx_drops='%.1f' tx_drops='%.1f'", packets->rx_pps,
+      packets->tx_pps, packets->rx_errors, packets->tx_errors, packets->rx_drops, packets->tx_drops);
+  return written < 0 ? written : length + written;
+}
+
+/**
+ * Confronta scarti ed errori con le soglie e invia l'evento di allarme
+ * quando lo stato cambia, non a ogni pubblicazione sopra soglia
+ */
+static void check_alert(const struct network_packets* packets) {
+  if (g_alert.max_drops <= 0 && g_alert.max_errors <= 0)
+    return;
+
+  double drops  = packets->rx_drops + packets->tx_drops;
+  double errors = packets->rx_errors + packets->tx_errors;
+  bool   drop   = g_alert.max_drops > 0 && drops >= g_alert.max_drops;
+  bool   error  = g_alert.max_errors > 0 && errors >= g_alert.max_errors;
+  if ((drop || error) == g_alert.active)
+    return;
+  g_alert.active = drop || error;
+
+  char message[MAX_MESSAGE_LENGTH];
+  int  length = snprintf(
+      message, sizeof(message), "--trigger '%s' state='%s' reason='%s'", g_alert.event, g_alert.active ? "spike" : "clear",
+      drop && error ? "drops,errors" : drop ? "drops" : error ? "errors" : "");
+  length = format_packets(message, length, packets);
+  if (length < 0 || length >= (int)sizeof(message)) {
+    fprintf(stderr, "Errore o troncamento durante la formattazione del messaggio di allarme\n");
+    return;
+  }
+  sketchybar(message);
+}
+
+/**
+ * Modalità oversampling: legge i contatori ogni sample_ns e pubblica ogni
+ * publish_ns media, picco e p95 della finestra, più il costo CPU del campionamento.
+ * Le pubblicazioni cadono sulla griglia condivisa con gli altri provider:
+ * l'ultimo campione di ogni finestra si legge proprio alla scadenza.
+ */
+static void run_oversampled(struct network* network, const char* event, uint64_t publish_ns, uint64_t sample_ns) {
+  static struct network_window window;
+  char                         trigger_message[MAX_MESSAGE_LENGTH];
+
+  uint64_t wall_start   = monotonic_ns();
+  uint64_t next_publish = cadence_next(publish_ns, wall_start);
+  uint64_t next_sample  = wall_start + sample_ns < next_publish ? wall_start + sample_ns : next_publish;
+  uint64_t cpu_start    = process_cpu_us();
+
+  // Il chiamante ha già letto la base dei delta
+  sleep_until(next_sample);
+
+  for (;;) {
+    uint64_t sample_start = trace_begin();
+    if (!network_sample(network))
+      return;
+    network_window_add(&window, network);
+    trace_end(TRACE_SAMPLE, sample_start);
+
+    if (next_sample < next_publish) {
+      next_sample = next_sample + sample_ns < next_publish ? next_sample + sample_ns : next_publish;
+      sleep_until(next_sample);
+      continue;
+    }
+
+    // Pubblicazione: aggregazione, formattazione e invio
+    uint64_t               tick_start = trace_begin();
+    struct network_stats   up, down;
+    struct network_packets packets;
+    int                    samples = network_window_flush(&window, &up, &down, &packets);
+    if (g_history_enabled && samples > 0)
+      history_append(&g_history, history_now_ms(), (double[]){up.avg, down.avg});
+
+    // Costo del ciclo interno: CPU consumata dal processo sul tempo trascorso
+    uint64_t cpu_now     = process_cpu_us();
+    uint64_t wall_now    = monotonic_ns();
+    double   cpu_percent = wall_now > wall_start ? 100.0 * (double)(cpu_now - cpu_start) * 1000.0 / (double)(wall_now - wall_start) : 0;
+    double   sample_us   = samples > 0 ? (double)(cpu_now - cpu_start) / samples : 0;
+    cpu_start            = cpu_now;
+    wall_start           = wall_now;
+
+    int       up_avg, up_peak, up_p95, down_avg, down_peak, down_p95;
+    enum unit up_avg_unit, up_peak_unit, up_p95_unit, down_avg_unit, down_peak_unit, down_p95_unit;
+    network_scale(up.avg, &up_avg, &up_avg_unit);
+    network_scale(up.peak, &up_peak, &up_peak_unit);
+    network_scale(up.p95, &up_p95, &up_p95_unit);
+    network_scale(down.avg, &down_avg, &down_avg_unit);
+    network_scale(down.peak, &down_peak, &down_peak_unit);
+    network_scale(down.p95, &down_p95, &down_p95_unit);
+
+    int trigger_len = snprintf(
+        trigger_message, sizeof(trigger_message),
+        "--trigger '%s' upload='%03d%s' download='%03d%s' upload_peak='%03d%s' download_peak='%03d%s' "
+        "upload_p95='%03d%s' download_p95='%03d%s' samples='%d' sampler_cpu='%.3f' sample_cost_us='%.1f'",
+        event, up_avg, unit_str[up_avg_unit], down_avg, unit_str[down_avg_unit], up_peak, unit_str[up_peak_unit], down_peak,
+        unit_str[down_peak_unit], up_p95, unit_str[up_p95_unit], down_p95, unit_str[down_p95_unit], samples, cpu_percent, sample_us);
+    trigger_len = format_packets(trigger_message, trigger_len, &packets);
+
+    if (trigger_len < 0 || trigger_len >= (int)sizeof(trigger_message)) {
+      fprintf(stderr, "Errore o troncamento durante la formattazione del messaggio trigger\n");
+      // Continuiamo comunque l'esecuzione
+    }
+    trace_end(TRACE_FORMAT, tick_start);
+
+    sketchybar(trigger_message);
+    check_alert(&packets);
+    trace_end(TRACE_TICK, tick_start);
+
+    // Se il processo è rimasto indietro (sospensione, bar bloccata) riparte dalla prossima scadenza
+    uint64_t now = monotonic_ns();
+    next_publish += publish_ns;
+    if (next_publish <= now)
+      next_publish = cadence_next(publish_ns, now);
+    next_sample = now + sample_ns < next_publish ? now + sample_ns : next_publish;
+    sleep_until(next_sample);
+  }
 }
 
 /**
@@ -61,13 +281,83 @@ int main(int argc, char** argv) {
 
   sketchybar(event_message);
 
-  // Inizializza la struttura network
-  struct network network;
-  if (network_init(&network, argv[1]) != 0) {
+  // Campionamento opzionale come quarto argomento, poi le opzioni in qualunque ordine
+  const char* sample_arg   = NULL;
+  const char* record_path  = NULL;
+  const char* replay_path  = NULL;
+  double      replay_speed = 1.0;
+  const char* history_dir  = NULL;
+  int         history_days = HISTORY_DEFAULT_RETENTION_DAYS;
+  int         first_option = 4;
+  if (argc > 4 && strncmp(argv[4], "--", 2) != 0) {
+    sample_arg   = argv[4];
+    first_option = 5;
+  }
+  for (int i = first_option; i < argc; i++) {
+    if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+      record_path = argv[++i];
+    } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+      replay_path = argv[++i];
+    } else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+      replay_speed = strtod(argv[++i], NULL);
+    } else if (strcmp(argv[i], "--history") == 0 && i + 1 < argc) {
+      history_dir = argv[++i];
+    } else if (strcmp(argv[i], "--history-days") == 0 && i + 1 < argc) {
+      history_days = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--max-drops") == 0 && i + 1 < argc) {
+      g_alert.max_drops = strtod(argv[++i], NULL);
+    } else if (strcmp(argv[i], "--max-errors") == 0 && i + 1 < argc) {
+      g_alert.max_errors = strtod(argv[++i], NULL);
+    } else if (strcmp(argv[i], "--alert-event") == 0 && i + 1 < argc) {
+      snprintf(g_alert.event, sizeof(g_alert.event), "%s", argv[++i]);
+    } else {
+      show_usage(argv[0]);
+      return 1;
+    }
+  }
+  if ((record_path && replay_path) || (history_dir && replay_path) || replay_speed < 0) {
+    show_usage(argv[0]);
+    return 1;
+  }
+
+  if (record_path && !sample_log_create(&g_sample_log, record_path, SAMPLE_LOG_NETWORK)) {
+    fprintf(stderr, "Impossibile creare il log %s: %s\n", record_path, strerror(errno));
+    return 1;
+  }
+  if (replay_path && !sample_log_open(&g_sample_log, replay_path, SAMPLE_LOG_NETWORK, replay_speed)) {
+    fprintf(stderr, "Impossibile aprire il log %s: %s\n", replay_path, strerror(errno));
+    return 1;
+  }
+  g_recording = record_path != NULL;
+  g_replaying = replay_path != NULL;
+
+  if (history_dir && !history_open(&g_history, history_dir, (const char* const[]){"upload", "download"}, 2, history_days)) {
+    fprintf(stderr, "Impossibile usare la directory dello storico %s: %s\n", history_dir, strerror(errno));
+    return 1;
+  }
+  g_history_enabled = history_dir != NULL;
+
+  // Evento di allarme, registrato solo se c'è almeno una soglia
+  if (g_alert.max_drops > 0 || g_alert.max_errors > 0) {
+    if (!g_alert.event[0])
+      snprintf(g_alert.event, sizeof(g_alert.event), "%.120s_alert", argv[2]);
+    snprintf(event_message, sizeof(event_message), "--add event '%s'", g_alert.event);
+    sketchybar(event_message);
+  }
+
+  // Inizializza la struttura network; in replay i contatori vengono dal log
+  struct network network = {0};
+  if (!g_replaying && network_init(&network, argv[1]) != 0) {
     fprintf(stderr, "Errore: impossibile inizializzare l'interfaccia di rete '%s'\n", argv[1]);
     return 1;
   }
 
+  // La lettura di base di network_init è il primo record del log
+  if (g_recording)
+    sample_log_write_counters(&g_sample_log, network.counters, NETWORK_COUNTERS);
+  if (g_replaying && !network_sample(&network))
+    return 0;
+
   // Buffer per il messaggio di trigger
   char trigger_message[MAX_MESSAGE_LENGTH];
 
@@ -77,31 +367,64 @@ int main(int argc, char** argv) {
     update_freq = 1.0;
   }
 
-  unsigned long sleep_microseconds = (unsigned long)(update_freq * 1000000);
+  unsigned long  sleep_microseconds = (unsigned long)(update_freq * 1000000);
+  struct cadence cadence;
+  cadence_init(&cadence, update_freq);
+
+  // Oversampling opzionale: campionamento interno più fitto della pubblicazione
+  if (sample_arg) {
+    long sample_ms = strtol(sample_arg, NULL, 10);
+    if (sample_ms <= 0 || (unsigned long)sample_ms * 1000 >= sleep_microseconds) {
+      fprintf(stderr, "Intervallo di campionamento non valido (%s), oversampling disattivato\n", sample_arg);
+    } else {
+      if ((unsigned long)sample_ms * 1000 * NETWORK_MAX_SAMPLES < sleep_microseconds)
+        sample_ms = (long)(sleep_microseconds / 1000 / NETWORK_MAX_SAMPLES) + 1;
+
+      // Il primo campione serve solo da base per i delta
+      if (network_sample(&network))
+        run_oversampled(&network, argv[2], (uint64_t)sleep_microseconds * 1000ull, (uint64_t)sample_ms * 1000000ull);
+      sample_log_close(&g_sample_log);
+      return 0;
+    }
+  }
 
   // Loop principale
   for (;;) {
     // Aggiorna le informazioni di rete
-    network_update(&network);
+    uint64_t tick_start = trace_begin();
+    if (!network_sample(&network))
+      break;
+    if (g_history_enabled && network.valid)
+      history_append(&g_history, history_now_ms(), (double[]){network.up_rate, network.down_rate});
+    trace_end(TRACE_SAMPLE, tick_start);
 
     // Prepara il messaggio di evento
-    int trigger_len = snprintf(
+    uint64_t format_start = trace_begin();
+    int      trigger_len  = snprintf(
         trigger_message, sizeof(trigger_message),
         "--trigger '%s' upload='%03d%s' download='%03d%s'", argv[2], network.up,
         unit_str[network.up_unit], network.down, unit_str[network.down_unit]);
+    struct network_packets packets = network_packets_of(network.deltas, network.valid ? network.interval : 0);
+    trigger_len                    = format_packets(trigger_message, trigger_len, &packets);
 
     if (trigger_len < 0 || trigger_len >= (int)sizeof(trigger_message)) {
       fprintf(stderr, "Errore o troncamento durante la formattazione del messaggio trigger\n");
       // Continuiamo comunque l'esecuzione
     }
+    trace_end(TRACE_FORMAT, format_start);
 
     // Invia il trigger a sketchybar
     sketchybar(trigger_message);
+    check_alert(&packets);
+    trace_end(TRACE_TICK, tick_start);
 
-    // Attesa per il prossimo aggiornamento
-    usleep(sleep_microseconds);
+    // Attesa per il prossimo aggiornamento, sulla griglia condivisa con gli
+    // altri provider; in replay il ritmo lo dà il log
+    if (!g_replaying)
+      cadence_wait(&cadence);
   }
 
-  // Mai raggiunto
+  // Raggiunto solo a fine replay
+  sample_log_close(&g_sample_log);
   return 0;
 }
@@ -0,0 +1,506 @@
+#ifndef PROC_H
+#define PROC_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __APPLE__
+#include <libproc.h>
+#include <mach/mach_time.h>
+#else
+#include "../batch_read.h"
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#endif
+
+// Numero massimo di processi pubblicati
+#define PROC_MAX_TOP 16
+// Lunghezza massima del nome di un processo (proc_name su macOS, comm su Linux)
+#define PROC_NAME_LENGTH 33
+// Capacità iniziale della tabella dei processi, cresce solo quando serve
+#define PROC_INITIAL_SLOTS 1024
+// fd lasciati liberi sotto RLIMIT_NOFILE quando si tengono in cache gli stat
+#define PROC_FD_RESERVE 64
+
+/**
+ * Stato di un processo tra due scansioni
+ */
+struct proc_entry {
+  pid_t    pid; // 0 indica uno slot vuoto
+  int      fd;  // /proc/<pid>/stat aperto (Linux), -1 se non in cache
+  uint32_t generation;
+  uint64_t cpu_ns; // Tempo CPU cumulativo all'ultima scansione
+  char     name[PROC_NAME_LENGTH];
+};
+
+/**
+ * Un elemento della classifica
+ */
+struct proc_top_item {
+  pid_t  pid;
+  double cpu; // Percentuale di un core
+  char   name[PROC_NAME_LENGTH];
+};
+
+struct proc {
+  // Tabella hash pid -> stato, indirizzamento aperto con sondaggio lineare
+  struct proc_entry* slots;
+  size_t             capacity;
+  size_t             used;
+  uint32_t           generation;
+  uint64_t           last_ns;
+
+  // Classifica: min-heap di dimensione limitata
+  int                  top_n;
+  int                  top_count;
+  struct proc_top_item top[PROC_MAX_TOP];
+
+  int    process_count;
+  size_t cached_fds;
+
+#ifdef __APPLE__
+  pid_t*                    pids;
+  int                       pids_capacity;
+  mach_timebase_info_data_t timebase;
+#else
+  int     proc_fd; // Directory /proc, riletta con getdents64
+  int64_t ns_per_tick;
+  size_t  fd_budget; // fd di stat tenuti in cache al massimo, sotto RLIMIT_NOFILE
+  char    dirents[32768];
+#endif
+};
+
+/**
+ * Tempo monotono corrente in nanosecondi
+ */
+[[nodiscard]] static inline uint64_t proc_now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * Hash di un pid (moltiplicativo di Fibonacci)
+ */
+[[nodiscard]] static inline size_t proc_hash(pid_t pid, size_t capacity) {
+  return (size_t)(((uint64_t)(uint32_t)pid * 11400714819323198485ull) >> 32) & (capacity - 1);
+}
+
+/**
+ * Cerca lo slot di un pid, o lo slot vuoto dove andrebbe inserito
+ */
+[[nodiscard]] static inline struct proc_entry* proc_slot(struct proc_entry* slots, size_t capacity, pid_t pid) {
+  size_t index = proc_hash(pid, capacity);
+  while (slots[index].pid != 0 && slots[index].pid != pid)
+    index = (index + 1) & (capacity - 1);
+  return &slots[index];
+}
+
+/**
+ * Raddoppia la tabella: unica allocazione dopo l'avvio, solo se i processi crescono
+ */
+[[nodiscard]] static inline bool proc_grow(struct proc* proc) {
+  size_t             capacity = proc->capacity * 2;
+  struct proc_entry* slots    = calloc(capacity, sizeof(struct proc_entry));
+  if (!slots)
+    return false;
+
+  for (size_t i = 0; i < proc->capacity; i++) {
+    if (proc->slots[i].pid != 0)
+      *proc_slot(slots, capacity, proc->slots[i].pid) = proc->slots[i];
+  }
+
+  free(proc->slots);
+  proc->slots    = slots;
+  proc->capacity = capacity;
+  return true;
+}
+
+/**
+ * Rimuove uno slot mantenendo intatte le catene di sondaggio (backward shift)
+ */
+static inline void proc_remove(struct proc* proc, struct proc_entry* entry) {
+  size_t hole = (size_t)(entry - proc->slots);
+  size_t mask = proc->capacity - 1;
+
+  if (entry->fd >= 0) {
+    close(entry->fd);
+    proc->cached_fds--;
+  }
+  proc->slots[hole].pid = 0;
+  proc->used--;
+
+  for (size_t next = (hole + 1) & mask; proc->slots[next].pid != 0; next = (next + 1) & mask) {
+    size_t home = proc_hash(proc->slots[next].pid, proc->capacity);
+    // Sposta l'elemento solo se il buco sta tra la sua posizione ideale e quella attuale
+    if (((next - home) & mask) >= ((next - hole) & mask)) {
+      proc->slots[hole]     = proc->slots[next];
+      proc->slots[next].pid = 0;
+      hole                  = next;
+    }
+  }
+}
+
+/**
+ * Inserisce un candidato nella classifica (min-heap sui consumi)
+ */
+static inline void proc_top_push(struct proc* proc, pid_t pid, double cpu, const char* name) {
+  struct proc_top_item* heap = proc->top;
+
+  if (proc->top_count == proc->top_n) {
+    if (cpu <= heap[0].cpu)
+      return;
+
+    // Sostituisce il minimo e lo fa scendere
+    int index = 0;
+    for (;;) {
+      int left     = 2 * index + 1;
+      int right    = left + 1;
+      int smallest = index;
+      if (left < proc->top_count && heap[left].cpu < (smallest == index ? cpu : heap[smallest].cpu))
+        smallest = left;
+      if (right < proc->top_count && heap[right].cpu < (smallest == index ? cpu : heap[smallest].cpu))
+        smallest = right;
+      if (smallest == index)
+        break;
+      heap[index] = heap[smallest];
+      index       = smallest;
+    }
+    heap[index].pid = pid;
+    heap[index].cpu = cpu;
+    snprintf(heap[index].name, sizeof(heap[index].name), "%s", name);
+    return;
+  }
+
+  int index = proc->top_count++;
+  while (index > 0 && heap[(index - 1) / 2].cpu > cpu) {
+    heap[index] = heap[(index - 1) / 2];
+    index       = (index - 1) / 2;
+  }
+  heap[index].pid = pid;
+  heap[index].cpu = cpu;
+  snprintf(heap[index].name, sizeof(heap[index].name), "%s", name);
+}
+
+static int proc_compare_top(const void* a, const void* b) {
+  double lhs = ((const struct proc_top_item*)a)->cpu;
+  double rhs = ((const struct proc_top_item*)b)->cpu;
+  return (lhs < rhs) - (lhs > rhs);
+}
+
+/**
+ * Aggiorna lo stato di un processo e lo propone alla classifica
+ *
+ * @param proc Stato della scansione
+ * @param entry Slot del processo
+ * @param cpu_ns Tempo CPU cumulativo letto ora
+ * @param elapsed_ns Tempo trascorso dalla scansione precedente
+ * @param fresh true se il processo non era noto
+ */
+static inline void proc_account(struct proc* proc, struct proc_entry* entry, uint64_t cpu_ns, uint64_t elapsed_ns, bool fresh) {
+  if (!fresh && elapsed_ns > 0 && cpu_ns >= entry->cpu_ns) {
+    double cpu = 100.0 * (double)(cpu_ns - entry->cpu_ns) / (double)elapsed_ns;
+    if (cpu > 0)
+      proc_top_push(proc, entry->pid, cpu, entry->name);
+  }
+  entry->cpu_ns     = cpu_ns;
+  entry->generation = proc->generation;
+  proc->process_count++;
+}
+
+/**
+ * Restituisce lo slot di un pid, inserendolo se nuovo
+ *
+ * @return Lo slot, NULL se la memoria è esaurita
+ */
+[[nodiscard]] static inline struct proc_entry* proc_lookup(struct proc* proc, pid_t pid, bool* fresh) {
+  if ((proc->used + 1) * 2 > proc->capacity && !proc_grow(proc))
+    return NULL;
+
+  struct proc_entry* entry = proc_slot(proc->slots, proc->capacity, pid);
+  *fresh                   = entry->pid == 0;
+  if (*fresh) {
+    memset(entry, 0, sizeof(struct proc_entry));
+    entry->pid = pid;
+    entry->fd  = -1;
+    proc->used++;
+  }
+  return entry;
+}
+
+#ifdef __APPLE__
+
+/**
+ * Scansione macOS: proc_listpids + proc_pidinfo(PROC_PIDTASKINFO)
+ */
+static inline void proc_scan_platform(struct proc* proc, uint64_t elapsed_ns) {
+  int bytes = proc_listpids(PROC_ALL_PIDS, 0, NULL, 0);
+  if (bytes <= 0)
+    return;
+
+  int needed = bytes / (int)sizeof(pid_t) + 64;
+  if (needed > proc->pids_capacity) {
+    pid_t* pids = realloc(proc->pids, (size_t)needed * sizeof(pid_t));
+    if (!pids)
+      return;
+    proc->pids          = pids;
+    proc->pids_capacity = needed;
+  }
+
+  bytes     = proc_listpids(PROC_ALL_PIDS, 0, proc->pids, proc->pids_capacity * (int)sizeof(pid_t));
+  int count = bytes / (int)sizeof(pid_t);
+
+  for (int i = 0; i < count; i++) {
+    pid_t pid = proc->pids[i];
+    if (pid <= 0)
+      continue;
+
+    struct proc_taskinfo info;
+    if (proc_pidinfo(pid, PROC_PIDTASKINFO, 0, &info, sizeof(info)) != (int)sizeof(info))
+      continue;
+
+    bool               fresh = false;
+    struct proc_entry* entry = proc_lookup(proc, pid, &fresh);
+    if (!entry)
+      return;
+
+    if (fresh && proc_name(pid, entry->name, sizeof(entry->name)) <= 0)
+      snprintf(entry->name, sizeof(entry->name), "%d", (int)pid);
+
+    // pti_total_* sono in unità di mach_absolute_time
+    uint64_t ticks  = info.pti_total_user + info.pti_total_system;
+    uint64_t cpu_ns = ticks * proc->timebase.numer / proc->timebase.denom;
+    proc_account(proc, entry, cpu_ns, elapsed_ns, fresh);
+  }
+}
+
+#else
+
+// Layout dei record restituiti da getdents64
+struct proc_dirent64 {
+  uint64_t       d_ino;
+  int64_t        d_off;
+  unsigned short d_reclen;
+  unsigned char  d_type;
+  char           d_name[];
+};
+
+/**
+ * Legge /proc/<pid>/stat: nome e utime+stime in tick, senza stdio
+ *
+ * @return true se la lettura è riuscita
+ */
+[[nodiscard]] static inline bool proc_read_stat(int fd, char* name, size_t name_size, uint64_t* ticks) {
+  char    buffer[1024];
+  ssize_t length = pread(fd, buffer, sizeof(buffer) - 1, 0);
+  if (length <= 0)
+    return false;
+  buffer[length] = '\0';
+
+  // Il nome può contenere spazi e parentesi: vale l'ultima ')'
+  char* open  = memchr(buffer, '(', (size_t)length);
+  char* close = strrchr(buffer, ')');
+  if (!open || !close || close < open)
+    return false;
+
+  if (name) {
+    size_t name_length = (size_t)(close - open - 1);
+    if (name_length >= name_size)
+      name_length = name_size - 1;
+    memcpy(name, open + 1, name_length);
+    name[name_length] = '\0';
+  }
+
+  // Dopo ") " iniziano i campi dal 3 (state); utime e stime sono il 14 e il 15
+  char* cursor = close + 2;
+  for (int field = 3; field < 14; field++) {
+    cursor = strchr(cursor, ' ');
+    if (!cursor)
+      return false;
+    cursor++;
+  }
+
+  char*    end   = NULL;
+  uint64_t utime = strtoull(cursor, &end, 10);
+  uint64_t stime = strtoull(end, NULL, 10);
+  *ticks         = utime + stime;
+  return true;
+}
+
+/**
+ * Scansione Linux: getdents64 su /proc, fd di stat persistenti riletti con pread
+ */
+static inline void proc_scan_platform(struct proc* proc, uint64_t elapsed_ns) {
+  if (lseek(proc->proc_fd, 0, SEEK_SET) < 0)
+    return;
+
+  for (;;) {
+    long bytes = syscall(SYS_getdents64, proc->proc_fd, proc->dirents, sizeof(proc->dirents));
+    if (bytes <= 0)
+      break;
+
+    for (long offset = 0; offset < bytes;) {
+      struct proc_dirent64* dirent = (struct proc_dirent64*)(proc->dirents + offset);
+      offset += dirent->d_reclen;
+
+      // Solo le directory numeriche sono processi
+      const char* name = dirent->d_name;
+      if (name[0] < '1' || name[0] > '9')
+        continue;
+
+      pid_t pid = 0;
+      for (const char* c = name; *c >= '0' && *c <= '9'; c++)
+        pid = pid * 10 + (*c - '0');
+
+      bool               fresh = false;
+      struct proc_entry* entry = proc_lookup(proc, pid, &fresh);
+      if (!entry)
+        return;
+
+      int  fd        = entry->fd;
+      bool transient = false;
+      if (fd < 0) {
+        char path[32];
+        snprintf(path, sizeof(path), "%d/stat", (int)pid);
+        fd = openat(proc->proc_fd, path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+          // Limite raggiunto comunque (fd aperti altrove): niente più cache oltre questa soglia
+          if ((errno == EMFILE || errno == ENFILE) && proc->fd_budget > proc->cached_fds)
+            proc->fd_budget = proc->cached_fds;
+          continue;
+        }
+        transient = proc->cached_fds >= proc->fd_budget;
+      }
+
+      uint64_t ticks = 0;
+      bool     ok    = proc_read_stat(fd, fresh ? entry->name : NULL, sizeof(entry->name), &ticks);
+
+      if (transient) {
+        close(fd);
+      } else if (entry->fd < 0) {
+        entry->fd = fd;
+        proc->cached_fds++;
+      }
+
+      // Un fd di un processo terminato restituisce ESRCH: lo slot verrà riciclato
+      if (!ok)
+        continue;
+
+      proc_account(proc, entry, ticks * (uint64_t)proc->ns_per_tick, elapsed_ns, fresh);
+    }
+  }
+}
+
+#endif
+
+/**
+ * Inizializza lo stato della scansione
+ *
+ * @param proc Struttura da inizializzare
+ * @param top_n Numero di processi in classifica
+ * @return 0 in caso di successo, -1 altrimenti
+ */
+[[nodiscard]] static inline int proc_init(struct proc* proc, int top_n) {
+  if (!proc)
+    return -1;
+
+  memset(proc, 0, sizeof(struct proc));
+  proc->top_n    = top_n < 1 ? 1 : (top_n > PROC_MAX_TOP ? PROC_MAX_TOP : top_n);
+  proc->capacity = PROC_INITIAL_SLOTS;
+  proc->slots    = calloc(proc->capacity, sizeof(struct proc_entry));
+  if (!proc->slots)
+    return -1;
+
+#ifdef __APPLE__
+  mach_timebase_info(&proc->timebase);
+#else
+  char path[BATCH_PATH_LENGTH];
+  proc->proc_fd = batch_path(path, sizeof(path), "/proc") ? open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC) : -1;
+  if (proc->proc_fd < 0) {
+    fprintf(stderr, "Impossibile aprire %s: %s\n", path, strerror(errno));
+    free(proc->slots);
+    return -1;
+  }
+
+  long ticks_per_second = sysconf(_SC_CLK_TCK);
+  proc->ns_per_tick     = 1000000000 / (ticks_per_second > 0 ? ticks_per_second : 100);
+
+  // Un fd per processo: alza il limite soft fino a quello hard
+  struct rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+    if (limit.rlim_cur < limit.rlim_max) {
+      limit.rlim_cur = limit.rlim_max;
+      setrlimit(RLIMIT_NOFILE, &limit);
+      getrlimit(RLIMIT_NOFILE, &limit);
+    }
+    // Margine per gli fd transitori e per quelli del resto del programma
+    proc->fd_budget = limit.rlim_cur > PROC_FD_RESERVE ? (size_t)(limit.rlim_cur - PROC_FD_RESERVE) : 0;
+  }
+#endif
+
+  proc->last_ns = proc_now_ns();
+  return 0;
+}
+
+/**
+ * Esegue una scansione e ricalcola la classifica
+ *
+ * @param proc Stato della scansione
+ */
+static inline void proc_update(struct proc* proc) {
+  if (!proc)
+    return;
+
+  uint64_t now     = proc_now_ns();
+  uint64_t elapsed = now - proc->last_ns;
+  proc->last_ns    = now;
+
+  proc->generation++;
+  proc->top_count     = 0;
+  proc->process_count = 0;
+
+  proc_scan_platform(proc, elapsed);
+
+  // Rimuove i processi non più presenti
+  for (size_t i = 0; i < proc->capacity; i++) {
+    struct proc_entry* entry = &proc->slots[i];
+    while (entry->pid != 0 && entry->generation != proc->generation)
+      proc_remove(proc, entry); // Lo shift può portare qui un altro slot da controllare
+  }
+
+  qsort(proc->top, (size_t)proc->top_count, sizeof(struct proc_top_item), proc_compare_top);
+}
+
+/**
+ * Libera le risorse della scansione
+ *
+ * @param proc Stato della scansione
+ */
+static inline void proc_cleanup(struct proc* proc) {
+  if (!proc)
+    return;
+
+  for (size_t i = 0; i < proc->capacity; i++) {
+    if (proc->slots[i].pid != 0 && proc->slots[i].fd >= 0)
+      close(proc->slots[i].fd);
+  }
+  free(proc->slots);
+  proc->slots = NULL;
+
+#ifdef __APPLE__
+  free(proc->pids);
+  proc->pids = NULL;
+#else
+  close(proc->proc_fd);
+#endif
+}
+
+#endif /* PROC_H */
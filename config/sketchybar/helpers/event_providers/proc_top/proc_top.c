@@ -0,0 +1,111 @@
+#include "../cadence.h"
+#include "../sketchybar.h"
+#include "proc.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const int MAX_EVENT_MESSAGE_LENGTH   = 512;
+static const int MAX_TRIGGER_MESSAGE_LENGTH = 2048;
+static const int DEFAULT_TOP_N              = 5;
+
+/**
+ * Mostra le istruzioni per l'uso del programma
+ */
+static void show_usage(const char* program_name) {
+  if (!program_name)
+    program_name = "proc_top";
+  printf("Usage: %s \"<event-name>\" \"<event_freq>\" [\"<top_n>\"]\n", program_name);
+}
+
+/**
+ * Copia un nome di processo rimuovendo i caratteri che romperebbero il messaggio
+ */
+static void sanitize_name(const char* name, char* buffer, size_t size) {
+  size_t length = 0;
+  for (const char* c = name; *c && length < size - 1; c++)
+    buffer[length++] = (*c == '\'' || *c == '"') ? '_' : *c;
+  buffer[length] = '\0';
+}
+
+int main(int argc, char** argv) {
+  float update_freq;
+
+  // Verifica degli argomenti
+  if (argc < 3 || (sscanf(argv[2], "%f", &update_freq) != 1) || update_freq <= 0) {
+    show_usage(argv[0]);
+    return 1;
+  }
+
+  int top_n = (argc > 3) ? atoi(argv[3]) : DEFAULT_TOP_N;
+  if (top_n <= 0 || top_n > PROC_MAX_TOP) {
+    fprintf(stderr, "Numero di processi non valido (%s), uso %d\n", argc > 3 ? argv[3] : "", DEFAULT_TOP_N);
+    top_n = DEFAULT_TOP_N;
+  }
+
+  if (update_freq > 3600) {
+    fprintf(stderr, "Frequenza di aggiornamento non valida (%f), uso 1 secondo\n", update_freq);
+    update_freq = 1.0;
+  }
+
+  // Inizializza la scansione dei processi
+  struct proc proc;
+  if (proc_init(&proc, top_n) != 0) {
+    fprintf(stderr, "Errore: impossibile inizializzare la scansione dei processi\n");
+    return 1;
+  }
+
+  // Setup the event in sketchybar
+  char event_message[MAX_EVENT_MESSAGE_LENGTH];
+  int  msg_len = snprintf(event_message, sizeof(event_message), "--add event '%s'", argv[1]);
+
+  if (msg_len < 0 || msg_len >= (int)sizeof(event_message)) {
+    fprintf(stderr, "Errore durante la formattazione del messaggio evento\n");
+    return 1;
+  }
+
+  sketchybar(event_message);
+
+  // La prima scansione serve solo da base per i delta
+  proc_update(&proc);
+
+  char           trigger_message[MAX_TRIGGER_MESSAGE_LENGTH];
+  char           name[PROC_NAME_LENGTH];
+  struct cadence cadence;
+  cadence_init(&cadence, update_freq);
+
+  // Loop principale: la prima attesa porta sulla griglia condivisa con gli altri provider
+  for (;;) {
+    cadence_wait(&cadence);
+    uint64_t tick_start = trace_begin();
+    proc_update(&proc);
+    trace_end(TRACE_SAMPLE, tick_start);
+
+    uint64_t format_start = trace_begin();
+    int      trigger_len  = snprintf(
+        trigger_message, sizeof(trigger_message), "--trigger '%s' count='%d' processes='%d'", argv[1], proc.top_count,
+        proc.process_count);
+
+    for (int i = 0; i < proc.top_count && trigger_len > 0 && trigger_len < (int)sizeof(trigger_message); i++) {
+      sanitize_name(proc.top[i].name, name, sizeof(name));
+      int written = snprintf(
+          trigger_message + trigger_len, sizeof(trigger_message) - (size_t)trigger_len, " name_%d='%s' pid_%d='%d' cpu_%d='%.1f'", i + 1,
+          name, i + 1, (int)proc.top[i].pid, i + 1, proc.top[i].cpu);
+      trigger_len = written < 0 ? written : trigger_len + written;
+    }
+
+    if (trigger_len < 0 || trigger_len >= (int)sizeof(trigger_message)) {
+      fprintf(stderr, "Errore o troncamento durante la formattazione del messaggio trigger\n");
+      // Continuiamo comunque l'esecuzione
+    }
+    trace_end(TRACE_FORMAT, format_start);
+
+    // Invia il trigger a sketchybar
+    sketchybar(trigger_message);
+    trace_end(TRACE_TICK, tick_start);
+  }
+
+  // Mai raggiunto
+  proc_cleanup(&proc);
+  return 0;
+}
@@ -0,0 +1,285 @@
+#ifndef SAMPLE_LOG_H
+#define SAMPLE_LOG_H
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Contatori massimi per record
+#define SAMPLE_LOG_MAX_COUNTERS 8
+// Dimensione massima di un blob (uscita di un comando)
+#define SAMPLE_LOG_MAX_BLOB (1u << 20)
+
+/**
+ * Log binario dei campioni grezzi di un provider (--record / --replay).
+ *
+ * Intestazione di 8 byte: "SBSL", versione, tipo di provider, due byte
+ * riservati. Poi un record per campione, tutto in varint LEB128:
+ *
+ *   delta del tempo monotono dal record precedente (ns)
+ *   tipo del record
+ *   COUNTERS: numero di contatori, poi per ciascuno la differenza dal
+ *             record precedente in zigzag (i contatori cumulativi crescono
+ *             poco tra due tick, quindi bastano 1-3 byte)
+ *   BLOB:     lunghezza, poi i byte
+ *
+ * Il replay rilegge i valori grezzi e li passa allo stesso calcolo e allo
+ * stesso invio del provider, a velocità reale, N volte più veloce o senza
+ * attese (--speed 0), su qualunque macchina.
+ */
+enum sample_log_kind {
+  SAMPLE_LOG_CPU     = 1,
+  SAMPLE_LOG_NETWORK = 2,
+  SAMPLE_LOG_BREW    = 3,
+};
+
+enum sample_record_type {
+  SAMPLE_RECORD_COUNTERS = 1,
+  SAMPLE_RECORD_BLOB     = 2,
+};
+
+/**
+ * Un record letto dal log
+ */
+struct sample_record {
+  uint64_t                timestamp_ns; // Tempo monotono della registrazione
+  enum sample_record_type type;
+  int                     count;
+  uint64_t                counters[SAMPLE_LOG_MAX_COUNTERS];
+  char*                   blob; // Terminato da '\0', valido fino alla lettura successiva
+  size_t                  blob_length;
+};
+
+struct sample_log {
+  FILE*    file;
+  bool     writing;
+  uint64_t last_ns;
+
+  // Base delle differenze, uguale in scrittura e in lettura
+  int      count;
+  uint64_t counters[SAMPLE_LOG_MAX_COUNTERS];
+
+  char*  blob;
+  size_t blob_capacity;
+
+  // Replay: riferimento tra il primo record e l'orologio reale
+  double   speed;
+  bool     paced;
+  uint64_t replay_origin_ns;
+  uint64_t wall_origin_ns;
+};
+
+/**
+ * Tempo monotono corrente in nanosecondi
+ */
+[[nodiscard]] static inline uint64_t sample_log_now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static inline void sample_log_put_varint(FILE* file, uint64_t value) {
+  do {
+    uint8_t byte = value & 0x7f;
+    value >>= 7;
+    fputc(value ? byte | 0x80 : byte, file);
+  } while (value);
+}
+
+[[nodiscard]] static inline bool sample_log_get_varint(FILE* file, uint64_t* value) {
+  *value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    int byte = fgetc(file);
+    if (byte == EOF)
+      return false;
+    *value |= (uint64_t)(byte & 0x7f) << shift;
+    if (!(byte & 0x80))
+      return true;
+  }
+  return false;
+}
+
+/**
+ * Crea un log e ne scrive l'intestazione
+ *
+ * @param log Log da inizializzare
+ * @param path Percorso del file, troncato se esiste
+ * @param kind Tipo di provider che registra
+ * @return true in caso di successo
+ */
+[[nodiscard]] static inline bool sample_log_create(struct sample_log* log, const char* path, enum sample_log_kind kind) {
+  memset(log, 0, sizeof(struct sample_log));
+  log->file = fopen(path, "wb");
+  if (!log->file)
+    return false;
+
+  const uint8_t header[8] = {'S', 'B', 'S', 'L', 1, (uint8_t)kind, 0, 0};
+  log->writing            = true;
+  log->last_ns            = sample_log_now();
+  return fwrite(header, sizeof(header), 1, log->file) == 1 && fflush(log->file) == 0;
+}
+
+/**
+ * Apre un log per il replay e ne verifica l'intestazione
+ *
+ * @param log Log da inizializzare
+ * @param path Percorso del file
+ * @param kind Tipo di provider atteso
+ * @param speed Fattore di velocità del replay, 0 per non attendere
+ * @return true se il file è un log del tipo atteso
+ */
+[[nodiscard]] static inline bool sample_log_open(struct sample_log* log, const char* path, enum sample_log_kind kind, double speed) {
+  memset(log, 0, sizeof(struct sample_log));
+  log->file = fopen(path, "rb");
+  if (!log->file)
+    return false;
+
+  uint8_t header[8];
+  if (fread(header, sizeof(header), 1, log->file) != 1 || memcmp(header, "SBSL", 4) != 0 || header[4] != 1 || header[5] != kind) {
+    fclose(log->file);
+    log->file = NULL;
+    errno     = EINVAL;
+    return false;
+  }
+  log->speed = speed;
+  return true;
+}
+
+/**
+ * Registra un campione di contatori cumulativi con il tempo monotono corrente
+ *
+ * @return true se il record è stato scritto
+ */
+static inline bool sample_log_write_counters(struct sample_log* log, const uint64_t* counters, int count) {
+  if (!log->file || count < 0 || count > SAMPLE_LOG_MAX_COUNTERS)
+    return false;
+
+  uint64_t now = sample_log_now();
+  sample_log_put_varint(log->file, now - log->last_ns);
+  sample_log_put_varint(log->file, SAMPLE_RECORD_COUNTERS);
+  sample_log_put_varint(log->file, (uint64_t)count);
+  if (count != log->count) {
+    memset(log->counters, 0, sizeof(log->counters));
+    log->count = count;
+  }
+  for (int i = 0; i < count; i++) {
+    int64_t delta = (int64_t)(counters[i] - log->counters[i]);
+    sample_log_put_varint(log->file, ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63));
+    log->counters[i] = counters[i];
+  }
+  log->last_ns = now;
+  return fflush(log->file) == 0;
+}
+
+/**
+ * Registra un blob (ad esempio l'uscita di un comando) con il tempo monotono corrente
+ *
+ * @return true se il record è stato scritto
+ */
+static inline bool sample_log_write_blob(struct sample_log* log, const char* data, size_t length) {
+  if (!log->file || length > SAMPLE_LOG_MAX_BLOB)
+    return false;
+
+  uint64_t now = sample_log_now();
+  sample_log_put_varint(log->file, now - log->last_ns);
+  sample_log_put_varint(log->file, SAMPLE_RECORD_BLOB);
+  sample_log_put_varint(log->file, length);
+  fwrite(data, 1, length, log->file);
+  log->last_ns = now;
+  return fflush(log->file) == 0;
+}
+
+/**
+ * Legge il record successivo e attende il suo istante di replay
+ *
+ * Il primo record parte subito; i successivi mantengono la distanza
+ * registrata divisa per la velocità. Se il consumatore resta indietro non
+ * recupera a raffica ma riparte dal record corrente.
+ *
+ * @param log Log aperto con sample_log_open
+ * @param record Record di output
+ * @return true se è stato letto un record, false a fine log o se è corrotto
+ */
+[[nodiscard]] static inline bool sample_log_next(struct sample_log* log, struct sample_record* record) {
+  if (!log->file || log->writing)
+    return false;
+
+  uint64_t delta_ns, type, length;
+  if (!sample_log_get_varint(log->file, &delta_ns) || !sample_log_get_varint(log->file, &type)
+      || !sample_log_get_varint(log->file, &length))
+    return false;
+
+  log->last_ns += delta_ns;
+  record->timestamp_ns = log->last_ns;
+  record->type         = (enum sample_record_type)type;
+
+  if (type == SAMPLE_RECORD_COUNTERS) {
+    if (length > SAMPLE_LOG_MAX_COUNTERS)
+      return false;
+    if ((int)length != log->count) {
+      memset(log->counters, 0, sizeof(log->counters));
+      log->count = (int)length;
+    }
+    for (int i = 0; i < log->count; i++) {
+      uint64_t zigzag;
+      if (!sample_log_get_varint(log->file, &zigzag))
+        return false;
+      log->counters[i] += (zigzag >> 1) ^ (uint64_t)-(int64_t)(zigzag & 1);
+    }
+    record->count = log->count;
+    memcpy(record->counters, log->counters, sizeof(log->counters));
+  } else if (type == SAMPLE_RECORD_BLOB) {
+    if (length > SAMPLE_LOG_MAX_BLOB)
+      return false;
+    if (length + 1 > log->blob_capacity) {
+      char* blob = realloc(log->blob, length + 1);
+      if (!blob)
+        return false;
+      log->blob          = blob;
+      log->blob_capacity = length + 1;
+    }
+    if (fread(log->blob, 1, length, log->file) != length)
+      return false;
+    log->blob[length]   = '\0';
+    record->blob        = log->blob;
+    record->blob_length = length;
+  } else {
+    return false;
+  }
+
+  // Attesa fino all'istante del record sull'orologio reale
+  uint64_t now = sample_log_now();
+  if (!log->paced) {
+    log->paced            = true;
+    log->replay_origin_ns = record->timestamp_ns;
+    log->wall_origin_ns   = now;
+  } else if (log->speed > 0) {
+    uint64_t due = log->wall_origin_ns + (uint64_t)((double)(record->timestamp_ns - log->replay_origin_ns) / log->speed);
+    if (due > now) {
+      uint64_t        remaining = due - now;
+      struct timespec ts        = {.tv_sec = (time_t)(remaining / 1000000000ull), .tv_nsec = (long)(remaining % 1000000000ull)};
+      while (nanosleep(&ts, &ts) < 0 && errno == EINTR) {
+      }
+    } else if (now - due > 1000000000ull) {
+      log->replay_origin_ns = record->timestamp_ns;
+      log->wall_origin_ns   = now;
+    }
+  }
+  return true;
+}
+
+/**
+ * Chiude il log
+ */
+static inline void sample_log_close(struct sample_log* log) {
+  if (log->file)
+    fclose(log->file);
+  free(log->blob);
+  memset(log, 0, sizeof(struct sample_log));
+}
+
+#endif /* SAMPLE_LOG_H */
@@ -0,0 +1,539 @@
+#ifndef COLLECT_H
+#define COLLECT_H
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <regex.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../batch_read.h"
+#include "../workers.h"
+
+// Eventi, sorgenti e comandi distinti in un file di configurazione
+#define COLLECT_MAX_EVENTS 16
+#define COLLECT_MAX_SOURCES 64
+#define COLLECT_MAX_COMMANDS 16
+// Lunghezza massima di un nome di evento o di sorgente
+#define COLLECT_NAME_LENGTH 64
+// Lunghezza massima di un valore pubblicato, terminatore incluso
+#define COLLECT_VALUE_LENGTH 128
+// Lunghezza massima di una riga del file di configurazione
+#define COLLECT_LINE_LENGTH 512
+// Output massimo letto da un comando
+#define COLLECT_OUTPUT_LENGTH 8192
+// Buffer iniziale di un file sorgente
+#define COLLECT_FILE_BUFFER 4096
+// Timeout predefinito di un comando, in secondi
+#define COLLECT_DEFAULT_TIMEOUT 10.0
+// Nuovo tentativo su un file mancante di un evento senza periodo, in secondi
+#define COLLECT_RETRY_SECONDS 5.0
+
+enum collect_kind {
+  COLLECT_FILE,    // File letto con pread da un descrittore persistente
+  COLLECT_COMMAND, // Comando della shell, eseguito su un worker
+};
+
+/**
+ * Un evento: un gruppo di sorgenti pubblicate insieme con un solo trigger.
+ *
+ * Un evento con periodo viene riletto a intervalli regolari; un evento con
+ * periodo 0 solo quando una delle sue sorgenti osservate cambia. Con
+ * on_change il trigger parte solo se almeno un valore è diverso dall'ultimo
+ * pubblicato.
+ */
+struct collect_event {
+  char     name[COLLECT_NAME_LENGTH];
+  double   period;    // Secondi tra due letture, 0 = solo su modifica
+  double   timeout;   // Secondi concessi ai comandi
+  bool     on_change; // Pubblica solo i valori cambiati
+  int      first;     // Prima sorgente in collect_config.sources
+  int      count;     // Numero di sorgenti
+  uint64_t due_ns;    // Prossima lettura sull'orologio monotono, UINT64_MAX = mai
+  bool     changed;   // Un valore è cambiato dall'ultimo trigger
+  bool     waiting;   // Attende il risultato di un comando lanciato da questa lettura
+  bool     published; // Il primo trigger è già partito
+};
+
+/**
+ * Un comando della shell, condiviso da tutte le sorgenti che lo usano: lo
+ * stesso `pmset -g batt` letto da tre sorgenti gira una volta sola.
+ */
+struct collect_command {
+  char              line[COLLECT_LINE_LENGTH];
+  int               timeout_ms;
+  struct worker_job job; // Risultato: output del comando, allocato con malloc
+};
+
+struct collect_source {
+  char                  name[COLLECT_NAME_LENGTH];
+  enum collect_kind     kind;
+  int                   event;                   // Indice dell'evento
+  int                   command;                 // Indice del comando, -1 per i file
+  char                  path[BATCH_PATH_LENGTH]; // Percorso del file, con il prefisso di batch_path
+  struct batch_source   file;                    // fd persistente, -1 se il file manca
+  bool                  watched;                 // Il file notifica le modifiche (non procfs/sysfs)
+  int                   watch;                   // Descrittore inotify, -1 se non osservato
+  bool                  has_pattern;
+  regex_t               pattern;                 // Estrattore: primo gruppo, o l'intera corrispondenza
+  char                  value[COLLECT_VALUE_LENGTH];
+};
+
+struct collect_config {
+  struct collect_event   events[COLLECT_MAX_EVENTS];
+  int                    event_count;
+  struct collect_source  sources[COLLECT_MAX_SOURCES];
+  int                    source_count;
+  struct collect_command commands[COLLECT_MAX_COMMANDS];
+  int                    command_count;
+};
+
+/**
+ * @return Orologio monotono in nanosecondi
+ */
+[[nodiscard]] static inline uint64_t collect_now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * Toglie gli spazi iniziali e finali, in place
+ */
+static inline char* collect_trim(char* text) {
+  while (isspace((unsigned char)*text))
+    text++;
+  size_t length = strlen(text);
+  while (length > 0 && isspace((unsigned char)text[length - 1]))
+    text[--length] = '\0';
+  return text;
+}
+
+/**
+ * Estrae il valore di una sorgente dal contenuto letto.
+ *
+ * Senza estrattore il valore è l'intero contenuto; con un'espressione
+ * regolare estesa è il primo gruppo, o l'intera corrispondenza se il
+ * pattern non ha gruppi, e nessuna corrispondenza dà il valore vuoto. Gli
+ * a capo diventano spazi e gli apici vengono tolti, perché il valore finisce
+ * tra apici nel messaggio di trigger.
+ *
+ * @param source Sorgente con l'eventuale estrattore
+ * @param text Contenuto letto, terminato da '\0'
+ * @param value Buffer di COLLECT_VALUE_LENGTH byte
+ */
+static inline void collect_extract(const struct collect_source* source, const char* text, char* value) {
+  const char* start  = text;
+  size_t      length = strlen(text);
+
+  if (source->has_pattern) {
+    regmatch_t match[2];
+    if (regexec(&source->pattern, text, 2, match, 0) != 0) {
+      value[0] = '\0';
+      return;
+    }
+    int group = match[1].rm_so >= 0 ? 1 : 0;
+    start     = text + match[group].rm_so;
+    length    = (size_t)(match[group].rm_eo - match[group].rm_so);
+  }
+
+  size_t written = 0;
+  for (size_t i = 0; i < length && written < COLLECT_VALUE_LENGTH - 1; i++) {
+    char c = start[i];
+    if (c == '\'')
+      continue;
+    value[written++] = (c == '\n' || c == '\r' || c == '\t') ? ' ' : c;
+  }
+  value[written] = '\0';
+
+  // Spazi in coda, tipicamente l'a capo finale dei file di sysfs
+  while (written > 0 && value[written - 1] == ' ')
+    value[--written] = '\0';
+  size_t skip = strspn(value, " ");
+  if (skip)
+    memmove(value, value + skip, written - skip + 1);
+}
+
+/**
+ * Aggiorna il valore di una sorgente
+ *
+ * @return true se il valore è cambiato
+ */
+static inline bool collect_store(struct collect_source* source, const char* text) {
+  char value[COLLECT_VALUE_LENGTH];
+  collect_extract(source, text, value);
+  if (strcmp(value, source->value) == 0)
+    return false;
+  memcpy(source->value, value, sizeof(value));
+  return true;
+}
+
+/**
+ * (Ri)apre il file di una sorgente; un file mancante lascia fd a -1
+ *
+ * @return true se il file è aperto
+ */
+static inline bool collect_source_open(struct collect_source* source) {
+  batch_source_close(&source->file);
+  return batch_source_open(&source->file, source->path, COLLECT_FILE_BUFFER);
+}
+
+/**
+ * @return true se il file aperto è stato cancellato o sostituito con un rename
+ */
+[[nodiscard]] static inline bool collect_source_stale(const struct collect_source* source) {
+  struct stat st;
+  return source->file.fd >= 0 && fstat(source->file.fd, &st) == 0 && st.st_nlink == 0;
+}
+
+/**
+ * Rilegge una sorgente file dall'offset 0 sul descrittore persistente
+ *
+ * @param syscalls Contatore delle chiamate di sistema, può essere NULL
+ * @return true se il valore è cambiato
+ */
+static inline bool collect_read_file(struct collect_source* source, uint64_t* syscalls) {
+  if (source->file.fd < 0 && !collect_source_open(source))
+    return collect_store(source, "");
+  if (!batch_source_pread(&source->file, syscalls)) {
+    // Descrittore non più valido (dispositivo rimosso, file sostituito): si riapre alla prossima lettura
+    batch_source_close(&source->file);
+    return collect_store(source, "");
+  }
+  return collect_store(source, source->file.buffer);
+}
+
+/**
+ * Esegue un comando con /bin/sh e ne legge l'output, entro un timeout.
+ *
+ * Gira su un worker, che ha tutti i segnali bloccati: il figlio li sblocca
+ * prima di exec. Il comando ha un suo gruppo di processi, così allo scadere
+ * del timeout viene ucciso insieme alle sue pipeline.
+ *
+ * @param line Comando
+ * @param timeout_ms Tempo massimo
+ * @return Output terminato da '\0' allocato con malloc, NULL se il comando non parte
+ */
+[[nodiscard]] static inline char* collect_run(const char* line, int timeout_ms) {
+  // Entrambi gli estremi sono close-on-exec: un comando lanciato in parallelo
+  // dall'altro worker non deve ereditare lo stdout di questo, o il lettore
+  // vedrebbe EOF solo all'uscita di quel comando. dup2 toglie il flag allo stdout del figlio.
+  int pipe_fds[2];
+#ifdef __APPLE__
+  // Senza pipe2: pipe, FD_CLOEXEC e fork sotto lo stesso lock, così nessun fork cade nel mezzo
+  static pthread_mutex_t fork_lock = PTHREAD_MUTEX_INITIALIZER;
+  pthread_mutex_lock(&fork_lock);
+  if (pipe(pipe_fds) < 0) {
+    pthread_mutex_unlock(&fork_lock);
+    return NULL;
+  }
+  fcntl(pipe_fds[0], F_SETFD, FD_CLOEXEC);
+  fcntl(pipe_fds[1], F_SETFD, FD_CLOEXEC);
+  pid_t pid = fork();
+  if (pid != 0)
+    pthread_mutex_unlock(&fork_lock);
+#else
+  if (pipe2(pipe_fds, O_CLOEXEC) < 0)
+    return NULL;
+  pid_t pid = fork();
+#endif
+  if (pid < 0) {
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+    return NULL;
+  }
+  if (pid == 0) {
+    sigset_t none;
+    sigemptyset(&none);
+    sigprocmask(SIG_SETMASK, &none, NULL);
+    setpgid(0, 0);
+    dup2(pipe_fds[1], STDOUT_FILENO);
+    close(pipe_fds[1]);
+    execl("/bin/sh", "sh", "-c", line, (char*)NULL);
+    _exit(127);
+  }
+  close(pipe_fds[1]);
+
+  char* output = malloc(COLLECT_OUTPUT_LENGTH);
+  if (!output) {
+    kill(-pid, SIGKILL);
+    close(pipe_fds[0]);
+    waitpid(pid, NULL, 0);
+    return NULL;
+  }
+
+  size_t   length   = 0;
+  uint64_t deadline = collect_now_ns() + (uint64_t)timeout_ms * 1000000ull;
+  for (;;) {
+    uint64_t now = collect_now_ns();
+    if (now >= deadline) {
+      kill(-pid, SIGKILL);
+      break;
+    }
+    struct pollfd pfd   = {.fd = pipe_fds[0], .events = POLLIN};
+    int           ready = poll(&pfd, 1, (int)((deadline - now + 999999) / 1000000));
+    if (ready < 0 && errno == EINTR)
+      continue;
+    if (ready <= 0)
+      continue;
+
+    // Oltre il buffer l'output si scarta, ma si continua a leggere per non bloccare il comando
+    char    discard[512];
+    bool    full  = length >= COLLECT_OUTPUT_LENGTH - 1;
+    ssize_t bytes = full ? read(pipe_fds[0], discard, sizeof(discard))
+                         : read(pipe_fds[0], output + length, COLLECT_OUTPUT_LENGTH - 1 - length);
+    if (bytes < 0 && errno == EINTR)
+      continue;
+    if (bytes <= 0)
+      break;
+    if (!full)
+      length += (size_t)bytes;
+  }
+  output[length] = '\0';
+  close(pipe_fds[0]);
+  while (waitpid(pid, NULL, 0) < 0 && errno == EINTR) {
+  }
+  return output;
+}
+
+/**
+ * Collector di un comando (lato worker)
+ */
+static inline void collect_command_job(void* context, struct latest* result) {
+  const struct collect_command* command = context;
+
+  uint64_t trace_start = trace_begin();
+  char*    output      = collect_run(command->line, command->timeout_ms);
+  trace_end(TRACE_SAMPLE, trace_start);
+
+  // Un comando che non parte pubblica l'output vuoto, così l'evento non resta in attesa
+  latest_put(result, output ? output : calloc(1, 1));
+}
+
+/**
+ * @return true se un percorso è in procfs o sysfs, che non notificano le modifiche a inotify e kqueue
+ */
+[[nodiscard]] static inline bool collect_virtual_path(const char* path) {
+  return strncmp(path, "/proc/", 6) == 0 || strncmp(path, "/sys/", 5) == 0;
+}
+
+/**
+ * Interpreta la parte destra di una sorgente: "file <percorso> [~ <regex>]"
+ * o "command <comando> [~ <regex>]"
+ *
+ * @return NULL in caso di successo, altrimenti il messaggio d'errore
+ */
+static inline const char* collect_parse_source(struct collect_config* config, struct collect_source* source, char* spec) {
+  char* pattern = strstr(spec, " ~ ");
+  if (pattern) {
+    *pattern = '\0';
+    pattern  = collect_trim(pattern + 3);
+  }
+
+  char* argument = spec;
+  while (*argument && !isspace((unsigned char)*argument))
+    argument++;
+  if (*argument)
+    *argument++ = '\0';
+  argument = collect_trim(argument);
+  if (!*argument)
+    return "sorgente senza argomento";
+
+  source->command = -1;
+  source->watch   = -1;
+  if (strcmp(spec, "file") == 0) {
+    source->kind = COLLECT_FILE;
+    // Solo procfs e sysfs seguono la radice delle fixture dei collettori Linux
+    bool prefixed = collect_virtual_path(argument) ? batch_path(source->path, sizeof(source->path), argument)
+                                                   : snprintf(source->path, sizeof(source->path), "%s", argument) < (int)sizeof(source->path);
+    if (!prefixed)
+      return "percorso troppo lungo";
+    source->watched = !collect_virtual_path(argument);
+  } else if (strcmp(spec, "command") == 0) {
+    source->kind = COLLECT_COMMAND;
+    for (int i = 0; i < config->command_count && source->command < 0; i++)
+      if (strcmp(config->commands[i].line, argument) == 0)
+        source->command = i;
+    if (source->command < 0) {
+      if (config->command_count == COLLECT_MAX_COMMANDS)
+        return "troppi comandi";
+      struct collect_command* command = &config->commands[config->command_count];
+      snprintf(command->line, sizeof(command->line), "%s", argument);
+      source->command = config->command_count++;
+    }
+  } else {
+    return "tipo di sorgente sconosciuto (file o command)";
+  }
+
+  if (pattern && *pattern) {
+    if (regcomp(&source->pattern, pattern, REG_EXTENDED | REG_NEWLINE) != 0)
+      return "espressione regolare non valida";
+    source->has_pattern = true;
+  }
+  return NULL;
+}
+
+/**
+ * Legge il file di configurazione.
+ *
+ * Formato, una direttiva per riga; '#' inizia un commento:
+ *
+ *   [battery_update]                       nome dell'evento
+ *   period    = 180                        secondi tra due letture (0 = solo su modifica)
+ *   on_change = yes                        pubblica solo se un valore è cambiato
+ *   timeout   = 5                          secondi concessi ai comandi
+ *   charge    = command pmset -g batt ~ ([0-9]+)%
+ *   status    = file /sys/class/power_supply/BAT0/status
+ *
+ * Ogni altra chiave è una sorgente, pubblicata con il proprio nome come
+ * variabile del trigger. I comandi sono l'ultima risorsa: un file viene letto
+ * senza processi figli.
+ *
+ * @param config Configurazione da riempire
+ * @param path Percorso del file
+ * @return true in caso di successo; gli errori sono scritti su stderr
+ */
+[[nodiscard]] static inline bool collect_load(struct collect_config* config, const char* path) {
+  memset(config, 0, sizeof(struct collect_config));
+
+  FILE* file = fopen(path, "r");
+  if (!file) {
+    fprintf(stderr, "%s: %s\n", path, strerror(errno));
+    return false;
+  }
+
+  char                  line[COLLECT_LINE_LENGTH];
+  int                   number = 0;
+  const char*           error  = NULL;
+  struct collect_event* event  = NULL;
+  while (!error && fgets(line, sizeof(line), file)) {
+    number++;
+    if (!strchr(line, '\n') && !feof(file)) {
+      error = "riga troppo lunga";
+      break;
+    }
+    // Un '#' a inizio riga o dopo uno spazio è un commento; nelle espressioni regolari resta valido
+    for (char* hash = strchr(line, '#'); hash; hash = strchr(hash + 1, '#')) {
+      if (hash == line || isspace((unsigned char)hash[-1])) {
+        *hash = '\0';
+        break;
+      }
+    }
+    char* text = collect_trim(line);
+    if (!*text)
+      continue;
+
+    if (*text == '[') {
+      char* end = strchr(text, ']');
+      if (!end || end == text + 1 || end[1] != '\0') {
+        error = "intestazione di evento non valida";
+      } else if (config->event_count == COLLECT_MAX_EVENTS) {
+        error = "troppi eventi";
+      } else {
+        *end  = '\0';
+        event = &config->events[config->event_count++];
+        // period è obbligatorio: -1 finché non viene indicato
+        *event = (struct collect_event){.period = -1, .timeout = COLLECT_DEFAULT_TIMEOUT, .on_change = true, .first = config->source_count};
+        snprintf(event->name, sizeof(event->name), "%s", text + 1);
+      }
+      continue;
+    }
+
+    char* equals = strchr(text, '=');
+    if (!event) {
+      error = "direttiva fuori da un evento";
+      continue;
+    }
+    if (!equals) {
+      error = "manca '='";
+      continue;
+    }
+    *equals     = '\0';
+    char* key   = collect_trim(text);
+    char* value = collect_trim(equals + 1);
+
+    if (strcmp(key, "period") == 0) {
+      event->period = strtod(value, NULL);
+      if (event->period < 0)
+        error = "periodo negativo";
+    } else if (strcmp(key, "timeout") == 0) {
+      event->timeout = strtod(value, NULL);
+      if (event->timeout <= 0)
+        error = "timeout non positivo";
+    } else if (strcmp(key, "on_change") == 0) {
+      event->on_change = strcmp(value, "yes") == 0 || strcmp(value, "true") == 0 || strcmp(value, "1") == 0;
+    } else if (config->source_count == COLLECT_MAX_SOURCES) {
+      error = "troppe sorgenti";
+    } else if (!*key || strlen(key) >= COLLECT_NAME_LENGTH || strpbrk(key, " \t'")) {
+      error = "nome di sorgente non valido";
+    } else {
+      struct collect_source* source = &config->sources[config->source_count];
+      *source                       = (struct collect_source){.event = config->event_count - 1, .file = {.fd = -1}};
+      snprintf(source->name, sizeof(source->name), "%s", key);
+      error = collect_parse_source(config, source, value);
+      if (!error) {
+        config->source_count++;
+        event->count++;
+      }
+    }
+  }
+  fclose(file);
+  if (error) {
+    fprintf(stderr, "%s:%d: %s\n", path, number, error);
+    return false;
+  }
+
+  for (int i = 0; !error && i < config->event_count; i++) {
+    struct collect_event* checked = &config->events[i];
+    bool                  watched = false;
+    for (int s = checked->first; s < checked->first + checked->count; s++)
+      watched |= config->sources[s].watched;
+
+    if (!checked->count) {
+      error = "evento senza sorgenti";
+    } else if (checked->period < 0) {
+      error = "evento senza period";
+    } else if (checked->period == 0 && !watched) {
+      error = "period = 0 richiede almeno un file osservabile (fuori da /proc e /sys)";
+    }
+    if (error) {
+      fprintf(stderr, "%s: [%s]: %s\n", path, checked->name, error);
+      return false;
+    }
+  }
+
+  // Un comando condiviso riceve il timeout più lungo tra gli eventi che lo usano
+  for (int s = 0; s < config->source_count; s++) {
+    struct collect_source* source = &config->sources[s];
+    if (source->kind != COLLECT_COMMAND)
+      continue;
+    int timeout_ms = (int)(config->events[source->event].timeout * 1000);
+    if (timeout_ms > config->commands[source->command].timeout_ms)
+      config->commands[source->command].timeout_ms = timeout_ms;
+  }
+  return true;
+}
+
+/**
+ * Libera le risorse di una configurazione
+ */
+static inline void collect_cleanup(struct collect_config* config) {
+  for (int s = 0; s < config->source_count; s++) {
+    batch_source_close(&config->sources[s].file);
+    if (config->sources[s].has_pattern)
+      regfree(&config->sources[s].pattern);
+  }
+}
+
+#endif /* COLLECT_H */
@@ -0,0 +1,204 @@
+#include "../cadence.h"
+#include "../sketchybar.h"
+#include "collect.h"
+#include "watch.h"
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const int MAX_MESSAGE_LENGTH = 4096;
+// Worker per i comandi: più comandi lenti non si bloccano a vicenda
+static const int COMMAND_THREADS = 2;
+
+static volatile sig_atomic_t g_terminate = 0;
+static volatile sig_atomic_t g_refresh   = 0;
+
+/**
+ * Mostra le istruzioni per l'uso del programma
+ */
+static void show_usage(const char* program_name) {
+  if (!program_name)
+    program_name = "sb_collect";
+  printf("Usage: %s \"<config>\" [--verbose]\n", program_name);
+  printf("  config: file con gli eventi e le loro sorgenti (vedi sb_collect.conf)\n");
+  printf("  SIGUSR1 rilegge subito tutti gli eventi, ad esempio al risveglio del sistema\n");
+}
+
+/**
+ * SIGINT/SIGTERM terminano, SIGUSR1 forza una lettura di tutti gli eventi
+ */
+static void signal_handler(int signum) {
+  if (signum == SIGUSR1)
+    g_refresh = 1;
+  else
+    g_terminate = 1;
+}
+
+/**
+ * Invia il trigger di un evento con i valori correnti delle sue sorgenti
+ */
+static void publish(struct collect_config* config, struct collect_event* event, bool verbose) {
+  uint64_t format_start = trace_begin();
+  char     message[MAX_MESSAGE_LENGTH];
+  int      length = snprintf(message, sizeof(message), "--trigger '%s'", event->name);
+  for (int s = event->first; s < event->first + event->count && length < (int)sizeof(message); s++) {
+    const struct collect_source* source = &config->sources[s];
+    length += snprintf(message + length, sizeof(message) - (size_t)length, " %s='%s'", source->name, source->value);
+  }
+  if (length >= (int)sizeof(message)) {
+    fprintf(stderr, "Messaggio troppo lungo per l'evento '%s', non inviato\n", event->name);
+    return;
+  }
+  trace_end(TRACE_FORMAT, format_start);
+
+  if (verbose)
+    fprintf(stderr, "%s\n", message);
+  sketchybar(message);
+  event->changed   = false;
+  event->published = true;
+}
+
+/**
+ * Pubblica un evento se la sua lettura è completa e c'è qualcosa da mostrare
+ */
+static void publish_if_ready(struct collect_config* config, struct collect_event* event, bool verbose) {
+  if (event->waiting) {
+    for (int s = event->first; s < event->first + event->count; s++) {
+      const struct collect_source* source = &config->sources[s];
+      if (source->kind == COLLECT_COMMAND && worker_job_busy(&config->commands[source->command].job))
+        return;
+    }
+    event->waiting = false;
+  }
+  if (event->changed || !event->published)
+    publish(config, event, verbose);
+}
+
+/**
+ * Legge un evento: i file subito, i comandi sul pool
+ *
+ * Un file osservato sostituito con un rename atomico viene riaperto e
+ * osservato di nuovo; un file mancante viene ricercato alla lettura
+ * successiva.
+ */
+static void collect_event(struct collect_config* config, int index, struct watcher* watcher, struct worker_pool* pool, uint64_t now) {
+  struct collect_event* event = &config->events[index];
+  bool                  retry = false;
+
+  uint64_t sample_start = trace_begin();
+  for (int s = event->first; s < event->first + event->count; s++) {
+    struct collect_source* source = &config->sources[s];
+    if (source->kind == COLLECT_COMMAND) {
+      worker_submit(pool, &config->commands[source->command].job);
+      event->waiting = true;
+      continue;
+    }
+
+    if (source->file.fd < 0 || collect_source_stale(source)) {
+      if (collect_source_open(source))
+        watcher_add(watcher, source);
+    }
+    event->changed |= collect_read_file(source, NULL);
+    retry |= source->file.fd < 0;
+  }
+  trace_end(TRACE_SAMPLE, sample_start);
+
+  // Gli eventi periodici cadono sulla griglia condivisa con gli altri provider
+  if (event->period > 0)
+    event->due_ns = cadence_next((uint64_t)(event->period * 1e9), now);
+  else
+    event->due_ns = retry ? now + (uint64_t)(COLLECT_RETRY_SECONDS * 1e9) : UINT64_MAX;
+
+  // Senza on_change ogni lettura completa produce un trigger
+  if (!event->on_change)
+    event->changed = true;
+}
+
+/**
+ * Consegna l'output dei comandi conclusi alle sorgenti che li usano
+ */
+static void apply_commands(struct collect_config* config) {
+  for (int c = 0; c < config->command_count; c++) {
+    char* output = latest_take(&config->commands[c].job.result);
+    if (!output)
+      continue;
+    for (int s = 0; s < config->source_count; s++) {
+      struct collect_source* source = &config->sources[s];
+      if (source->kind == COLLECT_COMMAND && source->command == c)
+        config->events[source->event].changed |= collect_store(source, output);
+    }
+    free(output);
+  }
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2 || (argc > 2 && strcmp(argv[2], "--verbose") != 0)) {
+    show_usage(argv[0]);
+    exit(1);
+  }
+  bool verbose = argc > 2;
+
+  static struct collect_config config;
+  if (!collect_load(&config, argv[1]))
+    return 1;
+
+  struct sigaction sa = {0};
+  sa.sa_handler       = signal_handler;
+  sigemptyset(&sa.sa_mask);
+  if (sigaction(SIGINT, &sa, NULL) < 0 || sigaction(SIGTERM, &sa, NULL) < 0 || sigaction(SIGUSR1, &sa, NULL) < 0) {
+    fprintf(stderr, "Avviso: impossibile impostare handler di segnali: %s\n", strerror(errno));
+    // Non è un errore critico, possiamo continuare
+  }
+
+  // Il pool serve anche senza comandi: la sua pipe di risveglio è il descrittore extra del watcher
+  static struct worker_pool pool;
+  struct watcher            watcher;
+  if (!worker_pool_start(&pool, COMMAND_THREADS) || !watcher_open(&watcher, pool.wake[0])) {
+    fprintf(stderr, "Errore: impossibile avviare il pool o il watcher: %s\n", strerror(errno));
+    return 1;
+  }
+  for (int c = 0; c < config.command_count; c++)
+    worker_job_init(&config.commands[c].job, collect_command_job, &config.commands[c], free);
+
+  char event_message[MAX_MESSAGE_LENGTH];
+  for (int e = 0; e < config.event_count; e++) {
+    snprintf(event_message, sizeof(event_message), "--add event '%s'", config.events[e].name);
+    sketchybar(event_message);
+  }
+
+  // Tutti gli eventi sono dovuti alla partenza, per popolare la barra
+  while (!g_terminate) {
+    uint64_t now = collect_now_ns();
+    if (g_refresh) {
+      g_refresh = 0;
+      for (int e = 0; e < config.event_count; e++)
+        config.events[e].due_ns = 0;
+    }
+
+    uint64_t next = UINT64_MAX;
+    for (int e = 0; e < config.event_count; e++) {
+      if (config.events[e].due_ns <= now)
+        collect_event(&config, e, &watcher, &pool, now);
+      if (config.events[e].due_ns < next)
+        next = config.events[e].due_ns;
+    }
+
+    apply_commands(&config);
+    for (int e = 0; e < config.event_count; e++)
+      publish_if_ready(&config, &config.events[e], verbose);
+
+    // Risveglio per una modifica, un comando concluso, la prossima lettura o un segnale
+    now            = collect_now_ns();
+    int timeout_ms = next == UINT64_MAX ? -1 : next <= now ? 0 : (int)((next - now + 999999) / 1000000);
+    watcher_wait(&watcher, &config, timeout_ms);
+  }
+
+  // Un comando ancora in corso usa la sua casella fino all'uscita del processo
+  for (int c = 0; c < config.command_count; c++)
+    if (!worker_job_busy(&config.commands[c].job))
+      latest_cleanup(&config.commands[c].job.result);
+  watcher_close(&watcher);
+  collect_cleanup(&config);
+  return 0;
+}
@@ -0,0 +1,146 @@
+#ifndef WATCH_H
+#define WATCH_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#ifdef __APPLE__
+#include <sys/event.h>
+#else
+#include <sys/inotify.h>
+#endif
+
+#include "collect.h"
+
+// Notifiche lette in un risveglio
+#define WATCH_BATCH 32
+
+/**
+ * Notifiche di modifica dei file sorgente, più un descrittore extra (il
+ * risveglio dei worker) atteso nello stesso punto.
+ *
+ * Su macOS è un kqueue con un filtro EVFILT_VNODE sul descrittore persistente
+ * di ogni file; chiudere il descrittore rimuove il filtro. Su Linux è un fd
+ * inotify con un watch per percorso: sorgenti sullo stesso file condividono
+ * lo stesso descrittore di watch. procfs e sysfs non generano notifiche, le
+ * loro sorgenti restano a periodo.
+ */
+struct watcher {
+  int fd;   // kqueue o inotify, -1 se non disponibile
+  int wake; // Descrittore extra atteso insieme alle notifiche
+};
+
+/**
+ * Apre il watcher
+ *
+ * @param watcher Watcher da inizializzare
+ * @param wake Descrittore da attendere insieme alle notifiche, ad esempio il risveglio del pool
+ * @return true in caso di successo
+ */
+[[nodiscard]] static inline bool watcher_open(struct watcher* watcher, int wake) {
+  watcher->wake = wake;
+#ifdef __APPLE__
+  watcher->fd = kqueue();
+  if (watcher->fd < 0)
+    return false;
+  fcntl(watcher->fd, F_SETFD, FD_CLOEXEC);
+
+  struct kevent change;
+  EV_SET(&change, wake, EVFILT_READ, EV_ADD, 0, 0, NULL);
+  return kevent(watcher->fd, &change, 1, NULL, 0, NULL) == 0;
+#else
+  watcher->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  return watcher->fd >= 0;
+#endif
+}
+
+/**
+ * Osserva il file aperto di una sorgente; da ripetere dopo ogni riapertura
+ *
+ * @return true se il file è osservato
+ */
+static inline bool watcher_add(struct watcher* watcher, struct collect_source* source) {
+  if (watcher->fd < 0 || !source->watched || source->file.fd < 0)
+    return false;
+#ifdef __APPLE__
+  struct kevent change;
+  EV_SET(&change, source->file.fd, EVFILT_VNODE, EV_ADD | EV_CLEAR,
+         NOTE_WRITE | NOTE_EXTEND | NOTE_ATTRIB | NOTE_LINK | NOTE_DELETE | NOTE_RENAME, 0, source);
+  return kevent(watcher->fd, &change, 1, NULL, 0, NULL) == 0;
+#else
+  // Il watch segue il percorso al momento della chiamata: dopo un rename atomico punta al nuovo file
+  source->watch = inotify_add_watch(watcher->fd, source->path, IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF);
+  return source->watch >= 0;
+#endif
+}
+
+/**
+ * Segna come da rileggere subito gli eventi delle sorgenti modificate
+ */
+static inline void watcher_touch(struct collect_config* config, struct collect_source* source) {
+  config->events[source->event].due_ns = 0;
+}
+
+/**
+ * Attende notifiche o il descrittore extra, fino al timeout
+ *
+ * Un segnale interrompe l'attesa. Le sorgenti modificate rendono dovuto il
+ * loro evento; il descrittore extra viene svuotato.
+ *
+ * @param timeout_ms Attesa massima in millisecondi, -1 = senza limite
+ */
+static inline void watcher_wait(struct watcher* watcher, struct collect_config* config, int timeout_ms) {
+  char drain[64];
+#ifdef __APPLE__
+  struct kevent   events[WATCH_BATCH];
+  struct timespec timeout = {.tv_sec = timeout_ms / 1000, .tv_nsec = (long)(timeout_ms % 1000) * 1000000L};
+  int             ready   = kevent(watcher->fd, NULL, 0, events, WATCH_BATCH, timeout_ms < 0 ? NULL : &timeout);
+  for (int i = 0; i < ready; i++) {
+    if (events[i].filter == EVFILT_READ) {
+      while (read(watcher->wake, drain, sizeof(drain)) > 0) {
+      }
+    } else if (events[i].filter == EVFILT_VNODE) {
+      watcher_touch(config, events[i].udata);
+    }
+  }
+#else
+  struct pollfd fds[2] = {{.fd = watcher->wake, .events = POLLIN}, {.fd = watcher->fd, .events = POLLIN}};
+  if (poll(fds, watcher->fd >= 0 ? 2 : 1, timeout_ms) <= 0)
+    return;
+
+  if (fds[0].revents & POLLIN) {
+    while (read(watcher->wake, drain, sizeof(drain)) > 0) {
+    }
+  }
+  if (watcher->fd < 0 || !(fds[1].revents & POLLIN))
+    return;
+
+  _Alignas(struct inotify_event) char buffer[WATCH_BATCH * (sizeof(struct inotify_event) + 256)];
+  ssize_t                             length;
+  while ((length = read(watcher->fd, buffer, sizeof(buffer))) > 0) {
+    for (ssize_t offset = 0; offset < length;) {
+      const struct inotify_event* event = (const struct inotify_event*)(buffer + offset);
+      for (int s = 0; s < config->source_count; s++) {
+        if (config->sources[s].watch == event->wd)
+          watcher_touch(config, &config->sources[s]);
+      }
+      offset += (ssize_t)(sizeof(struct inotify_event) + event->len);
+    }
+  }
+#endif
+}
+
+/**
+ * Chiude il watcher
+ */
+static inline void watcher_close(struct watcher* watcher) {
+  if (watcher->fd >= 0)
+    close(watcher->fd);
+  watcher->fd = -1;
+}
+
+#endif /* WATCH_H */
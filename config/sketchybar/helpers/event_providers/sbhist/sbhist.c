@@ -0,0 +1,404 @@
+#include "../history.h"
+#include <stdlib.h>
+
+// Intervalli mostrati se --step non è indicato
+static const int DEFAULT_BUCKETS = 300;
+
+/**
+ * Aggregato di un intervallo di downsampling
+ */
+struct bucket {
+  int64_t  start_ms;
+  uint64_t count;
+  double   sum[HISTORY_MAX_SERIES];
+  double   min[HISTORY_MAX_SERIES];
+  double   max[HISTORY_MAX_SERIES];
+};
+
+/**
+ * Contatori della scansione (--stats)
+ */
+struct scan_stats {
+  uint64_t partitions;
+  uint64_t blocks;
+  uint64_t skipped;    // Fuori intervallo, letto solo il riepilogo
+  uint64_t summarized; // Interi in un solo intervallo, aggregati dal riepilogo
+  uint64_t decoded;
+  uint64_t samples;
+};
+
+struct scan {
+  int64_t  from_ms;
+  int64_t  to_ms;
+  int64_t  step_ms; // 0 = campioni grezzi
+  int      series;
+  char     names[HISTORY_MAX_SERIES][HISTORY_NAME_LENGTH];
+  bool     header_printed;
+  struct bucket     bucket;
+  struct scan_stats stats;
+};
+
+/**
+ * Mostra le istruzioni per l'uso del programma
+ */
+static void show_usage(const char* program_name) {
+  if (!program_name)
+    program_name = "sbhist";
+  printf("Usage: %s <dir> [--from T] [--to T] [--step S] [--stats] | %s <dir> --info\n", program_name, program_name);
+  printf("  <dir>: directory scritta da un provider con --history\n");
+  printf("  T: secondi dall'epoch, AAAA-MM-GG[THH:MM] (UTC), now o relativo (-30m, -6h, -7d); default da -24h a now\n");
+  printf("  S: ampiezza degli intervalli (60, 5m, 1h, 1d) con media, minimo e massimo per serie;\n");
+  printf("     0 = campioni grezzi; default l'intervallo diviso in %d\n", DEFAULT_BUCKETS);
+  printf("  --stats: su stderr i blocchi saltati, aggregati dal riepilogo e decodificati\n");
+  printf("  --info: una riga per partizione con campioni e byte per campione\n");
+}
+
+/**
+ * Converte una durata (numero con unità s, m, h, d, w opzionale) in millisecondi
+ */
+[[nodiscard]] static bool parse_duration(const char* text, int64_t* ms) {
+  char*  end;
+  double value = strtod(text, &end);
+  if (end == text || value < 0)
+    return false;
+
+  double unit = 1000;
+  switch (*end) {
+  case '\0':
+  case 's':
+    break;
+  case 'm':
+    unit = 60e3;
+    break;
+  case 'h':
+    unit = 3600e3;
+    break;
+  case 'd':
+    unit = 86400e3;
+    break;
+  case 'w':
+    unit = 7 * 86400e3;
+    break;
+  default:
+    return false;
+  }
+  if (*end && end[1])
+    return false;
+  *ms = (int64_t)(value * unit);
+  return true;
+}
+
+/**
+ * Converte un istante assoluto o relativo a now in millisecondi dall'epoch
+ */
+[[nodiscard]] static bool parse_time(const char* text, int64_t now_ms, int64_t* ms) {
+  if (strcmp(text, "now") == 0) {
+    *ms = now_ms;
+    return true;
+  }
+
+  int64_t duration;
+  if (text[0] == '-' && parse_duration(text + 1, &duration)) {
+    *ms = now_ms - duration;
+    return true;
+  }
+
+  struct tm date = {0};
+  int       year, month, day, hour = 0, minute = 0;
+  int       fields = sscanf(text, "%4d-%2d-%2dT%2d:%2d", &year, &month, &day, &hour, &minute);
+  if (fields == 3 || fields == 5) {
+    date.tm_year = year - 1900;
+    date.tm_mon  = month - 1;
+    date.tm_mday = day;
+    date.tm_hour = hour;
+    date.tm_min  = minute;
+    *ms          = (int64_t)timegm(&date) * 1000;
+    return true;
+  }
+
+  char* end;
+  long long seconds = strtoll(text, &end, 10);
+  if (end == text || *end)
+    return false;
+  *ms = (int64_t)seconds * 1000;
+  return true;
+}
+
+/**
+ * Scrive un istante come ISO 8601 UTC
+ */
+static void print_time(int64_t ms, bool millis) {
+  time_t    seconds = (time_t)(ms / 1000);
+  struct tm date;
+  gmtime_r(&seconds, &date);
+  char text[32];
+  strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%S", &date);
+  if (millis)
+    printf("%s.%03dZ", text, (int)(ms % 1000));
+  else
+    printf("%sZ", text);
+}
+
+static void print_header(struct scan* scan) {
+  if (scan->header_printed)
+    return;
+  scan->header_printed = true;
+
+  printf("time");
+  if (scan->step_ms)
+    printf("\tcount");
+  for (int i = 0; i < scan->series; i++) {
+    if (scan->step_ms)
+      printf("\t%s_avg\t%s_min\t%s_max", scan->names[i], scan->names[i], scan->names[i]);
+    else
+      printf("\t%s", scan->names[i]);
+  }
+  printf("\n");
+}
+
+/**
+ * Scrive l'intervallo corrente, se ha campioni, e lo azzera
+ */
+static void flush_bucket(struct scan* scan) {
+  struct bucket* bucket = &scan->bucket;
+  if (!bucket->count)
+    return;
+
+  print_time(bucket->start_ms, false);
+  printf("\t%llu", (unsigned long long)bucket->count);
+  for (int i = 0; i < scan->series; i++)
+    printf("\t%.2f\t%.2f\t%.2f", bucket->sum[i] / (double)bucket->count, bucket->min[i], bucket->max[i]);
+  printf("\n");
+  bucket->count = 0;
+}
+
+/**
+ * Porta l'intervallo corrente su quello che contiene l'istante indicato
+ * (intervalli allineati ai multipli di step dall'epoch)
+ */
+static struct bucket* bucket_at(struct scan* scan, int64_t ms) {
+  int64_t start = ms - ms % scan->step_ms;
+  if (scan->bucket.count && scan->bucket.start_ms != start)
+    flush_bucket(scan);
+  scan->bucket.start_ms = start;
+  return &scan->bucket;
+}
+
+/**
+ * Aggiunge all'intervallo un aggregato (un campione o il riepilogo di un blocco)
+ */
+static void bucket_add(struct bucket* bucket, int series, uint64_t count, const double* sum, const double* min, const double* max) {
+  for (int i = 0; i < series; i++) {
+    if (!bucket->count || min[i] < bucket->min[i])
+      bucket->min[i] = min[i];
+    if (!bucket->count || max[i] > bucket->max[i])
+      bucket->max[i] = max[i];
+    bucket->sum[i] = (bucket->count ? bucket->sum[i] : 0) + sum[i];
+  }
+  bucket->count += count;
+}
+
+/**
+ * Legge un blocco: lo salta, lo aggrega dal riepilogo o lo decodifica
+ */
+static void scan_block(struct scan* scan, const struct history_block* block) {
+  scan->stats.blocks++;
+  if (!block->count || block->last_ms < scan->from_ms || block->first_ms > scan->to_ms) {
+    scan->stats.skipped++;
+    return;
+  }
+
+  if (scan->step_ms && block->first_ms >= scan->from_ms && block->last_ms <= scan->to_ms
+      && block->first_ms / scan->step_ms == block->last_ms / scan->step_ms) {
+    scan->stats.summarized++;
+    scan->stats.samples += block->count;
+    bucket_add(bucket_at(scan, block->first_ms), scan->series, block->count, block->sum, block->min, block->max);
+    return;
+  }
+
+  scan->stats.decoded++;
+  struct history_cursor cursor;
+  history_cursor_init(&cursor, block, scan->series);
+  int64_t ms;
+  double  values[HISTORY_MAX_SERIES];
+  while (history_cursor_next(&cursor, &ms, values)) {
+    if (ms < scan->from_ms || ms > scan->to_ms)
+      continue;
+    scan->stats.samples++;
+
+    if (scan->step_ms) {
+      bucket_add(bucket_at(scan, ms), scan->series, 1, values, values, values);
+    } else {
+      print_time(ms, true);
+      for (int i = 0; i < scan->series; i++)
+        printf("\t%.2f", values[i]);
+      printf("\n");
+    }
+  }
+}
+
+/**
+ * Mappa in sola lettura la partizione di un giorno
+ *
+ * @return L'intestazione, NULL se la partizione manca o non è valida
+ */
+[[nodiscard]] static const struct history_header* map_partition(const char* dir, int64_t day_ms, size_t* size) {
+  char path[HISTORY_PATH_LENGTH + 32];
+  if (!history_partition_path(path, sizeof(path), dir, day_ms))
+    return NULL;
+
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return NULL;
+
+  struct stat st;
+  void*       map = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && (size_t)st.st_size >= HISTORY_BLOCK_SIZE)
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+    return NULL;
+
+  const struct history_header* header = map;
+  if (!history_header_valid(header)) {
+    fprintf(stderr, "Partizione %s non valida, ignorata\n", path);
+    munmap(map, (size_t)st.st_size);
+    return NULL;
+  }
+  *size = (size_t)st.st_size;
+  return header;
+}
+
+/**
+ * Blocchi di una partizione che stanno per intero nel file
+ */
+[[nodiscard]] static uint32_t partition_blocks(const struct history_header* header, size_t size) {
+  uint32_t available = (uint32_t)(size / HISTORY_BLOCK_SIZE) - 1;
+  return header->blocks < available ? header->blocks : available;
+}
+
+/**
+ * --info: una riga per partizione dell'intervallo
+ */
+static void print_info(const char* dir, int64_t from_ms, int64_t to_ms) {
+  printf("partition\tseries\tblocks\tsamples\tbytes\tbytes_per_sample\tfirst\tlast\n");
+  for (int64_t day = history_day_start(from_ms); day <= to_ms; day += HISTORY_DAY_MS) {
+    size_t                       size;
+    const struct history_header* header = map_partition(dir, day, &size);
+    if (!header)
+      continue;
+
+    uint64_t samples = 0, bytes = 0;
+    int64_t  first = 0, last = 0;
+    uint32_t blocks = partition_blocks(header, size);
+    for (uint32_t b = 1; b <= blocks; b++) {
+      const struct history_block* block = (const void*)((const uint8_t*)header + (size_t)b * HISTORY_BLOCK_SIZE);
+      if (!block->count)
+        continue;
+      if (!samples)
+        first = block->first_ms;
+      last = block->last_ms;
+      samples += block->count;
+      bytes += sizeof(struct history_block) + (block->bits + 7) / 8;
+    }
+
+    char name[16];
+    time_t    seconds = (time_t)(day / 1000);
+    struct tm date;
+    gmtime_r(&seconds, &date);
+    strftime(name, sizeof(name), "%Y-%m-%d", &date);
+    printf("%s\t", name);
+    for (uint32_t i = 0; i < header->series; i++)
+      printf("%s%.*s", i ? "," : "", HISTORY_NAME_LENGTH, header->names[i]);
+    printf("\t%u\t%llu\t%llu\t%.2f\t", blocks, (unsigned long long)samples, (unsigned long long)bytes,
+           samples ? (double)bytes / (double)samples : 0.0);
+    print_time(first, false);
+    printf("\t");
+    print_time(last, false);
+    printf("\n");
+    munmap((void*)header, size);
+  }
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2 || argv[1][0] == '-') {
+    show_usage(argv[0]);
+    return 1;
+  }
+
+  const char* dir    = argv[1];
+  int64_t     now_ms = history_now_ms();
+  struct scan scan   = {.from_ms = now_ms - HISTORY_DAY_MS, .to_ms = now_ms, .step_ms = -1};
+  bool        info = false, stats = false;
+
+  for (int i = 2; i < argc; i++) {
+    bool valid = true;
+    if (strcmp(argv[i], "--from") == 0 && i + 1 < argc)
+      valid = parse_time(argv[++i], now_ms, &scan.from_ms);
+    else if (strcmp(argv[i], "--to") == 0 && i + 1 < argc)
+      valid = parse_time(argv[++i], now_ms, &scan.to_ms);
+    else if (strcmp(argv[i], "--step") == 0 && i + 1 < argc)
+      valid = parse_duration(argv[++i], &scan.step_ms);
+    else if (strcmp(argv[i], "--info") == 0)
+      info = true;
+    else if (strcmp(argv[i], "--stats") == 0)
+      stats = true;
+    else
+      valid = false;
+
+    if (!valid) {
+      show_usage(argv[0]);
+      return 1;
+    }
+  }
+  if (scan.from_ms > scan.to_ms) {
+    fprintf(stderr, "L'inizio dell'intervallo segue la fine\n");
+    return 1;
+  }
+
+  if (info) {
+    print_info(dir, scan.from_ms, scan.to_ms);
+    return 0;
+  }
+
+  if (scan.step_ms < 0) {
+    scan.step_ms = (scan.to_ms - scan.from_ms) / DEFAULT_BUCKETS;
+    scan.step_ms = scan.step_ms < 1000 ? 1000 : scan.step_ms / 1000 * 1000;
+  }
+
+  // Solo le partizioni dei giorni dell'intervallo, e di queste solo i blocchi che lo intersecano
+  for (int64_t day = history_day_start(scan.from_ms); day <= scan.to_ms; day += HISTORY_DAY_MS) {
+    size_t                       size;
+    const struct history_header* header = map_partition(dir, day, &size);
+    if (!header)
+      continue;
+
+    if (!scan.series) {
+      scan.series = (int)header->series;
+      memcpy(scan.names, header->names, sizeof(scan.names));
+      for (int i = 0; i < scan.series; i++)
+        scan.names[i][HISTORY_NAME_LENGTH - 1] = '\0';
+      print_header(&scan);
+    }
+    if (header->series != (uint32_t)scan.series) {
+      fprintf(stderr, "Partizione con serie diverse, ignorata\n");
+      munmap((void*)header, size);
+      continue;
+    }
+
+    scan.stats.partitions++;
+    uint32_t blocks = partition_blocks(header, size);
+    for (uint32_t b = 1; b <= blocks; b++)
+      scan_block(&scan, (const void*)((const uint8_t*)header + (size_t)b * HISTORY_BLOCK_SIZE));
+    munmap((void*)header, size);
+  }
+  if (scan.step_ms)
+    flush_bucket(&scan);
+
+  if (stats) {
+    fprintf(stderr, "partizioni %llu, blocchi %llu: %llu saltati, %llu dal riepilogo, %llu decodificati; campioni %llu\n",
+            (unsigned long long)scan.stats.partitions, (unsigned long long)scan.stats.blocks, (unsigned long long)scan.stats.skipped,
+            (unsigned long long)scan.stats.summarized, (unsigned long long)scan.stats.decoded, (unsigned long long)scan.stats.samples);
+  }
+  return 0;
+}
@@ -1,19 +1,32 @@
 #ifndef SKETCHYBAR_H
 #define SKETCHYBAR_H
 
+#ifdef __APPLE__
 #include <bootstrap.h>
 #include <mach/arm/kern_return.h>
 #include <mach/mach.h>
 #include <mach/mach_port.h>
 #include <mach/message.h>
+#endif
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "trace.h"
 
 typedef char* env;
 
+#ifdef __APPLE__
+
 #define MACH_HANDLER(name) void name(env env)
 typedef MACH_HANDLER(mach_handler);
 
@@ -28,14 +41,13 @@ struct mach_buffer {
   mach_msg_trailer_t  trailer;
 };
 
-static mach_port_t g_mach_port = 0;
-
 /**
- * Ottiene la porta bootstrap per la comunicazione con sketchybar
+ * Ottiene la porta bootstrap di una barra
  *
+ * @param name Nome della barra (BAR_NAME), il servizio è "git.felix.<name>"
  * @return La porta mach, 0 se fallisce
  */
-[[nodiscard]] static inline mach_port_t mach_get_bs_port() {
+[[nodiscard]] static inline mach_port_t mach_get_bs_port(const char* name) {
   mach_port_name_t task = mach_task_self();
 
   mach_port_t bs_port;
@@ -43,10 +55,6 @@ static mach_port_t g_mach_port = 0;
     return 0;
   }
 
-  const char* name = getenv("BAR_NAME");
-  if (!name)
-    name = "sketchybar";
-
   size_t name_len = strlen(name);
   // Verifica overflow
   if (name_len > 256) {
@@ -75,11 +83,12 @@ static mach_port_t g_mach_port = 0;
  * @param port Porta mach di destinazione
  * @param message Messaggio da inviare
  * @param len Lunghezza del messaggio
- * @return true se l'invio ha avuto successo, false altrimenti
+ * @param timeout Attesa massima in millisecondi, MACH_MSG_TIMEOUT_NONE per bloccare
+ * @return KERN_SUCCESS, MACH_SEND_TIMED_OUT se la barra non ha svuotato la coda in tempo, altrimenti un errore
  */
-[[nodiscard]] static inline bool mach_send_message(mach_port_t port, char* message, uint32_t len) {
+[[nodiscard]] static inline kern_return_t mach_send_message(mach_port_t port, char* message, uint32_t len, mach_msg_timeout_t timeout) {
   if (!message || !port || len == 0) {
-    return false;
+    return KERN_INVALID_ARGUMENT;
   }
 
   struct mach_message msg     = {0}; // Zero-inizializzazione usando C23
@@ -97,13 +106,15 @@ static mach_port_t g_mach_port = 0;
   msg.descriptor.deallocate = false;
   msg.descriptor.type       = MACH_MSG_OOL_DESCRIPTOR;
 
-  kern_return_t err = mach_msg(
-      &msg.header, MACH_SEND_MSG, sizeof(struct mach_message), 0, MACH_PORT_NULL,
-      MACH_MSG_TIMEOUT_NONE, MACH_PORT_NULL);
+  mach_msg_option_t options = MACH_SEND_MSG;
+  if (timeout != MACH_MSG_TIMEOUT_NONE)
+    options |= MACH_SEND_TIMEOUT;
 
-  return err == KERN_SUCCESS;
+  return mach_msg(&msg.header, options, sizeof(struct mach_message), 0, MACH_PORT_NULL, timeout, MACH_PORT_NULL);
 }
 
+#endif /* __APPLE__ */
+
 /**
  * Formatta un messaggio per sketchybar, gestendo correttamente le virgolette
  *
@@ -158,32 +169,651 @@ format_message(const char* message, char* formatted_message, size_t buffer_size)
 }
 
 /**
- * Invia un messaggio a sketchybar
+ * Esito di un invio verso la barra
+ */
+enum sketchybar_result {
+  SKETCHYBAR_SENT,      // Messaggio consegnato
+  SKETCHYBAR_TIMED_OUT, // La barra non ha accettato il messaggio entro il timeout
+  SKETCHYBAR_NO_BAR,    // Nessuna barra in ascolto
+};
+
+// --- Modalità dormiente ---
+
+// Backoff esponenziale tra due tentativi di ritrovare la barra
+#define SKETCHYBAR_PROBE_MIN_MS 250
+#define SKETCHYBAR_PROBE_MAX_MS 30000
+// Registrazioni "--add event" ripetute a ogni riconnessione
+#define SKETCHYBAR_MAX_REGISTRATIONS 8
+
+/**
+ * Stato della connessione con la barra.
  *
- * @param message Messaggio da inviare
+ * Se la barra sparisce (riavvio, crash) il provider non esce: resta
+ * dormiente dentro sketchybar(), quindi smette di campionare, e riprova a
+ * trovarla con un backoff esponenziale. Quando la barra torna ripete le
+ * registrazioni degli eventi e riprende con lo stato intatto (finestre
+ * mobili, contatori, cache dei processi), senza la partenza a freddo.
  */
-static inline void sketchybar(const char* message) {
-  if (!message)
+struct sketchybar_session {
+  pthread_mutex_t lock; // Protegge le registrazioni e l'attesa sul risveglio
+  pthread_cond_t  awake;
+  _Atomic bool    dormant;
+  uint64_t        reconnects;
+  int             registration_count;
+  char*           registrations[SKETCHYBAR_MAX_REGISTRATIONS];
+};
+
+static struct sketchybar_session g_sketchybar_session = {
+    .lock  = PTHREAD_MUTEX_INITIALIZER,
+    .awake = PTHREAD_COND_INITIALIZER,
+};
+
+/**
+ * Ricorda un messaggio "--add event" per ripeterlo alla riconnessione
+ *
+ * @param message Messaggio inviato dal provider
+ */
+static inline void sketchybar_remember(const char* message) {
+  if (strncmp(message, "--add event ", 12) != 0)
     return;
 
+  struct sketchybar_session* session = &g_sketchybar_session;
+  pthread_mutex_lock(&session->lock);
+  bool known = false;
+  for (int i = 0; i < session->registration_count && !known; i++)
+    known = strcmp(session->registrations[i], message) == 0;
+
+  if (!known && session->registration_count < SKETCHYBAR_MAX_REGISTRATIONS) {
+    char* copy = strdup(message);
+    if (copy)
+      session->registrations[session->registration_count++] = copy;
+  }
+  pthread_mutex_unlock(&session->lock);
+}
+
+/**
+ * @return true se il messaggio è una registrazione ricordata da sketchybar_remember
+ */
+[[nodiscard]] static inline bool sketchybar_remembered(const char* message) {
+  if (strncmp(message, "--add event ", 12) != 0)
+    return false;
+
+  struct sketchybar_session* session = &g_sketchybar_session;
+  pthread_mutex_lock(&session->lock);
+  bool known = false;
+  for (int i = 0; i < session->registration_count && !known; i++)
+    known = strcmp(session->registrations[i], message) == 0;
+  pthread_mutex_unlock(&session->lock);
+  return known;
+}
+
+#ifdef __APPLE__
+// --- Più barre ---
+
+// Barre servite da un solo provider
+#define SKETCHYBAR_MAX_BARS 8
+// Lunghezza massima del nome di una barra
+#define SKETCHYBAR_BAR_NAME_LENGTH 256
+// Attesa massima per barra negli invii sincroni con più barre
+#define SKETCHYBAR_BAR_TIMEOUT_MS 250
+
+/**
+ * Una barra destinataria, con la sua porta in cache
+ */
+struct sketchybar_bar {
+  char        name[SKETCHYBAR_BAR_NAME_LENGTH + 1];
+  mach_port_t port;       // 0 finché la barra non è raggiungibile
+  uint64_t    retry_ns;   // Istante della prossima ricerca della porta
+  int         backoff_ms; // Attesa prima della ricerca successiva
+};
+
+/**
+ * Barre a cui il provider invia ogni messaggio.
+ *
+ * BAR_NAME accetta un elenco separato da virgole (ad esempio
+ * "sketchybar,esterno" con una barra per monitor): il provider campiona e
+ * formatta una volta sola e invia lo stesso messaggio codificato a ogni
+ * porta. Le barre sono indipendenti: una barra morta viene cercata di nuovo
+ * con il suo backoff senza fermare le altre, e una barra bloccata costa al
+ * più il timeout d'invio. Il provider diventa dormiente solo quando non ne
+ * resta nessuna. Usato solo dal thread che invia (quello di campionamento,
+ * o il mittente in modalità asincrona).
+ */
+struct sketchybar_bars {
+  int                   count; // -1 finché BAR_NAME non è stato letto
+  struct sketchybar_bar bars[SKETCHYBAR_MAX_BARS];
+};
+
+static struct sketchybar_bars g_sketchybar_bars = {.count = -1};
+
+/**
+ * Legge l'elenco delle barre da BAR_NAME al primo uso
+ */
+[[nodiscard]] static inline struct sketchybar_bars* sketchybar_bars() {
+  struct sketchybar_bars* bars = &g_sketchybar_bars;
+  if (bars->count >= 0)
+    return bars;
+
+  bars->count       = 0;
+  const char* names = getenv("BAR_NAME");
+  if (!names || !*names)
+    names = "sketchybar";
+
+  for (const char* cursor = names; *cursor;) {
+    cursor += strspn(cursor, ", \t");
+    size_t length = strcspn(cursor, ", \t");
+    if (!length)
+      break;
+
+    if (length > SKETCHYBAR_BAR_NAME_LENGTH) {
+      fprintf(stderr, "Nome della barra troppo lungo\n");
+    } else if (bars->count == SKETCHYBAR_MAX_BARS) {
+      fprintf(stderr, "Troppe barre in BAR_NAME, ignoro %.*s\n", (int)length, cursor);
+    } else {
+      struct sketchybar_bar* bar = &bars->bars[bars->count++];
+      memcpy(bar->name, cursor, length);
+      bar->name[length] = '\0';
+      bar->backoff_ms   = SKETCHYBAR_PROBE_MIN_MS;
+    }
+    cursor += length;
+  }
+  return bars;
+}
+
+/**
+ * Rilascia la porta di una barra che non risponde più e pianifica la
+ * prossima ricerca con il suo backoff
+ */
+static inline void sketchybar_bar_drop(struct sketchybar_bar* bar) {
+  if (bar->port)
+    mach_port_deallocate(mach_task_self(), bar->port);
+  bar->port     = 0;
+  bar->retry_ns = trace_now() + (uint64_t)bar->backoff_ms * 1000000ull;
+  bar->backoff_ms *= 2;
+  if (bar->backoff_ms > SKETCHYBAR_PROBE_MAX_MS)
+    bar->backoff_ms = SKETCHYBAR_PROBE_MAX_MS;
+}
+
+/**
+ * Codifica e invia un messaggio a una sola barra
+ */
+[[nodiscard]] static inline kern_return_t sketchybar_bar_post(struct sketchybar_bar* bar, const char* message, mach_msg_timeout_t timeout) {
+  size_t   buffer_size = strlen(message) + 2;
+  char     formatted_message[buffer_size];
+  uint32_t length = format_message(message, formatted_message, buffer_size);
+  return length ? mach_send_message(bar->port, formatted_message, length, timeout) : KERN_SUCCESS;
+}
+
+/**
+ * Cerca la porta di una barra e le ripete le registrazioni ricordate
+ *
+ * @param bar Barra senza porta
+ * @param timeout Attesa massima di ogni registrazione
+ * @return true se la barra è raggiungibile e registrata
+ */
+[[nodiscard]] static inline bool sketchybar_bar_connect(struct sketchybar_bar* bar, mach_msg_timeout_t timeout) {
+  bar->port       = mach_get_bs_port(bar->name);
+  bool registered = bar->port != 0;
+
+  if (registered) {
+    struct sketchybar_session* session = &g_sketchybar_session;
+    pthread_mutex_lock(&session->lock);
+    for (int i = 0; i < session->registration_count && registered; i++)
+      registered = sketchybar_bar_post(bar, session->registrations[i], timeout) == KERN_SUCCESS;
+    pthread_mutex_unlock(&session->lock);
+  }
+
+  if (!registered) {
+    sketchybar_bar_drop(bar);
+    return false;
+  }
+  bar->backoff_ms = SKETCHYBAR_PROBE_MIN_MS;
+  return true;
+}
+
+/**
+ * Attesa d'invio per ogni barra: con una sola barra quella richiesta, con
+ * più barre mai illimitata, così una barra bloccata non ferma le altre
+ */
+[[nodiscard]] static inline mach_msg_timeout_t sketchybar_bar_timeout(const struct sketchybar_bars* bars, int timeout_ms) {
+  if (timeout_ms < 0 && bars->count > 1)
+    timeout_ms = SKETCHYBAR_BAR_TIMEOUT_MS;
+  return timeout_ms < 0 ? MACH_MSG_TIMEOUT_NONE : (mach_msg_timeout_t)timeout_ms;
+}
+
+/**
+ * Invia un messaggio a tutte le barre sulle rispettive porte mach
+ *
+ * Il messaggio è codificato una volta sola. Una barra senza porta viene
+ * cercata di nuovo quando scade il suo backoff; una porta che rifiuta il
+ * messaggio viene sostituita subito una volta, come con una barra sola.
+ *
+ * @param message Messaggio da inviare
+ * @param timeout_ms Attesa massima per barra in millisecondi, negativo per bloccare (o SKETCHYBAR_BAR_TIMEOUT_MS con più barre)
+ * @return SKETCHYBAR_SENT se almeno una barra l'ha ricevuto, SKETCHYBAR_NO_BAR se nessuna è raggiungibile
+ */
+[[nodiscard]] static inline enum sketchybar_result sketchybar_send(const char* message, int timeout_ms) {
+  struct sketchybar_bars* bars = sketchybar_bars();
+
   // Alloca buffer sufficientemente grande
   size_t buffer_size = strlen(message) + 2;
   char   formatted_message[buffer_size];
 
-  uint32_t length = format_message(message, formatted_message, buffer_size);
+  uint64_t trace_start = trace_begin();
+  uint32_t length      = format_message(message, formatted_message, buffer_size);
+  trace_end(TRACE_ENCODE, trace_start);
   if (!length)
+    return SKETCHYBAR_SENT;
+
+  mach_msg_timeout_t timeout = sketchybar_bar_timeout(bars, timeout_ms);
+  // Una barra appena (ri)collegata ha già ricevuto le registrazioni ricordate
+  bool registration = sketchybar_remembered(message);
+  int  sent = 0, timed_out = 0;
+  trace_start = trace_begin();
+
+  for (int i = 0; i < bars->count; i++) {
+    struct sketchybar_bar* bar   = &bars->bars[i];
+    bool                   fresh = false;
+    if (!bar->port) {
+      if (trace_now() < bar->retry_ns || !sketchybar_bar_connect(bar, timeout))
+        continue;
+      fresh = true;
+    }
+
+    kern_return_t err = fresh && registration ? KERN_SUCCESS : mach_send_message(bar->port, formatted_message, length, timeout);
+    if (err != KERN_SUCCESS && err != MACH_SEND_TIMED_OUT && !fresh) {
+      // Riprova a ottenere la porta
+      mach_port_deallocate(mach_task_self(), bar->port);
+      if (sketchybar_bar_connect(bar, timeout))
+        err = registration ? KERN_SUCCESS : mach_send_message(bar->port, formatted_message, length, timeout);
+    }
+
+    if (err == KERN_SUCCESS)
+      sent++;
+    else if (err == MACH_SEND_TIMED_OUT)
+      timed_out++;
+    else if (bar->port)
+      sketchybar_bar_drop(bar);
+  }
+  trace_end(TRACE_IPC, trace_start);
+
+  if (sent)
+    return SKETCHYBAR_SENT;
+  return timed_out ? SKETCHYBAR_TIMED_OUT : SKETCHYBAR_NO_BAR;
+}
+#else
+/**
+ * Senza sketchybar (Linux) il comando viene scritto su stdout, una riga per
+ * messaggio, così da poterlo inoltrare a qualunque barra o ispezionarlo.
+ * BAR_NAME non si applica: c'è un solo lettore, che può inoltrare a più barre.
+ *
+ * @param message Messaggio da inviare
+ * @param timeout_ms Attesa massima della pipe in millisecondi, negativo per bloccare
+ * @return Esito dell'invio
+ */
+[[nodiscard]] static inline enum sketchybar_result sketchybar_send(const char* message, int timeout_ms) {
+  uint64_t               trace_start = trace_begin();
+  enum sketchybar_result result      = SKETCHYBAR_SENT;
+
+  struct pollfd pfd = {.fd = STDOUT_FILENO, .events = POLLOUT};
+  if (timeout_ms >= 0 && poll(&pfd, 1, timeout_ms) == 0) {
+    result = SKETCHYBAR_TIMED_OUT;
+  } else if (puts(message) < 0 || fflush(stdout) != 0) {
+    // Il lettore ha chiuso la pipe, come se la barra non fosse più attiva
+    result = SKETCHYBAR_NO_BAR;
+  }
+
+  trace_end(TRACE_IPC, trace_start);
+  return result;
+}
+#endif /* __APPLE__ */
+
+/**
+ * Attende, senza campionare, che almeno una barra torni raggiungibile
+ *
+ * Riprova con un intervallo che raddoppia da SKETCHYBAR_PROBE_MIN_MS a
+ * SKETCHYBAR_PROBE_MAX_MS, cercando tutte le barre di BAR_NAME; una barra è
+ * tornata quando tutte le registrazioni ricordate le sono state ripetute con
+ * successo. Le altre vengono ritrovate in seguito da sketchybar_send. Su
+ * Linux la "barra" è il lettore di stdout: una pipe chiusa non si riapre,
+ * quindi non c'è nulla da attendere.
+ *
+ * @return true quando la connessione è ripristinata, false se non è possibile
+ */
+[[nodiscard]] static inline bool sketchybar_reconnect() {
+#ifdef __APPLE__
+  struct sketchybar_session* session = &g_sketchybar_session;
+  struct sketchybar_bars*    bars    = sketchybar_bars();
+  mach_msg_timeout_t         timeout = sketchybar_bar_timeout(bars, -1);
+  atomic_store(&session->dormant, true);
+  fprintf(stderr, "Barra non raggiungibile, provider dormiente\n");
+
+  for (int delay_ms = SKETCHYBAR_PROBE_MIN_MS;; delay_ms = delay_ms * 2 > SKETCHYBAR_PROBE_MAX_MS ? SKETCHYBAR_PROBE_MAX_MS : delay_ms * 2) {
+    struct timespec ts = {.tv_sec = delay_ms / 1000, .tv_nsec = (long)(delay_ms % 1000) * 1000000L};
+    while (nanosleep(&ts, &ts) < 0 && errno == EINTR) {
+    }
+
+    bool connected = false;
+    for (int i = 0; i < bars->count; i++) {
+      // La porta della barra precedente è morta: rilascia il nome prima di cercarne una nuova
+      if (bars->bars[i].port)
+        sketchybar_bar_drop(&bars->bars[i]);
+      connected |= sketchybar_bar_connect(&bars->bars[i], timeout);
+    }
+    if (!connected)
+      continue;
+
+    pthread_mutex_lock(&session->lock);
+    session->reconnects++;
+    atomic_store(&session->dormant, false);
+    pthread_cond_broadcast(&session->awake);
+    pthread_mutex_unlock(&session->lock);
+    fprintf(stderr, "Barra di nuovo raggiungibile, riprendo\n");
+    return true;
+  }
+#else
+  return false;
+#endif
+}
+
+/**
+ * Blocca il chiamante finché la sessione è dormiente (usata dal produttore
+ * in modalità asincrona, mentre il thread mittente cerca la barra)
+ */
+static inline void sketchybar_wait_awake() {
+  struct sketchybar_session* session = &g_sketchybar_session;
+  if (!atomic_load_explicit(&session->dormant, memory_order_acquire))
     return;
 
-  if (!g_mach_port)
-    g_mach_port = mach_get_bs_port();
+  pthread_mutex_lock(&session->lock);
+  while (atomic_load(&session->dormant))
+    pthread_cond_wait(&session->awake, &session->lock);
+  pthread_mutex_unlock(&session->lock);
+}
+
+// --- Invio asincrono ---
+
+// Messaggi in coda (potenza di 2) e chiavi con un messaggio in attesa a coda piena
+#define SKETCHYBAR_ASYNC_CAPACITY 64
+#define SKETCHYBAR_ASYNC_MAILBOXES 32
+
+/**
+ * Contatori esportati dalla modalità asincrona
+ */
+struct sketchybar_stats {
+  uint64_t queued;     // Messaggi accettati da sketchybar()
+  uint64_t sent;       // Messaggi consegnati alla barra
+  uint64_t superseded; // Messaggi sostituiti da uno più recente con la stessa chiave prima dell'invio
+  uint64_t dropped;    // Messaggi persi: coda e caselle piene, o timeout d'invio
+};
+
+/**
+ * Modalità asincrona: sketchybar() non fa IPC ma accoda il messaggio in una
+ * coda SPSC lock-free, e un thread dedicato lo invia con un timeout.
+ *
+ * Il produttore è il thread di campionamento, l'unico che può chiamare
+ * sketchybar() in questa modalità; non blocca mai e non prende lock. A coda
+ * piena vale l'ultimo valore: il messaggio va nella casella della sua chiave
+ * ("--trigger <evento>", "--set <item>" o l'intero comando) e sostituisce
+ * quello che vi era ancora in attesa. Finché una chiave ha una casella piena
+ * anche i messaggi successivi vi passano, così il mittente non invia mai un
+ * valore più vecchio dopo uno più nuovo.
+ */
+struct sketchybar_async {
+  bool     enabled;
+  int      timeout_ms;
+  uint32_t mask;
+
+  char**           ring; // Messaggi allocati dal produttore e liberati dal mittente
+  _Atomic uint32_t head; // Avanzato dal mittente
+  _Atomic uint32_t tail; // Avanzato dal produttore
+
+  uint64_t       keys[SKETCHYBAR_ASYNC_MAILBOXES]; // Solo produttore, 0 = libera
+  _Atomic(char*) mailboxes[SKETCHYBAR_ASYNC_MAILBOXES];
 
-  if (!mach_send_message(g_mach_port, formatted_message, length)) {
-    g_mach_port = mach_get_bs_port(); // Riprova a ottenere la porta
-    if (!mach_send_message(g_mach_port, formatted_message, length)) {
-      // No sketchybar instance running, exit.
-      exit(0);
+  int       wake[2]; // Pipe di risveglio, scrittura non bloccante
+  pthread_t thread;
+
+  _Atomic uint64_t queued;
+  _Atomic uint64_t sent;
+  _Atomic uint64_t superseded;
+  _Atomic uint64_t dropped;
+};
+
+static struct sketchybar_async g_sketchybar_async = {.wake = {-1, -1}};
+
+/**
+ * Chiave di coalescenza di un messaggio: le prime due parole (comando e
+ * destinatario) per --trigger e --set, altrimenti l'intero messaggio
+ */
+[[nodiscard]] static inline uint64_t sketchybar_message_key(const char* message) {
+  bool coalesce = strncmp(message, "--trigger ", 10) == 0 || strncmp(message, "--set ", 6) == 0;
+
+  // FNV-1a
+  uint64_t hash   = 1469598103934665603ull;
+  int      spaces = 0;
+  for (const char* c = message; *c; c++) {
+    if (*c == ' ' && coalesce && ++spaces == 2)
+      break;
+    hash = (hash ^ (uint8_t)*c) * 1099511628211ull;
+  }
+  return hash ? hash : 1;
+}
+
+/**
+ * Consegna un messaggio preso dalla coda e lo libera
+ */
+static inline void sketchybar_async_deliver(struct sketchybar_async* async, char* packet) {
+  enum sketchybar_result result = sketchybar_send(packet, async->timeout_ms);
+  while (result == SKETCHYBAR_NO_BAR) {
+    // Il produttore si ferma in sketchybar() finché la barra non torna
+    if (!sketchybar_reconnect())
+      exit(0); // No sketchybar instance running, exit.
+    result = sketchybar_send(packet, async->timeout_ms);
+  }
+  free(packet);
+
+  atomic_fetch_add_explicit(result == SKETCHYBAR_SENT ? &async->sent : &async->dropped, 1, memory_order_relaxed);
+}
+
+/**
+ * Thread mittente: svuota la coda nell'ordine, poi le caselle, e dorme sulla
+ * pipe di risveglio quando non c'è nulla da inviare
+ */
+static inline void* sketchybar_async_sender(void* argument) {
+  struct sketchybar_async* async = argument;
+  trace_name_thread("sender");
+
+  for (;;) {
+    bool delivered = false;
+
+    uint32_t head = atomic_load_explicit(&async->head, memory_order_relaxed);
+    while (head != atomic_load_explicit(&async->tail, memory_order_acquire)) {
+      char* packet = async->ring[head & async->mask];
+      atomic_store_explicit(&async->head, ++head, memory_order_release);
+      sketchybar_async_deliver(async, packet);
+      delivered = true;
+    }
+
+    for (int i = 0; i < SKETCHYBAR_ASYNC_MAILBOXES; i++) {
+      char* packet = atomic_exchange_explicit(&async->mailboxes[i], NULL, memory_order_acquire);
+      if (packet) {
+        sketchybar_async_deliver(async, packet);
+        delivered = true;
+      }
+    }
+
+    if (delivered)
+      continue;
+
+    // Un byte scritto dopo l'ultimo controllo resta nella pipe e sveglia subito il poll
+    struct pollfd pfd = {.fd = async->wake[0], .events = POLLIN};
+    if (poll(&pfd, 1, -1) > 0) {
+      char drain[64];
+      while (read(async->wake[0], drain, sizeof(drain)) > 0) {
+      }
     }
   }
+  return NULL;
+}
+
+/**
+ * Attiva la modalità asincrona. Da chiamare prima del primo sketchybar(),
+ * oppure impostando SKETCHYBAR_ASYNC=<timeout_ms> nell'ambiente.
+ *
+ * @param timeout_ms Attesa massima di un invio prima di scartare il messaggio
+ * @return true se il thread mittente è partito; altrimenti resta l'invio sincrono
+ */
+[[nodiscard]] static inline bool sketchybar_async_start(int timeout_ms) {
+  struct sketchybar_async* async = &g_sketchybar_async;
+  if (async->enabled)
+    return true;
+
+  // Il tracing si inizializza qui, prima che esista un secondo thread
+  (void)trace_enabled();
+
+  async->ring = calloc(SKETCHYBAR_ASYNC_CAPACITY, sizeof(char*));
+  if (!async->ring || pipe(async->wake) < 0) {
+    free(async->ring);
+    async->ring = NULL;
+    return false;
+  }
+  fcntl(async->wake[0], F_SETFL, O_NONBLOCK);
+  fcntl(async->wake[1], F_SETFL, O_NONBLOCK);
+  fcntl(async->wake[0], F_SETFD, FD_CLOEXEC);
+  fcntl(async->wake[1], F_SETFD, FD_CLOEXEC);
+
+  async->mask       = SKETCHYBAR_ASYNC_CAPACITY - 1;
+  async->timeout_ms = timeout_ms < 0 ? 0 : timeout_ms;
+
+  if (pthread_create(&async->thread, NULL, sketchybar_async_sender, async) != 0) {
+    close(async->wake[0]);
+    close(async->wake[1]);
+    free(async->ring);
+    async->ring = NULL;
+    return false;
+  }
+  pthread_detach(async->thread);
+  async->enabled = true;
+  return true;
+}
+
+/**
+ * Legge i contatori della modalità asincrona (tutti a zero se non è attiva)
+ */
+[[nodiscard]] static inline struct sketchybar_stats sketchybar_async_stats() {
+  struct sketchybar_async* async = &g_sketchybar_async;
+  return (struct sketchybar_stats){
+      .queued     = atomic_load_explicit(&async->queued, memory_order_relaxed),
+      .sent       = atomic_load_explicit(&async->sent, memory_order_relaxed),
+      .superseded = atomic_load_explicit(&async->superseded, memory_order_relaxed),
+      .dropped    = atomic_load_explicit(&async->dropped, memory_order_relaxed),
+  };
+}
+
+/**
+ * Accoda un messaggio senza bloccare. Ai --trigger si aggiungono i contatori
+ * ipc_superseded e ipc_dropped, così la barra li riceve con l'evento.
+ */
+static inline void sketchybar_async_enqueue(struct sketchybar_async* async, const char* message) {
+  size_t length = strlen(message);
+  char   suffix[64];
+  int    suffix_length = 0;
+  if (strncmp(message, "--trigger ", 10) == 0) {
+    suffix_length = snprintf(
+        suffix, sizeof(suffix), " ipc_superseded='%llu' ipc_dropped='%llu'",
+        (unsigned long long)atomic_load_explicit(&async->superseded, memory_order_relaxed),
+        (unsigned long long)atomic_load_explicit(&async->dropped, memory_order_relaxed));
+  }
+
+  char* packet = malloc(length + (size_t)suffix_length + 1);
+  if (!packet) {
+    atomic_fetch_add_explicit(&async->dropped, 1, memory_order_relaxed);
+    return;
+  }
+  memcpy(packet, message, length);
+  memcpy(packet + length, suffix, (size_t)suffix_length);
+  packet[length + (size_t)suffix_length] = '\0';
+  atomic_fetch_add_explicit(&async->queued, 1, memory_order_relaxed);
+
+  // Casella già assegnata alla chiave?
+  uint64_t key  = sketchybar_message_key(message);
+  int      slot = -1;
+  for (int i = 0; i < SKETCHYBAR_ASYNC_MAILBOXES; i++) {
+    if (async->keys[i] == key) {
+      slot = i;
+      break;
+    }
+  }
+
+  uint32_t tail = atomic_load_explicit(&async->tail, memory_order_relaxed);
+  bool     full = tail - atomic_load_explicit(&async->head, memory_order_acquire) > async->mask;
+  bool     held = slot >= 0 && atomic_load_explicit(&async->mailboxes[slot], memory_order_relaxed) != NULL;
+
+  if (!full && !held) {
+    async->ring[tail & async->mask] = packet;
+    atomic_store_explicit(&async->tail, tail + 1, memory_order_release);
+  } else {
+    // Assegna una casella libera: solo il produttore la riempie, quindi se è vuota lo resta
+    for (int i = 0; slot < 0 && i < SKETCHYBAR_ASYNC_MAILBOXES; i++) {
+      if (!async->keys[i] || !atomic_load_explicit(&async->mailboxes[i], memory_order_relaxed)) {
+        async->keys[i] = key;
+        slot           = i;
+      }
+    }
+    if (slot < 0) {
+      free(packet);
+      atomic_fetch_add_explicit(&async->dropped, 1, memory_order_relaxed);
+      return;
+    }
+
+    char* previous = atomic_exchange_explicit(&async->mailboxes[slot], packet, memory_order_acq_rel);
+    if (previous) {
+      free(previous);
+      atomic_fetch_add_explicit(&async->superseded, 1, memory_order_relaxed);
+    }
+  }
+
+  // Pipe piena: il mittente ha già risvegli in sospeso
+  ssize_t written = write(async->wake[1], "", 1);
+  (void)written;
+}
+
+/**
+ * Invia un messaggio a sketchybar
+ *
+ * In modalità asincrona il messaggio viene solo accodato; altrimenti l'invio
+ * è sincrono e bloccante come in origine. Se la barra non risponde, il
+ * chiamante resta fermo qui finché sketchybar_reconnect non la ritrova.
+ *
+ * @param message Messaggio da inviare
+ */
+static inline void sketchybar(const char* message) {
+  if (!message)
+    return;
+
+  static bool env_checked = false;
+  if (!env_checked) {
+    env_checked         = true;
+    const char* timeout = getenv("SKETCHYBAR_ASYNC");
+    if (timeout && *timeout && !sketchybar_async_start(atoi(timeout)))
+      fprintf(stderr, "Impossibile avviare l'invio asincrono, uso quello sincrono\n");
+  }
+
+  sketchybar_remember(message);
+
+  if (g_sketchybar_async.enabled) {
+    sketchybar_wait_awake();
+    uint64_t trace_start = trace_begin();
+    sketchybar_async_enqueue(&g_sketchybar_async, message);
+    trace_end(TRACE_ENQUEUE, trace_start);
+    return;
+  }
+
+  while (sketchybar_send(message, -1) == SKETCHYBAR_NO_BAR) {
+    if (!sketchybar_reconnect())
+      exit(0); // No sketchybar instance running, exit.
+  }
 }
 
 #endif /* SKETCHYBAR_H */
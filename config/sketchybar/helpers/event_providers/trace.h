@@ -0,0 +1,311 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Eventi conservati nel ring (i più vecchi vengono sovrascritti)
+#define TRACE_CAPACITY 16384
+// Lunghezza massima del percorso del file di trace
+#define TRACE_PATH_LENGTH 512
+// Thread con un nome nel trace
+#define TRACE_MAX_THREADS 8
+
+/**
+ * Fasi di un tick, con il nome mostrato in Perfetto
+ */
+enum trace_phase {
+  TRACE_TICK,    // Tick completo, escluse le attese
+  TRACE_SAMPLE,  // Lettura dei contatori (host_statistics, sysctl, procfs)
+  TRACE_FORMAT,  // snprintf del trigger
+  TRACE_ENCODE,  // format_message
+  TRACE_IPC,     // mach_msg o scrittura su stdout
+  TRACE_ENQUEUE, // Accodamento in modalità asincrona
+  TRACE_PHASE_COUNT,
+};
+
+static const char* const trace_phase_names[TRACE_PHASE_COUNT] = {"tick", "sample", "format", "encode", "ipc", "enqueue"};
+
+/**
+ * Un intervallo registrato: evento "X" (complete) del formato Chrome
+ */
+struct trace_event {
+  uint64_t start_ns;
+  uint64_t duration_ns;
+  uint32_t phase;
+  uint32_t thread;
+};
+
+/**
+ * Tracing opzionale delle fasi di un tick.
+ *
+ * Si attiva con SKETCHYBAR_TRACE=<file.json>. Il ring è allocato una volta
+ * all'attivazione e ogni fase costa due clock_gettime e una scrittura nel
+ * ring; da disattivato trace_begin è un solo confronto. Il ring viene
+ * scritto come JSON di Chrome trace-event (apribile in Perfetto o in
+ * chrome://tracing) all'uscita, su SIGUSR2 e su SIGINT/SIGTERM se il
+ * provider non li gestisce già. La scrittura usa solo open/write, quindi si
+ * può fare dal gestore del segnale.
+ */
+struct trace {
+  int                 state; // 0 da inizializzare, 1 spento, 2 attivo
+  char                path[TRACE_PATH_LENGTH];
+  struct trace_event* events;
+  _Atomic uint64_t    head;
+  _Atomic uint32_t    threads;
+  const char*         thread_names[TRACE_MAX_THREADS + 1]; // Indicizzati da 1, NULL = "sampler"
+};
+
+static struct trace g_trace;
+
+// Indice del thread corrente nel trace, assegnato al primo evento
+static _Thread_local uint32_t g_trace_thread = 0;
+
+static inline void trace_flush();
+
+/**
+ * Gestore di SIGUSR2: scrive il trace e continua
+ */
+static inline void trace_signal_flush(int signum) {
+  (void)signum;
+  trace_flush();
+}
+
+/**
+ * Gestore di SIGINT/SIGTERM installato solo se il provider non ne ha uno:
+ * scrive il trace e termina come avrebbe fatto il segnale
+ */
+static inline void trace_signal_exit(int signum) {
+  trace_flush();
+  signal(signum, SIG_DFL);
+  raise(signum);
+}
+
+/**
+ * Legge SKETCHYBAR_TRACE e, se impostata, alloca il ring e installa i gestori
+ */
+static inline void trace_init() {
+  g_trace.state    = 1;
+  const char* path = getenv("SKETCHYBAR_TRACE");
+  if (!path || !*path)
+    return;
+
+  int written = snprintf(g_trace.path, sizeof(g_trace.path), "%s", path);
+  if (written < 0 || written >= (int)sizeof(g_trace.path))
+    return;
+
+  g_trace.events = calloc(TRACE_CAPACITY, sizeof(struct trace_event));
+  if (!g_trace.events) {
+    fprintf(stderr, "Impossibile allocare il ring del trace, tracing disattivato\n");
+    return;
+  }
+
+  atexit(trace_flush);
+
+  // SIGUSR2 solo se libero: brew_check lo usa per reinviare la lista completa
+  struct sigaction sa = {0};
+  struct sigaction current;
+  sa.sa_handler = trace_signal_flush;
+  sa.sa_flags   = SA_RESTART;
+  sigemptyset(&sa.sa_mask);
+  if (sigaction(SIGUSR2, NULL, &current) == 0 && current.sa_handler == SIG_DFL)
+    sigaction(SIGUSR2, &sa, NULL);
+
+  // Solo dove il provider non ha già un gestore: se ne ha uno che chiama exit(), basta atexit
+  int exit_signals[] = {SIGINT, SIGTERM};
+  for (size_t i = 0; i < sizeof(exit_signals) / sizeof(exit_signals[0]); i++) {
+    if (sigaction(exit_signals[i], NULL, &current) == 0 && current.sa_handler == SIG_DFL) {
+      sa.sa_handler = trace_signal_exit;
+      sigaction(exit_signals[i], &sa, NULL);
+    }
+  }
+
+  g_trace.state = 2;
+}
+
+/**
+ * @return true se il tracing è attivo
+ */
+[[nodiscard]] static inline bool trace_enabled() {
+  if (g_trace.state == 0)
+    trace_init();
+  return g_trace.state == 2;
+}
+
+/**
+ * Tempo monotono corrente in nanosecondi
+ */
+[[nodiscard]] static inline uint64_t trace_now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * Indice del thread corrente, assegnato al primo uso
+ */
+[[nodiscard]] static inline uint32_t trace_thread() {
+  if (!g_trace_thread)
+    g_trace_thread = atomic_fetch_add_explicit(&g_trace.threads, 1, memory_order_relaxed) + 1;
+  return g_trace_thread;
+}
+
+/**
+ * Dà un nome al thread corrente nel trace (il thread di campionamento resta "sampler")
+ *
+ * @param name Stringa statica
+ */
+static inline void trace_name_thread(const char* name) {
+  if (!trace_enabled())
+    return;
+  uint32_t thread = trace_thread();
+  if (thread <= TRACE_MAX_THREADS)
+    g_trace.thread_names[thread] = name;
+}
+
+/**
+ * Apre una fase
+ *
+ * @return Istante d'inizio da passare a trace_end, 0 se il tracing è spento
+ */
+[[nodiscard]] static inline uint64_t trace_begin() {
+  return trace_enabled() ? trace_now() : 0;
+}
+
+/**
+ * Chiude una fase aperta con trace_begin e la registra nel ring
+ *
+ * @param phase Fase appena conclusa
+ * @param start_ns Valore restituito da trace_begin
+ */
+static inline void trace_end(enum trace_phase phase, uint64_t start_ns) {
+  if (!start_ns)
+    return;
+
+  uint32_t            thread = trace_thread();
+  uint64_t            slot   = atomic_fetch_add_explicit(&g_trace.head, 1, memory_order_relaxed);
+  struct trace_event* event  = &g_trace.events[slot % TRACE_CAPACITY];
+  event->start_ns            = start_ns;
+  event->duration_ns         = trace_now() - start_ns;
+  event->phase               = phase;
+  event->thread              = thread;
+}
+
+/**
+ * Buffer di scrittura del flush, svuotato con write()
+ */
+struct trace_writer {
+  int    fd;
+  size_t used;
+  char   buffer[4096];
+};
+
+static inline void trace_write_flush(struct trace_writer* writer) {
+  size_t offset = 0;
+  while (offset < writer->used) {
+    ssize_t written = write(writer->fd, writer->buffer + offset, writer->used - offset);
+    if (written <= 0)
+      break;
+    offset += (size_t)written;
+  }
+  writer->used = 0;
+}
+
+static inline void trace_write_string(struct trace_writer* writer, const char* string) {
+  for (; *string; string++) {
+    if (writer->used == sizeof(writer->buffer))
+      trace_write_flush(writer);
+    writer->buffer[writer->used++] = *string;
+  }
+}
+
+static inline void trace_write_uint(struct trace_writer* writer, uint64_t value) {
+  char  digits[21];
+  char* cursor = digits + sizeof(digits) - 1;
+  *cursor      = '\0';
+  do {
+    *--cursor = (char)('0' + value % 10);
+    value /= 10;
+  } while (value);
+  trace_write_string(writer, cursor);
+}
+
+/**
+ * Scrive nanosecondi come microsecondi con tre decimali, l'unità del formato
+ */
+static inline void trace_write_us(struct trace_writer* writer, uint64_t ns) {
+  trace_write_uint(writer, ns / 1000);
+  char fraction[5] = {'.', (char)('0' + ns / 100 % 10), (char)('0' + ns / 10 % 10), (char)('0' + ns % 10), '\0'};
+  trace_write_string(writer, fraction);
+}
+
+/**
+ * Scrive il contenuto del ring nel file di trace, dal più vecchio al più
+ * recente. Async-signal-safe: niente stdio né allocazioni.
+ */
+static inline void trace_flush() {
+  if (g_trace.state != 2)
+    return;
+
+  struct trace_writer writer = {.fd = open(g_trace.path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)};
+  if (writer.fd < 0)
+    return;
+
+  uint64_t head  = atomic_load_explicit(&g_trace.head, memory_order_acquire);
+  uint64_t count = head < TRACE_CAPACITY ? head : TRACE_CAPACITY;
+  uint64_t pid   = (uint64_t)getpid();
+
+  trace_write_string(&writer, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  for (uint64_t i = head - count; i < head; i++) {
+    const struct trace_event* event = &g_trace.events[i % TRACE_CAPACITY];
+    if (event->phase >= TRACE_PHASE_COUNT)
+      continue;
+
+    trace_write_string(&writer, "{\"name\":\"");
+    trace_write_string(&writer, trace_phase_names[event->phase]);
+    trace_write_string(&writer, "\",\"ph\":\"X\",\"ts\":");
+    trace_write_us(&writer, event->start_ns);
+    trace_write_string(&writer, ",\"dur\":");
+    trace_write_us(&writer, event->duration_ns);
+    trace_write_string(&writer, ",\"pid\":");
+    trace_write_uint(&writer, pid);
+    trace_write_string(&writer, ",\"tid\":");
+    trace_write_uint(&writer, event->thread);
+    trace_write_string(&writer, "},\n");
+  }
+
+  // Metadati: nome del processo e dei thread
+  uint32_t threads = atomic_load_explicit(&g_trace.threads, memory_order_relaxed);
+  for (uint32_t thread = 1; thread <= threads && thread <= TRACE_MAX_THREADS; thread++) {
+    trace_write_string(&writer, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":");
+    trace_write_uint(&writer, pid);
+    trace_write_string(&writer, ",\"tid\":");
+    trace_write_uint(&writer, thread);
+    trace_write_string(&writer, ",\"args\":{\"name\":\"");
+    trace_write_string(&writer, g_trace.thread_names[thread] ? g_trace.thread_names[thread] : "sampler");
+    trace_write_string(&writer, "\"}},\n");
+  }
+  trace_write_string(&writer, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":");
+  trace_write_uint(&writer, pid);
+  trace_write_string(&writer, ",\"args\":{\"name\":\"");
+#ifdef __APPLE__
+  trace_write_string(&writer, getprogname());
+#else
+  trace_write_string(&writer, program_invocation_short_name);
+#endif
+  trace_write_string(&writer, "\"}}\n]}\n");
+
+  trace_write_flush(&writer);
+  close(writer.fd);
+}
+
+#endif /* TRACE_H */
@@ -0,0 +1,244 @@
+#ifndef WORKERS_H
+#define WORKERS_H
+
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+// Thread massimi di un pool
+#define WORKER_MAX_THREADS 4
+// Job in attesa di un thread libero
+#define WORKER_QUEUE_CAPACITY 16
+
+/**
+ * Casella "ultimo valore vince" tra un collector e il publisher.
+ *
+ * Un solo produttore (il job sul worker) e un solo consumatore (il
+ * publisher), senza lock: il produttore scambia il puntatore con quello
+ * nuovo e libera il valore precedente se il publisher non l'aveva ancora
+ * preso, il publisher lo scambia con NULL. Il publisher non aspetta mai il
+ * collector e non vede mai un valore più vecchio di uno già consumato.
+ */
+struct latest {
+  _Atomic(void*) value;
+  void (*release)(void* value); // Libera un valore sostituito prima di essere letto
+
+  _Atomic uint64_t published;
+  _Atomic uint64_t superseded;
+};
+
+/**
+ * @param slot Casella da inizializzare
+ * @param release Funzione che libera un valore, ad esempio free
+ */
+static inline void latest_init(struct latest* slot, void (*release)(void* value)) {
+  atomic_init(&slot->value, NULL);
+  atomic_init(&slot->published, 0);
+  atomic_init(&slot->superseded, 0);
+  slot->release = release;
+}
+
+/**
+ * Pubblica un valore (lato collector); la casella ne diventa proprietaria
+ */
+static inline void latest_put(struct latest* slot, void* value) {
+  void* previous = atomic_exchange_explicit(&slot->value, value, memory_order_acq_rel);
+  atomic_fetch_add_explicit(&slot->published, 1, memory_order_relaxed);
+  if (previous) {
+    slot->release(previous);
+    atomic_fetch_add_explicit(&slot->superseded, 1, memory_order_relaxed);
+  }
+}
+
+/**
+ * Prende l'ultimo valore pubblicato (lato publisher)
+ *
+ * @return Il valore, di cui il chiamante diventa proprietario, o NULL se non ce n'è uno nuovo
+ */
+[[nodiscard]] static inline void* latest_take(struct latest* slot) {
+  return atomic_exchange_explicit(&slot->value, NULL, memory_order_acq_rel);
+}
+
+/**
+ * Libera un valore rimasto nella casella
+ */
+static inline void latest_cleanup(struct latest* slot) {
+  void* value = latest_take(slot);
+  if (value)
+    slot->release(value);
+}
+
+/**
+ * Un collector lento eseguito su un worker
+ */
+struct worker_job {
+  void (*run)(void* context, struct latest* result); // Raccoglie e pubblica con latest_put
+  void*         context;                             // Stato del collector, usato solo dal worker durante run
+  struct latest result;
+  _Atomic bool  busy; // Dall'accodamento alla fine di run
+};
+
+/**
+ * Modello a thread dei provider con collector lenti.
+ *
+ * Il thread principale fa da publisher: possiede i timer, i segnali e
+ * l'invio a sketchybar, e fa solo lavoro di durata limitata. I collector
+ * che possono bloccare a lungo (comandi esterni, rete) girano su un piccolo
+ * pool di worker e consegnano il risultato in una casella latest; il
+ * publisher la svuota a ogni risveglio. Un job già in coda o in esecuzione
+ * non viene accodato una seconda volta, quindi un collector lento non
+ * accumula richieste. La coda dei job usa un mutex perché l'accodamento è
+ * raro; il passaggio dei risultati resta lock-free.
+ *
+ * I worker sono detached: all'uscita del processo un collector ancora in
+ * corso viene semplicemente interrotto.
+ */
+struct worker_pool {
+  pthread_mutex_t    lock;
+  pthread_cond_t     ready;
+  struct worker_job* queue[WORKER_QUEUE_CAPACITY];
+  int                head;
+  int                count;
+  int                thread_count;
+  int                wake[2]; // Un byte per ogni job concluso, scrittura non bloccante
+};
+
+/**
+ * Thread worker: esegue i job nell'ordine di accodamento
+ */
+static inline void* worker_thread(void* argument) {
+  struct worker_pool* pool = argument;
+  trace_name_thread("worker");
+
+  for (;;) {
+    pthread_mutex_lock(&pool->lock);
+    while (!pool->count)
+      pthread_cond_wait(&pool->ready, &pool->lock);
+    struct worker_job* job = pool->queue[pool->head];
+    pool->head             = (pool->head + 1) % WORKER_QUEUE_CAPACITY;
+    pool->count--;
+    pthread_mutex_unlock(&pool->lock);
+
+    job->run(job->context, &job->result);
+    atomic_store_explicit(&job->busy, false, memory_order_release);
+
+    // Pipe piena: il publisher ha già risvegli in sospeso
+    ssize_t written = write(pool->wake[1], "", 1);
+    (void)written;
+  }
+  return NULL;
+}
+
+/**
+ * Avvia il pool
+ *
+ * @param pool Pool da inizializzare
+ * @param threads Numero di worker, da 1 a WORKER_MAX_THREADS
+ * @return true se è partito almeno un worker
+ */
+[[nodiscard]] static inline bool worker_pool_start(struct worker_pool* pool, int threads) {
+  *pool = (struct worker_pool){.wake = {-1, -1}};
+  if (threads < 1)
+    threads = 1;
+  if (threads > WORKER_MAX_THREADS)
+    threads = WORKER_MAX_THREADS;
+
+  // Il tracing si inizializza qui, prima che esista un secondo thread
+  (void)trace_enabled();
+
+  if (pthread_mutex_init(&pool->lock, NULL) != 0 || pthread_cond_init(&pool->ready, NULL) != 0 || pipe(pool->wake) < 0)
+    return false;
+  for (int i = 0; i < 2; i++) {
+    fcntl(pool->wake[i], F_SETFL, O_NONBLOCK);
+    fcntl(pool->wake[i], F_SETFD, FD_CLOEXEC);
+  }
+
+  // I worker nascono con tutti i segnali bloccati, così i gestori del provider girano sempre sul publisher
+  sigset_t all, previous;
+  sigfillset(&all);
+  pthread_sigmask(SIG_SETMASK, &all, &previous);
+  for (int i = 0; i < threads; i++) {
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, worker_thread, pool) != 0)
+      break;
+    pthread_detach(thread);
+    pool->thread_count++;
+  }
+  pthread_sigmask(SIG_SETMASK, &previous, NULL);
+  return pool->thread_count > 0;
+}
+
+/**
+ * Prepara un job
+ *
+ * @param job Job da inizializzare
+ * @param run Collector da eseguire sul worker
+ * @param context Stato del collector
+ * @param release Funzione che libera un risultato
+ */
+static inline void worker_job_init(struct worker_job* job, void (*run)(void* context, struct latest* result), void* context,
+                                   void (*release)(void* value)) {
+  job->run     = run;
+  job->context = context;
+  latest_init(&job->result, release);
+  atomic_init(&job->busy, false);
+}
+
+/**
+ * Accoda un job (lato publisher)
+ *
+ * @return false se il job è già in coda o in esecuzione, o se la coda è piena
+ */
+static inline bool worker_submit(struct worker_pool* pool, struct worker_job* job) {
+  if (atomic_exchange_explicit(&job->busy, true, memory_order_acq_rel))
+    return false;
+
+  pthread_mutex_lock(&pool->lock);
+  bool queued = pool->count < WORKER_QUEUE_CAPACITY;
+  if (queued) {
+    pool->queue[(pool->head + pool->count) % WORKER_QUEUE_CAPACITY] = job;
+    pool->count++;
+    pthread_cond_signal(&pool->ready);
+  }
+  pthread_mutex_unlock(&pool->lock);
+
+  if (!queued)
+    atomic_store_explicit(&job->busy, false, memory_order_release);
+  return queued;
+}
+
+/**
+ * @return true se il job è in coda o in esecuzione
+ */
+[[nodiscard]] static inline bool worker_job_busy(struct worker_job* job) {
+  return atomic_load_explicit(&job->busy, memory_order_acquire);
+}
+
+/**
+ * Attende (lato publisher) la fine di un job o lo scadere del timeout
+ *
+ * Un segnale interrompe l'attesa, così il publisher controlla subito i suoi flag.
+ *
+ * @param timeout_ms Attesa massima in millisecondi
+ * @return true se almeno un job si è concluso
+ */
+static inline bool worker_pool_wait(struct worker_pool* pool, int timeout_ms) {
+  struct pollfd pfd = {.fd = pool->wake[0], .events = POLLIN};
+  if (poll(&pfd, 1, timeout_ms) <= 0)
+    return false;
+
+  char drain[64];
+  while (read(pool->wake[0], drain, sizeof(drain)) > 0) {
+  }
+  return true;
+}
+
+#endif /* WORKERS_H */
@@ -0,0 +1,275 @@
+#ifndef MENUS_ALIAS_INDEX_H
+#define MENUS_ALIAS_INDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+
+// Number of hash slots, must be a power of two and larger than the number of status items
+#define ALIAS_INDEX_SLOTS 256
+#define ALIAS_MAX_LENGTH  256
+
+struct alias_bounds {
+  double x, y, width, height;
+};
+
+/**
+ * One window as reported by a window list source
+ */
+struct window_info {
+  const char*         owner;
+  const char*         name;
+  pid_t               pid;
+  long long           layer;
+  struct alias_bounds bounds;
+};
+
+typedef void (*window_visit_fn)(void* arg, const struct window_info* info);
+
+/**
+ * Source of the window list: CGWindowListCopyWindowInfo on macOS, a
+ * synthetic list in fake_backend.h
+ */
+struct window_source {
+  void* ctx;
+  // Calls visit for every on-screen window of the given layer
+  bool (*enumerate)(void* ctx, long long layer, window_visit_fn visit, void* arg);
+};
+
+struct alias_entry {
+  uint64_t            hash; // 0 marks an empty slot
+  pid_t               pid;
+  struct alias_bounds bounds;
+  void*               element; // Cached AX element, owned by the index
+  bool                seen;    // Present in the last refresh
+  char                alias[ALIAS_MAX_LENGTH];
+};
+
+/**
+ * Hash table of "owner,name" aliases of the menu bar windows.
+ *
+ * The table is rebuilt from the window source at most once per ttl, and on
+ * a miss if the last refresh is older than min_refresh; AX elements resolved
+ * for an alias survive refreshes as long as owner pid and position match.
+ */
+struct alias_index {
+  struct window_source* source;
+  long long             layer;
+  uint64_t              ttl_ns;
+  uint64_t              min_refresh_ns;
+  uint64_t              built_ns;
+  bool                  built;
+  void (*release)(void* element);
+
+  struct alias_entry slots[ALIAS_INDEX_SLOTS];
+
+  uint64_t refreshes;
+  uint64_t hits;
+  uint64_t misses;
+};
+
+/**
+ * FNV-1a of "owner,name", computed without building the joined string
+ */
+[[nodiscard]] static inline uint64_t alias_hash(const char* owner, const char* name) {
+  uint64_t hash = 1469598103934665603ull;
+  for (const char* c = owner; *c; c++)
+    hash = (hash ^ (uint8_t)*c) * 1099511628211ull;
+  hash = (hash ^ (uint8_t)',') * 1099511628211ull;
+  for (const char* c = name; *c; c++)
+    hash = (hash ^ (uint8_t)*c) * 1099511628211ull;
+  return hash ? hash : 1;
+}
+
+/**
+ * Hash of an already joined "owner,name" alias
+ */
+[[nodiscard]] static inline uint64_t alias_hash_joined(const char* alias) {
+  uint64_t hash = 1469598103934665603ull;
+  for (const char* c = alias; *c; c++)
+    hash = (hash ^ (uint8_t)*c) * 1099511628211ull;
+  return hash ? hash : 1;
+}
+
+/**
+ * Initializes the index
+ *
+ * @param index Index to initialize
+ * @param source Window list source
+ * @param layer Window layer of the status items
+ * @param ttl_ns Maximum age of the index before a lookup refreshes it
+ * @param release Releases cached elements, may be NULL
+ */
+static inline void alias_index_init(
+    struct alias_index* index, struct window_source* source, long long layer, uint64_t ttl_ns, void (*release)(void*)) {
+  memset(index, 0, sizeof(struct alias_index));
+  index->source         = source;
+  index->layer          = layer;
+  index->ttl_ns         = ttl_ns;
+  index->min_refresh_ns = ttl_ns / 10;
+  index->release        = release;
+}
+
+/**
+ * Finds the slot of an alias, or the empty slot where it would go
+ */
+[[nodiscard]] static inline struct alias_entry*
+alias_index_probe(struct alias_index* index, uint64_t hash, const char* owner, const char* name, const char* alias) {
+  size_t mask = ALIAS_INDEX_SLOTS - 1;
+  for (size_t i = 0, slot = hash & mask; i < ALIAS_INDEX_SLOTS; i++, slot = (slot + 1) & mask) {
+    struct alias_entry* entry = &index->slots[slot];
+    if (entry->hash == 0)
+      return entry;
+    if (entry->hash != hash)
+      continue;
+
+    if (alias && strcmp(entry->alias, alias) == 0)
+      return entry;
+
+    if (owner) {
+      size_t owner_len = strlen(owner);
+      if (strncmp(entry->alias, owner, owner_len) == 0 && entry->alias[owner_len] == ','
+          && strcmp(entry->alias + owner_len + 1, name) == 0)
+        return entry;
+    }
+  }
+  return NULL;
+}
+
+static void alias_index_visit(void* arg, const struct window_info* info) {
+  struct alias_index* index = arg;
+  if (!info->owner || !info->name || info->layer != index->layer)
+    return;
+
+  uint64_t            hash  = alias_hash(info->owner, info->name);
+  struct alias_entry* entry = alias_index_probe(index, hash, info->owner, info->name, NULL);
+  if (!entry)
+    return; // Table full
+
+  if (entry->hash == 0) {
+    int written = snprintf(entry->alias, sizeof(entry->alias), "%s,%s", info->owner, info->name);
+    if (written < 0 || written >= (int)sizeof(entry->alias)) {
+      entry->alias[0] = '\0';
+      return;
+    }
+    entry->hash = hash;
+  } else if (entry->seen) {
+    return; // Keep the first window for duplicated aliases, like the linear scan
+  }
+
+  // A relaunched app or a moved item invalidates the cached element
+  if (entry->element && (entry->pid != info->pid || entry->bounds.x != info->bounds.x)) {
+    if (index->release)
+      index->release(entry->element);
+    entry->element = NULL;
+  }
+
+  entry->pid    = info->pid;
+  entry->bounds = info->bounds;
+  entry->seen   = true;
+}
+
+/**
+ * Rebuilds the index from the window source
+ *
+ * @param index Index to refresh
+ * @param now_ns Current monotonic time
+ * @return true on success
+ */
+static inline bool alias_index_refresh(struct alias_index* index, uint64_t now_ns) {
+  for (size_t i = 0; i < ALIAS_INDEX_SLOTS; i++)
+    index->slots[i].seen = false;
+
+  if (!index->source->enumerate(index->source->ctx, index->layer, alias_index_visit, index))
+    return false;
+
+  // Drop vanished aliases and reinsert the survivors, so probe chains stay intact
+  static struct alias_entry live[ALIAS_INDEX_SLOTS];
+  size_t                    live_count = 0;
+
+  for (size_t i = 0; i < ALIAS_INDEX_SLOTS; i++) {
+    struct alias_entry* entry = &index->slots[i];
+    if (entry->hash == 0)
+      continue;
+    if (entry->seen)
+      live[live_count++] = *entry;
+    else if (entry->element && index->release)
+      index->release(entry->element);
+  }
+
+  memset(index->slots, 0, sizeof(index->slots));
+  for (size_t i = 0; i < live_count; i++) {
+    struct alias_entry* entry = alias_index_probe(index, live[i].hash, NULL, NULL, live[i].alias);
+    if (entry)
+      *entry = live[i];
+  }
+
+  index->built    = true;
+  index->built_ns = now_ns;
+  index->refreshes++;
+  return true;
+}
+
+/**
+ * Looks up an alias, refreshing the index lazily
+ *
+ * @param index Index to query
+ * @param alias "owner,name" alias
+ * @param now_ns Current monotonic time
+ * @return The entry, or NULL if no menu bar window matches
+ */
+[[nodiscard]] static inline struct alias_entry* alias_index_lookup(struct alias_index* index, const char* alias, uint64_t now_ns) {
+  if (!index || !alias)
+    return NULL;
+
+  if (!index->built || now_ns - index->built_ns > index->ttl_ns)
+    (void)alias_index_refresh(index, now_ns);
+
+  uint64_t            hash  = alias_hash_joined(alias);
+  struct alias_entry* entry = alias_index_probe(index, hash, NULL, NULL, alias);
+
+  // Status items appear at any time, retry once on a fresh window list
+  if ((!entry || entry->hash == 0) && now_ns - index->built_ns > index->min_refresh_ns) {
+    (void)alias_index_refresh(index, now_ns);
+    entry = alias_index_probe(index, hash, NULL, NULL, alias);
+  }
+
+  if (!entry || entry->hash == 0) {
+    index->misses++;
+    return NULL;
+  }
+
+  index->hits++;
+  return entry;
+}
+
+/**
+ * Forgets the cached element of an entry, e.g. after a failed press
+ *
+ * @param index Index owning the entry
+ * @param entry Entry to reset
+ */
+static inline void alias_index_drop_element(struct alias_index* index, struct alias_entry* entry) {
+  if (entry && entry->element) {
+    if (index->release)
+      index->release(entry->element);
+    entry->element = NULL;
+  }
+}
+
+/**
+ * Releases every cached element
+ *
+ * @param index Index to clean up
+ */
+static inline void alias_index_cleanup(struct alias_index* index) {
+  for (size_t i = 0; i < ALIAS_INDEX_SLOTS; i++)
+    alias_index_drop_element(index, &index->slots[i]);
+  memset(index->slots, 0, sizeof(index->slots));
+  index->built = false;
+}
+
+#endif /* MENUS_ALIAS_INDEX_H */
@@ -0,0 +1,565 @@
+#ifndef MENUS_AX_BACKEND_H
+#define MENUS_AX_BACKEND_H
+
+#include "alias_index.h"
+#include "backend.h"
+#include <Carbon/Carbon.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Constants for better clarity
+static const int MENU_BAR_LAYER           = 0x19;
+static const int MAIN_DISPLAY             = 0;
+static const int MAX_NAME_BUFFER          = 256;
+static const int CLICK_DELAY_MICROSECONDS = 150000; // 150ms
+
+/**
+ * Initializes accessibility API access
+ *
+ * @return true if initialization succeeds, false otherwise
+ */
+[[nodiscard]] static bool ax_init() {
+  const void* keys[]   = {kAXTrustedCheckOptionPrompt};
+  const void* values[] = {kCFBooleanTrue};
+
+  CFDictionaryRef options = CFDictionaryCreate(
+      kCFAllocatorDefault, keys, values, sizeof(keys) / sizeof(*keys), &kCFCopyStringDictionaryKeyCallBacks,
+      &kCFTypeDictionaryValueCallBacks);
+
+  if (!options) {
+    fprintf(stderr, "Error creating options dictionary\n");
+    return false;
+  }
+
+  bool trusted = AXIsProcessTrustedWithOptions(options);
+  CFRelease(options);
+
+  if (!trusted) {
+    fprintf(stderr, "Accessibility permissions not granted\n");
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * Performs a click on a UI element
+ *
+ * @param element Element to click on
+ * @return false if the element is no longer valid
+ */
+static bool ax_perform_click(AXUIElementRef element) {
+  if (!element)
+    return false;
+
+  // First cancel any ongoing action
+  AXUIElementPerformAction(element, kAXCancelAction);
+  usleep(CLICK_DELAY_MICROSECONDS);
+
+  // Then perform the press action
+  AXError error = AXUIElementPerformAction(element, kAXPressAction);
+  return error != kAXErrorInvalidUIElement && error != kAXErrorCannotComplete;
+}
+
+/**
+ * Gets the title of a UI element
+ *
+ * @param element Element to get the title from
+ * @return The element's title, or NULL on error
+ */
+[[nodiscard]] static CFStringRef ax_get_title(AXUIElementRef element) {
+  if (!element)
+    return NULL;
+
+  CFTypeRef title = NULL;
+  AXError   error = AXUIElementCopyAttributeValue(element, kAXTitleAttribute, &title);
+
+  if (error != kAXErrorSuccess)
+    return NULL;
+  return (CFStringRef)title;
+}
+
+// Window list used to resolve aliases: only on-screen windows are copied
+static const CGWindowListOption WINDOW_LIST_OPTIONS = kCGWindowListOptionOnScreenOnly | kCGWindowListExcludeDesktopElements;
+
+// Maximum age of the alias index before a click refreshes it
+static const uint64_t ALIAS_INDEX_TTL_NS = 2000000000ull; // 2s
+
+/**
+ * Current CLOCK_MONOTONIC time in nanoseconds
+ */
+[[nodiscard]] static uint64_t ax_now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * Returns the UTF-8 contents of a CFString, without copying when possible
+ */
+[[nodiscard]] static const char* ax_cstring(CFStringRef string, char* buffer, CFIndex size) {
+  const char* direct = CFStringGetCStringPtr(string, kCFStringEncodingUTF8);
+  if (direct)
+    return direct;
+  return CFStringGetCString(string, buffer, size, kCFStringEncodingUTF8) ? buffer : NULL;
+}
+
+/**
+ * Window list source backed by CGWindowListCopyWindowInfo
+ */
+static bool ax_enumerate_windows(void* ctx, long long wanted_layer, window_visit_fn visit, void* arg) {
+  (void)ctx;
+
+  CFArrayRef window_list = CGWindowListCopyWindowInfo(WINDOW_LIST_OPTIONS, kCGNullWindowID);
+  if (!window_list) {
+    fprintf(stderr, "Unable to get window list\n");
+    return false;
+  }
+
+  char    owner_buffer[MAX_NAME_BUFFER];
+  char    name_buffer[MAX_NAME_BUFFER];
+  CFIndex window_count = CFArrayGetCount(window_list);
+
+  for (CFIndex i = 0; i < window_count; ++i) {
+    CFDictionaryRef dictionary = CFArrayGetValueAtIndex(window_list, i);
+    if (!dictionary)
+      continue;
+
+    // Filter on the layer first, it is the cheapest field to read
+    CFNumberRef layer_ref = CFDictionaryGetValue(dictionary, kCGWindowLayer);
+    long long   layer     = 0;
+    if (!layer_ref || !CFNumberGetValue(layer_ref, kCFNumberLongLongType, &layer) || layer != wanted_layer)
+      continue;
+
+    CFStringRef     owner_ref     = CFDictionaryGetValue(dictionary, kCGWindowOwnerName);
+    CFNumberRef     owner_pid_ref = CFDictionaryGetValue(dictionary, kCGWindowOwnerPID);
+    CFStringRef     name_ref      = CFDictionaryGetValue(dictionary, kCGWindowName);
+    CFDictionaryRef bounds_ref    = CFDictionaryGetValue(dictionary, kCGWindowBounds);
+
+    if (!name_ref || !owner_ref || !owner_pid_ref || !bounds_ref)
+      continue;
+
+    struct window_info info = {.layer = layer};
+
+    int owner_pid = 0;
+    CFNumberGetValue(owner_pid_ref, kCFNumberIntType, &owner_pid);
+    info.pid = owner_pid;
+
+    CGRect bounds = CGRectNull;
+    if (!CGRectMakeWithDictionaryRepresentation(bounds_ref, &bounds))
+      continue;
+    info.bounds = (struct alias_bounds){bounds.origin.x, bounds.origin.y, bounds.size.width, bounds.size.height};
+
+    info.owner = ax_cstring(owner_ref, owner_buffer, sizeof(owner_buffer));
+    info.name  = ax_cstring(name_ref, name_buffer, sizeof(name_buffer));
+    if (!info.owner || !info.name)
+      continue;
+
+    visit(arg, &info);
+  }
+
+  CFRelease(window_list);
+  return true;
+}
+
+static void ax_release_element(void* element) {
+  if (element)
+    CFRelease((CFTypeRef)element);
+}
+
+/**
+ * Finds the status item of pid whose position matches the window bounds
+ *
+ * @param pid Owner of the status item
+ * @param bounds Bounds of the status item window
+ * @return The corresponding UI element (retained), or NULL on error
+ */
+[[nodiscard]] static AXUIElementRef ax_find_extra_menu_item(pid_t pid, struct alias_bounds bounds) {
+  AXUIElementRef app = AXUIElementCreateApplication(pid);
+  if (!app) {
+    return NULL;
+  }
+
+  AXUIElementRef result       = NULL;
+  CFTypeRef      extras       = NULL;
+  CFArrayRef     children_ref = NULL;
+
+  AXError error = AXUIElementCopyAttributeValue(app, kAXExtrasMenuBarAttribute, &extras);
+  if (error == kAXErrorSuccess && extras) {
+    error = AXUIElementCopyAttributeValue(extras, kAXVisibleChildrenAttribute, (CFTypeRef*)&children_ref);
+
+    if (error == kAXErrorSuccess && children_ref) {
+      CFIndex count = CFArrayGetCount(children_ref);
+      for (CFIndex i = 0; i < count; i++) {
+        AXUIElementRef item         = (AXUIElementRef)CFArrayGetValueAtIndex(children_ref, i);
+        CFTypeRef      position_ref = NULL;
+
+        AXUIElementCopyAttributeValue(item, kAXPositionAttribute, &position_ref);
+        if (!position_ref)
+          continue;
+
+        CGPoint position = CGPointZero;
+        AXValueGetValue(position_ref, kAXValueCGPointType, &position);
+        CFRelease(position_ref);
+
+        // 10 point tolerance for positioning
+        static const CGFloat POSITION_TOLERANCE = 10.0;
+        if (fabs(position.x - bounds.x) <= POSITION_TOLERANCE) {
+          result = (AXUIElementRef)CFRetain(item);
+          break;
+        }
+      }
+      CFRelease(children_ref);
+    }
+    CFRelease(extras);
+  }
+
+  CFRelease(app);
+  return result;
+}
+
+/**
+ * Gets an extra menu item (icons in the system menubar)
+ *
+ * The alias is resolved through the index and the AX element is cached per
+ * alias, so steady-state clicks skip both the window list and the AX scan.
+ *
+ * @param index Alias index
+ * @param alias Application,window alias
+ * @return The index entry with a resolved element, or NULL on error
+ */
+[[nodiscard]] static struct alias_entry* ax_get_extra_menu_item(struct alias_index* index, const char* alias) {
+  if (!alias)
+    return NULL;
+
+  struct alias_entry* entry = alias_index_lookup(index, alias, ax_now_ns());
+  if (!entry)
+    return NULL;
+
+  if (!entry->element)
+    entry->element = (void*)ax_find_extra_menu_item(entry->pid, entry->bounds);
+
+  return entry->element ? entry : NULL;
+}
+
+// SkyLight function declarations
+extern int  SLSMainConnectionID();
+extern void SLSSetMenuBarVisibilityOverrideOnDisplay(int cid, int did, bool enabled);
+extern void SLSSetMenuBarInsetAndAlpha(int cid, double u1, double u2, float alpha);
+
+/**
+ * Selects an item from the extra menu
+ *
+ * @param index Alias index
+ * @param alias Application,window alias
+ * @return true if the item was found and clicked
+ */
+static bool ax_select_menu_extra(struct alias_index* index, const char* alias) {
+  if (!alias)
+    return false;
+
+  struct alias_entry* entry = ax_get_extra_menu_item(index, alias);
+  if (!entry) {
+    fprintf(stderr, "Unable to find menu item: %s\n", alias);
+    return false;
+  }
+
+  int connection_id = SLSMainConnectionID();
+
+  // Temporarily hide the menubar
+  SLSSetMenuBarInsetAndAlpha(connection_id, 0, 1, 0.0);
+  SLSSetMenuBarVisibilityOverrideOnDisplay(connection_id, MAIN_DISPLAY, true);
+  SLSSetMenuBarInsetAndAlpha(connection_id, 0, 1, 0.0);
+
+  // Perform the click on the element, resolving it again if the cached one died
+  bool clicked = ax_perform_click((AXUIElementRef)entry->element);
+  if (!clicked) {
+    alias_index_drop_element(index, entry);
+    entry   = ax_get_extra_menu_item(index, alias);
+    clicked = entry && ax_perform_click((AXUIElementRef)entry->element);
+  }
+
+  // Restore the menubar
+  SLSSetMenuBarVisibilityOverrideOnDisplay(connection_id, MAIN_DISPLAY, false);
+  SLSSetMenuBarInsetAndAlpha(connection_id, 0, 1, 1.0);
+
+  return clicked;
+}
+
+// Process Serial Number function declarations
+extern void _SLPSGetFrontProcess(ProcessSerialNumber* psn);
+extern void SLSGetConnectionIDForPSN(int cid, ProcessSerialNumber* psn, int* cid_out);
+extern void SLSConnectionGetPID(int cid, pid_t* pid_out);
+
+/**
+ * Gets the pid of the frontmost application
+ *
+ * @return The pid of the frontmost application, or 0 on error
+ */
+[[nodiscard]] static pid_t ax_get_front_pid() {
+  ProcessSerialNumber psn = {0};
+  _SLPSGetFrontProcess(&psn);
+
+  int connection_id = SLSMainConnectionID();
+  int target_cid    = 0;
+  SLSGetConnectionIDForPSN(connection_id, &psn, &target_cid);
+
+  pid_t pid = 0;
+  SLSConnectionGetPID(target_cid, &pid);
+
+  if (pid == 0)
+    fprintf(stderr, "Unable to get PID of frontmost application\n");
+  return pid;
+}
+
+// Notifications that make a cached menu bar stale
+static const CFStringRef* const AX_INVALIDATING_NOTIFICATIONS[] = {
+    &kAXFocusedWindowChangedNotification,
+    &kAXMenuItemSelectedNotification,
+    &kAXTitleChangedNotification,
+    &kAXUIElementDestroyedNotification,
+};
+
+struct ax_observer {
+  pid_t          pid;
+  AXObserverRef  observer;
+  AXUIElementRef app;
+};
+
+struct ax_backend {
+  struct menu_backend* backend;
+  struct ax_observer   observers[MENU_MAX_ITEMS];
+  struct window_source windows;
+  struct alias_index   aliases;
+
+  menu_readable_fn on_readable;
+  void*            readable_arg;
+};
+
+/**
+ * Copies the title of an element into a C string
+ *
+ * @param element Element to read the title from
+ * @param buffer Output buffer
+ * @param size Size of the output buffer
+ * @return true if a non-empty title was copied
+ */
+[[nodiscard]] static bool ax_copy_title(AXUIElementRef element, char* buffer, CFIndex size) {
+  CFStringRef title = ax_get_title(element);
+  if (!title)
+    return false;
+
+  bool copied = CFStringGetLength(title) > 0 && CFStringGetCString(title, buffer, size, kCFStringEncodingUTF8);
+  CFRelease(title);
+  return copied;
+}
+
+static pid_t ax_backend_front_pid(void* ctx) {
+  (void)ctx;
+  return ax_get_front_pid();
+}
+
+static bool ax_backend_snapshot(void* ctx, pid_t pid, struct menu_snapshot* out) {
+  (void)ctx;
+
+  AXUIElementRef app = AXUIElementCreateApplication(pid);
+  if (!app)
+    return false;
+
+  AXUIElementRef menubars_ref = NULL;
+  CFArrayRef     children_ref = NULL;
+  bool           success      = false;
+
+  AXError error = AXUIElementCopyAttributeValue(app, kAXMenuBarAttribute, (CFTypeRef*)&menubars_ref);
+
+  if (error == kAXErrorSuccess && menubars_ref) {
+    error = AXUIElementCopyAttributeValue(menubars_ref, kAXVisibleChildrenAttribute, (CFTypeRef*)&children_ref);
+
+    if (error == kAXErrorSuccess && children_ref) {
+      CFIndex count = CFArrayGetCount(children_ref);
+      char    title[MAX_NAME_BUFFER];
+
+      for (CFIndex i = 0; i < count; i++) {
+        AXUIElementRef item = (AXUIElementRef)CFArrayGetValueAtIndex(children_ref, i);
+
+        // The Apple menu is never listed, no need to fetch its title
+        bool has_title = i > 0 && ax_copy_title(item, title, sizeof(title));
+        if (!menu_snapshot_push(out, has_title ? title : NULL, (void*)CFRetain(item))) {
+          CFRelease(item);
+          break;
+        }
+      }
+      CFRelease(children_ref);
+      success = true;
+    }
+    CFRelease(menubars_ref);
+  }
+
+  CFRelease(app);
+  return success;
+}
+
+static bool ax_backend_press(void* ctx, void* item) {
+  (void)ctx;
+  return ax_perform_click((AXUIElementRef)item);
+}
+
+static void ax_backend_release(void* ctx, void* item) {
+  (void)ctx;
+  if (item)
+    CFRelease((CFTypeRef)item);
+}
+
+static bool ax_backend_select_extra(void* ctx, const char* alias) {
+  struct ax_backend* ax = ctx;
+  return ax_select_menu_extra(&ax->aliases, alias);
+}
+
+/**
+ * Observer callback: forwards every notification as an invalidation of its pid
+ */
+static void ax_observer_callback(AXObserverRef observer, AXUIElementRef element, CFStringRef notification, void* refcon) {
+  (void)observer;
+  (void)notification;
+
+  struct ax_backend* ax  = refcon;
+  pid_t              pid = 0;
+  if (AXUIElementGetPid(element, &pid) != kAXErrorSuccess)
+    return;
+
+  if (ax->backend->on_invalidate)
+    ax->backend->on_invalidate(ax->backend->invalidate_arg, pid);
+}
+
+static void ax_backend_unwatch(void* ctx, pid_t pid) {
+  struct ax_backend* ax = ctx;
+
+  for (int i = 0; i < MENU_MAX_ITEMS; i++) {
+    struct ax_observer* slot = &ax->observers[i];
+    if (slot->pid != pid || !slot->observer)
+      continue;
+
+    for (size_t n = 0; n < sizeof(AX_INVALIDATING_NOTIFICATIONS) / sizeof(*AX_INVALIDATING_NOTIFICATIONS); n++)
+      AXObserverRemoveNotification(slot->observer, slot->app, *AX_INVALIDATING_NOTIFICATIONS[n]);
+
+    CFRunLoopRemoveSource(CFRunLoopGetCurrent(), AXObserverGetRunLoopSource(slot->observer), kCFRunLoopDefaultMode);
+    CFRelease(slot->observer);
+    CFRelease(slot->app);
+    memset(slot, 0, sizeof(struct ax_observer));
+  }
+}
+
+static bool ax_backend_watch(void* ctx, pid_t pid) {
+  struct ax_backend*  ax   = ctx;
+  struct ax_observer* slot = NULL;
+
+  for (int i = 0; i < MENU_MAX_ITEMS; i++) {
+    if (ax->observers[i].pid == pid && ax->observers[i].observer)
+      return true;
+    if (!slot && !ax->observers[i].observer)
+      slot = &ax->observers[i];
+  }
+
+  if (!slot)
+    return false;
+
+  AXObserverRef observer = NULL;
+  if (AXObserverCreate(pid, ax_observer_callback, &observer) != kAXErrorSuccess || !observer)
+    return false;
+
+  AXUIElementRef app = AXUIElementCreateApplication(pid);
+  if (!app) {
+    CFRelease(observer);
+    return false;
+  }
+
+  // Without at least one registered notification the cache could never be refreshed
+  size_t registered = 0;
+  for (size_t n = 0; n < sizeof(AX_INVALIDATING_NOTIFICATIONS) / sizeof(*AX_INVALIDATING_NOTIFICATIONS); n++) {
+    if (AXObserverAddNotification(observer, app, *AX_INVALIDATING_NOTIFICATIONS[n], ax) == kAXErrorSuccess)
+      registered++;
+  }
+
+  if (!registered) {
+    CFRelease(app);
+    CFRelease(observer);
+    return false;
+  }
+
+  CFRunLoopAddSource(CFRunLoopGetCurrent(), AXObserverGetRunLoopSource(observer), kCFRunLoopDefaultMode);
+  slot->pid      = pid;
+  slot->observer = observer;
+  slot->app      = app;
+  return true;
+}
+
+/**
+ * Bridges the listening socket into the CFRunLoop that drives the observers
+ */
+static void ax_fd_callback(CFFileDescriptorRef fdref, CFOptionFlags flags, void* info) {
+  (void)flags;
+  struct ax_backend* ax = info;
+  ax->on_readable(ax->readable_arg);
+  CFFileDescriptorEnableCallBacks(fdref, kCFFileDescriptorReadCallBack);
+}
+
+static void ax_backend_run(void* ctx, int fd, menu_readable_fn on_readable, void* arg) {
+  struct ax_backend* ax = ctx;
+  ax->on_readable       = on_readable;
+  ax->readable_arg      = arg;
+
+  CFFileDescriptorContext context = {0, ax, NULL, NULL, NULL};
+  CFFileDescriptorRef     fdref   = CFFileDescriptorCreate(kCFAllocatorDefault, fd, false, ax_fd_callback, &context);
+  if (!fdref) {
+    fprintf(stderr, "Unable to watch the daemon socket\n");
+    return;
+  }
+
+  CFRunLoopSourceRef source = CFFileDescriptorCreateRunLoopSource(kCFAllocatorDefault, fdref, 0);
+  CFRunLoopAddSource(CFRunLoopGetCurrent(), source, kCFRunLoopDefaultMode);
+  CFFileDescriptorEnableCallBacks(fdref, kCFFileDescriptorReadCallBack);
+
+  // Short slices keep the loop responsive to the stop flag set by signals
+  while (!ax->backend->stop || !*ax->backend->stop)
+    CFRunLoopRunInMode(kCFRunLoopDefaultMode, 0.5, false);
+
+  CFRunLoopRemoveSource(CFRunLoopGetCurrent(), source, kCFRunLoopDefaultMode);
+  CFRelease(source);
+  CFFileDescriptorInvalidate(fdref);
+  CFRelease(fdref);
+}
+
+/**
+ * Initializes the accessibility backend
+ *
+ * @param backend Interface to fill
+ * @param ax Backend state
+ * @return true if accessibility access is granted
+ */
+[[nodiscard]] static inline bool ax_backend_init(struct menu_backend* backend, struct ax_backend* ax) {
+  memset(ax, 0, sizeof(struct ax_backend));
+  ax->backend           = backend;
+  ax->windows.ctx       = ax;
+  ax->windows.enumerate = ax_enumerate_windows;
+  alias_index_init(&ax->aliases, &ax->windows, MENU_BAR_LAYER, ALIAS_INDEX_TTL_NS, ax_release_element);
+
+  memset(backend, 0, sizeof(struct menu_backend));
+  backend->name         = "ax";
+  backend->ctx          = ax;
+  backend->front_pid    = ax_backend_front_pid;
+  backend->snapshot     = ax_backend_snapshot;
+  backend->press        = ax_backend_press;
+  backend->release      = ax_backend_release;
+  backend->select_extra = ax_backend_select_extra;
+  backend->watch        = ax_backend_watch;
+  backend->unwatch      = ax_backend_unwatch;
+  backend->run          = ax_backend_run;
+
+  return ax_init();
+}
+
+#endif /* MENUS_AX_BACKEND_H */
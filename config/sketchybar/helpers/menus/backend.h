@@ -0,0 +1,113 @@
+#ifndef MENUS_BACKEND_H
+#define MENUS_BACKEND_H
+
+#include <signal.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/types.h>
+
+// Limits of a single cached menu bar
+#define MENU_MAX_ITEMS   32
+#define MENU_TITLE_BYTES 2048
+
+/**
+ * Snapshot of the menu bar of one application.
+ *
+ * Item 0 is the Apple menu: it is kept as a handle (so that `-s 0` keeps
+ * working) but its title is never listed, like the original `-l` output.
+ */
+struct menu_snapshot {
+  int    count;
+  void*  items[MENU_MAX_ITEMS]; // Backend-owned handles, released through the backend
+  size_t titles_len;
+  char   titles[MENU_TITLE_BYTES]; // Newline separated titles of items 1..count-1
+};
+
+/**
+ * Appends an item to a snapshot
+ *
+ * @param snapshot Snapshot to fill
+ * @param title UTF-8 title of the item, may be NULL
+ * @param item Backend handle of the item
+ * @return true if the item was stored, false if the snapshot is full
+ */
+static inline bool menu_snapshot_push(struct menu_snapshot* snapshot, const char* title, void* item) {
+  if (!snapshot || snapshot->count >= MENU_MAX_ITEMS)
+    return false;
+
+  int index              = snapshot->count++;
+  snapshot->items[index] = item;
+
+  if (index == 0 || !title || !title[0])
+    return true;
+
+  size_t length = strlen(title);
+  if (snapshot->titles_len + length + 1 >= MENU_TITLE_BYTES)
+    return true; // Keep the handle, drop the title
+
+  memcpy(snapshot->titles + snapshot->titles_len, title, length);
+  snapshot->titles_len += length;
+  snapshot->titles[snapshot->titles_len++] = '\n';
+  snapshot->titles[snapshot->titles_len]   = '\0';
+  return true;
+}
+
+typedef void (*menu_invalidate_fn)(void* arg, pid_t pid);
+typedef void (*menu_readable_fn)(void* arg);
+
+/**
+ * Interface to the accessibility layer.
+ *
+ * The AX implementation lives in ax_backend.h, a synthetic one usable on
+ * any platform lives in fake_backend.h.
+ */
+struct menu_backend {
+  const char* name;
+  void*       ctx;
+
+  // Pid of the frontmost application, 0 on error
+  pid_t (*front_pid)(void* ctx);
+  // Walks the menu bar of pid and fills the snapshot
+  bool (*snapshot)(void* ctx, pid_t pid, struct menu_snapshot* out);
+  // Presses an item previously returned by snapshot
+  bool (*press)(void* ctx, void* item);
+  // Releases an item previously returned by snapshot
+  void (*release)(void* ctx, void* item);
+  // Selects an item of the extras menu bar through its "owner,name" alias
+  bool (*select_extra)(void* ctx, const char* alias);
+  // Starts/stops delivering invalidations for pid
+  bool (*watch)(void* ctx, pid_t pid);
+  void (*unwatch)(void* ctx, pid_t pid);
+  // Runs the event loop until *stop is set, calling on_readable whenever fd can be read
+  void (*run)(void* ctx, int fd, menu_readable_fn on_readable, void* arg);
+
+  volatile sig_atomic_t* stop;
+
+  // Invalidation sink, set by the cache
+  menu_invalidate_fn on_invalidate;
+  void*              invalidate_arg;
+};
+
+/**
+ * Releases all the handles of a snapshot
+ *
+ * @param backend Backend that produced the snapshot
+ * @param snapshot Snapshot to clear
+ */
+static inline void menu_snapshot_clear(struct menu_backend* backend, struct menu_snapshot* snapshot) {
+  if (!snapshot)
+    return;
+
+  for (int i = 0; i < snapshot->count; i++) {
+    if (backend && backend->release && snapshot->items[i])
+      backend->release(backend->ctx, snapshot->items[i]);
+    snapshot->items[i] = NULL;
+  }
+  snapshot->count      = 0;
+  snapshot->titles_len = 0;
+  snapshot->titles[0]  = '\0';
+}
+
+#endif /* MENUS_BACKEND_H */
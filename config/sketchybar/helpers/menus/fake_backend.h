@@ -0,0 +1,268 @@
+#ifndef MENUS_FAKE_BACKEND_H
+#define MENUS_FAKE_BACKEND_H
+
+#include "alias_index.h"
+#include "backend.h"
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Layer of the synthetic status item windows, same value as the real menu bar
+#define FAKE_MENU_BAR_LAYER 0x19
+
+struct fake_window {
+  struct window_info info;
+  char               owner[32];
+  char               name[32];
+};
+
+/**
+ * Synthetic accessibility backend.
+ *
+ * Every pid owns a deterministic menu bar of `items` entries; each emulated
+ * AX attribute read burns `ax_cost_ns` nanoseconds, so the cost of a walk is
+ * comparable to the real one and the cache can be benchmarked anywhere.
+ * Status items come from a synthetic window list, see fake_backend_windows.
+ */
+struct fake_backend {
+  pid_t    front;
+  int      items;
+  uint64_t ax_cost_ns;
+  uint64_t ax_calls;
+  uint64_t presses;
+  pid_t    watched[MENU_MAX_ITEMS];
+
+  struct fake_window*  windows;
+  int                  window_count;
+  uint64_t             window_list_copies;
+  struct window_source window_source;
+  struct alias_index   aliases;
+
+  struct menu_backend* backend;
+};
+
+/**
+ * Current CLOCK_MONOTONIC time in nanoseconds
+ */
+[[nodiscard]] static inline uint64_t fake_now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * Emulates the cost of one AX round trip to the target application
+ */
+static inline void fake_ax_call(struct fake_backend* fake) {
+  fake->ax_calls++;
+  if (!fake->ax_cost_ns)
+    return;
+
+  uint64_t deadline = fake_now_ns() + fake->ax_cost_ns;
+  while (fake_now_ns() < deadline) {
+  }
+}
+
+static pid_t fake_front_pid(void* ctx) {
+  struct fake_backend* fake = ctx;
+  fake_ax_call(fake);
+  return fake->front;
+}
+
+static bool fake_snapshot(void* ctx, pid_t pid, struct menu_snapshot* out) {
+  struct fake_backend* fake = ctx;
+
+  // Menu bar attribute plus visible children
+  fake_ax_call(fake);
+  fake_ax_call(fake);
+
+  char title[64];
+  for (int i = 0; i < fake->items; i++) {
+    fake_ax_call(fake); // Title attribute
+    snprintf(title, sizeof(title), "Menu %d.%d", (int)pid, i);
+    if (!menu_snapshot_push(out, title, (void*)(uintptr_t)(((uint64_t)pid << 8) | (uint64_t)(i + 1))))
+      break;
+  }
+  return true;
+}
+
+static bool fake_press(void* ctx, void* item) {
+  struct fake_backend* fake = ctx;
+  fake_ax_call(fake);
+  fake->presses++;
+  return item != NULL;
+}
+
+static void fake_release(void* ctx, void* item) {
+  (void)ctx;
+  (void)item;
+}
+
+/**
+ * Window list source over the synthetic windows
+ */
+static bool fake_enumerate_windows(void* ctx, long long layer, window_visit_fn visit, void* arg) {
+  struct fake_backend* fake = ctx;
+  fake->window_list_copies++;
+
+  for (int i = 0; i < fake->window_count; i++) {
+    if (fake->windows[i].info.layer == layer)
+      visit(arg, &fake->windows[i].info);
+  }
+  return true;
+}
+
+/**
+ * Emulates the AX scan of the extras menu bar of pid: one position read per item
+ */
+[[nodiscard]] static void* fake_find_extra_menu_item(struct fake_backend* fake, pid_t pid, struct alias_bounds bounds) {
+  fake_ax_call(fake); // Extras menu bar
+  fake_ax_call(fake); // Visible children
+
+  for (int i = 0; i < fake->window_count; i++) {
+    const struct window_info* info = &fake->windows[i].info;
+    if (info->pid != pid || info->layer != FAKE_MENU_BAR_LAYER)
+      continue;
+    fake_ax_call(fake); // Position attribute
+    if (info->bounds.x == bounds.x)
+      return (void*)(uintptr_t)(i + 1);
+  }
+  return NULL;
+}
+
+static bool fake_select_extra(void* ctx, const char* alias) {
+  struct fake_backend* fake  = ctx;
+  struct alias_entry*  entry = alias_index_lookup(&fake->aliases, alias, fake_now_ns());
+  if (!entry)
+    return false;
+
+  if (!entry->element)
+    entry->element = fake_find_extra_menu_item(fake, entry->pid, entry->bounds);
+  if (!entry->element)
+    return false;
+
+  fake_ax_call(fake);
+  fake->presses++;
+  return true;
+}
+
+static bool fake_watch(void* ctx, pid_t pid) {
+  struct fake_backend* fake = ctx;
+  for (int i = 0; i < MENU_MAX_ITEMS; i++) {
+    if (fake->watched[i] == 0 || fake->watched[i] == pid) {
+      fake->watched[i] = pid;
+      return true;
+    }
+  }
+  return false;
+}
+
+static void fake_unwatch(void* ctx, pid_t pid) {
+  struct fake_backend* fake = ctx;
+  for (int i = 0; i < MENU_MAX_ITEMS; i++) {
+    if (fake->watched[i] == pid)
+      fake->watched[i] = 0;
+  }
+}
+
+static void fake_run(void* ctx, int fd, menu_readable_fn on_readable, void* arg) {
+  struct fake_backend* fake = ctx;
+  struct pollfd        pfd  = {.fd = fd, .events = POLLIN};
+
+  while (!fake->backend->stop || !*fake->backend->stop) {
+    int ready = poll(&pfd, 1, 500);
+    if (ready > 0 && (pfd.revents & POLLIN))
+      on_readable(arg);
+  }
+}
+
+/**
+ * Emulates an AX notification for pid: the menu bar of the app changed
+ *
+ * @param backend Fake backend
+ * @param pid Application whose menus changed
+ */
+static inline void fake_backend_touch(struct menu_backend* backend, pid_t pid) {
+  struct fake_backend* fake = backend->ctx;
+  for (int i = 0; i < MENU_MAX_ITEMS; i++) {
+    if (fake->watched[i] == pid && backend->on_invalidate)
+      backend->on_invalidate(backend->invalidate_arg, pid);
+  }
+}
+
+/**
+ * Replaces the synthetic window list
+ *
+ * Windows are spread over count / 8 owner pids; one window every
+ * `menubar_every` sits on the menu bar layer and is named "Owner<pid>,Item<i>".
+ *
+ * @param backend Fake backend
+ * @param count Total number of windows
+ * @param menubar_every Ratio of windows that are status items
+ * @return true on success
+ */
+[[nodiscard]] static inline bool fake_backend_windows(struct menu_backend* backend, int count, int menubar_every) {
+  struct fake_backend* fake = backend->ctx;
+
+  alias_index_cleanup(&fake->aliases);
+  free(fake->windows);
+  fake->window_count = 0;
+
+  fake->windows = calloc((size_t)count, sizeof(struct fake_window));
+  if (!fake->windows)
+    return false;
+
+  for (int i = 0; i < count; i++) {
+    struct fake_window* window = &fake->windows[i];
+    pid_t               pid    = 1000 + i / 8;
+    bool                status = menubar_every > 0 && i % menubar_every == 0;
+
+    snprintf(window->owner, sizeof(window->owner), "Owner%d", (int)pid);
+    snprintf(window->name, sizeof(window->name), "%s%d", status ? "Item" : "Window", i);
+    window->info = (struct window_info){
+        .owner  = window->owner,
+        .name   = window->name,
+        .pid    = pid,
+        .layer  = status ? FAKE_MENU_BAR_LAYER : 0,
+        .bounds = {(double)(i * 24), 0.0, 24.0, 24.0},
+    };
+  }
+
+  fake->window_count = count;
+  return true;
+}
+
+/**
+ * Initializes the fake backend
+ *
+ * @param backend Interface to fill
+ * @param fake Backend state
+ * @param items Number of items of every synthetic menu bar
+ * @param ax_cost_ns Emulated cost of every AX call
+ */
+static inline void fake_backend_init(struct menu_backend* backend, struct fake_backend* fake, int items, uint64_t ax_cost_ns) {
+  memset(fake, 0, sizeof(struct fake_backend));
+  fake->front      = 100;
+  fake->items      = items;
+  fake->ax_cost_ns = ax_cost_ns;
+  fake->backend    = backend;
+
+  fake->window_source.ctx       = fake;
+  fake->window_source.enumerate = fake_enumerate_windows;
+  alias_index_init(&fake->aliases, &fake->window_source, FAKE_MENU_BAR_LAYER, 2000000000ull, NULL);
+
+  memset(backend, 0, sizeof(struct menu_backend));
+  backend->name         = "fake";
+  backend->ctx          = fake;
+  backend->front_pid    = fake_front_pid;
+  backend->snapshot     = fake_snapshot;
+  backend->press        = fake_press;
+  backend->release      = fake_release;
+  backend->select_extra = fake_select_extra;
+  backend->watch        = fake_watch;
+  backend->unwatch      = fake_unwatch;
+  backend->run          = fake_run;
+}
+
+#endif /* MENUS_FAKE_BACKEND_H */
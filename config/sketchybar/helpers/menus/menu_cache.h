@@ -0,0 +1,135 @@
+#ifndef MENUS_MENU_CACHE_H
+#define MENUS_MENU_CACHE_H
+
+#include "backend.h"
+
+// Number of applications kept in the cache, least recently used is evicted
+#define MENU_CACHE_SLOTS 16
+
+struct menu_cache_entry {
+  pid_t                pid;
+  bool                 valid;   // Snapshot matches the current menu bar
+  bool                 watched; // Backend delivers invalidations for pid
+  uint64_t             last_used;
+  struct menu_snapshot snapshot;
+};
+
+struct menu_cache {
+  struct menu_backend*    backend;
+  uint64_t                clock;
+  struct menu_cache_entry entries[MENU_CACHE_SLOTS];
+
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t invalidations;
+};
+
+/**
+ * Marks the snapshot of pid as stale, called by the backend observers
+ *
+ * @param arg The cache
+ * @param pid Application whose menu bar changed
+ */
+static void menu_cache_invalidate(void* arg, pid_t pid) {
+  struct menu_cache* cache = arg;
+  if (!cache)
+    return;
+
+  for (int i = 0; i < MENU_CACHE_SLOTS; i++) {
+    struct menu_cache_entry* entry = &cache->entries[i];
+    if (entry->pid == pid && entry->valid) {
+      entry->valid = false;
+      cache->invalidations++;
+    }
+  }
+}
+
+/**
+ * Initializes the cache and hooks it to the backend invalidations
+ *
+ * @param cache Cache to initialize
+ * @param backend Backend used to fill the cache
+ */
+static inline void menu_cache_init(struct menu_cache* cache, struct menu_backend* backend) {
+  memset(cache, 0, sizeof(struct menu_cache));
+  cache->backend          = backend;
+  backend->on_invalidate  = menu_cache_invalidate;
+  backend->invalidate_arg = cache;
+}
+
+/**
+ * Releases every cached handle and observer
+ *
+ * @param cache Cache to clean up
+ */
+static inline void menu_cache_cleanup(struct menu_cache* cache) {
+  for (int i = 0; i < MENU_CACHE_SLOTS; i++) {
+    struct menu_cache_entry* entry = &cache->entries[i];
+    if (entry->watched && cache->backend->unwatch)
+      cache->backend->unwatch(cache->backend->ctx, entry->pid);
+    menu_snapshot_clear(cache->backend, &entry->snapshot);
+    entry->pid     = 0;
+    entry->valid   = false;
+    entry->watched = false;
+  }
+}
+
+/**
+ * Returns the slot of pid, recycling the least recently used one if needed
+ */
+[[nodiscard]] static inline struct menu_cache_entry* menu_cache_slot(struct menu_cache* cache, pid_t pid) {
+  struct menu_cache_entry* victim = &cache->entries[0];
+
+  for (int i = 0; i < MENU_CACHE_SLOTS; i++) {
+    struct menu_cache_entry* entry = &cache->entries[i];
+    if (entry->pid == pid)
+      return entry;
+    if (entry->pid == 0 || (victim->pid != 0 && entry->last_used < victim->last_used))
+      victim = entry;
+  }
+
+  if (victim->watched && cache->backend->unwatch)
+    cache->backend->unwatch(cache->backend->ctx, victim->pid);
+  menu_snapshot_clear(cache->backend, &victim->snapshot);
+
+  victim->pid     = pid;
+  victim->valid   = false;
+  victim->watched = false;
+  return victim;
+}
+
+/**
+ * Gets the menu bar of pid, walking it through the backend only when stale
+ *
+ * @param cache Cache to query
+ * @param pid Application pid
+ * @return The cached snapshot, or NULL on error
+ */
+[[nodiscard]] static inline const struct menu_snapshot* menu_cache_get(struct menu_cache* cache, pid_t pid) {
+  if (!cache || pid <= 0)
+    return NULL;
+
+  struct menu_cache_entry* entry = menu_cache_slot(cache, pid);
+  entry->last_used               = ++cache->clock;
+
+  if (entry->valid) {
+    cache->hits++;
+    return &entry->snapshot;
+  }
+
+  cache->misses++;
+
+  // Subscribe before walking, so that changes racing with the walk invalidate it
+  if (!entry->watched && cache->backend->watch)
+    entry->watched = cache->backend->watch(cache->backend->ctx, pid);
+
+  menu_snapshot_clear(cache->backend, &entry->snapshot);
+  if (!cache->backend->snapshot(cache->backend->ctx, pid, &entry->snapshot))
+    return NULL;
+
+  // Without observers nothing would ever invalidate the entry: keep it one-shot
+  entry->valid = entry->watched;
+  return &entry->snapshot;
+}
+
+#endif /* MENUS_MENU_CACHE_H */
@@ -0,0 +1,321 @@
+#ifndef MENUS_MENU_SERVER_H
+#define MENUS_MENU_SERVER_H
+
+#include "menu_cache.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Maximum size of a request line and of a response
+#define MENU_REQUEST_BYTES  512
+#define MENU_RESPONSE_BYTES (MENU_TITLE_BYTES + 64)
+// Time a client gets to send its request and to take the response
+#define MENU_CLIENT_TIMEOUT_MS 500
+
+/**
+ * Request protocol, one request per connection:
+ *
+ *   "l"          -> titles of the frontmost app, one per line
+ *   "s <id>"     -> presses menu item <id> of the frontmost app
+ *   "s <alias>"  -> presses the extras menu item "owner,name"
+ *   "i"          -> cache statistics
+ *
+ * The connection is closed by the server after the response.
+ */
+struct menu_server {
+  struct menu_cache cache;
+  int               fd;
+  char              path[sizeof(((struct sockaddr_un*)0)->sun_path)];
+};
+
+/**
+ * Builds the path of the daemon socket for the current bar and user
+ *
+ * @param buffer Output buffer
+ * @param size Size of the buffer
+ * @return true on success, false if the path does not fit
+ */
+[[nodiscard]] static inline bool menu_socket_path(char* buffer, size_t size) {
+  const char* name = getenv("BAR_NAME");
+  if (!name)
+    name = "sketchybar";
+
+  const char* tmp = getenv("TMPDIR");
+  if (!tmp || !tmp[0])
+    tmp = "/tmp";
+
+  size_t tmp_len = strlen(tmp);
+  while (tmp_len > 1 && tmp[tmp_len - 1] == '/')
+    tmp_len--;
+
+  int written = snprintf(buffer, size, "%.*s/menus.%s.%u.sock", (int)tmp_len, tmp, name, (unsigned)getuid());
+  return written > 0 && written < (int)size;
+}
+
+/**
+ * Executes a single request against the cache
+ *
+ * @param server Server owning the cache
+ * @param request Request line, without trailing newline
+ * @param response Output buffer
+ * @param size Size of the output buffer
+ * @return Length of the response, -1 if the request failed
+ */
+static inline int menu_server_handle(struct menu_server* server, const char* request, char* response, size_t size) {
+  if (!server || !request || !response || size == 0)
+    return -1;
+
+  struct menu_cache*   cache   = &server->cache;
+  struct menu_backend* backend = cache->backend;
+  response[0]                  = '\0';
+
+  if (strcmp(request, "l") == 0) {
+    const struct menu_snapshot* snapshot = menu_cache_get(cache, backend->front_pid(backend->ctx));
+    if (!snapshot)
+      return -1;
+
+    size_t length = snapshot->titles_len < size ? snapshot->titles_len : size - 1;
+    memcpy(response, snapshot->titles, length);
+    response[length] = '\0';
+    return (int)length;
+  }
+
+  if (request[0] == 's' && request[1] == ' ') {
+    const char* argument = request + 2;
+    int         id       = 0;
+    char        tail     = 0;
+
+    if (sscanf(argument, "%d%c", &id, &tail) == 1) {
+      const struct menu_snapshot* snapshot = menu_cache_get(cache, backend->front_pid(backend->ctx));
+      if (!snapshot || id < 0 || id >= snapshot->count)
+        return -1;
+      return backend->press(backend->ctx, snapshot->items[id]) ? 0 : -1;
+    }
+
+    return backend->select_extra(backend->ctx, argument) ? 0 : -1;
+  }
+
+  if (strcmp(request, "i") == 0) {
+    return snprintf(
+        response, size, "backend=%s hits=%llu misses=%llu invalidations=%llu\n", backend->name,
+        (unsigned long long)cache->hits, (unsigned long long)cache->misses, (unsigned long long)cache->invalidations);
+  }
+
+  return -1;
+}
+
+/**
+ * Reads a full line from a connected socket
+ *
+ * @return Length of the line, -1 if the read failed or timed out
+ */
+[[nodiscard]] static inline int menu_read_line(int fd, char* buffer, size_t size) {
+  size_t length = 0;
+  while (length < size - 1) {
+    ssize_t bytes = read(fd, buffer + length, size - 1 - length);
+    if (bytes < 0 && errno == EINTR)
+      continue;
+    if (bytes < 0)
+      return -1;
+    if (bytes == 0)
+      break;
+    length += (size_t)bytes;
+    if (memchr(buffer + length - bytes, '\n', (size_t)bytes))
+      break;
+  }
+  buffer[length] = '\0';
+
+  char* newline = strchr(buffer, '\n');
+  if (newline) {
+    *newline = '\0';
+    length   = (size_t)(newline - buffer);
+  }
+  return (int)length;
+}
+
+/**
+ * Writes the whole buffer to a socket
+ */
+[[nodiscard]] static inline bool menu_write_all(int fd, const char* buffer, size_t length) {
+  while (length > 0) {
+    ssize_t bytes = write(fd, buffer, length);
+    if (bytes < 0 && errno == EINTR)
+      continue;
+    if (bytes <= 0)
+      return false;
+    buffer += bytes;
+    length -= (size_t)bytes;
+  }
+  return true;
+}
+
+/**
+ * Accepts and serves one pending connection, called by the backend run loop.
+ * The daemon has a single thread: a client that never sends its line or
+ * never reads the response is dropped after MENU_CLIENT_TIMEOUT_MS instead
+ * of blocking every later request.
+ *
+ * @param arg The server
+ */
+static void menu_server_on_readable(void* arg) {
+  struct menu_server* server = arg;
+
+  // The listening socket is non-blocking: a connection gone before accept returns at once
+  int client = accept(server->fd, NULL, NULL);
+  if (client < 0)
+    return;
+
+  // On macOS the accepted socket inherits O_NONBLOCK, and the timeouts below only apply to blocking reads
+  int flags = fcntl(client, F_GETFL);
+  if (flags < 0 || fcntl(client, F_SETFL, flags & ~O_NONBLOCK) < 0) {
+    close(client);
+    return;
+  }
+
+  struct timeval timeout = {.tv_sec = MENU_CLIENT_TIMEOUT_MS / 1000, .tv_usec = (MENU_CLIENT_TIMEOUT_MS % 1000) * 1000};
+  if (setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) < 0
+      || setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout)) < 0) {
+    close(client);
+    return;
+  }
+
+  char request[MENU_REQUEST_BYTES];
+  char response[MENU_RESPONSE_BYTES];
+
+  if (menu_read_line(client, request, sizeof(request)) > 0) {
+    int length = menu_server_handle(server, request, response, sizeof(response));
+
+    // The first byte is the status, so clients can tell empty from failed
+    if (menu_write_all(client, length < 0 ? "E" : "O", 1) && length > 0)
+      (void)menu_write_all(client, response, (size_t)length);
+  }
+
+  close(client);
+}
+
+/**
+ * Creates the listening socket of the daemon
+ *
+ * @param server Server to initialize
+ * @param backend Backend used to serve requests
+ * @return true on success, false otherwise
+ */
+[[nodiscard]] static inline bool menu_server_init(struct menu_server* server, struct menu_backend* backend) {
+  menu_cache_init(&server->cache, backend);
+  server->fd = -1;
+
+  if (!menu_socket_path(server->path, sizeof(server->path))) {
+    fprintf(stderr, "Socket path too long\n");
+    return false;
+  }
+
+  server->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (server->fd < 0) {
+    fprintf(stderr, "Unable to create socket: %s\n", strerror(errno));
+    return false;
+  }
+  fcntl(server->fd, F_SETFD, FD_CLOEXEC);
+  fcntl(server->fd, F_SETFL, fcntl(server->fd, F_GETFL) | O_NONBLOCK);
+
+  struct sockaddr_un address = {0};
+  address.sun_family         = AF_UNIX;
+  memcpy(address.sun_path, server->path, strlen(server->path) + 1);
+
+  // A previous daemon may have left its socket behind
+  unlink(server->path);
+
+  if (bind(server->fd, (struct sockaddr*)&address, sizeof(address)) < 0 || listen(server->fd, 16) < 0) {
+    fprintf(stderr, "Unable to listen on %s: %s\n", server->path, strerror(errno));
+    close(server->fd);
+    server->fd = -1;
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * Serves requests until the backend run loop returns
+ *
+ * @param server Initialized server
+ */
+static inline void menu_server_run(struct menu_server* server) {
+  struct menu_backend* backend = server->cache.backend;
+  backend->run(backend->ctx, server->fd, menu_server_on_readable, server);
+}
+
+/**
+ * Closes the socket and releases the cache
+ *
+ * @param server Server to clean up
+ */
+static inline void menu_server_cleanup(struct menu_server* server) {
+  if (server->fd >= 0) {
+    close(server->fd);
+    unlink(server->path);
+    server->fd = -1;
+  }
+  menu_cache_cleanup(&server->cache);
+}
+
+/**
+ * Sends a request to a running daemon
+ *
+ * @param request Request line
+ * @param response Output buffer, NUL terminated
+ * @param size Size of the output buffer
+ * @return Length of the response, -1 if the daemon failed the request, -2 if no daemon is running
+ */
+static inline int menu_client_request(const char* request, char* response, size_t size) {
+  struct sockaddr_un address = {0};
+  address.sun_family         = AF_UNIX;
+  if (!menu_socket_path(address.sun_path, sizeof(address.sun_path)))
+    return -2;
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+    return -2;
+
+  if (connect(fd, (struct sockaddr*)&address, sizeof(address)) < 0) {
+    close(fd);
+    return -2;
+  }
+
+  size_t request_len = strlen(request);
+  if (!menu_write_all(fd, request, request_len) || !menu_write_all(fd, "\n", 1)) {
+    close(fd);
+    return -2;
+  }
+
+  char    status = 0;
+  ssize_t bytes;
+  do {
+    bytes = read(fd, &status, 1);
+  } while (bytes < 0 && errno == EINTR);
+
+  if (bytes != 1) {
+    close(fd);
+    return -2;
+  }
+
+  size_t length = 0;
+  while (length < size - 1) {
+    bytes = read(fd, response + length, size - 1 - length);
+    if (bytes < 0 && errno == EINTR)
+      continue;
+    if (bytes <= 0)
+      break;
+    length += (size_t)bytes;
+  }
+  response[length] = '\0';
+  close(fd);
+
+  return status == 'O' ? (int)length : -1;
+}
+
+#endif /* MENUS_MENU_SERVER_H */
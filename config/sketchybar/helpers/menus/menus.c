@@ -1,403 +1,287 @@
-#include <Carbon/Carbon.h>
+#include "fake_backend.h"
+#include "menu_server.h"
+#include <signal.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
-// Constants for better clarity
-static const int MENU_BAR_LAYER           = 0x19;
-static const int MAIN_DISPLAY             = 0;
-static const int MAX_BUFFER_SIZE          = 512;
-static const int MAX_NAME_BUFFER          = 256;
-static const int CLICK_DELAY_MICROSECONDS = 150000; // 150ms
+#ifdef __APPLE__
+#include "ax_backend.h"
+#endif
 
-/**
- * Initializes accessibility API access
- *
- * @return true if initialization succeeds, false otherwise
- */
-[[nodiscard]] static bool ax_init() {
-  const void* keys[]   = {kAXTrustedCheckOptionPrompt};
-  const void* values[] = {kCFBooleanTrue};
-
-  CFDictionaryRef options = CFDictionaryCreate(
-      kCFAllocatorDefault, keys, values, sizeof(keys) / sizeof(*keys), &kCFCopyStringDictionaryKeyCallBacks,
-      &kCFTypeDictionaryValueCallBacks);
+// Defaults of the synthetic backend used by -f and -b
+static const int      FAKE_MENU_ITEMS      = 12;
+static const uint64_t FAKE_AX_COST_NS      = 20000; // 20us, in line with a responsive app
+static const int      BENCHMARK_ITERATIONS = 2000;
+static const int      BENCHMARK_WINDOWS    = 2000;
+static const int      BENCHMARK_STATUS     = 16; // One status item every 16 windows
 
-  if (!options) {
-    fprintf(stderr, "Error creating options dictionary\n");
-    return false;
-  }
-
-  bool trusted = AXIsProcessTrustedWithOptions(options);
-  CFRelease(options);
-
-  if (!trusted) {
-    fprintf(stderr, "Accessibility permissions not granted\n");
-    return false;
-  }
+static volatile sig_atomic_t g_terminate_flag = 0;
 
-  return true;
+static void handle_signal(int sig) {
+  (void)sig;
+  g_terminate_flag = 1;
 }
 
 /**
- * Performs a click on a UI element
- *
- * @param element Element to click on
+ * Shows program usage
  */
-static void ax_perform_click(AXUIElementRef element) {
-  if (!element)
-    return;
-
-  // First cancel any ongoing action
-  AXUIElementPerformAction(element, kAXCancelAction);
-  usleep(CLICK_DELAY_MICROSECONDS);
-
-  // Then perform the press action
-  AXUIElementPerformAction(element, kAXPressAction);
+static void show_usage(const char* program_name) {
+  if (!program_name)
+    program_name = "menus";
+  printf("Usage: %s [-f] [-l | -s id/alias | -d | -b [iterations]]\n", program_name);
+  printf("  -l: List menu options in the frontmost app\n");
+  printf("  -s id: Select menu option with specified ID\n");
+  printf(
+      "  -s alias: Select extra menu option with specified alias (format: "
+      "'app,name')\n");
+  printf("  -d: Run as a resident daemon caching menus per app\n");
+  printf("  -b: Benchmark the cache and the daemon round trip on the synthetic backend\n");
+  printf("  -f: Use the synthetic backend instead of the accessibility APIs\n");
 }
 
 /**
- * Gets the title of a UI element
- *
- * @param element Element to get the title from
- * @return The element's title, or NULL on error
+ * Microseconds per operation since start
  */
-[[nodiscard]] static CFStringRef ax_get_title(AXUIElementRef element) {
-  if (!element)
-    return NULL;
-
-  CFTypeRef title = NULL;
-  AXError   error = AXUIElementCopyAttributeValue(element, kAXTitleAttribute, &title);
-
-  if (error != kAXErrorSuccess)
-    return NULL;
-  return (CFStringRef)title;
+[[nodiscard]] static double us_per_op(uint64_t start_ns, int iterations) {
+  return (double)(fake_now_ns() - start_ns) / 1000.0 / (double)iterations;
 }
 
 /**
- * Selects a menu option by ID
- *
- * @param app Application containing the menu
- * @param id ID of the option to select
+ * Alias resolution as done before the index: format and compare every window
+ * of the full list, then scan the extras menu bar of the owner
  */
-static void ax_select_menu_option(AXUIElementRef app, int id) {
-  if (!app || id < 0)
-    return;
+static bool linear_select_extra(struct fake_backend* fake, const char* alias) {
+  char buffer[2 * ALIAS_MAX_LENGTH];
+  fake->window_list_copies++;
 
-  AXUIElementRef menubars_ref = NULL;
-  CFArrayRef     children_ref = NULL;
-
-  AXError error = AXUIElementCopyAttributeValue(app, kAXMenuBarAttribute, (CFTypeRef*)&menubars_ref);
+  for (int i = 0; i < fake->window_count; i++) {
+    const struct window_info* info = &fake->windows[i].info;
+    if (info->layer != FAKE_MENU_BAR_LAYER)
+      continue;
 
-  if (error == kAXErrorSuccess && menubars_ref) {
-    error = AXUIElementCopyAttributeValue(menubars_ref, kAXVisibleChildrenAttribute, (CFTypeRef*)&children_ref);
+    snprintf(buffer, sizeof(buffer), "%s,%s", info->owner, info->name);
+    if (strcmp(buffer, alias) != 0)
+      continue;
 
-    if (error == kAXErrorSuccess && children_ref) {
-      CFIndex count = CFArrayGetCount(children_ref);
-      if (id < count) {
-        AXUIElementRef item = (AXUIElementRef)CFArrayGetValueAtIndex(children_ref, id);
-        ax_perform_click(item);
-      }
-      CFRelease(children_ref);
-    }
-    CFRelease(menubars_ref);
+    if (!fake_find_extra_menu_item(fake, info->pid, info->bounds))
+      return false;
+    fake_ax_call(fake);
+    return true;
   }
+  return false;
 }
 
 /**
- * Prints available menu options
+ * Measures cold walks, cache hits and daemon round trips on the fake backend
  *
- * @param app Application containing the menu
+ * @param iterations Number of requests per measurement
+ * @return Exit status
  */
-static void ax_print_menu_options(AXUIElementRef app) {
-  if (!app)
-    return;
-
-  AXUIElementRef menubars_ref = NULL;
-  CFArrayRef     children_ref = NULL;
-
-  AXError error = AXUIElementCopyAttributeValue(app, kAXMenuBarAttribute, (CFTypeRef*)&menubars_ref);
-
-  if (error == kAXErrorSuccess && menubars_ref) {
-    error = AXUIElementCopyAttributeValue(menubars_ref, kAXVisibleChildrenAttribute, (CFTypeRef*)&children_ref);
-
-    if (error == kAXErrorSuccess && children_ref) {
-      CFIndex count = CFArrayGetCount(children_ref);
-
-      for (CFIndex i = 1; i < count; i++) {
-        AXUIElementRef item  = (AXUIElementRef)CFArrayGetValueAtIndex(children_ref, i);
-        CFStringRef    title = ax_get_title(item);
-
-        if (title) {
-          CFIndex title_length = CFStringGetLength(title);
-          if (title_length > 0) {
-            // Safe buffer allocation for the string
-            CFIndex buffer_size = CFStringGetMaximumSizeForEncoding(title_length, kCFStringEncodingUTF8) + 1;
-            char*   buffer      = (char*)malloc(buffer_size);
-
-            if (buffer) {
-              if (CFStringGetCString(title, buffer, buffer_size, kCFStringEncodingUTF8)) {
-                printf("%s\n", buffer);
-              }
-              free(buffer);
-            }
-          }
-          CFRelease(title);
-        }
-      }
-      CFRelease(children_ref);
-    }
-    CFRelease(menubars_ref);
+static int run_benchmark(int iterations) {
+  struct menu_backend backend;
+  struct fake_backend fake;
+  fake_backend_init(&backend, &fake, FAKE_MENU_ITEMS, FAKE_AX_COST_NS);
+
+  struct menu_server server = {.fd = -1};
+  menu_cache_init(&server.cache, &backend);
+
+  char     response[MENU_RESPONSE_BYTES];
+  uint64_t calls = fake.ax_calls;
+  uint64_t start = fake_now_ns();
+  for (int i = 0; i < iterations; i++) {
+    fake_backend_touch(&backend, fake.front);
+    (void)menu_server_handle(&server, "l", response, sizeof(response));
   }
-}
-
-/**
- * Gets an extra menu item (icons in the system menubar)
- *
- * @param alias Application,window alias
- * @return The corresponding UI element, or NULL on error
- */
-[[nodiscard]] static AXUIElementRef ax_get_extra_menu_item(const char* alias) {
-  if (!alias)
-    return NULL;
-
-  pid_t      pid         = 0;
-  CGRect     bounds      = CGRectNull;
-  CFArrayRef window_list = CGWindowListCopyWindowInfo(kCGWindowListOptionAll, kCGNullWindowID);
-
-  if (!window_list) {
-    fprintf(stderr, "Unable to get window list\n");
-    return NULL;
-  }
-
-  char owner_buffer[MAX_NAME_BUFFER] = {0};
-  char name_buffer[MAX_NAME_BUFFER]  = {0};
-  char buffer[MAX_BUFFER_SIZE]       = {0};
-  int  window_count                  = CFArrayGetCount(window_list);
+  printf(
+      "cold list:     %9.2f us/op  %5.1f ax calls/op\n", us_per_op(start, iterations),
+      (double)(fake.ax_calls - calls) / iterations);
 
-  for (int i = 0; i < window_count; ++i) {
-    CFDictionaryRef dictionary = CFArrayGetValueAtIndex(window_list, i);
-    if (!dictionary)
-      continue;
+  calls = fake.ax_calls;
+  start = fake_now_ns();
+  for (int i = 0; i < iterations; i++)
+    (void)menu_server_handle(&server, "l", response, sizeof(response));
+  printf(
+      "cached list:   %9.2f us/op  %5.1f ax calls/op\n", us_per_op(start, iterations),
+      (double)(fake.ax_calls - calls) / iterations);
 
-    CFStringRef     owner_ref     = CFDictionaryGetValue(dictionary, kCGWindowOwnerName);
-    CFNumberRef     owner_pid_ref = CFDictionaryGetValue(dictionary, kCGWindowOwnerPID);
-    CFStringRef     name_ref      = CFDictionaryGetValue(dictionary, kCGWindowName);
-    CFNumberRef     layer_ref     = CFDictionaryGetValue(dictionary, kCGWindowLayer);
-    CFDictionaryRef bounds_ref    = CFDictionaryGetValue(dictionary, kCGWindowBounds);
+  calls = fake.ax_calls;
+  start = fake_now_ns();
+  for (int i = 0; i < iterations; i++)
+    (void)menu_server_handle(&server, "s 3", response, sizeof(response));
+  printf(
+      "cached select: %9.2f us/op  %5.1f ax calls/op\n", us_per_op(start, iterations),
+      (double)(fake.ax_calls - calls) / iterations);
 
-    if (!name_ref || !owner_ref || !owner_pid_ref || !layer_ref || !bounds_ref)
-      continue;
+  // Status item clicks, cycling over every alias of the synthetic window list
+  if (!fake_backend_windows(&backend, BENCHMARK_WINDOWS, BENCHMARK_STATUS))
+    return 1;
 
-    long long int layer = 0;
-    CFNumberGetValue(layer_ref, CFNumberGetType(layer_ref), &layer);
+  char aliases[8][64];
+  for (int i = 0; i < 8; i++) {
+    const struct fake_window* window = &fake.windows[(i * 13 % (BENCHMARK_WINDOWS / BENCHMARK_STATUS)) * BENCHMARK_STATUS];
+    snprintf(aliases[i], sizeof(aliases[i]), "%s,%s", window->owner, window->name);
+  }
 
-    uint64_t owner_pid = 0;
-    CFNumberGetValue(owner_pid_ref, CFNumberGetType(owner_pid_ref), &owner_pid);
+  calls = fake.ax_calls;
+  start = fake_now_ns();
+  for (int i = 0; i < iterations; i++)
+    (void)linear_select_extra(&fake, aliases[i % 8]);
+  printf(
+      "linear alias:  %9.2f us/op  %5.1f ax calls/op\n", us_per_op(start, iterations),
+      (double)(fake.ax_calls - calls) / iterations);
 
-    if (layer != MENU_BAR_LAYER)
-      continue;
+  calls = fake.ax_calls;
+  start = fake_now_ns();
+  for (int i = 0; i < iterations; i++)
+    (void)fake_select_extra(&fake, aliases[i % 8]);
+  printf(
+      "indexed alias: %9.2f us/op  %5.1f ax calls/op  (%llu index refreshes)\n", us_per_op(start, iterations),
+      (double)(fake.ax_calls - calls) / iterations, (unsigned long long)fake.aliases.refreshes);
 
-    bounds = CGRectNull;
-    if (!CGRectMakeWithDictionaryRepresentation(bounds_ref, &bounds))
-      continue;
+  menu_cache_cleanup(&server.cache);
 
-    if (!CFStringGetCString(owner_ref, owner_buffer, sizeof(owner_buffer), kCFStringEncodingUTF8)
-        || !CFStringGetCString(name_ref, name_buffer, sizeof(name_buffer), kCFStringEncodingUTF8))
-      continue;
+  // Round trip through a forked daemon, as seen by `menus -l`
+  if (!menu_server_init(&server, &backend))
+    return 1;
 
-    int snprintf_result = snprintf(buffer, sizeof(buffer), "%s,%s", owner_buffer, name_buffer);
-    if (snprintf_result < 0 || snprintf_result >= (int)sizeof(buffer))
-      continue;
+  pid_t child = fork();
+  if (child < 0) {
+    menu_server_cleanup(&server);
+    return 1;
+  }
+  if (child == 0) {
+    backend.stop = &g_terminate_flag;
+    menu_server_run(&server);
+    _exit(0);
+  }
 
-    if (strcmp(buffer, alias) == 0) {
-      pid = owner_pid;
+  start = fake_now_ns();
+  for (int i = 0; i < iterations; i++) {
+    if (menu_client_request("l", response, sizeof(response)) < 0) {
+      fprintf(stderr, "Daemon request failed\n");
       break;
     }
   }
+  printf("daemon list:   %9.2f us/op\n", us_per_op(start, iterations));
 
-  CFRelease(window_list);
+  if (menu_client_request("i", response, sizeof(response)) > 0)
+    printf("%s", response);
 
-  if (!pid) {
-    return NULL;
-  }
+  kill(child, SIGTERM);
+  waitpid(child, NULL, 0);
+  menu_server_cleanup(&server);
+  return 0;
+}
 
-  AXUIElementRef app = AXUIElementCreateApplication(pid);
-  if (!app) {
-    return NULL;
+int main(int argc, char** argv) {
+  if (argc == 1) {
+    show_usage(argv[0]);
+    exit(0);
   }
 
-  AXUIElementRef result       = NULL;
-  CFTypeRef      extras       = NULL;
-  CFArrayRef     children_ref = NULL;
-
-  AXError error = AXUIElementCopyAttributeValue(app, kAXExtrasMenuBarAttribute, &extras);
-  if (error == kAXErrorSuccess && extras) {
-    error = AXUIElementCopyAttributeValue(extras, kAXVisibleChildrenAttribute, (CFTypeRef*)&children_ref);
-
-    if (error == kAXErrorSuccess && children_ref) {
-      CFIndex count = CFArrayGetCount(children_ref);
-      for (CFIndex i = 0; i < count; i++) {
-        AXUIElementRef item         = (AXUIElementRef)CFArrayGetValueAtIndex(children_ref, i);
-        CFTypeRef      position_ref = NULL;
-        CFTypeRef      size_ref     = NULL;
-
-        AXUIElementCopyAttributeValue(item, kAXPositionAttribute, &position_ref);
-        AXUIElementCopyAttributeValue(item, kAXSizeAttribute, &size_ref);
-
-        if (!position_ref || !size_ref) {
-          if (position_ref)
-            CFRelease(position_ref);
-          if (size_ref)
-            CFRelease(size_ref);
-          continue;
-        }
-
-        CGPoint position = CGPointZero;
-        AXValueGetValue(position_ref, kAXValueCGPointType, &position);
-
-        CGSize size = CGSizeZero;
-        AXValueGetValue(size_ref, kAXValueCGSizeType, &size);
-
-        CFRelease(position_ref);
-        CFRelease(size_ref);
-
-        // 10 point tolerance for positioning
-        static const CGFloat POSITION_TOLERANCE = 10.0;
-        if (fabs(position.x - bounds.origin.x) <= POSITION_TOLERANCE) {
-          result = (AXUIElementRef)CFRetain(item);
-          break;
-        }
-      }
-      CFRelease(children_ref);
-    }
-    CFRelease(extras);
+  bool use_fake = false;
+#ifndef __APPLE__
+  use_fake = true;
+#endif
+  if (strcmp(argv[1], "-f") == 0) {
+    use_fake = true;
+    argv++;
+    argc--;
   }
 
-  CFRelease(app);
-  return result;
-}
-
-// SkyLight function declarations
-extern int  SLSMainConnectionID();
-extern void SLSSetMenuBarVisibilityOverrideOnDisplay(int cid, int did, bool enabled);
-extern void SLSSetMenuBarInsetAndAlpha(int cid, double u1, double u2, float alpha);
-
-/**
- * Selects an item from the extra menu
- *
- * @param alias Application,window alias
- */
-static void ax_select_menu_extra(const char* alias) {
-  if (!alias)
-    return;
-
-  AXUIElementRef item = ax_get_extra_menu_item(alias);
-  if (!item) {
-    fprintf(stderr, "Unable to find menu item: %s\n", alias);
-    return;
+  if (argc < 2) {
+    show_usage(argv[0]);
+    return 1;
   }
 
-  int connection_id = SLSMainConnectionID();
-
-  // Temporarily hide the menubar
-  SLSSetMenuBarInsetAndAlpha(connection_id, 0, 1, 0.0);
-  SLSSetMenuBarVisibilityOverrideOnDisplay(connection_id, MAIN_DISPLAY, true);
-  SLSSetMenuBarInsetAndAlpha(connection_id, 0, 1, 0.0);
-
-  // Perform the click on the element
-  ax_perform_click(item);
-
-  // Restore the menubar
-  SLSSetMenuBarVisibilityOverrideOnDisplay(connection_id, MAIN_DISPLAY, false);
-  SLSSetMenuBarInsetAndAlpha(connection_id, 0, 1, 1.0);
+  if (strcmp(argv[1], "-b") == 0) {
+    int iterations = (argc > 2) ? atoi(argv[2]) : BENCHMARK_ITERATIONS;
+    return run_benchmark(iterations > 0 ? iterations : BENCHMARK_ITERATIONS);
+  }
 
-  CFRelease(item);
-}
+  // Build the request shared by the daemon protocol and the one-shot path
+  char request[MENU_REQUEST_BYTES];
+  bool daemon = strcmp(argv[1], "-d") == 0;
 
-// Process Serial Number function declarations
-extern void _SLPSGetFrontProcess(ProcessSerialNumber* psn);
-extern void SLSGetConnectionIDForPSN(int cid, ProcessSerialNumber* psn, int* cid_out);
-extern void SLSConnectionGetPID(int cid, pid_t* pid_out);
+  if (strcmp(argv[1], "-l") == 0) {
+    snprintf(request, sizeof(request), "l");
+  } else if (argc == 3 && strcmp(argv[1], "-s") == 0) {
+    int written = snprintf(request, sizeof(request), "s %s", argv[2]);
+    if (written < 0 || written >= (int)sizeof(request)) {
+      fprintf(stderr, "Selection too long\n");
+      return 1;
+    }
+  } else if (!daemon) {
+    show_usage(argv[0]);
+    return 1;
+  }
 
-/**
- * Gets the frontmost application
- *
- * @return The UI element of the frontmost application, or NULL on error
- */
-[[nodiscard]] static AXUIElementRef ax_get_front_app() {
-  ProcessSerialNumber psn = {0};
-  _SLPSGetFrontProcess(&psn);
+  char response[MENU_RESPONSE_BYTES];
+  int  length = 0;
 
-  int connection_id = SLSMainConnectionID();
-  int target_cid    = 0;
-  SLSGetConnectionIDForPSN(connection_id, &psn, &target_cid);
+  // A resident daemon answers from its cache without touching AX again
+  if (!daemon) {
+    length = menu_client_request(request, response, sizeof(response));
+    if (length >= 0) {
+      fputs(response, stdout);
+      return 0;
+    }
+    if (length == -1) {
+      fprintf(stderr, "Request failed: %s\n", request);
+      return 1;
+    }
+  }
 
-  pid_t pid = 0;
-  SLSConnectionGetPID(target_cid, &pid);
+  struct menu_backend backend;
+  struct fake_backend fake;
+#ifdef __APPLE__
+  struct ax_backend ax;
+#endif
 
-  if (pid == 0) {
-    fprintf(stderr, "Unable to get PID of frontmost application\n");
-    return NULL;
+  if (use_fake) {
+    fake_backend_init(&backend, &fake, FAKE_MENU_ITEMS, 0);
+  } else {
+#ifdef __APPLE__
+    if (!ax_backend_init(&backend, &ax)) {
+      fprintf(stderr, "Error initializing accessibility APIs\n");
+      return 1;
+    }
+#endif
   }
 
-  return AXUIElementCreateApplication(pid);
-}
+  struct menu_server server = {.fd = -1};
 
-/**
- * Shows program usage
- */
-static void show_usage(const char* program_name) {
-  if (!program_name)
-    program_name = "menus";
-  printf("Usage: %s [-l | -s id/alias ]\n", program_name);
-  printf("  -l: List menu options in the frontmost app\n");
-  printf("  -s id: Select menu option with specified ID\n");
-  printf(
-      "  -s alias: Select extra menu option with specified alias (format: "
-      "'app,name')\n");
-}
+  if (daemon) {
+    struct sigaction sa = {0};
+    sa.sa_handler       = handle_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
 
-int main(int argc, char** argv) {
-  if (argc == 1) {
-    show_usage(argv[0]);
-    exit(0);
-  }
+    if (!menu_server_init(&server, &backend))
+      return 1;
 
-  if (!ax_init()) {
-    fprintf(stderr, "Error initializing accessibility APIs\n");
-    return 1;
+    backend.stop = &g_terminate_flag;
+    menu_server_run(&server);
+    menu_server_cleanup(&server);
+    return 0;
   }
 
-  if (strcmp(argv[1], "-l") == 0) {
-    AXUIElementRef app = ax_get_front_app();
-    if (!app) {
-      fprintf(stderr, "Unable to get frontmost application\n");
-      return 1;
-    }
-    ax_print_menu_options(app);
-    CFRelease(app);
-  } else if (argc == 3 && strcmp(argv[1], "-s") == 0) {
-    int id = 0;
-    if (sscanf(argv[2], "%d", &id) == 1) {
-      // Select by numeric ID
-      AXUIElementRef app = ax_get_front_app();
-      if (!app) {
-        fprintf(stderr, "Unable to get frontmost application\n");
-        return 1;
-      }
-      ax_select_menu_option(app, id);
-      CFRelease(app);
-    } else {
-      // Select by alias
-      ax_select_menu_extra(argv[2]);
-    }
-  } else {
-    show_usage(argv[0]);
+  // No daemon running: serve the request in-process
+  menu_cache_init(&server.cache, &backend);
+  length = menu_server_handle(&server, request, response, sizeof(response));
+  if (length > 0)
+    fputs(response, stdout);
+  menu_server_cleanup(&server);
+
+  if (length < 0) {
+    fprintf(stderr, "Request failed: %s\n", request);
     return 1;
   }
-
   return 0;
 }
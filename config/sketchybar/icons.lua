@@ -7,6 +7,8 @@ local icons = {
     apple = "􀣺",
     gear = "􀍟",
     cpu = "􀫥",
+    memory = "􀫦",
+    disk = "􀤂",
     clipboard = "􀉄",
 
     switch = {
@@ -50,6 +52,8 @@ local icons = {
     apple = "",
     gear = "",
     cpu = "",
+    memory = "",
+    disk = "",
     clipboard = "Missing Icon",
 
     switch = {
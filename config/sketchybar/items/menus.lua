@@ -2,6 +2,10 @@ local colors = require("colors")
 local icons = require("icons")
 local settings = require("settings")
 
+-- Resident helper that keeps the menus of every app cached: the `menus -l`
+-- and `menus -s` calls below are answered by it over a local socket.
+sbar.exec("killall menus >/dev/null; $CONFIG_DIR/helpers/menus/bin/menus -d")
+
 local menu_watcher = sbar.add("item", {
   drawing = false,
   updates = false,
@@ -11,7 +11,6 @@ local battery = sbar.add("item", "widgets.battery", {
     }
   },
   label = { font = { family = settings.font.numbers } },
-  update_freq = 180,
   popup = { align = "center" }
 })
 
@@ -30,51 +29,61 @@ local remaining_time = sbar.add("item", {
 })
 
 
-battery:subscribe({"routine", "power_source_change", "system_woke"}, function()
-  sbar.exec("pmset -g batt", function(batt_info)
-    local icon = "!"
-    local label = "?"
+-- Battery state comes from sb_collect, which runs pmset once per read and publishes parsed fields
+sbar.exec("killall sb_collect >/dev/null; $CONFIG_DIR/helpers/event_providers/sb_collect/bin/sb_collect $CONFIG_DIR/helpers/event_providers/sb_collect/sketchybar.conf")
 
-    local found, _, charge = batt_info:find("(%d+)%%")
-    if found then
-      charge = tonumber(charge)
-      label = charge .. "%"
-    end
+local remaining = nil
+
+battery:subscribe("battery_update", function(env)
+  local icon = "!"
+  local label = "?"
 
-    local color = colors.green
-    local charging, _, _ = batt_info:find("AC Power")
+  local charge = tonumber(env.charge)
+  local found = charge ~= nil
+  if found then
+    label = charge .. "%"
+  end
 
-    if charging then
-      icon = icons.battery.charging
+  local color = colors.green
+  local charging = env.source == "AC Power"
+
+  if charging then
+    icon = icons.battery.charging
+  else
+    if found and charge > 80 then
+      icon = icons.battery._100
+    elseif found and charge > 60 then
+      icon = icons.battery._75
+    elseif found and charge > 40 then
+      icon = icons.battery._50
+    elseif found and charge > 20 then
+      icon = icons.battery._25
+      color = colors.orange
     else
-      if found and charge > 80 then
-        icon = icons.battery._100
-      elseif found and charge > 60 then
-        icon = icons.battery._75
-      elseif found and charge > 40 then
-        icon = icons.battery._50
-      elseif found and charge > 20 then
-        icon = icons.battery._25
-        color = colors.orange
-      else
-        icon = icons.battery._0
-        color = colors.red
-      end
+      icon = icons.battery._0
+      color = colors.red
     end
+  end
 
-    local lead = ""
-    if found and charge < 10 then
-      lead = "0"
-    end
+  local lead = ""
+  if found and charge < 10 then
+    lead = "0"
+  end
+
+  remaining = env.remaining ~= "" and env.remaining or nil
+
+  battery:set({
+    icon = {
+      string = icon,
+      color = color
+    },
+    label = { string = lead .. label },
+  })
+end)
 
-    battery:set({
-      icon = {
-        string = icon,
-        color = color
-      },
-      label = { string = lead .. label },
-    })
-  end)
+-- Power source changes and wake-ups ask sb_collect for an immediate read
+battery:subscribe({"power_source_change", "system_woke"}, function()
+  sbar.exec("killall -USR1 sb_collect >/dev/null")
 end)
 
 battery:subscribe("mouse.clicked", function(env)
@@ -82,11 +91,8 @@ battery:subscribe("mouse.clicked", function(env)
   battery:set( { popup = { drawing = "toggle" } })
 
   if drawing == "off" then
-    sbar.exec("pmset -g batt", function(batt_info)
-      local found, _, remaining = batt_info:find(" (%d+:%d+) remaining")
-      local label = found and remaining .. "h" or "No estimate"
-      remaining_time:set( { label = label })
-    end)
+    local label = remaining and remaining .. "h" or "No estimate"
+    remaining_time:set( { label = label })
   end
 end)
 
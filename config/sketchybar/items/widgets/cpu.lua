@@ -3,8 +3,17 @@ local colors = require("colors")
 local settings = require("settings")
 
 -- Execute the event provider binary which provides the event "cpu_update" for
--- the cpu load data, which is fired every 2.0 seconds.
-sbar.exec("killall cpu_load >/dev/null; $CONFIG_DIR/helpers/event_providers/cpu_load/bin/cpu_load cpu_update 2.0")
+-- the cpu load data, which is fired every 2.0 seconds. With --stats it also
+-- publishes rolling averages and p95 over 1/5/15 minutes, with --clusters the
+-- load of the performance and efficiency cores, clock speed and throttling.
+-- Sends are asynchronous, so the rolling windows keep their timestamps even
+-- while the bar is busy.
+sbar.exec("killall cpu_load >/dev/null; SKETCHYBAR_ASYNC=250 $CONFIG_DIR/helpers/event_providers/cpu_load/bin/cpu_load cpu_update 2.0 --stats --clusters")
+
+-- Execute the event provider binary which provides the event "proc_update"
+-- with the top 5 processes by cpu usage, fired every 2.0 seconds
+local top_count = 5
+sbar.exec("killall proc_top >/dev/null; $CONFIG_DIR/helpers/event_providers/proc_top/bin/proc_top proc_update 2.0 " .. top_count)
 
 local cpu = sbar.add("graph", "widgets.cpu" , 42, {
   position = "right",
@@ -28,11 +37,36 @@ local cpu = sbar.add("graph", "widgets.cpu" , 42, {
     width = 0,
     y_offset = 4
   },
-  padding_right = settings.paddings + 6
+  padding_right = settings.paddings + 6,
+  popup = { align = "center" }
 })
 
+-- One popup row per process of the top list
+local top_rows = {}
+for i = 1, top_count do
+  top_rows[i] = sbar.add("item", "widgets.cpu.top." .. i, {
+    position = "popup." .. cpu.name,
+    drawing = false,
+    icon = {
+      string = "?",
+      width = 160,
+      align = "left",
+    },
+    label = {
+      string = "??%",
+      font = { family = settings.font.numbers },
+      width = 60,
+      align = "right",
+    },
+  })
+end
+
 cpu:subscribe("cpu_update", function(env)
-  -- Also available: env.user_load, env.sys_load
+  -- Also available: env.user_load, env.sys_load, env.avg_1m, env.p95_1m,
+  -- env.avg_5m, env.p95_5m, env.avg_15m, env.p95_15m, env.clusters,
+  -- env.p_load, env.e_load (hybrid cpus only), env.freq_mhz (not on Apple
+  -- Silicon), env.freq_limit
+  local throttled = env.throttled == "1"
   local load = tonumber(env.total_load)
   cpu:push({ load / 100. })
 
@@ -49,12 +83,37 @@ cpu:subscribe("cpu_update", function(env)
 
   cpu:set({
     graph = { color = color },
+    icon = { color = throttled and colors.red or colors.white },
     label = "cpu " .. env.total_load .. "%",
   })
 end)
 
+cpu:subscribe("proc_update", function(env)
+  -- Also available: env.processes, env.pid_<i>
+  local count = tonumber(env.count) or 0
+  for i = 1, top_count do
+    if i <= count then
+      top_rows[i]:set({
+        drawing = true,
+        icon = { string = env["name_" .. i] },
+        label = { string = env["cpu_" .. i] .. "%" },
+      })
+    else
+      top_rows[i]:set({ drawing = false })
+    end
+  end
+end)
+
 cpu:subscribe("mouse.clicked", function(env)
-  sbar.exec("open -a 'Activity Monitor'")
+  if env.BUTTON == "right" then
+    sbar.exec("open -a 'Activity Monitor'")
+    return
+  end
+  cpu:set({ popup = { drawing = "toggle" } })
+end)
+
+cpu:subscribe("mouse.exited.global", function(env)
+  cpu:set({ popup = { drawing = false } })
 end)
 
 -- Background around the cpu item
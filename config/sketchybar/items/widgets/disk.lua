@@ -0,0 +1,95 @@
+local icons = require("icons")
+local colors = require("colors")
+local settings = require("settings")
+
+-- Execute the event provider binary which provides the event "disk_update"
+-- for all whole disks, which is fired every 2.0 seconds
+sbar.exec("killall disk_load >/dev/null; $CONFIG_DIR/helpers/event_providers/disk_load/bin/disk_load all disk_update 2.0")
+
+local disk_write = sbar.add("item", "widgets.disk1", {
+  position = "right",
+  padding_left = -5,
+  width = 0,
+  icon = {
+    padding_right = 0,
+    font = {
+      style = settings.font.style_map["Bold"],
+      size = 9.0,
+    },
+    string = icons.wifi.upload,
+  },
+  label = {
+    font = {
+      family = settings.font.numbers,
+      style = settings.font.style_map["Bold"],
+      size = 9.0,
+    },
+    color = colors.red,
+    string = "??? Bps",
+  },
+  y_offset = 4,
+})
+
+local disk_read = sbar.add("item", "widgets.disk2", {
+  position = "right",
+  padding_left = -5,
+  icon = {
+    padding_right = 0,
+    font = {
+      style = settings.font.style_map["Bold"],
+      size = 9.0,
+    },
+    string = icons.wifi.download,
+  },
+  label = {
+    font = {
+      family = settings.font.numbers,
+      style = settings.font.style_map["Bold"],
+      size = 9.0,
+    },
+    color = colors.blue,
+    string = "??? Bps",
+  },
+  y_offset = -4,
+})
+
+local disk = sbar.add("item", "widgets.disk.padding", {
+  position = "right",
+  icon = { string = icons.disk },
+  label = { drawing = false },
+})
+
+-- Background around the item
+sbar.add("bracket", "widgets.disk.bracket", {
+  disk.name,
+  disk_write.name,
+  disk_read.name
+}, {
+  background = { color = colors.bg1 },
+})
+
+sbar.add("item", { position = "right", width = settings.group_paddings })
+
+disk_write:subscribe("disk_update", function(env)
+  -- Also available: env.read_iops, env.write_iops, env.disks
+  local write_color = (env.write == "000 Bps") and colors.grey or colors.red
+  local read_color = (env.read == "000 Bps") and colors.grey or colors.blue
+  disk_write:set({
+    icon = { color = write_color },
+    label = {
+      string = env.write,
+      color = write_color
+    }
+  })
+  disk_read:set({
+    icon = { color = read_color },
+    label = {
+      string = env.read,
+      color = read_color
+    }
+  })
+end)
+
+disk:subscribe("mouse.clicked", function(env)
+  sbar.exec("open -a 'Activity Monitor'")
+end)
@@ -61,6 +61,36 @@ local function get_color(count)
   return color
 end
 
+-- Outdated packages as last synced from brew_check, keyed by name. Triggers carry only
+-- added/removed deltas from generation `base` to `generation`; the full list comes with full=1.
+local packages = {}
+local generation = nil
+
+local function sync_packages(env)
+  local gen = tonumber(env.generation)
+  if not gen then return end -- Manual trigger without provider data
+  if env.full == "1" then
+    packages = {}
+    for name in (env.pending_updates or ""):gmatch("[^,]+") do packages[name] = true end
+  elseif generation == tonumber(env.base) then
+    for name in (env.removed or ""):gmatch("[^,]+") do packages[name] = nil end
+    for name in (env.added or ""):gmatch("[^,]+") do packages[name] = true end
+  else
+    -- A trigger was missed: ask brew_check for the full list
+    generation = nil
+    safe_exec("pkill -USR2 -f 'brew_check' >/dev/null 2>&1")
+    return
+  end
+  generation = gen
+end
+local function package_list()
+  local names = {}
+  for name in pairs(packages) do table.insert(names, name) end
+  if #names == 0 then return "none" end
+  table.sort(names)
+  return table.concat(names, ",")
+end
+
 -- Start event provider (unchanged)
 start_event_provider()
 
@@ -85,6 +115,7 @@ local brew = sbar.add("item", CONFIG.widget_name, {
 
 -- Subscribe to update event (modified for robustness)
 brew:subscribe("brew_update", function(env)
+  sync_packages(env)
   local count = tonumber(env.outdated_count) or 0
   local color = get_color(count)
   
@@ -97,9 +128,23 @@ brew:subscribe("brew_update", function(env)
   -- Tooltip logic (unchanged from original version)
   local tooltip = ""
   local error_message = env.error or ""
-  if error_message ~= "" and error_message ~= "No error" then tooltip = "ERROR: " .. error_message .. "\n\n" end
+  if error_message:find("^Deferred: ") then
+    -- Update postponed by the busy gate, not a failure
+    tooltip = "Update " .. error_message:gsub("^Deferred", "deferred") .. "\n\n"
+  elseif error_message ~= "" and error_message ~= "No error" and error_message ~= "Success" then
+    tooltip = "ERROR: " .. error_message .. "\n\n"
+  end
   if count > 0 then
-    tooltip = tooltip .. "Packages to update: " .. (env.pending_updates or "none")
+    tooltip = tooltip .. "Packages to update: " .. package_list()
+    -- Per-manager counts when brew_check watches more than one package manager
+    local managers = env.managers or ""
+    if managers:find(" ") then
+      local counts = {}
+      for name in managers:gmatch("%S+") do
+        table.insert(counts, name .. " " .. (env["outdated_" .. name] or "0"))
+      end
+      tooltip = tooltip .. "\n" .. table.concat(counts, ", ")
+    end
     local last_check = tonumber(env.last_check) or 0
     if last_check > 0 then
       local time_diff = os.time() - last_check
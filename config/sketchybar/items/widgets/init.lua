@@ -2,4 +2,6 @@ require("items.widgets.battery")
 require("items.widgets.volume")
 require("items.widgets.wifi")
 require("items.widgets.cpu")
+require("items.widgets.memory")
+require("items.widgets.disk")
 require("items.widgets.homebrew")
@@ -0,0 +1,102 @@
+local icons = require("icons")
+local colors = require("colors")
+local settings = require("settings")
+
+-- Execute the event provider binary which provides the event "mem_update"
+-- with memory, compression, swap and pressure, sampled every 2.0 seconds.
+-- The trigger only fires when one of the published values changes.
+sbar.exec("killall mem_load >/dev/null; $CONFIG_DIR/helpers/event_providers/mem_load/bin/mem_load mem_update 2.0")
+
+local pressure_colors = {
+  normal = colors.green,
+  warn = colors.orange,
+  critical = colors.red,
+}
+
+local memory = sbar.add("graph", "widgets.memory", 42, {
+  position = "right",
+  graph = { color = colors.green },
+  background = {
+    height = 22,
+    color = { alpha = 0 },
+    border_color = { alpha = 0 },
+    drawing = true,
+  },
+  icon = { string = icons.memory },
+  label = {
+    string = "mem ??%",
+    font = {
+      family = settings.font.numbers,
+      style = settings.font.style_map["Bold"],
+      size = 9.0,
+    },
+    align = "right",
+    padding_right = 0,
+    width = 0,
+    y_offset = 4
+  },
+  padding_right = settings.paddings + 6,
+  popup = { align = "center" }
+})
+
+local function popup_row(name, title)
+  return sbar.add("item", "widgets.memory." .. name, {
+    position = "popup." .. memory.name,
+    icon = { string = title, width = 110, align = "left" },
+    label = {
+      string = "??",
+      font = { family = settings.font.numbers },
+      width = 110,
+      align = "right",
+    },
+  })
+end
+
+local used_row = popup_row("used", "Used")
+local compressed_row = popup_row("compressed", "Compressed")
+local swap_row = popup_row("swap", "Swap")
+local pressure_row = popup_row("pressure", "Pressure")
+
+memory:subscribe("mem_update", function(env)
+  local load = tonumber(env.used_pct) or 0
+  local color = pressure_colors[env.pressure] or colors.green
+  memory:push({ load / 100. })
+
+  memory:set({
+    graph = { color = color },
+    icon = { color = env.pressure == "normal" and colors.white or color },
+    label = "mem " .. env.used_pct .. "%",
+  })
+
+  used_row:set({ label = env.used .. " GiB" })
+  compressed_row:set({ label = env.compressed .. " GiB" })
+  swap_row:set({ label = env.swap_used .. " / " .. env.swap_total .. " GiB" })
+  -- psi_some and psi_full are only published on Linux with PSI
+  local pressure = env.pressure
+  if env.psi_some ~= nil and env.psi_some ~= "" then
+    pressure = pressure .. " (" .. env.psi_some .. "%)"
+  end
+  pressure_row:set({ label = { string = pressure, color = color } })
+end)
+
+memory:subscribe("mouse.clicked", function(env)
+  if env.BUTTON == "right" then
+    sbar.exec("open -a 'Activity Monitor'")
+    return
+  end
+  memory:set({ popup = { drawing = "toggle" } })
+end)
+
+memory:subscribe("mouse.exited.global", function(env)
+  memory:set({ popup = { drawing = false } })
+end)
+
+-- Background around the memory item
+sbar.add("bracket", "widgets.memory.bracket", { memory.name }, {
+  background = { color = colors.bg1 }
+})
+
+sbar.add("item", "widgets.memory.padding", {
+  position = "right",
+  width = settings.group_paddings
+})
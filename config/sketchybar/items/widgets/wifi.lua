@@ -3,8 +3,18 @@ local colors = require("colors")
 local settings = require("settings")
 
 -- Execute the event provider binary which provides the event "network_update"
--- for the network interface "en0", which is fired every 2.0 seconds.
-sbar.exec("killall network_load >/dev/null; $CONFIG_DIR/helpers/event_providers/network_load/bin/network_load en0 network_update 2.0")
+-- for the network interface "en0", which is fired every 2.0 seconds. The
+-- counters are sampled every 100ms so that bursts survive the aggregation;
+-- SKETCHYBAR_ASYNC hands the triggers to a sender thread (250ms send timeout)
+-- so a busy bar never stalls the sampling loop. More than 10 dropped or 5
+-- errored packets per second fire "network_update_alert" once, and again on
+-- recovery.
+sbar.exec("killall network_load >/dev/null; SKETCHYBAR_ASYNC=250 $CONFIG_DIR/helpers/event_providers/network_load/bin/network_load en0 network_update 2.0 100 --max-drops 10 --max-errors 5")
+
+-- Execute the event provider binary which provides the event "net_top_update"
+-- with the top 3 processes by network traffic, fired every 2.0 seconds
+local talker_count = 3
+sbar.exec("killall net_top >/dev/null; $CONFIG_DIR/helpers/event_providers/net_top/bin/net_top net_top_update 2.0 " .. talker_count)
 
 local popup_width = 250
 
@@ -152,9 +162,31 @@ local router = sbar.add("item", {
   },
 })
 
+-- One popup row per process of the top talkers list
+local talker_rows = {}
+for i = 1, talker_count do
+  talker_rows[i] = sbar.add("item", "widgets.wifi.talker." .. i, {
+    position = "popup." .. wifi_bracket.name,
+    drawing = false,
+    icon = {
+      align = "left",
+      string = "?",
+      width = popup_width / 2,
+    },
+    label = {
+      string = "??? Bps",
+      font = { family = settings.font.numbers },
+      width = popup_width / 2,
+      align = "right",
+    },
+  })
+end
+
 sbar.add("item", { position = "right", width = settings.group_paddings })
 
 wifi_up:subscribe("network_update", function(env)
+  -- Also available: env.upload_peak, env.download_peak, env.upload_p95, env.download_p95,
+  -- env.rx_pps, env.tx_pps, env.rx_errors, env.tx_errors, env.rx_drops, env.tx_drops
   local up_color = (env.upload == "000 Bps") and colors.grey or colors.red
   local down_color = (env.download == "000 Bps") and colors.grey or colors.blue
   wifi_up:set({
@@ -173,6 +205,27 @@ wifi_up:subscribe("network_update", function(env)
   })
 end)
 
+wifi:subscribe("network_update_alert", function(env)
+  -- env.reason is "drops", "errors" or "drops,errors" while state is "spike"
+  wifi:set({ icon = { color = env.state == "spike" and colors.orange or colors.white } })
+end)
+
+wifi:subscribe("net_top_update", function(env)
+  -- Also available: env.pid_<i>, env.active, env.unresolved, env.other_up, env.other_down
+  local count = tonumber(env.count) or 0
+  for i = 1, talker_count do
+    if i <= count then
+      talker_rows[i]:set({
+        drawing = true,
+        icon = { string = env["name_" .. i] },
+        label = { string = env["up_" .. i] .. " / " .. env["down_" .. i] },
+      })
+    else
+      talker_rows[i]:set({ drawing = false })
+    end
+  end
+end)
+
 wifi:subscribe({"wifi_change", "system_woke"}, function(env)
   sbar.exec("ipconfig getifaddr en0", function(ip)
     local connected = not (ip == "")